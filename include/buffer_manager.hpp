@@ -1,9 +1,12 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <vector>
 #include <memory>
 #include <cstring>
+#include "lockfree_ring.hpp"
 
 namespace mpquic_fec {
 
@@ -32,29 +35,93 @@ public:
      * @brief 读取数据
      */
     const uint8_t* data() const { return data_.get(); }
+    uint8_t* mutable_data() { return data_.get(); }
     uint32_t size() const { return size_; }
     uint32_t capacity() const { return capacity_; }
 
+    /**
+     * @brief 设置数据长度（调用方已通过mutable_data()写入内容）
+     */
+    void resize(uint32_t size);
+
     /**
      * @brief 重置缓冲区
      */
     void reset();
 
 private:
-    std::unique_ptr<uint8_t[]> data_;
+    friend class BufferPool;
+
+    static constexpr uint8_t kNoSizeClass = 0xFF;
+
+    /**
+     * @brief 存储释放器：池内存储归还HugePageArena，其余delete[]
+     */
+    struct StorageDeleter {
+        uint32_t arena_bytes = 0;
+        void operator()(uint8_t* ptr) const;
+    };
+
+    /**
+     * @brief 接管池中的存储（仅BufferPool使用）
+     */
+    Buffer(uint8_t* storage, uint32_t capacity, uint8_t size_class);
+
+    std::unique_ptr<uint8_t[], StorageDeleter> data_;
     uint32_t size_ = 0;
     uint32_t capacity_;
+    uint8_t size_class_ = kNoSizeClass;   // 所属尺寸档，池外分配为kNoSizeClass
 };
 
 /**
  * @brief 缓冲区池，用于重用内存
+ * 
+ * 存储以slab为单位（一次kMagazineBatch个）从HugePageArena分配。
+ * 按尺寸分档（MTU / Jumbo帧 / GSO块），每档两级缓存：
+ * - 线程本地弹匣：acquire/release 的快速路径，无锁无原子操作
+ * - 全局无锁仓库：弹匣空时批量补充，溢出时批量归还
+ * 
+ * 仓库超过高水位的部分直接释放，避免突发流量后长期占用内存。
+ * 稳态下 acquire/release 在弹匣与仓库之间循环，不触发堆分配；
+ * 超过最大档的请求退化为普通分配，归还时直接释放
  */
 class BufferPool {
 public:
+    static constexpr size_t kNumSizeClasses = 3;
+    static constexpr std::array<uint32_t, kNumSizeClasses> kSizeClasses = {
+        1500,    // 以太网MTU
+        9000,    // Jumbo帧
+        65536    // GSO/GRO聚合块
+    };
+
+    static constexpr size_t kMagazineBatch = 32;      // 弹匣与仓库之间的批量大小
+    static constexpr size_t kMagazineCapacity = 2 * kMagazineBatch;
+    static constexpr size_t kDepotCapacity = 8192;    // 每档仓库容量（高水位上限）
+    static constexpr size_t kDefaultHighWater = 1024; // 每档仓库默认保留的缓冲区数
+
+    /**
+     * @brief 池统计（仅统计慢路径事件，快速路径不计数）
+     */
+    struct Statistics {
+        uint64_t heap_allocations = 0;     // 池内档位新分配的缓冲区数（来自Arena slab）
+        uint64_t heap_frees = 0;           // 高水位修剪与溢出归还Arena的缓冲区数
+        uint64_t depot_refills = 0;        // 弹匣从仓库批量补充次数
+        uint64_t depot_spills = 0;         // 弹匣向仓库批量归还次数
+        uint64_t oversize_allocations = 0; // 超过最大档的直接分配次数
+        std::array<size_t, kNumSizeClasses> depot_buffers{};  // 各档仓库当前缓冲区数
+    };
+
     static BufferPool& instance();
 
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
     /**
      * @brief 获取一个缓冲区
+     * 
+     * 返回容量不小于size的最小档位缓冲区
      */
     Buffer acquire(uint32_t size);
 
@@ -63,9 +130,91 @@ public:
      */
     void release(Buffer&& buffer);
 
+    /**
+     * @brief 预先为某档位分配count个缓冲区放入仓库，使之后的收发不再分配
+     */
+    void reserve(uint32_t size, size_t count);
+
+    /**
+     * @brief 设置各档仓库的高水位，并立即修剪超出部分
+     */
+    void set_high_water(size_t max_buffers_per_class);
+
+    /**
+     * @brief 将仓库修剪到高水位以下
+     * @return 释放的缓冲区数
+     */
+    size_t trim();
+
+    Statistics get_statistics() const;
+
+    /**
+     * @brief 返回容纳size字节的最小档位，超过最大档时返回kNumSizeClasses
+     */
+    static size_t size_class_for(uint32_t size);
+
+private:
+    /**
+     * @brief 线程本地弹匣，线程退出时把缓存归还仓库
+     */
+    struct Magazine {
+        std::array<std::array<uint8_t*, kMagazineCapacity>, kNumSizeClasses> slots;
+        std::array<size_t, kNumSizeClasses> counts{};
+
+        ~Magazine();
+    };
+
+    BufferPool();
+
+    static Magazine& local_magazine();
+
+    size_t refill(Magazine& magazine, size_t size_class);
+    void allocate_slab(Magazine& magazine, size_t size_class);
+    static void free_storage(uint8_t* storage, size_t size_class);
+    void spill(Magazine& magazine, size_t size_class, size_t count);
+    size_t trim_class(size_t size_class, size_t keep);
+
+    std::array<std::unique_ptr<LockFreeRing<uint8_t*>>, kNumSizeClasses> depots_;
+    std::atomic<size_t> high_water_;
+
+    std::atomic<uint64_t> heap_allocations_;
+    std::atomic<uint64_t> heap_frees_;
+    std::atomic<uint64_t> depot_refills_;
+    std::atomic<uint64_t> depot_spills_;
+    std::atomic<uint64_t> oversize_allocations_;
+};
+
+/**
+ * @brief 从BufferPool取得、析构时归还池中的缓冲区
+ *
+ * 用作容器元素（发送队列、接收组缓存），元素销毁即回收存储
+ */
+class PooledBuffer {
+public:
+    /**
+     * @brief 取一个容量不小于size的缓冲区，长度为size（内容未初始化）
+     */
+    explicit PooledBuffer(uint32_t size);
+
+    /**
+     * @brief 取缓冲区并拷入data
+     */
+    PooledBuffer(const uint8_t* data, uint32_t size);
+
+    ~PooledBuffer();
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+    PooledBuffer(PooledBuffer&&) noexcept = default;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+
+    const uint8_t* data() const { return buffer_.data(); }
+    uint8_t* mutable_data() { return buffer_.mutable_data(); }
+    uint32_t size() const { return buffer_.size(); }
+    uint32_t capacity() const { return buffer_.capacity(); }
+
 private:
-    BufferPool() = default;
-    std::vector<Buffer> pool_;
+    Buffer buffer_;
 };
 
 } // namespace mpquic_fec
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace mpquic_fec {
+
+/**
+ * @brief 读取时间戳计数器：x86上为TSC，其他平台退化为steady_clock纳秒
+ */
+inline uint64_t read_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/**
+ * @brief steady_clock微秒（时间基准）
+ */
+inline uint64_t steady_now_us() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief 时间源接口（微秒，单调递增，与steady_clock同一纪元）
+ */
+class ClockSource {
+public:
+    virtual ~ClockSource() = default;
+    virtual uint64_t now_us() = 0;
+};
+
+/**
+ * @brief 以TSC为读数、定期对齐steady_clock的时间源
+ *
+ * 每次读取只有一条rdtsc和一次乘加；每隔 kRecalibrateUs 由碰上的读取线程
+ * 重新锚定一次，把与steady_clock的偏差在下一个间隔内平滑消化（速率始终为正，
+ * 读数不会回退）。校准完成前直接返回steady_clock
+ */
+class TscClock : public ClockSource {
+public:
+    TscClock();
+
+    uint64_t now_us() override;
+
+    /**
+     * @brief 当前估计的每微秒tick数（未校准时为0）
+     */
+    double ticks_per_us() const;
+
+private:
+    static constexpr uint64_t kInitialCalibrationUs = 1000;
+    static constexpr uint64_t kRecalibrateUs = 50000;
+
+    // 锚点：读数 = base_us + (ticks - base_ticks) * us_per_tick
+    struct Anchor {
+        uint64_t base_ticks;
+        uint64_t base_us;
+        double us_per_tick;
+        uint64_t recalibrate_ticks;   // 超过该tick后重新锚定
+    };
+
+    static uint64_t extrapolate(const Anchor& anchor, uint64_t ticks);
+    Anchor load_anchor() const;
+    void store_anchor(const Anchor& anchor);
+    uint64_t recalibrate(uint64_t ticks);
+
+    // 锚点以seqlock发布：写者持mutex_，读者遇到奇数或变化的序号时重读
+    std::atomic<uint64_t> seq_{0};
+    std::atomic<uint64_t> base_ticks_{0};
+    std::atomic<uint64_t> base_us_{0};
+    std::atomic<double> us_per_tick_{0.0};
+    std::atomic<uint64_t> recalibrate_ticks_{0};
+
+    std::mutex mutex_;
+    const uint64_t origin_ticks_;
+    const uint64_t origin_us_;
+};
+
+/**
+ * @brief 手动推进的时间源，用于仿真与确定性回放
+ */
+class VirtualClock : public ClockSource {
+public:
+    explicit VirtualClock(uint64_t start_us = 0) : now_us_(start_us) {}
+
+    uint64_t now_us() override {
+        return now_us_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 设置当前时间（不允许回退，早于当前时间的值被忽略）
+     */
+    void set(uint64_t now_us);
+
+    void advance(uint64_t delta_us) {
+        now_us_.fetch_add(delta_us, std::memory_order_acq_rel);
+    }
+
+private:
+    std::atomic<uint64_t> now_us_;
+};
+
+/**
+ * @brief 进程级时钟入口
+ *
+ * 数据面所有时间戳都经由 Clock::now_us() 读取；默认时间源是TscClock，
+ * 仿真时用 set_source() 换成VirtualClock。线程处于ClockBatch作用域内时
+ * 返回批次开始时缓存的时刻，一批事件只读一次时钟
+ */
+class Clock {
+public:
+    static uint64_t now_us() {
+        if (batch_depth_ > 0) {
+            return batch_now_us_;
+        }
+        return source().now_us();
+    }
+
+    /**
+     * @brief 替换进程时间源，nullptr恢复默认的TscClock
+     *
+     * 旧时间源不会被释放，正在读取它的线程不受影响
+     */
+    static void set_source(std::shared_ptr<ClockSource> source);
+
+    /**
+     * @brief 默认的TSC时间源
+     */
+    static TscClock& tsc();
+
+private:
+    friend class ClockBatch;
+
+    static ClockSource& source() {
+        ClockSource* current = source_.load(std::memory_order_acquire);
+        return current ? *current : tsc();
+    }
+
+    // nullptr表示默认时间源（常量初始化，静态构造期间读取也安全）
+    static inline std::atomic<ClockSource*> source_{nullptr};
+    static inline thread_local uint32_t batch_depth_ = 0;
+    static inline thread_local uint64_t batch_now_us_ = 0;
+};
+
+/**
+ * @brief 批次时钟作用域：构造时读一次时钟，作用域内本线程的 Clock::now_us() 都返回该值
+ *
+ * 嵌套时沿用最外层的时刻；不要跨越阻塞等待持有
+ */
+class ClockBatch {
+public:
+    ClockBatch() {
+        if (Clock::batch_depth_++ == 0) {
+            Clock::batch_now_us_ = Clock::source().now_us();
+        }
+    }
+
+    ~ClockBatch() {
+        --Clock::batch_depth_;
+    }
+
+    ClockBatch(const ClockBatch&) = delete;
+    ClockBatch& operator=(const ClockBatch&) = delete;
+
+    uint64_t now_us() const { return Clock::batch_now_us_; }
+};
+
+} // namespace mpquic_fec
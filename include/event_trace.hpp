@@ -0,0 +1,218 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mpquic_fec {
+
+/**
+ * @brief 事件类型（写入文件，数值不可更改）
+ */
+enum class TraceEventType : uint16_t {
+    PACKET_SENT = 1,      // value=包号, flags&kTraceRepair 表示冗余包
+    PACKET_ACKED = 2,     // value=RTT(us)
+    PACKET_LOST = 3,      // value=包号
+    GROUP_DECODED = 4,    // value=由冗余块重建的源块数
+    PARAMS_UPDATED = 5,   // k/m=新参数, value=冗余率×1e6, group_id=流槽位
+    PATH_SWITCH = 6       // path_id=新源路径, value=旧源路径
+};
+
+/**
+ * @brief 定长32字节事件记录（文件格式即内存布局，小端）
+ */
+struct TraceRecord {
+    uint64_t time_ns;       // 相对追踪开始的单调时钟
+    uint64_t group_id;
+    uint64_t value;
+    uint16_t type;          // TraceEventType
+    uint16_t path_id;
+    uint8_t block_index;
+    uint8_t k;
+    uint8_t m;
+    uint8_t flags;
+};
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord must stay 32 bytes");
+
+constexpr uint8_t kTraceRepair = 0x01;
+
+/**
+ * @brief 追踪文件头（64字节），其后紧跟TraceRecord数组
+ */
+struct TraceFileHeader {
+    char magic[8];              // "MPQFECEV"
+    uint32_t version;
+    uint32_t record_size;
+    int64_t start_unix_ns;      // time_ns=0 对应的系统时间
+    uint64_t record_count;      // 关闭时回填
+    uint8_t reserved[32];
+};
+static_assert(sizeof(TraceFileHeader) == 64, "TraceFileHeader must stay 64 bytes");
+
+/**
+ * @brief 二进制事件追踪器
+ *
+ * 每个线程首次记录时注册一个单生产者环形缓冲区，记录路径上只有一次
+ * 时钟读取和一次环形写入；后台线程定期把各线程缓冲区搬运到
+ * 内存映射文件。环形满时丢弃并计数，不阻塞数据面。
+ *
+ * 记录开关可在运行时切换（set_enabled），关闭时记录路径只剩一次原子读。
+ * 生成的文件由 trace2qlog 转换为qlog JSON
+ */
+class EventTracer {
+public:
+    static constexpr char kMagic[8] = {'M', 'P', 'Q', 'F', 'E', 'C', 'E', 'V'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kThreadRingRecords = 8192;
+    static constexpr size_t kFileGrowBytes = 4 * 1024 * 1024;
+
+    struct Statistics {
+        uint64_t records_written = 0;
+        uint64_t records_dropped = 0;
+        size_t threads = 0;
+    };
+
+    /**
+     * @brief 全局追踪器（有意不析构：线程退出时仍会访问），进程退出时自动stop()
+     */
+    static EventTracer& instance();
+
+    EventTracer(const EventTracer&) = delete;
+    EventTracer& operator=(const EventTracer&) = delete;
+
+    /**
+     * @brief 打开追踪文件并开始记录
+     * @throws std::runtime_error 文件无法创建或映射时
+     */
+    void start(const std::string& path);
+
+    /**
+     * @brief 若设置了环境变量 MPQUIC_FEC_EVENT_TRACE，则以其值为路径开始记录
+     * @return 是否已开始记录
+     */
+    bool start_from_env();
+
+    /**
+     * @brief 停止记录，写出剩余事件并关闭文件
+     */
+    void stop();
+
+    /**
+     * @brief 运行时暂停/恢复记录（文件保持打开）
+     */
+    void set_enabled(bool enabled) {
+        enabled_.store(enabled && sink_open_.load(std::memory_order_acquire),
+                       std::memory_order_release);
+    }
+
+    bool enabled() const {
+        return enabled_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 记录一个事件（热路径）
+     */
+    void record(TraceEventType type, uint64_t group_id, uint32_t path_id, uint64_t value,
+                uint8_t block_index = 0, uint8_t k = 0, uint8_t m = 0, uint8_t flags = 0) {
+        if (!enabled()) {
+            return;
+        }
+
+        TraceRecord rec;
+        rec.time_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count() - start_steady_ns_);
+        rec.group_id = group_id;
+        rec.value = value;
+        rec.type = static_cast<uint16_t>(type);
+        rec.path_id = static_cast<uint16_t>(path_id);
+        rec.block_index = block_index;
+        rec.k = k;
+        rec.m = m;
+        rec.flags = flags;
+        local_buffer().push(rec);
+    }
+
+    Statistics get_statistics() const;
+
+private:
+    /**
+     * @brief 单生产者（所属线程）/单消费者（搬运线程）环形缓冲区
+     */
+    struct ThreadBuffer {
+        alignas(64) std::atomic<uint64_t> head{0};   // 生产者写入位置
+        alignas(64) std::atomic<uint64_t> tail{0};   // 消费者读取位置
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> retired{false};             // 所属线程已退出
+        TraceRecord records[kThreadRingRecords];
+
+        void push(const TraceRecord& rec) {
+            uint64_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) >= kThreadRingRecords) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            records[h % kThreadRingRecords] = rec;
+            head.store(h + 1, std::memory_order_release);
+        }
+    };
+
+    /**
+     * @brief 线程退出时标记缓冲区，由搬运线程排空后回收
+     */
+    struct ThreadBufferHandle {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~ThreadBufferHandle();
+    };
+
+    EventTracer() = default;
+
+    ThreadBuffer& local_buffer();
+
+    void run_flusher();
+    size_t drain_buffers();
+    void append_records(const TraceRecord* records, size_t count);
+    bool map_window();
+    void close_sink();
+
+    std::atomic<bool> enabled_{false};
+    std::atomic<bool> sink_open_{false};
+    bool exit_hook_registered_ = false;
+    int64_t start_steady_ns_ = 0;
+
+    // 线程缓冲区注册表
+    mutable std::mutex buffers_mutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+    uint64_t retired_dropped_ = 0;
+
+    // 内存映射文件：按kFileGrowBytes窗口推进
+    std::mutex sink_mutex_;
+    int fd_ = -1;
+    uint8_t* window_ = nullptr;
+    size_t window_offset_ = 0;   // 窗口在文件中的起始偏移
+    size_t window_used_ = 0;
+    std::atomic<uint64_t> records_written_{0};
+
+    // 搬运线程
+    std::thread flusher_;
+    std::atomic<bool> flusher_running_{false};
+    std::mutex flusher_mutex_;
+    std::condition_variable flusher_cv_;
+};
+
+/**
+ * @brief 事件记录便捷函数
+ */
+inline void trace_event(TraceEventType type, uint64_t group_id, uint32_t path_id,
+                        uint64_t value, uint8_t block_index = 0, uint8_t k = 0,
+                        uint8_t m = 0, uint8_t flags = 0) {
+    EventTracer::instance().record(type, group_id, path_id, value, block_index, k, m, flags);
+}
+
+} // namespace mpquic_fec
@@ -6,11 +6,19 @@
 
 namespace mpquic_fec {
 
+/**
+ * @brief GF(2^8)下一个编码组的块数上限（k+m）
+ */
+constexpr uint32_t kMaxFECBlocks = 256;
+
 /**
  * @brief FEC编码器 - 基于Reed-Solomon纠删码
  * 
  * 使用 k 个数据块生成 m 个冗余块，总共 n=k+m 块
  * 可以容忍任意 m 个块丢失
+ * 
+ * GF(2^8) 上的系统Cauchy码，编码矩阵与ISA-L的
+ * gf_gen_cauchy1_matrix 一致，要求 k+m <= 256
  */
 class FECEncoder {
 public:
@@ -30,6 +38,13 @@ public:
     std::vector<std::vector<uint8_t>> encode(
         const std::vector<std::vector<uint8_t>>& data_blocks);
 
+    /**
+     * @brief 编码数据块，冗余块直接写入调用方提供的存储（各块均为block_size字节）
+     * @param data_blocks k个数据块的地址
+     * @param parity_blocks m个冗余块的地址
+     */
+    void encode(const uint8_t* const* data_blocks, uint8_t* const* parity_blocks);
+
     uint32_t get_k() const { return k_; }
     uint32_t get_m() const { return m_; }
     uint32_t get_block_size() const { return block_size_; }
@@ -38,7 +53,7 @@ private:
     uint32_t k_;           // 数据块数
     uint32_t m_;           // 冗余块数
     uint32_t block_size_;  // 块大小
-    void* encode_matrix_;  // 编码矩阵（ISA-L使用）
+    std::vector<uint8_t> encode_matrix_;  // 冗余部分的编码矩阵（m×k）
 };
 
 /**
@@ -53,17 +68,27 @@ public:
      * @brief 解码恢复丢失的数据块
      * @param received_blocks 接收到的块（可能包含数据块和冗余块）
      * @param block_ids 每个块的ID (0到k-1是数据块, k到n-1是冗余块)
-     * @return 恢复的完整数据块
+     * @return 恢复的完整数据块（按块索引0到k-1排列）
      */
     std::vector<std::vector<uint8_t>> decode(
         const std::vector<std::vector<uint8_t>>& received_blocks,
         const std::vector<uint32_t>& block_ids);
 
+    /**
+     * @brief 上一次解码中由冗余块重建的数据块数
+     */
+    uint32_t last_recovered_count() const { return last_recovered_count_; }
+
 private:
     uint32_t k_;
     uint32_t m_;
     uint32_t block_size_;
-    void* decode_matrix_;
+    std::vector<uint8_t> encode_matrix_;   // 与编码端相同的m×k矩阵
+    
+    // 最近一次丢失模式的逆矩阵缓存（相同丢失模式连续出现时免去求逆）
+    std::vector<uint32_t> cached_rows_;
+    std::vector<uint8_t> decode_matrix_;
+    uint32_t last_recovered_count_;
 };
 
 } // namespace mpquic_fec
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "hugepage_arena.hpp"
+#include "memory_accounting.hpp"
 #include <cstdint>
+#include <deque>
 #include <vector>
 #include <memory>
 #include <map>
@@ -37,21 +40,46 @@ struct FECGroupInfo {
         : group_id(gid), k(k_val), m(m_val), block_size(bs), timestamp_us(ts) {}
 };
 
+/**
+ * @brief 组ID布局：高16位为流槽位，低48位为流内组序号（从1开始）
+ * 
+ * 各流的编码组序列相互独立，接收端据此按流重组
+ */
+constexpr uint32_t kGroupSequenceBits = 48;
+constexpr uint64_t kGroupSequenceMask = (uint64_t(1) << kGroupSequenceBits) - 1;
+
+inline uint64_t make_stream_group_id(uint32_t stream_slot, uint64_t sequence) {
+    return (static_cast<uint64_t>(stream_slot) << kGroupSequenceBits) |
+           (sequence & kGroupSequenceMask);
+}
+
+inline uint32_t group_stream_slot(uint64_t group_id) {
+    return static_cast<uint32_t>(group_id >> kGroupSequenceBits);
+}
+
+inline uint64_t group_sequence(uint64_t group_id) {
+    return group_id & kGroupSequenceMask;
+}
+
 /**
  * @brief FEC帧头部结构
  * 
  * 包含FEC帧的元数据信息
  */
 struct FECFrameHeader {
-    FrameType frame_type;      // 帧类型（SOURCE或REPAIR）
-    uint64_t group_id;         // 编码组ID
-    uint32_t block_index;      // 块在组内的索引
-    uint32_t total_blocks;     // 组内总块数（k+m）
-    uint32_t payload_length;   // payload长度
+    FrameType frame_type = FrameType::STREAM_FRAME;  // 帧类型（SOURCE或REPAIR）
+    uint64_t group_id = 0;         // 编码组ID
+    uint32_t block_index = 0;      // 块在组内的索引
+    uint32_t total_blocks = 0;     // 组内总块数（k+m）
+    uint32_t payload_length = 0;   // payload长度
+    uint32_t source_blocks = 0;    // 组内源块数k（0表示未知，接收端需推断）
     
     // 序列化到字节流
     std::vector<uint8_t> serialize() const;
     
+    // 序列化到out（至少HEADER_SIZE字节）
+    void serialize_to(uint8_t* out) const;
+    
     // 从字节流反序列化
     static FECFrameHeader deserialize(const uint8_t* data, size_t len);
     
@@ -64,7 +92,7 @@ struct FECFrameHeader {
  */
 struct FECFrame {
     FECFrameHeader header;
-    std::vector<uint8_t> payload;
+    ArenaBytes payload;          // 负载分配自HugePageArena
     
     // 获取完整帧大小
     size_t total_size() const {
@@ -74,6 +102,9 @@ struct FECFrame {
     // 序列化整个帧
     std::vector<uint8_t> serialize() const;
     
+    // 序列化到out（至少total_size()字节），返回写入的字节数
+    size_t serialize_to(uint8_t* out) const;
+    
     // 反序列化
     static FECFrame deserialize(const uint8_t* data, size_t len);
     
@@ -117,13 +148,35 @@ public:
     // 根据group id查找该组的所有包
     std::vector<PacketMapping> find_by_group(uint64_t group_id);
     
-    // 清理过期映射（避免内存泄漏）
-    void cleanup_old_mappings(uint64_t before_group_id);
+    // 清理 [from_group_id, before_group_id) 范围内的过期映射（避免内存泄漏）
+    void cleanup_old_mappings(uint64_t before_group_id, uint64_t from_group_id = 0);
+    
+    // 按登记顺序从最早的组开始驱逐映射，直到释放至少bytes字节，返回实际释放的字节数
+    size_t evict_oldest(size_t bytes);
+    
+    // 设置内存账户（记在 MemoryTag::PACKET_MAPPING 下）
+    void set_memory_account(std::shared_ptr<MemoryAccount> account) {
+        memory_account_ = std::move(account);
+    }
     
 private:
+    // 单个映射的估算占用：两个索引各一份PacketMapping
+    static constexpr size_t kMappingBytes =
+        2 * sizeof(PacketMapping) + sizeof(std::pair<uint32_t, uint64_t>) + kMapNodeOverhead;
+    static constexpr size_t kGroupBytes =
+        sizeof(uint64_t) + sizeof(std::vector<PacketMapping>) + kMapNodeOverhead;
+    
+    // 删除一个组的全部映射，返回释放的字节数
+    size_t erase_group(std::map<uint64_t, std::vector<PacketMapping>>::iterator it);
+    
     // 使用组合键存储映射
     std::map<std::pair<uint32_t, uint64_t>, PacketMapping> pkt_to_mapping_;
     std::map<uint64_t, std::vector<PacketMapping>> group_to_mappings_;
+    
+    // 组的登记顺序（驱逐用；可能含已清理的组ID，驱逐时跳过）
+    std::deque<uint64_t> group_order_;
+    
+    std::shared_ptr<MemoryAccount> memory_account_;
 };
 
 } // namespace mpquic_fec
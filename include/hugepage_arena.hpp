@@ -0,0 +1,203 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace mpquic_fec {
+
+/**
+ * @brief 大页内存Arena
+ *
+ * 以2MB为单位向内核申请内存块，依次尝试：
+ * 1. mmap(MAP_HUGETLB)：显式大页（需预留 vm.nr_hugepages）
+ * 2. 普通mmap + madvise(MADV_HUGEPAGE)：透明大页
+ * 3. 普通mmap：以上都不可用时透明回退
+ *
+ * 两级分配，快速路径不加锁：
+ * - 线程缓存：每线程从2MB块切出 kThreadChunkSize 的私有段做指针碰撞分配，
+ *   不超过 kMaxCachedAllocation 的释放挂入线程本地空闲链表复用
+ * - 全局：线程段的补充、空闲链表超过 kThreadCacheCapacity 时的批量归还
+ *   以及更大的请求在全局锁下完成
+ *
+ * 内存不归还内核。超过 kMaxSmallAllocation 的请求单独映射、释放时直接munmap。
+ *
+ * FEC编码组（含源块与冗余块负载）、接收组和BufferPool的slab都从这里分配，
+ * 使 (k+m)×block_size 的工作集集中在少量大页上，降低dTLB缺失
+ */
+class HugePageArena {
+public:
+    static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+    static constexpr size_t kAlignment = 64;
+    static constexpr size_t kMaxSmallAllocation = kHugePageSize / 4;
+    static constexpr size_t kThreadChunkSize = 256 * 1024;
+    static constexpr size_t kMaxCachedAllocation = 16 * 1024;
+    static constexpr size_t kThreadCacheBatch = 32;       // 线程缓存与全局之间的批量大小
+    static constexpr size_t kThreadCacheCapacity = 2 * kThreadCacheBatch;
+
+    /**
+     * @brief Arena占用统计
+     *
+     * 分配计数按线程批量汇总，可能滞后各线程最近的少量操作
+     */
+    struct Statistics {
+        uint64_t mapped_bytes = 0;        // 向内核申请的总字节数
+        uint64_t hugetlb_bytes = 0;       // 累计以MAP_HUGETLB显式大页映射的字节数
+        uint64_t thp_bytes = 0;           // 累计madvise透明大页成功的字节数
+        uint64_t in_use_bytes = 0;        // 当前已分配给调用方的字节数
+        uint64_t peak_in_use_bytes = 0;
+        uint64_t allocations = 0;
+        uint64_t deallocations = 0;
+    };
+
+    /**
+     * @brief 全局Arena（有意不析构：静态对象析构期间仍可能归还内存）
+     */
+    static HugePageArena& instance();
+
+    HugePageArena(const HugePageArena&) = delete;
+    HugePageArena& operator=(const HugePageArena&) = delete;
+
+    /**
+     * @brief 分配bytes字节，按64字节对齐
+     * @throws std::bad_alloc 内核拒绝映射时
+     */
+    void* allocate(size_t bytes);
+
+    /**
+     * @brief 归还内存，bytes须与分配时一致（可由任意线程归还）
+     */
+    void deallocate(void* ptr, size_t bytes) noexcept;
+
+    /**
+     * @brief 是否尝试大页（默认开启）；只影响之后新映射的内存块
+     */
+    void set_huge_pages_enabled(bool enabled);
+
+    Statistics get_statistics() const;
+
+private:
+    HugePageArena();
+
+    // 空闲链表节点：复用已释放内存的首字节
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    static constexpr size_t kCachedClasses = kMaxCachedAllocation / kAlignment + 1;
+
+    /**
+     * @brief 线程缓存（下标：取整后尺寸 / kAlignment）
+     */
+    struct ThreadCache {
+        uint8_t* cursor = nullptr;
+        uint8_t* end = nullptr;
+        std::array<FreeNode*, kCachedClasses> heads{};
+        std::array<uint32_t, kCachedClasses> counts{};
+
+        // 尚未汇总到全局统计的增量
+        uint32_t pending_allocations = 0;
+        uint32_t pending_deallocations = 0;
+        int64_t pending_in_use = 0;
+    };
+
+    static size_t round_up(size_t bytes) {
+        return (bytes + kAlignment - 1) & ~(kAlignment - 1);
+    }
+
+    static size_t round_up_mapping(size_t bytes) {
+        return (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+    }
+
+    /**
+     * @brief 映射bytes字节（已按2MB取整），按配置依次尝试大页
+     */
+    void* map_region(size_t bytes);
+
+    /**
+     * @brief 从全局取rounded字节：先查空闲链表，再从2MB块碰撞分配（需持锁）
+     */
+    void* allocate_locked(size_t rounded);
+
+    /**
+     * @brief 把ptr挂入全局空闲链表（需持锁）
+     */
+    void push_free_locked(void* ptr, size_t rounded);
+
+    // 线程缓存的慢路径
+    void* refill_thread_cache(ThreadCache& cache, size_t rounded);
+    void spill_thread_cache(ThreadCache& cache, size_t size_class, size_t count);
+    void retire_thread_segment(ThreadCache& cache);
+
+    /**
+     * @brief 汇总线程缓存的统计增量
+     */
+    void flush_statistics(ThreadCache& cache);
+    void record(int64_t in_use_delta, uint64_t allocations, uint64_t deallocations);
+
+    /**
+     * @brief 线程退出时归还其空闲链表与剩余私有段
+     */
+    void release_thread_cache(ThreadCache& cache);
+
+    static ThreadCache* local_cache();
+
+    mutable std::mutex mutex_;
+    std::atomic<bool> huge_pages_enabled_;
+
+    uint8_t* chunk_cursor_;
+    uint8_t* chunk_end_;
+    std::vector<FreeNode*> free_lists_;   // 下标：取整后尺寸 / kAlignment
+
+    std::atomic<uint64_t> mapped_bytes_{0};
+    std::atomic<uint64_t> hugetlb_bytes_{0};
+    std::atomic<uint64_t> thp_bytes_{0};
+    std::atomic<int64_t> in_use_bytes_{0};
+    std::atomic<uint64_t> peak_in_use_bytes_{0};
+    std::atomic<uint64_t> allocations_{0};
+    std::atomic<uint64_t> deallocations_{0};
+};
+
+/**
+ * @brief 从HugePageArena分配的STL分配器
+ *
+ * 用于 std::allocate_shared 和关联容器的节点分配
+ */
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    static_assert(alignof(T) <= HugePageArena::kAlignment,
+                  "ArenaAllocator supports alignment up to 64 bytes");
+
+    ArenaAllocator() noexcept = default;
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(HugePageArena::instance().allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        HugePageArena::instance().deallocate(ptr, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>&) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>&) const noexcept { return false; }
+};
+
+/**
+ * @brief 负载存储在HugePageArena中的字节数组（编码组源块与FEC帧负载）
+ */
+using ArenaBytes = std::vector<uint8_t, ArenaAllocator<uint8_t>>;
+
+} // namespace mpquic_fec
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "stage_timing.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief 锁竞争统计开关
+ *
+ * 由CMake选项 MPQUIC_FEC_LOCK_PROFILING 设置；未开启时InstrumentedMutex
+ * 只是对底层互斥量的内联转发，与直接使用std::mutex等价
+ */
+#ifndef MPQUIC_FEC_LOCK_PROFILING
+#define MPQUIC_FEC_LOCK_PROFILING 0
+#endif
+
+namespace mpquic_fec {
+
+/**
+ * @brief 加锁位置（统计数组下标）
+ */
+enum class LockSite : uint8_t {
+    GROUP_MANAGER,      // FECGroupManager::mutex_
+    SEND_QUEUE,         // PacketSendHook::queue_mutex_
+    RECEIVE_HOOK,       // PacketReceiveHook::mutex_
+    CONTROLLER,         // MPQUICFECController::mutex_
+    MANAGER_RECEIVE,    // MPQUICManager::recv_mutex_
+    MOCK_CONNECTION,    // MockQuicConnection 内部状态
+    SHM_EGRESS,         // MPQUICManager::egress_mutex_（共享内存出口环的生产者侧）
+    MANAGER_SEND,       // MPQUICManager::send_mutex_（发送序号与包号的对应表）
+    COALESCER,          // MPQUICManager::coalesce_mutex_（合并中的小消息）
+    COUNT
+};
+
+constexpr size_t kLockSiteCount = static_cast<size_t>(LockSite::COUNT);
+
+/**
+ * @brief 单个加锁位置的统计快照
+ *
+ * 直方图桶与StageTimingStats相同（tick为单位，除以 ticks_per_ns 换算）。
+ * 等待时间从第一次try_lock失败算起；递归锁只统计最外层的获取与持有
+ */
+struct LockSiteStats {
+    LockSite site = LockSite::COUNT;
+    const char* name = "";
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;          // 需要等待的获取次数
+    double wait_total_ns = 0;
+    double wait_p50_ns = 0;
+    double wait_p99_ns = 0;
+    double wait_max_ns = 0;
+    uint64_t hold_count = 0;         // 已释放的持有次数
+    double hold_total_ns = 0;
+    double hold_p50_ns = 0;
+    double hold_p99_ns = 0;
+    double hold_max_ns = 0;
+    double ticks_per_ns = 1;
+    std::array<uint64_t, kStageHistogramBuckets> wait_buckets{};   // 仅含竞争的获取
+    std::array<uint64_t, kStageHistogramBuckets> hold_buckets{};
+};
+
+/**
+ * @brief 各加锁位置的获取次数与等待/持有时间直方图（全局）
+ */
+class LockProfiler {
+public:
+    /**
+     * @brief 全局实例（有意不析构：静态对象析构期间仍可能加锁）
+     */
+    static LockProfiler& instance();
+
+    LockProfiler(const LockProfiler&) = delete;
+    LockProfiler& operator=(const LockProfiler&) = delete;
+
+    static constexpr bool compiled_in() {
+        return MPQUIC_FEC_LOCK_PROFILING != 0;
+    }
+
+    static const char* site_name(LockSite site);
+
+    void record_acquire(LockSite site, uint64_t wait_ticks, bool contended) {
+        Site& s = sites_[static_cast<size_t>(site)];
+        s.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        if (contended) {
+            s.contended.fetch_add(1, std::memory_order_relaxed);
+            s.wait.record(wait_ticks);
+        }
+    }
+
+    void record_hold(LockSite site, uint64_t hold_ticks) {
+        sites_[static_cast<size_t>(site)].hold.record(hold_ticks);
+    }
+
+    /**
+     * @brief 各加锁位置的统计快照（未编译统计时返回空）
+     */
+    std::vector<LockSiteStats> snapshot() const;
+
+    void reset();
+
+private:
+    struct Histogram {
+        std::atomic<uint64_t> total_ticks{0};
+        std::atomic<uint64_t> max_ticks{0};
+        std::atomic<uint64_t> buckets[kStageHistogramBuckets] = {};
+
+        void record(uint64_t ticks) {
+            total_ticks.fetch_add(ticks, std::memory_order_relaxed);
+            buckets[StageTiming::bucket_for(ticks)].fetch_add(1, std::memory_order_relaxed);
+            uint64_t max = max_ticks.load(std::memory_order_relaxed);
+            while (ticks > max &&
+                   !max_ticks.compare_exchange_weak(max, ticks, std::memory_order_relaxed)) {
+            }
+        }
+    };
+
+    struct alignas(64) Site {
+        std::atomic<uint64_t> acquisitions{0};
+        std::atomic<uint64_t> contended{0};
+        Histogram wait;
+        Histogram hold;
+    };
+
+    LockProfiler() = default;
+
+    Site sites_[kLockSiteCount];
+};
+
+/**
+ * @brief 可统计竞争的互斥量包装，满足Lockable，可直接用于lock_guard/unique_lock
+ *
+ * Mutex 为 std::mutex 或 std::recursive_mutex
+ */
+template <typename Mutex>
+class InstrumentedMutex {
+public:
+    explicit InstrumentedMutex(LockSite site) : site_(site) {}
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+#if MPQUIC_FEC_LOCK_PROFILING
+    void lock() {
+        if (mutex_.try_lock()) {
+            acquired(0, false);
+            return;
+        }
+        uint64_t start = read_tsc();
+        mutex_.lock();
+        acquired(read_tsc() - start, true);
+    }
+
+    bool try_lock() {
+        if (!mutex_.try_lock()) {
+            return false;
+        }
+        acquired(0, false);
+        return true;
+    }
+
+    void unlock() {
+        // 持有时间须在释放前计算：depth_/hold_start_只由持有者访问
+        if (--depth_ == 0) {
+            LockProfiler::instance().record_hold(site_, read_tsc() - hold_start_);
+        }
+        mutex_.unlock();
+    }
+#else
+    void lock() { mutex_.lock(); }
+    bool try_lock() { return mutex_.try_lock(); }
+    void unlock() { mutex_.unlock(); }
+#endif
+
+    LockSite site() const { return site_; }
+
+private:
+#if MPQUIC_FEC_LOCK_PROFILING
+    void acquired(uint64_t wait_ticks, bool contended) {
+        if (depth_++ == 0) {
+            hold_start_ = read_tsc();
+            LockProfiler::instance().record_acquire(site_, wait_ticks, contended);
+        }
+    }
+
+    uint32_t depth_ = 0;
+    uint64_t hold_start_ = 0;
+#endif
+
+    Mutex mutex_;
+    LockSite site_;
+};
+
+using ProfiledMutex = InstrumentedMutex<std::mutex>;
+using ProfiledRecursiveMutex = InstrumentedMutex<std::recursive_mutex>;
+
+} // namespace mpquic_fec
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace mpquic_fec {
+
+/**
+ * @brief 有界无锁环形队列（Vyukov MPMC算法）
+ *
+ * 每个槽位带序号：生产者/消费者各自用一次CAS抢占位置，
+ * 再通过槽位序号的release/acquire完成数据交接，不需要互斥锁。
+ * 多生产者单消费者(MPSC)是其特例，消费者侧的CAS不会发生竞争。
+ *
+ * 容量向上取整为2的幂；队列满时 try_push 返回false，由调用方决定丢弃或重试
+ */
+template<typename T>
+class LockFreeRing {
+public:
+    explicit LockFreeRing(size_t capacity)
+        : enqueue_pos_(0), dequeue_pos_(0) {
+        if (capacity < 2) {
+            throw std::invalid_argument("LockFreeRing capacity must be at least 2");
+        }
+
+        size_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        mask_ = rounded - 1;
+
+        cells_.reset(new Cell[rounded]);
+        for (size_t i = 0; i < rounded; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LockFreeRing(const LockFreeRing&) = delete;
+    LockFreeRing& operator=(const LockFreeRing&) = delete;
+
+    /**
+     * @brief 入队（可多线程并发调用）
+     * @return 队列满时返回false，item保持不变
+     */
+    bool try_push(T&& item) {
+        Cell* cell = nullptr;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                                       std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // 队列满
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& item) {
+        T copy(item);
+        return try_push(std::move(copy));
+    }
+
+    /**
+     * @brief 出队
+     * @return 队列空时返回false
+     */
+    bool try_pop(T& out) {
+        Cell* cell = nullptr;
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                                       std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // 队列空
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        out = std::move(cell->data);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 批量出队，对每个元素调用fn
+     * @return 实际出队的元素数
+     */
+    template<typename F>
+    size_t drain(F&& fn, size_t max_items) {
+        size_t count = 0;
+        T item;
+        while (count < max_items && try_pop(item)) {
+            fn(std::move(item));
+            ++count;
+        }
+        return count;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    /**
+     * @brief 近似元素数（并发修改时仅供统计）
+     */
+    size_t size_approx() const {
+        size_t enq = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t deq = dequeue_pos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+
+    // 生产者与消费者游标分处不同缓存行，避免伪共享
+    alignas(64) std::atomic<size_t> enqueue_pos_;
+    alignas(64) std::atomic<size_t> dequeue_pos_;
+};
+
+} // namespace mpquic_fec
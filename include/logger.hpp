@@ -1,10 +1,28 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <chrono>
-#include <iomanip>
+#include "lockfree_ring.hpp"
+
+/**
+ * @brief 编译期日志级别：0=DEBUG 1=INFO 2=WARN 3=ERROR
+ *
+ * 低于该级别的LOG_*宏展开为不求值的空语句，由CMake缓存变量 MPQUIC_FEC_LOG_LEVEL 设置
+ */
+#ifndef MPQUIC_FEC_LOG_LEVEL
+#define MPQUIC_FEC_LOG_LEVEL 0
+#endif
 
 namespace mpquic_fec {
 
@@ -15,38 +33,198 @@ enum class LogLevel {
     ERROR
 };
 
+/**
+ * @brief 日志调用点状态（每个LOG_*宏展开处一个静态实例），用于限速
+ */
+struct LogSite {
+    std::atomic<int64_t> window_start_ns{0};
+    std::atomic<uint32_t> window_count{0};
+    std::atomic<uint32_t> suppressed{0};
+};
+
+/**
+ * @brief 异步日志器
+ *
+ * 调用线程只把时间戳和参数按二进制编码进定长记录，推入无锁环形队列；
+ * 后台线程负责格式化时间、拼接参数并写出stdout。
+ *
+ * - 同一调用点每秒超过限速阈值的日志被丢弃，下一条放行的日志附带被抑制的条数
+ * - 队列满时丢弃并计数，由后台线程补报
+ * - 超过单条记录容量的日志先flush()再同步写出，保证顺序
+ * - 进程退出（atexit）时排空队列并停止后台线程，之后退化为同步写出
+ */
 class Logger {
 public:
+    static constexpr size_t kRecordSize = 256;
+    static constexpr size_t kRingCapacity = 8192;
+    static constexpr uint32_t kDefaultRateLimit = 200;   // 每个调用点每秒最多条数
+
     static Logger& instance() {
-        static Logger logger;
-        return logger;
+        // 有意不析构：静态对象析构期间仍可能写日志
+        static Logger* logger = new Logger();
+        return *logger;
     }
 
     void set_level(LogLevel level) {
-        level_ = level;
+        level_.store(level, std::memory_order_relaxed);
+    }
+
+    bool enabled(LogLevel level) const {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 设置每个调用点每秒的日志上限，0表示不限速
+     */
+    void set_rate_limit(uint32_t per_second) {
+        rate_limit_.store(per_second, std::memory_order_relaxed);
     }
 
     template<typename... Args>
-    void log(LogLevel level, Args&&... args) {
-        if (level < level_) return;
+    void log(LogSite& site, LogLevel level, Args&&... args) {
+        if (!enabled(level)) return;
+
+        int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        uint32_t suppressed = 0;
+        if (!admit(site, now_ns, suppressed)) return;
+
+        Record record;
+        record.timestamp_ns = now_ns;
+        record.level = level;
+        record.suppressed = suppressed;
+        record.length = 0;
+
+        bool fits = (encode_arg(record, args) && ...);
+        if (!fits) {
+            log_oversized(level, now_ns, suppressed, args...);
+            return;
+        }
+        submit(std::move(record));
+    }
+
+    /**
+     * @brief 阻塞直到此前提交的日志全部写出
+     */
+    void flush();
+
+    /**
+     * @brief 排空队列并停止后台线程，之后的日志同步写出
+     */
+    void shutdown();
+
+    /**
+     * @brief 因队列满而丢弃的日志条数
+     */
+    uint64_t dropped_records() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
 
-        auto now = std::chrono::system_clock::now();
-        auto time = std::chrono::system_clock::to_time_t(now);
-        
+private:
+    /**
+     * @brief 参数类型标签
+     */
+    enum class ArgType : uint8_t {
+        INT,
+        UINT,
+        DOUBLE,
+        BOOL,
+        CHAR,
+        STRING
+    };
+
+    /**
+     * @brief 定长二进制日志记录
+     *
+     * payload依次存放 [ArgType][值]，字符串为 [ArgType][u16长度][字节]
+     */
+    struct Record {
+        int64_t timestamp_ns = 0;
+        uint32_t suppressed = 0;
+        LogLevel level = LogLevel::INFO;
+        uint16_t length = 0;
+        bool flush_marker = false;
+        uint64_t flush_seq = 0;
+        char payload[kRecordSize - 32];
+    };
+
+    Logger();
+
+    bool admit(LogSite& site, int64_t now_ns, uint32_t& suppressed);
+    void submit(Record&& record);
+
+    static bool append(Record& record, ArgType type, const void* data, size_t size) {
+        if (record.length + 1 + size > sizeof(record.payload)) {
+            return false;
+        }
+        record.payload[record.length] = static_cast<char>(type);
+        std::memcpy(record.payload + record.length + 1, data, size);
+        record.length = static_cast<uint16_t>(record.length + 1 + size);
+        return true;
+    }
+
+    static bool append_string(Record& record, std::string_view str) {
+        if (str.size() > UINT16_MAX ||
+            record.length + 3 + str.size() > sizeof(record.payload)) {
+            return false;
+        }
+        uint16_t len = static_cast<uint16_t>(str.size());
+        record.payload[record.length] = static_cast<char>(ArgType::STRING);
+        std::memcpy(record.payload + record.length + 1, &len, sizeof(len));
+        std::memcpy(record.payload + record.length + 3, str.data(), str.size());
+        record.length = static_cast<uint16_t>(record.length + 3 + str.size());
+        return true;
+    }
+
+    /**
+     * @brief 按类型编码单个参数；无法二进制表示的类型在调用线程格式化为字符串
+     * @return 记录容量不足时返回false
+     */
+    template<typename T>
+    static bool encode_arg(Record& record, const T& arg) {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_same_v<U, bool>) {
+            return append(record, ArgType::BOOL, &arg, sizeof(bool));
+        } else if constexpr (std::is_same_v<U, char> || std::is_same_v<U, signed char> ||
+                             std::is_same_v<U, unsigned char>) {
+            // 与ostream一致：(u)int8_t按字符输出
+            char c = static_cast<char>(arg);
+            return append(record, ArgType::CHAR, &c, 1);
+        } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+            int64_t v = arg;
+            return append(record, ArgType::INT, &v, sizeof(v));
+        } else if constexpr (std::is_integral_v<U>) {
+            uint64_t v = arg;
+            return append(record, ArgType::UINT, &v, sizeof(v));
+        } else if constexpr (std::is_floating_point_v<U>) {
+            double v = static_cast<double>(arg);
+            return append(record, ArgType::DOUBLE, &v, sizeof(v));
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            return append_string(record, std::string_view(arg));
+        } else {
+            std::ostringstream oss;
+            oss << arg;
+            return append_string(record, oss.str());
+        }
+    }
+
+    template<typename... Args>
+    void log_oversized(LogLevel level, int64_t timestamp_ns, uint32_t suppressed,
+                       const Args&... args) {
         std::ostringstream oss;
-        oss << "[" << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S") << "] ";
-        oss << "[" << level_to_string(level) << "] ";
-        
         (oss << ... << args);
-        
-        std::cout << oss.str() << std::endl;
+        flush();
+        write_line(level, timestamp_ns, suppressed, oss.str());
     }
 
-private:
-    Logger() = default;
-    LogLevel level_ = LogLevel::INFO;
+    void run();
+    void format_record(const Record& record, std::string& out);
+    void write_line(LogLevel level, int64_t timestamp_ns, uint32_t suppressed,
+                    const std::string& message);
+    void append_prefix(LogLevel level, int64_t timestamp_ns, std::string& out);
 
-    std::string level_to_string(LogLevel level) {
+    static const char* level_to_string(LogLevel level) {
         switch (level) {
             case LogLevel::DEBUG: return "DEBUG";
             case LogLevel::INFO:  return "INFO ";
@@ -55,12 +233,72 @@ private:
             default: return "UNKNO";
         }
     }
+
+    std::atomic<LogLevel> level_{LogLevel::INFO};
+    std::atomic<uint32_t> rate_limit_{kDefaultRateLimit};
+    std::atomic<uint64_t> dropped_{0};
+
+    LockFreeRing<Record> ring_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> consumer_sleeping_{false};
+    std::thread worker_;
+
+    // 后台线程休眠/flush等待
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable flushed_cv_;
+    uint64_t flush_requested_ = 0;
+    uint64_t flush_completed_ = 0;
+
+    // 同步写出（关闭后或超长日志）与后台线程写出互斥
+    std::mutex output_mutex_;
+
+    // 时间前缀缓存：同一秒内复用格式化结果（仅写出方访问）
+    int64_t cached_second_ = -1;
+    char cached_time_[32] = {};
 };
 
-// 便捷宏
-#define LOG_DEBUG(...) mpquic_fec::Logger::instance().log(mpquic_fec::LogLevel::DEBUG, __VA_ARGS__)
-#define LOG_INFO(...)  mpquic_fec::Logger::instance().log(mpquic_fec::LogLevel::INFO, __VA_ARGS__)
-#define LOG_WARN(...)  mpquic_fec::Logger::instance().log(mpquic_fec::LogLevel::WARN, __VA_ARGS__)
-#define LOG_ERROR(...) mpquic_fec::Logger::instance().log(mpquic_fec::LogLevel::ERROR, __VA_ARGS__)
+/**
+ * @brief 编译期被裁掉的日志：参数只做语法检查，不求值
+ */
+template<typename... Args>
+inline void log_discard(const Args&...) {}
 
 } // namespace mpquic_fec
+
+// 便捷宏
+#define MPQUIC_FEC_LOG_AT(level, ...)                                              \
+    do {                                                                           \
+        if (mpquic_fec::Logger::instance().enabled(level)) {                       \
+            static mpquic_fec::LogSite mpquic_fec_log_site_;                       \
+            mpquic_fec::Logger::instance().log(mpquic_fec_log_site_, level,        \
+                                               __VA_ARGS__);                       \
+        }                                                                          \
+    } while (0)
+
+#define MPQUIC_FEC_LOG_DISCARDED(...)                                              \
+    do {                                                                           \
+        if (false) {                                                               \
+            mpquic_fec::log_discard(__VA_ARGS__);                                  \
+        }                                                                          \
+    } while (0)
+
+#if MPQUIC_FEC_LOG_LEVEL <= 0
+#define LOG_DEBUG(...) MPQUIC_FEC_LOG_AT(mpquic_fec::LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) MPQUIC_FEC_LOG_DISCARDED(__VA_ARGS__)
+#endif
+
+#if MPQUIC_FEC_LOG_LEVEL <= 1
+#define LOG_INFO(...)  MPQUIC_FEC_LOG_AT(mpquic_fec::LogLevel::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...)  MPQUIC_FEC_LOG_DISCARDED(__VA_ARGS__)
+#endif
+
+#if MPQUIC_FEC_LOG_LEVEL <= 2
+#define LOG_WARN(...)  MPQUIC_FEC_LOG_AT(mpquic_fec::LogLevel::WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...)  MPQUIC_FEC_LOG_DISCARDED(__VA_ARGS__)
+#endif
+
+#define LOG_ERROR(...) MPQUIC_FEC_LOG_AT(mpquic_fec::LogLevel::ERROR, __VA_ARGS__)
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
+namespace mpquic_fec {
+
+/**
+ * @brief Gilbert-Elliott 两状态突发丢包模型
+ *
+ * Good/Bad两个状态，每个包先按转移概率切换状态，再按所在状态的丢包率丢包。
+ * p_good_to_bad = 0 且 loss_good = 丢包率 时退化为Bernoulli独立丢包
+ *
+ * 稳态丢包率：π_B·loss_bad + (1-π_B)·loss_good，π_B = p/(p+r)
+ */
+class GilbertElliottModel {
+public:
+    GilbertElliottModel()
+        : p_good_to_bad_(0), p_bad_to_good_(1), loss_good_(0), loss_bad_(1),
+          in_bad_state_(false) {}
+
+    GilbertElliottModel(double p_good_to_bad, double p_bad_to_good,
+                        double loss_good = 0.0, double loss_bad = 1.0)
+        : p_good_to_bad_(p_good_to_bad), p_bad_to_good_(p_bad_to_good),
+          loss_good_(loss_good), loss_bad_(loss_bad), in_bad_state_(false) {}
+
+    /**
+     * @brief 独立(Bernoulli)丢包
+     */
+    static GilbertElliottModel bernoulli(double loss_rate) {
+        return GilbertElliottModel(0.0, 1.0, loss_rate, loss_rate);
+    }
+
+    /**
+     * @brief 按平均丢包率和平均突发长度构造（Bad状态必丢，Good状态不丢）
+     * @param mean_burst_len 平均连续丢包数（≥1）
+     */
+    static GilbertElliottModel from_loss_rate(double loss_rate, double mean_burst_len) {
+        GilbertElliottModel model;
+        model.set_loss_rate(loss_rate, mean_burst_len);
+        return model;
+    }
+
+    /**
+     * @brief 重新设定平均丢包率（Trace回放时使用），保持突发长度不变
+     *
+     * 突发长度为b时可达的最高丢包率为b/(b+1)（p_good_to_bad = 1）；
+     * 超过时p_good_to_bad取1并拉长突发，使稳态丢包率仍等于loss_rate
+     */
+    void set_loss_rate(double loss_rate, double mean_burst_len) {
+        loss_rate = std::max(0.0, std::min(0.999, loss_rate));
+        p_bad_to_good_ = 1.0 / std::max(1.0, mean_burst_len);
+        p_good_to_bad_ = p_bad_to_good_ * loss_rate / (1.0 - loss_rate);
+        if (p_good_to_bad_ > 1.0) {
+            p_good_to_bad_ = 1.0;
+            p_bad_to_good_ = (1.0 - loss_rate) / loss_rate;
+        }
+        loss_good_ = 0.0;
+        loss_bad_ = 1.0;
+    }
+
+    /**
+     * @brief 稳态平均丢包率
+     */
+    double average_loss_rate() const {
+        double denom = p_good_to_bad_ + p_bad_to_good_;
+        double pi_bad = denom > 0 ? p_good_to_bad_ / denom : 0.0;
+        return pi_bad * loss_bad_ + (1.0 - pi_bad) * loss_good_;
+    }
+
+    /**
+     * @brief 推进一个包并判定是否丢失
+     */
+    template<typename RNG>
+    bool next_lost(RNG& rng) {
+        std::uniform_real_distribution<double> dis(0.0, 1.0);
+        if (in_bad_state_) {
+            if (dis(rng) < p_bad_to_good_) in_bad_state_ = false;
+        } else {
+            if (dis(rng) < p_good_to_bad_) in_bad_state_ = true;
+        }
+        return dis(rng) < (in_bad_state_ ? loss_bad_ : loss_good_);
+    }
+
+    bool in_bad_state() const { return in_bad_state_; }
+
+private:
+    double p_good_to_bad_;
+    double p_bad_to_good_;
+    double loss_good_;
+    double loss_bad_;
+    bool in_bad_state_;
+};
+
+} // namespace mpquic_fec
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mpquic_fec {
+
+/**
+ * @brief 内存记账的子系统标签
+ */
+enum class MemoryTag : uint8_t {
+    ENCODE_GROUPS,     // FECGroupManager 已编码组缓存
+    RECEIVE_GROUPS,    // PacketReceiveHook 接收组与帧缓存
+    PACKET_MAPPING,    // PacketNumberMapper 包号/组映射
+    DECODERS,          // PacketReceiveHook 按(k,m)缓存的解码器
+    COUNT
+};
+
+constexpr size_t kMemoryTagCount = static_cast<size_t>(MemoryTag::COUNT);
+
+/**
+ * @brief 标签名（用于日志和指标标签）
+ */
+const char* memory_tag_name(MemoryTag tag);
+
+/**
+ * @brief std::map 每个节点在负载之外的开销（红黑树指针+颜色+分配器对齐）
+ */
+constexpr size_t kMapNodeOverhead = 48;
+
+/**
+ * @brief 分子系统的内存记账与预算
+ *
+ * 各组件在插入/删除缓存条目时按估算的占用字节数调用charge/release，
+ * 计数同时累加到父账户（默认是进程账户），因此既能按连接也能按进程查看。
+ * 计数都是relaxed原子量，读取不需要组件的锁。
+ *
+ * 预算为0表示不限制；账户本身只记账和判定是否超预算，
+ * 超预算时的驱逐/降冗余由持有账户的控制器执行
+ */
+class MemoryAccount {
+public:
+    /**
+     * @brief 某一时刻的账户快照
+     */
+    struct Snapshot {
+        std::array<uint64_t, kMemoryTagCount> used{};
+        std::array<uint64_t, kMemoryTagCount> peak{};
+        std::array<uint64_t, kMemoryTagCount> budget{};
+        uint64_t total = 0;
+        uint64_t total_peak = 0;
+        uint64_t total_budget = 0;
+    };
+
+    /**
+     * @brief 进程级账户（有意不析构：静态对象析构期间仍可能release）
+     */
+    static MemoryAccount& process();
+
+    /**
+     * @param parent 父账户，nullptr表示顶层
+     */
+    explicit MemoryAccount(MemoryAccount* parent = &process());
+
+    /**
+     * @brief 析构时把仍记在本账户上的占用从父账户扣除
+     */
+    ~MemoryAccount();
+
+    MemoryAccount(const MemoryAccount&) = delete;
+    MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+    void charge(MemoryTag tag, size_t bytes);
+    void release(MemoryTag tag, size_t bytes);
+
+    uint64_t used(MemoryTag tag) const {
+        return used_[index(tag)].load(std::memory_order_relaxed);
+    }
+
+    uint64_t total() const {
+        return total_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 设置子系统预算（字节，0为不限制）
+     */
+    void set_budget(MemoryTag tag, uint64_t bytes) {
+        budget_[index(tag)].store(bytes, std::memory_order_relaxed);
+    }
+
+    uint64_t budget(MemoryTag tag) const {
+        return budget_[index(tag)].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 设置本账户所有子系统合计的预算（字节，0为不限制）
+     */
+    void set_total_budget(uint64_t bytes) {
+        total_budget_.store(bytes, std::memory_order_relaxed);
+    }
+
+    uint64_t total_budget() const {
+        return total_budget_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 子系统超出预算的字节数（未超或不限制时为0）
+     */
+    uint64_t excess(MemoryTag tag) const {
+        uint64_t limit = budget(tag);
+        uint64_t in_use = used(tag);
+        return limit > 0 && in_use > limit ? in_use - limit : 0;
+    }
+
+    /**
+     * @brief 合计超出预算的字节数
+     */
+    uint64_t total_excess() const {
+        uint64_t limit = total_budget();
+        uint64_t in_use = total();
+        return limit > 0 && in_use > limit ? in_use - limit : 0;
+    }
+
+    Snapshot snapshot() const;
+
+private:
+    static size_t index(MemoryTag tag) {
+        return static_cast<size_t>(tag);
+    }
+
+    static void raise_peak(std::atomic<uint64_t>& peak, uint64_t value) {
+        uint64_t current = peak.load(std::memory_order_relaxed);
+        while (value > current &&
+               !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    MemoryAccount* parent_;
+    std::array<std::atomic<uint64_t>, kMemoryTagCount> used_{};
+    std::array<std::atomic<uint64_t>, kMemoryTagCount> peak_{};
+    std::array<std::atomic<uint64_t>, kMemoryTagCount> budget_{};
+    std::atomic<uint64_t> total_{0};
+    std::atomic<uint64_t> total_peak_{0};
+    std::atomic<uint64_t> total_budget_{0};
+};
+
+} // namespace mpquic_fec
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mpquic_fec {
+
+/**
+ * @brief 小消息合并器：把多条应用消息打包进一个FEC源块
+ *
+ * 块内每条消息是一条记录：u16 长度（大端） | 消息字节。记录之后的
+ * 填充为零，长度为0的记录表示块结束，因此空消息不参与合并。
+ *
+ * 类似Nagle：块装满（再放不下任何一条记录）时立即取出；否则块中
+ * 第一条消息等待超过max_delay_us后由调用方取出。每个块前预留headroom
+ * 字节，调用方可就地写入块头。
+ *
+ * 不加锁，由调用方同步
+ */
+class MessageCoalescer {
+public:
+    static constexpr size_t kRecordHeaderSize = 2;
+
+    /**
+     * @param block_size 每个块的总字节数（含headroom）
+     * @param headroom 块首预留给调用方的字节数
+     * @param max_delay_us 块中第一条消息最长等待时间
+     * @throws std::invalid_argument 块中装不下一条非空记录
+     */
+    MessageCoalescer(size_t block_size, size_t headroom, uint64_t max_delay_us);
+
+    /**
+     * @brief 消息能否以单条记录装入一个块
+     */
+    bool accepts(size_t size) const {
+        return size > 0 && size <= kMaxRecordLength &&
+               headroom_ + kRecordHeaderSize + size <= block_size_;
+    }
+
+    /**
+     * @brief 追加一条消息（须满足accepts）
+     *
+     * 当前块放不下时先把它移入out_blocks；追加后块已满也移入out_blocks
+     * @throws std::invalid_argument 消息不能装入单个块
+     */
+    void append(const uint8_t* data, size_t size, uint64_t now_us,
+                std::vector<std::vector<uint8_t>>& out_blocks);
+
+    /**
+     * @brief 取出当前块（含headroom，记录区未用部分不补零）
+     * @return 没有待发消息时返回false
+     */
+    bool take(std::vector<uint8_t>& out_block);
+
+    /**
+     * @brief 块中第一条消息是否已等满max_delay_us
+     */
+    bool due(uint64_t now_us) const {
+        return messages_ > 0 && now_us >= first_append_us_ + max_delay_us_;
+    }
+
+    /**
+     * @brief 当前块的截止时刻（没有待发消息时无意义）
+     */
+    uint64_t deadline_us() const { return first_append_us_ + max_delay_us_; }
+
+    bool empty() const { return messages_ == 0; }
+    size_t pending_messages() const { return messages_; }
+
+    /**
+     * @brief 把记录区拆回消息，遇到长度为0或越界的记录即停止
+     * @return 拆出的消息数
+     */
+    static size_t split(const uint8_t* records, size_t size,
+                        std::vector<std::vector<uint8_t>>& out_messages);
+
+private:
+    static constexpr size_t kMaxRecordLength = 0xFFFF;
+
+    size_t block_size_;
+    size_t headroom_;
+    uint64_t max_delay_us_;
+
+    std::vector<uint8_t> block_;
+    size_t messages_ = 0;
+    uint64_t first_append_us_ = 0;
+};
+
+} // namespace mpquic_fec
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mpquic_fec {
+
+/**
+ * @brief 指标类型（对应Prometheus的TYPE行）
+ */
+enum class MetricType {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM
+};
+
+/**
+ * @brief 指标标签：按给定顺序输出的 (名称, 值) 列表
+ */
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief 某一时刻的一组指标
+ *
+ * 由数据面所在线程构建后整体发布给MetricsExporter，
+ * 抓取时只读取这个不可变快照，不接触数据面的任何锁
+ */
+class MetricsSnapshot {
+public:
+    void counter(const std::string& name, const std::string& help,
+                 const MetricLabels& labels, double value);
+
+    void gauge(const std::string& name, const std::string& help,
+               const MetricLabels& labels, double value);
+
+    /**
+     * @brief 直方图
+     * @param buckets 按上界升序的 (le, 累计样本数)，+Inf桶自动追加
+     */
+    void histogram(const std::string& name, const std::string& help,
+                   const MetricLabels& labels,
+                   const std::vector<std::pair<double, uint64_t>>& buckets,
+                   double sum, uint64_t count);
+
+    /**
+     * @brief 按Prometheus文本格式（0.0.4）输出
+     */
+    std::string render() const;
+
+    bool empty() const { return families_.empty(); }
+
+private:
+    struct Sample {
+        std::string suffix;     // _bucket/_sum/_count，普通指标为空
+        std::string labels;     // 已格式化的 {k="v",...}
+        double value;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        MetricType type;
+        std::vector<Sample> samples;
+    };
+
+    Family& family(const std::string& name, const std::string& help, MetricType type);
+
+    static std::string format_labels(const MetricLabels& labels,
+                                     const std::string& extra_name = "",
+                                     const std::string& extra_value = "");
+
+    std::vector<Family> families_;
+};
+
+/**
+ * @brief 本地指标端点
+ *
+ * 在Unix域套接字和/或127.0.0.1的TCP端口上以HTTP返回最近一次publish()的快照，
+ * 可直接由Prometheus（TCP）或 curl --unix-socket 抓取。
+ * 快照以shared_ptr原子替换，格式化在服务线程上按抓取进行，发布方只付出一次指针交换
+ */
+class MetricsExporter {
+public:
+    MetricsExporter() = default;
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    /**
+     * @brief 在Unix域套接字上监听（已存在的同名套接字文件会被替换）
+     * @throws std::runtime_error 无法绑定，或path已存在且不是套接字时
+     */
+    void listen_unix(const std::string& path);
+
+    /**
+     * @brief 在127.0.0.1:port上监听，port为0时由内核分配
+     * @return 实际监听的端口
+     * @throws std::runtime_error 无法绑定时
+     */
+    uint16_t listen_tcp(uint16_t port);
+
+    /**
+     * @brief 启动服务线程（至少调用过一次listen_*）
+     */
+    void start();
+
+    /**
+     * @brief 停止服务线程并关闭监听套接字
+     */
+    void stop();
+
+    /**
+     * @brief 发布新的快照，之后的抓取返回它
+     */
+    void publish(MetricsSnapshot snapshot);
+
+    /**
+     * @brief 当前快照的文本（不经过套接字）
+     */
+    std::string scrape() const;
+
+    uint64_t scrape_count() const {
+        return scrapes_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void run();
+    void serve_client(int fd);
+
+    std::vector<int> listen_fds_;
+    std::string unix_path_;
+    int wake_pipe_[2] = {-1, -1};
+
+    std::shared_ptr<const MetricsSnapshot> snapshot_;
+    std::thread server_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> scrapes_{0};
+};
+
+} // namespace mpquic_fec
@@ -4,9 +4,16 @@
 #include "path_scheduler.hpp"
 #include "oco_controller.hpp"
 #include "fec_frame.hpp"
+#include "instrumented_mutex.hpp"
+#include "memory_accounting.hpp"
+#include "stage_timing.hpp"
+#include "warm_start.hpp"
 #include <memory>
 #include <queue>
 #include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
 
 namespace mpquic_fec {
 
@@ -23,6 +30,24 @@ struct SendPacketMeta {
     SendPacketMeta() : packet_number(0), path_id(0), send_time_us(0), is_repair(false) {}
 };
 
+/**
+ * @brief 流量类别，决定流的编码组大小与冗余度
+ */
+enum class TrafficClass {
+    INTERACTIVE,   // 交互类：小编码组降低填充时延，冗余率偏高
+    STREAMING,     // 流媒体：直接使用OCO决策的(k, m)
+    BULK           // 批量传输：大编码组提高编码效率，冗余率与OCO决策一致
+};
+
+/**
+ * @brief 有界队列满时的处理策略
+ */
+enum class BackpressurePolicy {
+    BLOCK,               // 等待队列腾出空间（超时后失败）
+    DROP_OLDEST,         // 丢弃队列中最旧的条目，新数据优先
+    DEGRADE_REDUNDANCY   // 积压时各流冗余块减半，先丢弃排队的冗余块，仍满时丢弃最旧的条目
+};
+
 /**
  * @brief MP-QUIC FEC 数据流控制器
  * 
@@ -64,6 +89,16 @@ public:
      */
     void update_loss_correlation(uint32_t path_i, uint32_t path_j, double rho);
     
+    /**
+     * @brief 打开一条流（流0在构造时以STREAMING类别打开）
+     * 
+     * 每条流有独立的编码组序列，流间的丢包和组填充时延互不影响。
+     * 对已打开的流调用时更新其流量类别
+     * 
+     * @return 流槽位（组ID的高16位）
+     */
+    uint32_t open_stream(uint64_t stream_id, TrafficClass traffic_class);
+    
     /**
      * @brief 发送数据包（核心Hook入口）
      * 
@@ -71,17 +106,46 @@ public:
      * 
      * @param stream_data 流数据
      * @param original_path_id 原始目标路径（可能会被重新分配）
+     * @param stream_id 所属流，必须已打开
      * @return 实际发送的数据包列表（包含源包和冗余包）
      */
     std::vector<SendPacketMeta> send_stream_data(const std::vector<uint8_t>& stream_data,
-                                                 uint32_t original_path_id = 0);
+                                                 uint32_t original_path_id = 0,
+                                                 uint64_t stream_id = 0);
+    
+    /**
+     * @brief 同上，数据直接从调用方缓冲区（如共享内存槽位）读取，返回后即可复用
+     */
+    std::vector<SendPacketMeta> send_stream_data(const uint8_t* data, size_t size,
+                                                 uint32_t original_path_id = 0,
+                                                 uint64_t stream_id = 0);
+    
+    /**
+     * @brief 强制完成所有流当前未满的编码组并分配路径
+     * 
+     * 消息结尾等需要立即发出数据时调用，避免尾部数据等待凑满k个包
+     */
+    std::vector<SendPacketMeta> flush_pending_groups();
+    
+    /**
+     * @brief 强制完成指定流当前未满的编码组
+     */
+    std::vector<SendPacketMeta> flush_pending_groups(uint64_t stream_id);
+    
+    /**
+     * @brief 取出内部产生的待发送数据包
+     * 
+     * periodic_update() 和参数调整会强制完成未满的编码组，
+     * 这些组的帧暂存于此，由调用方取出后发送
+     */
+    std::vector<SendPacketMeta> pop_pending_packets();
     
     /**
      * @brief 接收数据包（解码Hook入口）
      * 
      * @param frame 接收到的FEC帧
      * @param from_path_id 来源路径
-     * @return 如果成功解码，返回恢复的原始数据
+     * @return 组解码完成时返回该组全部k个源块（按块索引排列），否则为空
      */
     std::vector<std::vector<uint8_t>> receive_fec_frame(const FECFrame& frame,
                                                         uint32_t from_path_id);
@@ -93,6 +157,7 @@ public:
      * 1. 更新链路质量指标
      * 2. 触发OCO学习更新
      * 3. 调整FEC参数
+     * 4. 更新路径活性（第一个ACK到达后开始监测ACK静默）
      */
     void on_ack_received(uint32_t path_id, uint64_t packet_number, uint64_t rtt_us);
     
@@ -105,9 +170,14 @@ public:
      * @brief 定期更新（建议每100ms调用一次）
      * 
      * 执行：
+     * - 路径活性检查（每次调用都执行，不受100ms间隔限制）
      * - OCO决策更新
      * - FEC参数调整
      * - 编码组刷新
+     * 
+     * 路径ACK静默超过PTO时退出调度，并把它最近未应答的块按各组缺口
+     * （优先冗余块）改由其他路径补发；之后按PTO退避在该路径上发送探测包。
+     * 补发和探测包与强制完成的组一样由pop_pending_packets()取出
      */
     void periodic_update();
     
@@ -121,6 +191,23 @@ public:
      */
     void set_fec_strategy(AdaptiveFECStrategy::Strategy strategy);
     
+    /**
+     * @brief 发送积压时降冗余：各流冗余块数减半（与内存超预算相同），直到取消
+     *
+     * 参数立即生效，以旧参数完成的组由pop_pending_packets()取出
+     */
+    void set_redundancy_degraded(bool degraded);
+    
+    /**
+     * @brief 路径活性状态（传输层没有确认反馈时恒为ALIVE）
+     */
+    PathLiveness get_path_liveness(uint32_t path_id) const;
+    
+    /**
+     * @brief 指定流当前的编码参数 (k, m)
+     */
+    std::pair<uint32_t, uint32_t> get_coding_params(uint64_t stream_id = 0) const;
+    
     /**
      * @brief 获取统计信息
      */
@@ -128,18 +215,106 @@ public:
         uint64_t total_packets_sent;
         uint64_t source_packets_sent;
         uint64_t repair_packets_sent;
-        uint64_t packets_recovered;
+        uint64_t packets_recovered;     // 由冗余块重建的源包数
+        uint64_t groups_decoded;
         uint64_t fec_groups_created;
         double current_redundancy_rate;
         double avg_encoding_time_us;
         
+        // 编码组/接收组/缓冲区slab所在的HugePageArena占用
+        uint64_t arena_mapped_bytes;
+        uint64_t arena_huge_page_bytes;   // 其中以大页（HUGETLB或THP）映射的字节数
+        uint64_t arena_in_use_bytes;
+        uint64_t arena_peak_in_use_bytes;
+        
+        // 本连接的内存记账（按MemoryAccount估算的占用）
+        uint64_t memory_in_use_bytes;
+        uint64_t memory_peak_bytes;
+        uint64_t memory_evicted_bytes;    // 因超预算驱逐的累计字节数
+        uint64_t groups_evicted;          // 其中被驱逐的未完成接收组数
+        bool memory_pressure;             // 超过总预算后处于降冗余状态
+        bool redundancy_degraded;         // 因发送积压处于降冗余状态
+        
+        // 路径活性
+        uint64_t path_failures;           // 因ACK静默退出调度的次数
+        uint64_t probe_packets_sent;
+        uint64_t reroute_packets_sent;    // 为失效路径上在途的块在其他路径补发的包
+        
         Statistics() : total_packets_sent(0), source_packets_sent(0),
                       repair_packets_sent(0), packets_recovered(0),
-                      fec_groups_created(0), current_redundancy_rate(0),
-                      avg_encoding_time_us(0) {}
+                      groups_decoded(0), fec_groups_created(0), current_redundancy_rate(0),
+                      avg_encoding_time_us(0), arena_mapped_bytes(0),
+                      arena_huge_page_bytes(0), arena_in_use_bytes(0),
+                      arena_peak_in_use_bytes(0), memory_in_use_bytes(0),
+                      memory_peak_bytes(0), memory_evicted_bytes(0), groups_evicted(0),
+                      memory_pressure(false), redundancy_degraded(false), path_failures(0),
+                      probe_packets_sent(0), reroute_packets_sent(0) {}
     };
     
-    Statistics get_statistics() const { return stats_; }
+    Statistics get_statistics() const;
+    
+    /**
+     * @brief 热路径分阶段耗时直方图（进程全局，含所有控制器实例）
+     *
+     * 未开启CMake选项 MPQUIC_FEC_STAGE_TIMING 时返回空
+     */
+    std::vector<StageTimingStats> get_stage_timings() const;
+    
+    /**
+     * @brief 各加锁位置的竞争统计（进程全局，含所有实例）
+     *
+     * 未开启CMake选项 MPQUIC_FEC_LOCK_PROFILING 时返回空
+     */
+    std::vector<LockSiteStats> get_lock_profile() const;
+    
+    /**
+     * @brief 本连接各子系统的内存占用、峰值与预算
+     */
+    MemoryAccount::Snapshot get_memory_usage() const;
+    
+    /**
+     * @brief 设置子系统内存预算（字节，0为不限制）
+     *
+     * 超出时从该子系统最旧的条目开始驱逐
+     */
+    void set_memory_budget(MemoryTag tag, uint64_t bytes);
+    
+    /**
+     * @brief 设置本连接的内存总预算（字节，0为不限制）
+     *
+     * 超出时依次驱逐接收组、包号映射、已编码组和解码器缓存，
+     * 并在占用回落到预算的3/4以下之前把各流的冗余块数减半
+     */
+    void set_memory_budget(uint64_t total_bytes);
+    
+    /**
+     * @brief 获取内存账户（父账户为进程账户 MemoryAccount::process()）
+     */
+    std::shared_ptr<MemoryAccount> get_memory_account() { return memory_account_; }
+    
+    /**
+     * @brief 设置路径指纹（见path_fingerprint），预热状态按指纹保存和恢复
+     */
+    void set_path_fingerprint(uint32_t path_id, const std::string& fingerprint);
+    
+    /**
+     * @brief 把已设置指纹的路径学到的状态写入store
+     *
+     * 包括链路指标、调度权重、梯度累积、路径间相关性和当前(k, m)决策；
+     * store中其他指纹的记录保持不变
+     */
+    void export_warm_start(WarmStartStore& store) const;
+    
+    /**
+     * @brief 用store中的记录预热尚未预热过的路径
+     *
+     * 每条路径只在第一次遇到其指纹记录时预热一次。在路径发送出数据之前，
+     * update_path_state() 上报的RTT/丢包/带宽/抖动由保存值代替（连接刚建立时
+     * 这些值还只是默认估计）。预热后按保存的网络决策或预热后的指标重新设定(k, m)
+     *
+     * @return 本次预热的路径数
+     */
+    size_t apply_warm_start(const WarmStartStore& store);
     
     /**
      * @brief 获取路径调度器（用于外部查询）
@@ -152,39 +327,118 @@ public:
     std::shared_ptr<OCORedundancyController> get_oco_controller() { return oco_controller_; }
 
 private:
+    /**
+     * @brief 单条流的发送侧状态
+     */
+    struct StreamContext {
+        uint64_t stream_id;
+        uint32_t slot;
+        TrafficClass traffic_class;
+        std::shared_ptr<FECGroupManager> group_manager;
+        std::shared_ptr<PacketSendHook> send_hook;
+    };
+    
+    // 小于该值的流ID通过数组直接索引槽位
+    static constexpr uint64_t kFlatStreamIds = 256;
+    
     // 核心组件
-    std::shared_ptr<FECGroupManager> group_manager_;
-    std::shared_ptr<PacketSendHook> send_hook_;
+    std::vector<std::unique_ptr<StreamContext>> streams_;       // 按槽位索引
+    std::vector<int32_t> flat_stream_slots_;                    // 小流ID -> 槽位，-1表示未打开
+    std::unordered_map<uint64_t, uint32_t> stream_slots_;       // 大流ID -> 槽位
     std::shared_ptr<PacketReceiveHook> receive_hook_;
     std::shared_ptr<PathScheduler> path_scheduler_;
     std::shared_ptr<OCORedundancyController> oco_controller_;
     std::shared_ptr<PacketNumberMapper> pkt_mapper_;
     std::shared_ptr<AdaptiveFECStrategy> fec_strategy_;
+    std::shared_ptr<MemoryAccount> memory_account_;
+    
+    // 超过总预算后置位，期间降低冗余度
+    bool memory_pressure_;
+    
+    // 发送积压时由上层置位，期间降低冗余度
+    bool redundancy_degraded_;
     
     // 当前冗余决策
     RedundancyDecision current_decision_;
     
+    // 内部强制完成的组产生的待发送包
+    std::vector<SendPacketMeta> pending_packets_;
+    
     // 包序号生成器（每条路径独立）
     std::map<uint32_t, uint64_t> next_packet_numbers_;
     
+    /**
+     * @brief 尚未应答的已发送块（开始活性监测后记录，丢失的块也保留到被挤出）
+     */
+    struct InFlightFrame {
+        uint64_t group_id;
+        uint32_t block_index;
+        uint32_t source_blocks;   // 组的k
+        bool is_repair;
+        uint64_t send_time_us;
+    };
+    static constexpr size_t kMaxInFlightFrames = 1024;   // 每条路径
+    std::map<uint32_t, std::map<uint64_t, InFlightFrame>> in_flight_;   // 路径 -> 包号 -> 块
+    
+    // 上一次分配的源路径（用于记录路径切换事件）
+    uint32_t last_source_path_;
+    
     // 统计信息
     Statistics stats_;
     
     // 配置
     bool fec_enabled_;
     uint32_t block_size_;
+    uint32_t default_k_;
+    uint32_t default_m_;
     
     // 线程安全
-    mutable std::mutex mutex_;
+    mutable ProfiledMutex mutex_{LockSite::CONTROLLER};
     
     // 上次更新时间
     uint64_t last_update_time_us_;
     
+    // 预热状态：路径指纹、已预热的路径、尚未发送数据的路径使用的保存值
+    std::map<uint32_t, std::string> path_fingerprints_;
+    std::set<uint32_t> warm_started_paths_;
+    std::map<uint32_t, PathWarmState> warm_seeds_;
+    
     /**
      * @brief 执行OCO决策并更新FEC参数
      */
     void update_fec_parameters();
     
+    /**
+     * @brief 按current_decision_更新各流的(k, m)（调用方持锁）
+     */
+    void apply_coding_params_locked();
+    
+    /**
+     * @brief 检查预算并在超出时驱逐缓存（调用方持锁）
+     */
+    void enforce_memory_budgets_locked();
+    
+    /**
+     * @brief 查找流，未打开时返回nullptr（调用方持锁）
+     */
+    StreamContext* find_stream(uint64_t stream_id) const;
+    
+    /**
+     * @brief 查找流，未打开时抛出std::invalid_argument（调用方持锁）
+     */
+    StreamContext& stream_for(uint64_t stream_id) const;
+    
+    /**
+     * @brief 按流量类别从基准决策推导(k, m)
+     */
+    static std::pair<uint32_t, uint32_t> class_coding_params(TrafficClass traffic_class,
+                                                             const RedundancyDecision& base);
+    
+    /**
+     * @brief 强制完成流中未满的编码组，结果追加到out_packets（调用方持锁）
+     */
+    void flush_groups_locked(StreamContext& stream, std::vector<SendPacketMeta>& out_packets);
+    
     /**
      * @brief 分配包到路径
      */
@@ -192,14 +446,30 @@ private:
                                  std::vector<SendPacketMeta>& out_packets);
     
     /**
-     * @brief 获取下一个包序号
+     * @brief 在指定路径上发出一个帧：分配包号、记录映射/在途块/统计（调用方持锁）
      */
-    uint64_t get_next_packet_number(uint32_t path_id);
+    void emit_packet_locked(const FECFrame& frame, uint32_t path_id, bool is_repair,
+                            uint64_t send_time_us, std::vector<SendPacketMeta>& out_packets);
+    
+    /**
+     * @brief 检查ACK静默，为刚失效的路径补发、为静默路径发探测包（调用方持锁）
+     */
+    void check_path_liveness_locked(uint64_t now_us);
+    
+    /**
+     * @brief 把失效路径上最近未应答的块按各组缺口改由其他路径补发（调用方持锁）
+     */
+    void reroute_in_flight_locked(uint32_t failed_path, uint64_t now_us);
     
     /**
-     * @brief 获取当前时间戳
+     * @brief 从编码组缓存重建块的帧（调用方持锁）
      */
-    uint64_t get_timestamp_us() const;
+    bool rebuild_frame_locked(uint64_t group_id, uint32_t block_index, FECFrame& out_frame);
+    
+    /**
+     * @brief 获取下一个包序号
+     */
+    uint64_t get_next_packet_number(uint32_t path_id);
     
     /**
      * @brief 更新统计信息
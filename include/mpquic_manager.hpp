@@ -2,17 +2,68 @@
 
 #include "quic_connection.hpp"
 #include "path_scheduler.hpp"
-#include "fec_encoder.hpp"
+#include "buffer_manager.hpp"
+#include "mpquic_fec_controller.hpp"
+#include "instrumented_mutex.hpp"
+#include "message_coalescer.hpp"
+#include "metrics_exporter.hpp"
+#include "shm_ring.hpp"
+#include "warm_start.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <limits>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 namespace mpquic_fec {
 
+/**
+ * @brief FEC帧的承载方式
+ */
+enum class FECTransportMode {
+    STREAM,     // 可靠流：丢包会被重传，FEC冗余多余且存在队头阻塞
+    DATAGRAM    // 不可靠数据报：可靠性完全由FEC提供
+};
+
+/**
+ * @brief try_send的结果
+ */
+enum class SendResult {
+    SENT,          // 已编码并进入发送队列（或已交给传输层）
+    WOULD_BLOCK,   // 发送队列已满，未做任何处理
+    FAILED         // 参数错误或发送失败
+};
+
+/**
+ * @brief 共享内存入口/出口环条目flags中的消息边界标记
+ */
+constexpr uint32_t kRingMessageStart = 0x01;
+constexpr uint32_t kRingMessageEnd = 0x02;
+
 /**
  * @brief 多路径QUIC管理器
  * 
- * 整合QUIC连接、路径调度和FEC编码，提供统一的多路径传输接口
+ * 整合QUIC连接、路径调度和FEC编码，提供统一的多路径传输接口。
+ * 
+ * 线上每个包都是一个序列化的FECFrame：不受保护的数据使用STREAM_FRAME，
+ * 受保护的数据经MPQUICFECController编码为源帧/修复帧。
+ * FEC源块格式为 [u16 有效长度][u8 标志][u8 保留][数据]，
+ * 标志标记消息的首块/尾块，有效长度为0的块是组内填充。
+ * 能装入单个块的小消息由MessageCoalescer合并，这类块带合并标志，
+ * 数据为若干条长度前缀记录，每条是一条完整消息。
+ * 
+ * 每条应用流有独立的编码组序列（组ID高16位为流ID）和接收重组状态，
+ * 一条流的丢包或组填充等待不会阻塞其他流。
+ * 
+ * 编码并分配路径后的FEC块进入各路径的有界发送队列，传输层发送缓冲区
+ * 有空间时依次交出；队列满时按BackpressurePolicy处理（见set_backpressure）
  */
 class MPQUICManager {
 public:
@@ -22,7 +73,10 @@ public:
      */
     explicit MPQUICManager(bool use_real_quic = false);
     
-    ~MPQUICManager() = default;
+    /**
+     * @brief 停止后台编码线程
+     */
+    ~MPQUICManager();
 
     /**
      * @brief 初始化客户端连接
@@ -45,13 +99,58 @@ public:
     PathID add_path(const std::string& local_addr, uint16_t local_port,
                    const std::string& remote_addr, uint16_t remote_port);
 
+    /**
+     * @brief 为路径挂载链路Trace（回放RTT/丢包率/带宽变化）
+     * @return 底层连接支持Trace回放且加载成功时返回true
+     */
+    bool attach_path_trace(PathID path_id, const std::string& trace_file);
+
+    /**
+     * @brief 创建一条应用流
+     * 
+     * 流的编码组大小与冗余度由流量类别决定。流0在构造时以STREAMING类别创建
+     * @return 流ID（按创建顺序分配，即线上的流槽位，收发两端一致）
+     */
+    StreamID create_stream(TrafficClass traffic_class = TrafficClass::STREAMING);
+
     /**
      * @brief 发送数据（自动选择最优路径）
      * @param data 要发送的数据
      * @param use_fec 是否使用FEC保护
+     * @param stream_id 应用流ID（create_stream的返回值）
      * @return 成功返回true
      */
-    bool send_data(const std::vector<uint8_t>& data, bool use_fec = true);
+    bool send_data(const std::vector<uint8_t>& data, bool use_fec = true,
+                   StreamID stream_id = 0);
+
+    /**
+     * @brief 非阻塞发送：发送队列放不下受保护消息编码后的全部数据时不做处理，返回WOULD_BLOCK
+     * 
+     * 与策略无关，从不等待，也不丢弃已排队的数据；调用方稍后（如下一次process_events后）重试。
+     * 超过队列上限的消息只在队列为空时接受
+     */
+    SendResult try_send(const std::vector<uint8_t>& data, bool use_fec = true,
+                        StreamID stream_id = 0);
+
+    /**
+     * @brief 设置发送队列上限与队列满时的策略（默认BLOCK，4MiB）
+     * 
+     * - BLOCK: send_data在编码前等待队列放下整条消息，超过block_timeout_ms后失败且不发送任何组；
+     *   超过上限的消息等待队列清空，之后在组间等待队列回落。获准后消息的所有组都会发出
+     * - DROP_OLDEST: 照常入队，超出上限时丢弃最旧的排队块
+     * - DEGRADE_REDUNDANCY: 排队超过上限一半时各流冗余块减半（回落到1/4以下时恢复），
+     *   超出上限时先丢弃排队的冗余块，仍超出时丢弃最旧的块
+     * 
+     * 不受保护的数据不经过发送队列
+     * @throws std::invalid_argument max_queued_bytes为0
+     */
+    void set_backpressure(BackpressurePolicy policy, size_t max_queued_bytes,
+                          int block_timeout_ms = 1000);
+
+    /**
+     * @brief 发送队列中的字节数（各路径合计）
+     */
+    size_t get_queued_bytes() const { return send_queued_bytes_.load(std::memory_order_relaxed); }
 
     /**
      * @brief 在指定路径上发送数据
@@ -60,17 +159,38 @@ public:
 
     /**
      * @brief 配置FEC参数
+     * 
+     * 重建FEC控制器，(k, m)为初始值，运行中由OCO控制器按链路状态调整
      * @param k 数据块数量
      * @param m 冗余块数量
-     * @param block_size 块大小
+     * @param block_size 块大小（含4字节块头）
      */
     void configure_fec(uint32_t k, uint32_t m, uint32_t block_size);
 
+    /**
+     * @brief 设置小消息合并的等待上限（默认0，即关闭）
+     * 
+     * 能装入单个块的受保护消息先合并进所在流的当前块，块满或块中第一条消息
+     * 等待超过max_delay_us时才编码发送，同时完成该流未满的编码组。
+     * INTERACTIVE流不参与合并；共享内存入口的消息不经过合并器。
+     * 0表示关闭合并，每条消息单独成块并立即完成编码组。修改前先发出合并中的消息
+     */
+    void set_message_coalescing(uint32_t max_delay_us);
+
     /**
      * @brief 启用/禁用FEC
      */
     void enable_fec(bool enable);
 
+    /**
+     * @brief 设置FEC帧的承载方式
+     *
+     * 默认在连接支持时使用DATAGRAM；底层不支持时回退到STREAM
+     */
+    void set_fec_transport_mode(FECTransportMode mode);
+
+    FECTransportMode get_fec_transport_mode() const { return fec_transport_mode_; }
+
     /**
      * @brief 更新路径状态（供调度器使用）
      */
@@ -82,36 +202,311 @@ public:
     void set_data_received_callback(
         std::function<void(const std::vector<uint8_t>&)> callback);
 
+    /**
+     * @brief 设置带流ID的数据接收回调
+     */
+    void set_stream_data_received_callback(
+        std::function<void(StreamID, const std::vector<uint8_t>&)> callback);
+
     /**
      * @brief 获取连接统计信息
      */
     std::string get_statistics() const;
+    
+    /**
+     * @brief 开启Prometheus指标端点
+     * 
+     * 指标快照由process_events()按publish_interval_ms周期构建并发布，
+     * 抓取只读取已发布的快照，不会进入收发路径的任何锁
+     * @param unix_socket_path Unix域套接字路径，为空则不监听
+     * @param tcp_port 127.0.0.1上的TCP端口，-1不监听，0由内核分配
+     * @return 端点启动成功返回true
+     */
+    bool enable_metrics_endpoint(const std::string& unix_socket_path, int tcp_port = -1,
+                                 int publish_interval_ms = 1000);
+    
+    /**
+     * @brief 构建当前的连接/路径/阶段指标快照
+     */
+    MetricsSnapshot collect_metrics() const;
+    
+    /**
+     * @brief 立即发布一次指标快照（未开启端点时无操作）
+     */
+    void publish_metrics();
+
+    /**
+     * @brief 接入共享内存入口环（本进程为消费者）
+     *
+     * 生产者进程把消息按槽位切片直接写入环：条目的stream_id为应用流ID，
+     * flags以kRingMessageStart/kRingMessageEnd标记消息首尾。process_events()
+     * 在槽位headroom中就地写入4字节块头，把槽位整体交给编码器，负载不经过
+     * 中间缓冲区；FEC关闭时按消息拼接后直接发送。
+     * 受保护的条目同样受set_backpressure()约束：BLOCK策略下发送队列放不下时停止取出，
+     * 条目留在环中直到队列回落，生产者因环满而等待。
+     * 槽位负载不得超过一个FEC块的有效负载（块大小减4）
+     * @throws std::invalid_argument headroom不足4字节或槽位大于FEC块负载
+     */
+    void attach_ingress_ring(std::shared_ptr<ShmRing> ring);
+    
+    /**
+     * @brief 接入共享内存出口环（本进程为生产者）
+     *
+     * 重组完成的消息按槽位切片写入环（flags同入口环）。剩余槽位放不下整条消息时
+     * 丢弃该消息并计数，不阻塞接收路径；接收回调照常调用
+     */
+    void attach_egress_ring(std::shared_ptr<ShmRing> ring);
 
     /**
-     * @brief 关闭连接
+     * @brief 开启预热状态持久化
+     *
+     * 立即从state_file加载上次保存的路径模型（文件不存在或损坏时从零开始），
+     * 路径同步时按路径指纹（本地地址+远端前缀）恢复；close()时把本次学到的
+     * 状态合并写回state_file
+     * @return 加载到已保存状态时返回true
+     */
+    bool enable_warm_start(const std::string& state_file);
+    
+    /**
+     * @brief 立即保存预热状态（未开启时无操作）
+     */
+    void save_warm_start();
+
+    /**
+     * @brief 关闭连接（开启了预热状态持久化时先保存）
      */
     void close();
 
     /**
      * @brief 处理事件（需要在主循环中调用）
+     * 
+     * 接收到的数据在此调用线程上解码并触发接收回调
      */
     void process_events(int timeout_ms = 10);
 
 private:
+    // 重组完成的消息：(应用流ID, 数据)
+    using ReceivedMessages = std::vector<std::pair<StreamID, std::vector<uint8_t>>>;
+
+    /**
+     * @brief 单条应用流的接收重组状态
+     */
+    struct StreamReassembly {
+        std::map<uint64_t, std::vector<std::vector<uint8_t>>> decoded_groups;  // 按流内组序号排序
+        uint64_t next_group_seq = 1;
+        std::vector<uint8_t> partial_message;
+        bool in_message = false;
+        uint64_t head_blocked_seq = 0;                              // 正在等待的缺口组序号（0表示无缺口）
+        uint64_t head_blocked_since_us = 0;                         // 缺口出现时刻（Clock::now_us）
+    };
+
+    /**
+     * @brief send_data/try_send的共同实现
+     * @param may_block false时发送队列放不下整条消息即返回WOULD_BLOCK，从不等待
+     */
+    SendResult send_message(const std::vector<uint8_t>& data, bool use_fec, StreamID stream_id,
+                            bool may_block);
+
     /**
      * @brief 使用FEC编码并发送数据
+     * 
+     * 消息按块切分为任意多个编码组；多组消息以流水线方式处理，
+     * 发送第N组的同时在后台编码第N+1组。开始编码后不再放弃：消息的所有组都会入队
+     * @param reserved 调用方为本消息预留的发送队列字节数，随各组入队转为实际排队量
+     * @param pace_groups 超过队列上限的大消息在各组之间等待队列回落（超时后不再等待）
+     */
+    bool send_with_fec(const std::vector<uint8_t>& data, StreamID stream_id, size_t& reserved,
+                       bool pace_groups);
+
+    /**
+     * @brief 从offset起向控制器提交源块，直到完成一个编码组或消息结束
+     * @return 该组的全部数据包（源帧+修复帧）
      */
-    bool send_with_fec(const std::vector<uint8_t>& data);
+    std::vector<SendPacketMeta> encode_next_group(const std::vector<uint8_t>& data,
+                                                  size_t& offset, StreamID stream_id);
+
+    /**
+     * @brief 把一次组编码交给后台编码线程（首次调用时启动），按提交顺序执行
+     */
+    std::future<std::vector<SendPacketMeta>> submit_encode(
+        std::function<std::vector<SendPacketMeta>()> job);
+
+    /**
+     * @brief 后台编码线程主循环
+     */
+    void run_encode_worker();
 
     /**
      * @brief 直接发送数据（不使用FEC）
      */
-    bool send_without_fec(const std::vector<uint8_t>& data);
+    bool send_without_fec(const std::vector<uint8_t>& data, StreamID stream_id);
+
+    /**
+     * @brief 封装为STREAM_FRAME后在指定路径发送
+     */
+    bool send_unprotected(PathID path_id, StreamID stream_id, const std::vector<uint8_t>& data);
+
+    // 不由控制器分配包号的包（不参与确认反馈）
+    static constexpr uint64_t kUntrackedPacket = std::numeric_limits<uint64_t>::max();
+    
+    /**
+     * @brief 按当前承载方式发送一个FEC块（调用方持有send_mutex_）
+     * @param packet_number 控制器分配的包号，传输层确认/丢失时回报给控制器
+     */
+    bool send_fec_block_locked(PathID path_id, StreamID quic_stream, const PooledBuffer& block,
+                               uint64_t packet_number = kUntrackedPacket);
+
+    /**
+     * @brief 把小消息合并进所在流的当前块，块满时编码发送
+     */
+    bool coalesce_message(const std::vector<uint8_t>& data, StreamID stream_id);
+    
+    /**
+     * @brief 取出该流合并中的块并编码，使其先于随后的消息发出
+     */
+    void take_coalesced_block(StreamID stream_id, std::vector<SendPacketMeta>& out_packets);
+    
+    /**
+     * @brief 填写合并块的块头并交给控制器编码（调用方持有coalesce_mutex_）
+     */
+    void encode_coalesced_block_locked(std::vector<uint8_t>& block, StreamID stream_id,
+                                       std::vector<SendPacketMeta>& out_packets);
+    
+    /**
+     * @brief 发出已到截止时刻（force时为全部）的合并块，并完成这些流未满的编码组
+     * @return 距下一个截止时刻的微秒数，没有合并中的消息时返回UINT64_MAX
+     */
+    uint64_t flush_coalesced_messages(bool force);
+
+    /**
+     * @brief 把控制器产生的一批数据包放入发送队列并尽量交给传输层
+     * @param reserved 非空时从该预留中扣除入队的字节数
+     * @return 本次交出时有源块发送失败时返回false
+     */
+    bool send_packets(const std::vector<SendPacketMeta>& packets, size_t* reserved = nullptr);
+    
+    /**
+     * @brief 依次把各路径队首的块交给传输层，直到传输层发送缓冲区达到水位（调用方持有send_mutex_）
+     */
+    bool drain_send_queues_locked();
+    
+    /**
+     * @brief 队列超过上限时按策略丢弃排队的块（调用方持有send_mutex_）
+     */
+    void trim_send_queues_locked();
+    
+    /**
+     * @brief 估计一条消息编码后进入发送队列的字节数（上界）
+     */
+    size_t estimate_queued_bytes(size_t message_size, StreamID stream_id) const;
+    
+    /**
+     * @brief 在编码前为一条消息预留发送队列空间
+     * 
+     * 排队量加上已有预留放得下该消息，或两者均为0时获准；超过上限的大消息只能进入空队列
+     * @param wait true且为BLOCK策略时等待空间（最长block_timeout_ms），否则立即判断
+     * @return 获准时返回true，bytes计入预留，由调用方最终释放
+     */
+    bool reserve_send_queue(size_t bytes, bool wait);
+    
+    /**
+     * @brief 释放剩余的预留
+     */
+    void release_send_reservation(size_t& reserved);
+    
+    /**
+     * @brief BLOCK策略：等待发送队列回落到上限以下（其他策略直接返回true）
+     * @return 超时返回false
+     */
+    bool wait_for_send_queue();
+    
+    /**
+     * @brief 交出块并在send_space_cv_上等待，直到ready()成立或超过block_timeout_ms
+     * 
+     * 队列交出或丢弃块、预留释放、上限变化时被唤醒（调用方通过lock持有send_mutex_）
+     */
+    bool wait_send_space_locked(std::unique_lock<ProfiledMutex>& lock,
+                                const std::function<bool()>& ready);
+    
+    /**
+     * @brief 估计传输层最早何时能接受某条路径的队首块（调用方持有send_mutex_）
+     */
+    std::chrono::microseconds transport_drain_delay_locked() const;
+    
+    /**
+     * @brief DEGRADE_REDUNDANCY策略：按队列水位切换控制器的降冗余状态
+     */
+    void update_redundancy_degradation();
+    
+    /**
+     * @brief 等待传输层事件；发送队列非空时按1ms切片等待并交出块
+     */
+    void wait_transport_events(int timeout_ms);
+
+    /**
+     * @brief 在QUIC流上发送已序列化的帧
+     */
+    bool send_raw_on_path(PathID path_id, StreamID quic_stream, const PooledBuffer& bytes,
+                          uint64_t packet_number = kUntrackedPacket);
+    
+    /**
+     * @brief 登记一个已交给传输层的包：路径发送序号 -> 控制器包号（调用方持有send_mutex_）
+     */
+    void record_sent_packet_locked(PathID path_id, uint64_t packet_number);
+    
+    /**
+     * @brief 传输层确认/丢失回调：换算为控制器包号后转交控制器
+     */
+    void handle_packet_ack(PathID path_id, uint64_t sequence, bool acked, uint64_t rtt_us);
+
+    /**
+     * @brief 应用流对应的QUIC流（STREAM承载时各应用流互不阻塞）
+     */
+    StreamID quic_stream_for(StreamID stream_id) const;
+
+    /**
+     * @brief 处理接收到的数据报
+     */
+    void handle_received_datagram(PathID path_id, const std::vector<uint8_t>& data);
+
+    /**
+     * @brief 处理一个完整的FEC帧（调用方持有recv_mutex_）
+     */
+    void handle_received_frame(PathID path_id, const FECFrame& frame, ReceivedMessages& messages);
+
+    /**
+     * @brief 按组序号重组一条流已解码的组并交付消息（调用方持有recv_mutex_）
+     * @param skip_gap 队首缺口等待超时，直接跳过
+     */
+    void deliver_decoded_groups(StreamID stream_id, StreamReassembly& stream,
+                                ReceivedMessages& messages, bool skip_gap = false);
+
+    /**
+     * @brief 队首缺口等待超时后跳过，交付其后已解码的消息
+     */
+    void skip_stalled_groups();
+
+    /**
+     * @brief 调用接收回调，并写入出口环
+     */
+    void dispatch_messages(const ReceivedMessages& messages);
+    
+    /**
+     * @brief 处理入口环中已提交的条目（最多一圈，避免饿死其他事件）
+     */
+    void drain_ingress_ring();
+
+    /**
+     * @brief 重建FEC控制器，重新打开各应用流并同步路径
+     */
+    void reset_fec_controller();
 
     /**
      * @brief 处理接收到的数据
+     * @param path_id 这块数据到达的路径
      */
-    void handle_received_data(StreamID stream_id, 
+    void handle_received_data(PathID path_id,
+                            StreamID stream_id, 
                             const std::vector<uint8_t>& data,
                             bool fin);
 
@@ -122,26 +517,98 @@ private:
 
     std::unique_ptr<IQUICConnection> quic_conn_;
     std::unique_ptr<PathScheduler> scheduler_;
-    std::unique_ptr<FECEncoder> fec_encoder_;
-    std::unique_ptr<FECDecoder> fec_decoder_;
+    std::unique_ptr<MPQUICFECController> fec_controller_;
 
     StreamID data_stream_;
     bool fec_enabled_;
+    FECTransportMode fec_transport_mode_;
     
     // FEC配置
     uint32_t fec_k_;
     uint32_t fec_m_;
     uint32_t fec_block_size_;
 
-    // 接收缓冲区
-    std::map<uint32_t, std::vector<uint8_t>> recv_buffer_;
+    // 应用流：流量类别与承载的QUIC流（按应用流ID索引）
+    std::vector<TrafficClass> stream_classes_;
+    std::vector<StreamID> quic_streams_;
+    std::vector<bool> quic_stream_created_;
+
+    // 接收侧：各QUIC流的字节缓冲（流不保留帧边界）与各应用流的重组状态
+    ProfiledMutex recv_mutex_{LockSite::MANAGER_RECEIVE};
+    std::map<StreamID, std::vector<uint8_t>> stream_rx_buffers_;
+    std::map<StreamID, StreamReassembly> reassembly_;
     std::function<void(const std::vector<uint8_t>&)> data_received_callback_;
+    std::function<void(StreamID, const std::vector<uint8_t>&)> stream_data_received_callback_;
+    
+    // 多组消息的后台编码：一个常驻线程，发送第N组时编码第N+1组
+    std::mutex encode_mutex_;
+    std::condition_variable encode_cv_;
+    std::deque<std::packaged_task<std::vector<SendPacketMeta>()>> encode_jobs_;
+    bool encode_stop_ = false;
+    std::thread encode_thread_;
+    
+    // 小消息合并（按应用流），coalesce_delay_us_为0表示关闭
+    mutable ProfiledMutex coalesce_mutex_{LockSite::COALESCER};
+    std::map<StreamID, MessageCoalescer> coalescers_;
+    uint32_t coalesce_delay_us_;
+    uint64_t coalesced_messages_ = 0;
+    uint64_t coalesced_blocks_ = 0;
+    
+    // 确认反馈：各路径的发送序号与控制器包号的对应（传输层不支持时不登记）
+    mutable ProfiledMutex send_mutex_{LockSite::MANAGER_SEND};
+    bool packet_acks_ = false;
+    std::map<PathID, uint64_t> send_sequences_;
+    std::map<PathID, std::map<uint64_t, uint64_t>> sent_packets_;
+    
+    /**
+     * @brief 发送队列中的一个已序列化FEC块（存储取自BufferPool，出队即归还）
+     */
+    struct QueuedBlock {
+        StreamID quic_stream = 0;
+        PooledBuffer bytes;
+        uint64_t packet_number = kUntrackedPacket;
+        uint64_t order = 0;          // 入队顺序（跨路径比较新旧）
+        bool is_repair = false;
+    };
+    
+    // 发送队列（按路径，受send_mutex_保护）与背压配置
+    std::map<PathID, std::deque<QueuedBlock>> send_queues_;
+    std::atomic<size_t> send_queued_bytes_{0};
+    uint64_t send_queue_order_ = 0;
+    BackpressurePolicy backpressure_policy_ = BackpressurePolicy::BLOCK;
+    size_t max_queued_bytes_ = size_t(4) << 20;
+    int block_timeout_ms_ = 1000;
+    bool redundancy_degraded_ = false;
+    size_t send_reserved_bytes_ = 0;                     // 已获准、尚未入队的消息预留
+    std::condition_variable_any send_space_cv_;          // 配合send_mutex_，队列腾出空间时通知
+    std::atomic<uint64_t> send_queue_dropped_{0};       // 按块计
+    std::atomic<uint64_t> send_would_block_{0};
     
     // 统计信息
     uint64_t total_bytes_sent_;
     uint64_t total_bytes_received_;
     uint64_t fec_blocks_sent_;
     uint64_t fec_blocks_recovered_;
+    
+    // 指标端点
+    std::unique_ptr<MetricsExporter> metrics_exporter_;
+    std::chrono::milliseconds metrics_interval_{1000};
+    std::chrono::steady_clock::time_point last_metrics_publish_;
+    
+    // 共享内存入口/出口环
+    std::shared_ptr<ShmRing> ingress_ring_;
+    std::map<StreamID, std::vector<uint8_t>> ingress_partial_;   // FEC关闭时拼接中的消息
+    uint64_t ingress_entries_ = 0;
+    uint64_t ingress_bytes_ = 0;
+    uint64_t ingress_blocked_ = 0;   // BLOCK策略下因发送队列已满暂停取出的次数
+    std::shared_ptr<ShmRing> egress_ring_;
+    ProfiledMutex egress_mutex_{LockSite::SHM_EGRESS};           // 接收回调可能来自多个线程
+    std::atomic<uint64_t> egress_entries_{0};
+    std::atomic<uint64_t> egress_dropped_{0};                    // 按消息计
+    
+    // 预热状态（warm_state_file_为空表示未开启）
+    std::string warm_state_file_;
+    WarmStartStore warm_store_;
 };
 
 } // namespace mpquic_fec
@@ -135,6 +135,17 @@ public:
      */
     std::vector<LinkMetrics> get_all_metrics() const;
     
+    /**
+     * @brief 获取路径间丢包相关性（未设置时为0）
+     */
+    double get_loss_correlation(uint32_t path_i, uint32_t path_j) const;
+    
+    /**
+     * @brief 获取/设置路径的梯度累积（用于预热状态的保存与恢复）
+     */
+    double get_gradient_accumulator(uint32_t path_id) const;
+    void set_gradient_accumulator(uint32_t path_id, double value);
+    
 private:
     // 链路质量指标缓存
     std::map<uint32_t, LinkMetrics> link_metrics_;
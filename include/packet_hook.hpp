@@ -3,6 +3,10 @@
 #include "fec_encoder.hpp"
 #include "fec_frame.hpp"
 #include "buffer_manager.hpp"
+#include "hugepage_arena.hpp"
+#include "instrumented_mutex.hpp"
+#include "memory_accounting.hpp"
+#include <deque>
 #include <queue>
 #include <memory>
 #include <mutex>
@@ -16,7 +20,7 @@ namespace mpquic_fec {
 struct PendingPacket {
     uint64_t packet_number;      // 包序号
     uint32_t path_id;            // 原始路径ID
-    std::vector<uint8_t> data;   // 原始数据
+    ArenaBytes data;             // 原始数据（分配自HugePageArena）
     uint64_t timestamp_us;       // 时间戳
     
     PendingPacket() : packet_number(0), path_id(0), timestamp_us(0) {}
@@ -32,8 +36,9 @@ struct EncodingGroup {
     std::vector<FECFrame> repair_frames;
     bool is_encoded;
     uint64_t created_time_us;
+    size_t accounted_bytes;      // 进入已编码缓存时记入MemoryAccount的字节数
     
-    EncodingGroup() : group_id(0), is_encoded(false), created_time_us(0) {}
+    EncodingGroup() : group_id(0), is_encoded(false), created_time_us(0), accounted_bytes(0) {}
 };
 
 /**
@@ -46,15 +51,24 @@ struct EncodingGroup {
  */
 class FECGroupManager {
 public:
+    // 已编码组缓存的组数上限（供补发重建帧），超过时丢弃最旧的组
+    static constexpr size_t kMaxEncodedGroups = 1024;
+    
+    /**
+     * @param first_group_id 首个组ID（多流时包含流槽位前缀，见make_stream_group_id）
+     */
     FECGroupManager(uint32_t default_k = 4, uint32_t default_m = 2, 
-                   uint32_t block_size = 1200);
+                   uint32_t block_size = 1200, uint64_t first_group_id = 1);
     ~FECGroupManager() = default;
     
     /**
      * @brief 添加待编码的数据包
+     * 
+     * 不足block_size的数据补零；超过block_size时抛出std::invalid_argument
      * @return 如果形成完整编码组，返回组ID；否则返回0
      */
     uint64_t add_source_packet(const PendingPacket& packet);
+    uint64_t add_source_packet(PendingPacket&& packet);
     
     /**
      * @brief 获取已编码完成的组
@@ -63,19 +77,33 @@ public:
     
     /**
      * @brief 强制编码当前未完成的组（用于超时或主动刷新）
+     * 
+     * 不足k个源块的组按实际源块数s编码为(s, m)组，不补零块
      */
     std::vector<uint64_t> flush_pending_groups();
     
     /**
      * @brief 更新编码参数 (k, m)
+     * @return 以旧参数强制完成的组ID（调用方需发送这些组）
      */
-    void update_coding_params(uint32_t k, uint32_t m);
+    std::vector<uint64_t> update_coding_params(uint32_t k, uint32_t m);
     
     /**
      * @brief 清理已完成的编码组
      */
     void cleanup_old_groups(uint64_t before_group_id);
     
+    /**
+     * @brief 从最旧的已编码组开始驱逐，直到释放至少bytes字节
+     * @return 实际释放的字节数
+     */
+    size_t evict_oldest(size_t bytes);
+    
+    /**
+     * @brief 设置内存账户（已编码组缓存记在 MemoryTag::ENCODE_GROUPS 下）
+     */
+    void set_memory_account(std::shared_ptr<MemoryAccount> account);
+    
     /**
      * @brief 获取当前编码参数
      */
@@ -83,6 +111,13 @@ public:
         return {current_k_, current_m_};
     }
     
+    /**
+     * @brief 下一个将要分配的组ID
+     */
+    uint64_t next_group_id() const { return next_group_id_; }
+    
+    uint32_t block_size() const { return block_size_; }
+    
 private:
     // 当前编码参数
     uint32_t current_k_;
@@ -91,27 +126,36 @@ private:
     
     // 编码器
     std::unique_ptr<FECEncoder> encoder_;
+    // 未满组按实际源块数编码所用的编码器（按源块数缓存）
+    std::map<uint32_t, std::unique_ptr<FECEncoder>> short_encoders_;
     
     // 当前正在积累的编码组
     std::shared_ptr<EncodingGroup> current_group_;
     
-    // 已完成的编码组缓存
-    std::map<uint64_t, std::shared_ptr<EncodingGroup>> encoded_groups_;
+    // 已完成的编码组缓存（组对象、map节点与块负载均分配自HugePageArena）
+    std::map<uint64_t, std::shared_ptr<EncodingGroup>, std::less<uint64_t>,
+             ArenaAllocator<std::pair<const uint64_t, std::shared_ptr<EncodingGroup>>>>
+        encoded_groups_;
     
     // 下一个组ID
     uint64_t next_group_id_;
     
     // 线程安全（使用递归互斥锁以支持 update_coding_params 调用 flush_pending_groups）
-    std::recursive_mutex mutex_;
+    ProfiledRecursiveMutex mutex_{LockSite::GROUP_MANAGER};
     
     // 执行FEC编码
     void perform_encoding(std::shared_ptr<EncodingGroup> group);
     
+    // 取源块数为k（当前m）的编码器
+    FECEncoder& encoder_for(uint32_t k);
+    
     // 创建新的编码组
     std::shared_ptr<EncodingGroup> create_new_group();
     
-    // 获取当前时间戳（微秒）
-    uint64_t get_timestamp_us() const;
+    // 把已编码的组放入缓存并记账
+    void store_encoded_group(const std::shared_ptr<EncodingGroup>& group);
+    
+    std::shared_ptr<MemoryAccount> memory_account_;
 };
 
 /**
@@ -138,6 +182,25 @@ public:
                        const std::vector<uint8_t>& stream_data,
                        std::vector<FECFrame>& out_packets);
     
+    /**
+     * @brief 同上，数据直接从调用方缓冲区（如共享内存槽位）复制进编码块
+     */
+    bool on_packet_send(uint64_t packet_num, uint32_t path_id,
+                       const uint8_t* data, size_t size,
+                       std::vector<FECFrame>& out_packets);
+    
+    /**
+     * @brief 强制完成当前未满的编码组，输出其源帧和修复帧
+     * @return 是否输出了帧
+     */
+    bool flush(std::vector<FECFrame>& out_packets);
+    
+    /**
+     * @brief 从已编码组缓存重建指定块的帧（用于探测和失效路径的补发）
+     * @return 组已被清理或块索引越界时返回false
+     */
+    bool rebuild_frame(uint64_t group_id, uint32_t block_index, FECFrame& out_frame);
+    
     /**
      * @brief 设置是否启用FEC
      */
@@ -155,12 +218,15 @@ private:
     
     // 待发送的FEC帧队列
     std::queue<FECFrame> pending_frames_;
-    mutable std::mutex queue_mutex_;
+    mutable ProfiledMutex queue_mutex_{LockSite::SEND_QUEUE};
+    
+    // 输出已编码组的全部帧
+    bool append_group_frames(uint64_t group_id, std::vector<FECFrame>& out_packets);
     
     // 包装原始数据为FEC源帧
     FECFrame wrap_source_frame(uint64_t group_id, uint32_t block_idx,
-                               uint32_t total_blocks, 
-                               const std::vector<uint8_t>& data);
+                               uint32_t source_blocks, uint32_t total_blocks,
+                               const ArenaBytes& data);
 };
 
 /**
@@ -173,9 +239,26 @@ public:
     PacketReceiveHook();
     ~PacketReceiveHook() = default;
     
+    /**
+     * @brief 接收统计
+     */
+    struct Statistics {
+        uint64_t frames_received;
+        uint64_t groups_decoded;
+        uint64_t blocks_recovered;   // 由冗余块重建的丢失源块数
+        uint64_t decode_failures;
+        uint64_t groups_evicted;     // 因内存预算被驱逐的未完成接收组
+        
+        Statistics() : frames_received(0), groups_decoded(0),
+                      blocks_recovered(0), decode_failures(0), groups_evicted(0) {}
+    };
+    
     /**
      * @brief 接收FEC帧
-     * @return 如果成功恢复了数据，返回恢复的原始数据
+     * 
+     * 帧头给出的k、m不可解码（为0或k+m超过256）或块索引超出组时丢弃该帧，
+     * 计入decode_failures
+     * @return 组解码完成时返回该组全部k个源块（按块索引排列），否则为空
      */
     std::vector<std::vector<uint8_t>> on_frame_received(const FECFrame& frame);
     
@@ -184,24 +267,63 @@ public:
      */
     bool can_decode_group(uint64_t group_id);
     
+    /**
+     * @brief 清理 [from_group_id, before_group_id) 范围内的接收组
+     */
+    void cleanup_old_groups(uint64_t before_group_id, uint64_t from_group_id = 0);
+    
+    /**
+     * @brief 按到达顺序从最早的接收组开始驱逐，直到释放至少bytes字节
+     * @return 实际释放的字节数
+     */
+    size_t evict_oldest(size_t bytes);
+    
+    /**
+     * @brief 丢弃缓存的解码器（之后按需重建）
+     * @return 释放的字节数
+     */
+    size_t evict_decoders();
+    
+    /**
+     * @brief 设置内存账户（接收组记在 RECEIVE_GROUPS，解码器记在 DECODERS 下）
+     */
+    void set_memory_account(std::shared_ptr<MemoryAccount> account);
+    
+    Statistics get_statistics();
+    
 private:
-    // 接收缓冲区：按组ID组织
+    // 接收缓冲区：按组ID组织，节点分配自HugePageArena，帧负载取自BufferPool
     struct ReceivedGroup {
         FECGroupInfo info;
-        std::map<uint32_t, FECFrame> received_frames;  // block_index -> frame
+        std::map<uint32_t, PooledBuffer, std::less<uint32_t>,
+                 ArenaAllocator<std::pair<const uint32_t, PooledBuffer>>>
+            received_frames;  // block_index -> payload
         bool is_complete;
+        size_t accounted_bytes;   // 记入MemoryAccount的字节数
         
-        ReceivedGroup() : is_complete(false) {}
+        ReceivedGroup() : is_complete(false), accounted_bytes(0) {}
     };
     
-    std::map<uint64_t, ReceivedGroup> received_groups_;
-    std::recursive_mutex mutex_;
+    std::map<uint64_t, ReceivedGroup, std::less<uint64_t>,
+             ArenaAllocator<std::pair<const uint64_t, ReceivedGroup>>>
+        received_groups_;
+    ProfiledRecursiveMutex mutex_{LockSite::RECEIVE_HOOK};
+    Statistics stats_;
+    
+    // 接收组的创建顺序（驱逐用；可能含已清理的组ID，驱逐时跳过）
+    std::deque<uint64_t> arrival_order_;
+    
+    std::shared_ptr<MemoryAccount> memory_account_;
     
     // 解码器映射（按k,m缓存）
     std::map<std::pair<uint32_t, uint32_t>, std::unique_ptr<FECDecoder>> decoders_;
     
     // 尝试解码组
     std::vector<std::vector<uint8_t>> try_decode_group(uint64_t group_id);
+    
+    // 记账辅助（账户未设置时不记）
+    void charge(MemoryTag tag, size_t bytes);
+    void release(MemoryTag tag, size_t bytes);
 };
 
 } // namespace mpquic_fec
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <cstdint>
+#include <deque>
 #include <map>
 #include <memory>
 
@@ -28,6 +29,23 @@ struct PathState {
                   bytes_sent(0), bytes_acked(0), jitter_ms(0), cwnd(0) {}
 };
 
+/**
+ * @brief 路径活性状态（由ACK静默判定）
+ */
+enum class PathLiveness {
+    ALIVE,      // 正常调度（含尚未纳入监测的路径）
+    PROBING,    // ACK静默超过PTO：退出调度，只发送探测包
+    DEAD        // 连续多次探测无应答：判定失效，继续退避探测以发现恢复
+};
+
+/**
+ * @brief 一次活性检查的结果
+ */
+struct LivenessCheck {
+    std::vector<uint32_t> probe_paths;    // 需要在该路径上发送一个探测包
+    std::vector<uint32_t> failed_paths;   // 本次刚退出调度的路径（其在途数据需要补发）
+};
+
 /**
  * @brief 基于在线凸优化(OCO)的路径调度器
  * 
@@ -74,6 +92,11 @@ public:
      * @return path_id -> 权重 (0到1之间，总和为1)
      */
     std::map<uint32_t, double> get_path_weights() const;
+    
+    /**
+     * @brief 设置路径权重（其余路径按比例缩放，总和保持为1）
+     */
+    void set_path_weight(uint32_t path_id, double weight);
 
     /**
      * @brief 获取路径统计信息
@@ -91,11 +114,73 @@ public:
     void update_path_correlation(uint32_t path_i, uint32_t path_j, double correlation);
     
     /**
-     * @brief 检查路径是否可用
+     * @brief 检查路径是否可用（指标达标且未因ACK静默退出调度）
      */
     bool is_path_available(uint32_t path_id) const;
+    
+    /**
+     * @brief 记录一次发送，用于ACK静默判定
+     * 
+     * 收到第一个ACK之前（传输层不提供ACK反馈时）不记录，所有路径保持ALIVE
+     */
+    void on_packet_sent(uint32_t path_id, uint64_t now_us);
+    
+    /**
+     * @brief 记录一次ACK
+     * 
+     * 更新平滑RTT，视该包发出前的在途包为已应答，路径恢复ALIVE
+     * @return 路径此前已退出调度时返回true
+     */
+    bool on_packet_acked(uint32_t path_id, uint64_t rtt_us, uint64_t now_us);
+    
+    /**
+     * @brief 检查各路径的ACK静默
+     * 
+     * 最早的未应答包发出后超过一个PTO仍无ACK时，路径转为PROBING并退出调度；
+     * 此后每个PTO（指数退避）请求一次探测，连续kMaxProbes次无应答转为DEAD
+     */
+    LivenessCheck check_liveness(uint64_t now_us);
+    
+    /**
+     * @brief 是否已开始活性监测（收到过ACK）
+     */
+    bool is_liveness_monitored() const { return liveness_monitored_; }
+    
+    /**
+     * @brief 获取路径活性状态
+     */
+    PathLiveness get_path_liveness(uint32_t path_id) const;
+    
+    /**
+     * @brief 路径当前的探测超时：srtt + max(4·rttvar, 1ms) + max_ack_delay
+     * 
+     * 尚无RTT样本时以上报的RTT（未知时333ms）为初值
+     */
+    uint64_t get_pto_us(uint32_t path_id) const;
 
 private:
+    /**
+     * @brief 单条路径的活性监测状态
+     */
+    struct LivenessState {
+        PathLiveness status = PathLiveness::ALIVE;
+        bool rtt_sampled = false;
+        uint64_t srtt_us = 0;
+        uint64_t rttvar_us = 0;
+        uint64_t last_ack_us = 0;
+        uint64_t last_probe_us = 0;
+        uint32_t probe_count = 0;
+        std::deque<uint64_t> unacked_send_us;   // 未应答包的发送时刻（按发送顺序）
+    };
+    
+    static constexpr uint32_t kMaxProbes = 3;                // 转为DEAD前的探测次数
+    static constexpr uint32_t kMaxProbeBackoff = 6;          // 探测间隔最多退避到64个PTO
+    static constexpr uint64_t kTimerGranularityUs = 1000;
+    static constexpr uint64_t kMaxAckDelayUs = 25000;        // 对端默认max_ack_delay（RFC 9000）
+    static constexpr uint64_t kInitialRttUs = 333000;        // RFC 9002 初始RTT
+    static constexpr size_t kMaxTrackedSends = 4096;
+    
+
     std::map<uint32_t, PathState> paths_;
     std::map<uint32_t, double> weights_;  // 当前路径权重
     
@@ -105,6 +190,10 @@ private:
     // 路径间丢包相关性矩阵（简化版）
     std::map<std::pair<uint32_t, uint32_t>, double> path_correlations_;
     
+    // 活性监测（收到第一个ACK后开启）
+    std::map<uint32_t, LivenessState> liveness_;
+    bool liveness_monitored_ = false;
+    
     double alpha_ = 0.1;  // 学习率
     double beta_ = 0.5;   // RTT权重系数
     double gamma_ = 0.3;  // 丢包率权重系数
@@ -127,8 +216,16 @@ private:
     
     /**
      * @brief 找到与指定路径相关性最低的路径
+     * @param available_only 只在可用路径中选择
      */
-    uint32_t find_least_correlated_path(uint32_t path_id) const;
+    uint32_t find_least_correlated_path(uint32_t path_id, bool available_only) const;
+    
+    /**
+     * @brief 是否至少有一条可用路径（全部不可用时选路退回到所有路径）
+     */
+    bool has_available_path() const;
+    
+    uint64_t pto_us(uint32_t path_id, const LivenessState& state) const;
 };
 
 } // namespace mpquic_fec
@@ -42,25 +42,47 @@ struct QUICPathInfo {
     bool is_active;
     double rtt_ms;
     double loss_rate;
+    double bandwidth_mbps;   // 0表示未知
     uint64_t bytes_sent;
     uint64_t bytes_received;
     
     QUICPathInfo() 
         : path_id(0), local_port(0), remote_port(0), 
-          is_active(false), rtt_ms(0), loss_rate(0),
+          is_active(false), rtt_ms(0), loss_rate(0), bandwidth_mbps(0),
           bytes_sent(0), bytes_received(0) {}
 };
 
 /**
  * @brief 数据接收回调函数类型
+ * @param path_id 这块数据到达的路径
  * @param stream_id 流ID
  * @param data 接收到的数据
  * @param fin 是否为流的最后一块数据
  */
-using DataRecvCallback = std::function<void(StreamID stream_id, 
+using DataRecvCallback = std::function<void(PathID path_id,
+                                            StreamID stream_id, 
                                             const std::vector<uint8_t>& data, 
                                             bool fin)>;
 
+/**
+ * @brief DATAGRAM接收回调函数类型（QUIC DATAGRAM扩展，RFC 9221）
+ * @param path_id 接收路径
+ * @param data 数据报内容
+ */
+using DatagramRecvCallback = std::function<void(PathID path_id,
+                                                const std::vector<uint8_t>& data)>;
+
+/**
+ * @brief 包确认/丢失回调函数类型
+ * @param path_id 发送路径
+ * @param sequence 包在该路径上的发送序号：send_on_path/send_datagram_on_path
+ *                 每成功交给传输层一个包，该路径的序号加1（从1开始）
+ * @param acked true为对端已确认，false为判定丢失
+ * @param rtt_us 确认时的RTT样本（微秒），丢失时为0
+ */
+using PacketAckCallback = std::function<void(PathID path_id, uint64_t sequence,
+                                             bool acked, uint64_t rtt_us)>;
+
 /**
  * @brief 连接状态变化回调函数类型
  * @param old_state 旧状态
@@ -125,6 +147,46 @@ public:
                                 const std::vector<uint8_t>& data,
                                 bool fin = false) = 0;
 
+    /**
+     * @brief 是否支持不可靠的DATAGRAM传输
+     */
+    virtual bool supports_datagrams() const = 0;
+
+    /**
+     * @brief 单个DATAGRAM可承载的最大字节数
+     */
+    virtual size_t max_datagram_size() const = 0;
+
+    /**
+     * @brief 在指定路径上发送不可靠数据报
+     *
+     * 与流不同，数据报丢失后不会重传，也不存在队头阻塞；
+     * 可靠性完全由上层（FEC）负责
+     * @param path_id 路径ID
+     * @param data 数据报内容（不超过max_datagram_size()）
+     * @return 交给传输层的字节数，0表示发送失败（丢失不会报告）
+     */
+    virtual size_t send_datagram_on_path(PathID path_id,
+                                         const std::vector<uint8_t>& data) = 0;
+
+    /**
+     * @brief send_on_path的指针版本，供上层直接发送缓冲池中的数据
+     *
+     * 默认实现拷贝到临时vector后转发；实现方可覆盖以省去这次分配
+     */
+    virtual size_t send_bytes_on_path(PathID path_id, StreamID stream_id,
+                                      const uint8_t* data, size_t size, bool fin = false) {
+        return send_on_path(path_id, stream_id, std::vector<uint8_t>(data, data + size), fin);
+    }
+
+    /**
+     * @brief send_datagram_on_path的指针版本（默认实现同上）
+     */
+    virtual size_t send_datagram_bytes_on_path(PathID path_id, const uint8_t* data,
+                                               size_t size) {
+        return send_datagram_on_path(path_id, std::vector<uint8_t>(data, data + size));
+    }
+
     /**
      * @brief 关闭流
      * @param stream_id 流ID
@@ -166,6 +228,20 @@ public:
      */
     virtual void remove_path(PathID path_id) = 0;
 
+    /**
+     * @brief 为路径挂载链路Trace（仅模拟实现支持）
+     *
+     * 挂载后路径的RTT、丢包率和带宽随时间按Trace回放，
+     * 用于可复现的性能对比。真实传输无需网络仿真，默认返回false
+     * @param path_id 路径ID
+     * @param trace_file JSON或CSV格式的Trace文件
+     * @return 成功返回true
+     */
+    virtual bool set_path_trace(PathID path_id [[maybe_unused]],
+                                const std::string& trace_file [[maybe_unused]]) {
+        return false;
+    }
+
     /**
      * @brief 获取所有路径信息
      */
@@ -181,6 +257,30 @@ public:
      */
     virtual void set_data_recv_callback(DataRecvCallback callback) = 0;
 
+    /**
+     * @brief 设置DATAGRAM接收回调
+     */
+    virtual void set_datagram_recv_callback(DatagramRecvCallback callback) = 0;
+
+    /**
+     * @brief 设置包确认/丢失回调（在process_events()所在线程上调用）
+     *
+     * 上层据此测量各路径的RTT并检测ACK静默。默认不支持，返回false
+     * @return 传输层会报告确认结果时返回true
+     */
+    virtual bool set_packet_ack_callback(PacketAckCallback callback [[maybe_unused]]) {
+        return false;
+    }
+
+    /**
+     * @brief 路径发送缓冲区中尚未发出的字节数
+     *
+     * 上层据此控制交给传输层的数据量；缓冲区满时send_*返回0。默认返回0（不报告积压）
+     */
+    virtual size_t get_send_queue_bytes(PathID path_id [[maybe_unused]]) const {
+        return 0;
+    }
+
     /**
      * @brief 设置状态变化回调
      */
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace mpquic_fec {
+
+/**
+ * @brief 共享内存环的一个已提交条目（消费者视角，指向共享内存，release()前有效）
+ */
+struct ShmRingEntry {
+    uint8_t* data;        // 负载起始地址
+    uint32_t length;      // 负载长度
+    uint32_t stream_id;
+    uint32_t flags;       // 由使用方定义（如消息首尾标记）
+    uint32_t headroom;    // data之前可写的字节数，消费者可在此就地加头部
+
+    ShmRingEntry() : data(nullptr), length(0), stream_id(0), flags(0), headroom(0) {}
+};
+
+/**
+ * @brief 跨进程单生产者单消费者共享内存环
+ *
+ * 环位于一个memfd中（已封印大小，对端无法截断），另有两个eventfd门铃：
+ * data门铃由生产者提交后敲响，space门铃由消费者释放槽位后敲响。
+ * 只有对方声明正在等待时才敲门铃，稳态收发不进入内核。
+ *
+ * 每个槽位是定长的 [元数据][headroom][负载]：生产者 try_reserve() 拿到负载
+ * 区指针后直接在共享内存中写数据，commit() 发布；消费者 peek() 得到指向同一
+ * 块内存的条目，处理完 release() 归还。三个fd可通过Unix域套接字
+ * （send_fds/receive）交给另一个进程，两端映射同一块内存。
+ *
+ * 一个进程只能使用生产者或消费者一侧的接口，每侧只允许一个线程
+ */
+class ShmRing {
+public:
+    /**
+     * @brief 创建新的环（创建方持有全部fd）
+     * @param slot_count 槽位数，向上取整为2的幂
+     * @param slot_size 每个槽位的负载容量（字节）
+     * @param headroom 每个槽位负载前预留给消费者的字节数
+     * @throws std::invalid_argument 参数非法；std::runtime_error 系统调用失败
+     */
+    static std::unique_ptr<ShmRing> create(size_t slot_count, size_t slot_size,
+                                           size_t headroom = 0);
+
+    /**
+     * @brief 映射已有的环（接管fd的所有权，校验头部与文件大小）
+     * @throws std::runtime_error 头部非法或映射失败
+     */
+    static std::unique_ptr<ShmRing> attach(int memory_fd, int data_event_fd, int space_event_fd);
+
+    /**
+     * @brief 从Unix域套接字接收对端send_fds()发来的环
+     * @throws std::runtime_error 接收失败或消息中没有3个fd
+     */
+    static std::unique_ptr<ShmRing> receive(int unix_socket);
+
+    ~ShmRing();
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    /**
+     * @brief 通过Unix域套接字（SCM_RIGHTS）把三个fd发给对端
+     * @throws std::runtime_error 发送失败
+     */
+    void send_fds(int unix_socket) const;
+
+    // ---------- 生产者侧 ----------
+
+    /**
+     * @brief 预留下一个空闲槽位
+     * @return 负载区指针（容量slot_size()），环满时返回nullptr
+     */
+    uint8_t* try_reserve();
+
+    /**
+     * @brief 发布try_reserve()预留的槽位
+     * @throws std::invalid_argument 没有预留槽位或长度超过slot_size()
+     */
+    void commit(uint32_t length, uint32_t stream_id = 0, uint32_t flags = 0);
+
+    /**
+     * @brief 复制一段数据到下一个槽位并发布（不需要就地写入时的便捷接口）
+     * @return 环满时返回false
+     */
+    bool try_write(const uint8_t* data, size_t length, uint32_t stream_id = 0,
+                   uint32_t flags = 0);
+
+    /**
+     * @brief 等待空闲槽位
+     * @return 有空闲槽位时返回true，超时返回false（timeout_ms < 0 表示一直等待）
+     */
+    bool wait_for_space(int timeout_ms);
+
+    // ---------- 消费者侧 ----------
+
+    /**
+     * @brief 查看最早的已提交条目（不出队）
+     * @return 环空时返回false
+     * @throws std::runtime_error 共享内存中的游标或长度被对端破坏
+     */
+    bool peek(ShmRingEntry& entry);
+
+    /**
+     * @brief 归还peek()得到的槽位
+     */
+    void release();
+
+    /**
+     * @brief 等待已提交条目
+     * @return 有条目时返回true，超时返回false（timeout_ms < 0 表示一直等待）
+     */
+    bool wait_for_data(int timeout_ms);
+
+    // ---------- 查询 ----------
+
+    size_t slot_count() const { return slot_count_; }
+    size_t slot_size() const { return slot_size_; }
+    size_t headroom() const { return headroom_; }
+
+    /**
+     * @brief 当前已提交未释放的条目数
+     */
+    size_t size() const;
+
+    int memory_fd() const { return memory_fd_; }
+    int data_event_fd() const { return data_event_fd_; }
+    int space_event_fd() const { return space_event_fd_; }
+
+private:
+    struct Header;
+    struct SlotMeta;
+
+    ShmRing(int memory_fd, int data_event_fd, int space_event_fd);
+
+    void map(size_t bytes);
+    SlotMeta* slot(uint64_t index) const;
+    uint8_t* payload(SlotMeta* meta) const;
+
+    static void ring_doorbell(int event_fd);
+    static bool wait_doorbell(int event_fd, int timeout_ms);
+
+    int memory_fd_;
+    int data_event_fd_;
+    int space_event_fd_;
+
+    uint8_t* base_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    Header* header_ = nullptr;
+
+    // 几何参数在映射后从头部读出并固定，不再信任共享内存中的值
+    size_t slot_count_ = 0;
+    size_t slot_size_ = 0;
+    size_t headroom_ = 0;
+    size_t slot_stride_ = 0;
+
+    bool reserved_ = false;   // 生产者：已预留未提交
+};
+
+} // namespace mpquic_fec
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "clock.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 热路径分阶段计时开关
+ *
+ * 由CMake选项 MPQUIC_FEC_STAGE_TIMING 设置；未开启时 MPQUIC_FEC_STAGE_SCOPE
+ * 展开为空，热路径上不留任何指令
+ */
+#ifndef MPQUIC_FEC_STAGE_TIMING
+#define MPQUIC_FEC_STAGE_TIMING 0
+#endif
+
+namespace mpquic_fec {
+
+/**
+ * @brief 热路径阶段（统计数组下标）
+ */
+enum class Stage : uint8_t {
+    // 发送方向：send_stream_data → 交给传输层
+    SEND_HOOK_INGEST,       // 控制器入口、Hook拦截、组完成后的帧封装
+    SEND_GROUP_ACCUMULATE,  // 源包加入编码组（补零、入队）
+    SEND_ENCODE,            // 编码组RS编码
+    SEND_PATH_SELECT,       // 源/冗余路径选择
+    SEND_PN_MAPPING,        // 包号分配与映射登记
+    SEND_TRANSPORT_HANDOFF, // 序列化并交给QUIC连接
+    // 接收方向：传输层回调 → 按序交付
+    RECV_TRANSPORT_INGEST,  // 流/数据报切帧与反序列化
+    RECV_FRAME_INGEST,      // 接收组查找与帧缓存
+    RECV_DECODE,            // 编码组解码
+    RECV_REASSEMBLY,        // 组内解块、流内排序
+    COUNT
+};
+
+constexpr size_t kStageCount = static_cast<size_t>(Stage::COUNT);
+// 对数直方图：每个2的幂区间再四等分，相对误差不超过25%
+constexpr size_t kStageHistogramSubBuckets = 4;
+constexpr size_t kStageHistogramBuckets = 63 * kStageHistogramSubBuckets;
+
+/**
+ * @brief 阶段计时的tick读数（见read_tsc）
+ */
+inline uint64_t read_stage_ticks() {
+    return read_tsc();
+}
+
+/**
+ * @brief 单个阶段的耗时统计快照
+ *
+ * buckets[i] 统计耗时落在 [bucket_lower(i), bucket_upper(i)) 个tick内的样本数，
+ * 除以 ticks_per_ns 换算为纳秒
+ */
+struct StageTimingStats {
+    Stage stage = Stage::COUNT;
+    const char* name = "";
+    uint64_t count = 0;
+    double total_ns = 0;
+    double mean_ns = 0;
+    double p50_ns = 0;          // 按直方图桶上界估计
+    double p99_ns = 0;
+    double max_ns = 0;
+    double ticks_per_ns = 1;
+    std::array<uint64_t, kStageHistogramBuckets> buckets{};
+};
+
+/**
+ * @brief 分阶段耗时直方图（全局）
+ *
+ * 各阶段记录的是自身耗时：嵌套在内的其他阶段耗时被扣除，
+ * 因此各阶段之和即端到端耗时，不会重复计算。
+ * 记录路径只有两次TSC读取和几次relaxed原子加；
+ * TSC频率在读取快照时按steady_clock校准
+ */
+class StageTiming {
+public:
+    /**
+     * @brief 全局实例（有意不析构：静态对象析构期间仍可能记录）
+     */
+    static StageTiming& instance();
+
+    StageTiming(const StageTiming&) = delete;
+    StageTiming& operator=(const StageTiming&) = delete;
+
+    static constexpr bool compiled_in() {
+        return MPQUIC_FEC_STAGE_TIMING != 0;
+    }
+
+    static const char* stage_name(Stage stage);
+
+    /**
+     * @brief 直方图桶的tick区间 [lower, upper)
+     */
+    static double bucket_lower(size_t bucket);
+    static double bucket_upper(size_t bucket);
+
+    /**
+     * @brief tick数所在的直方图桶
+     */
+    static size_t bucket_for(uint64_t ticks) {
+        if (ticks < kStageHistogramSubBuckets) {
+            return static_cast<size_t>(ticks);
+        }
+        // 最高位所在的2的幂区间 + 其后两位
+        int octave = 63 - __builtin_clzll(ticks);
+        size_t sub = static_cast<size_t>(ticks >> (octave - 2)) & (kStageHistogramSubBuckets - 1);
+        return static_cast<size_t>(octave - 1) * kStageHistogramSubBuckets + sub;
+    }
+
+    /**
+     * @brief 按直方图估计百分位（取所在桶的上界，不超过max_ns）
+     */
+    static double percentile_ns(const std::array<uint64_t, kStageHistogramBuckets>& buckets,
+                                uint64_t count, double q, double ticks_per_ns, double max_ns);
+
+    void record(Stage stage, uint64_t ticks) {
+        Histogram& h = histograms_[static_cast<size_t>(stage)];
+        h.total_ticks.fetch_add(ticks, std::memory_order_relaxed);
+        h.buckets[bucket_for(ticks)].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t max = h.max_ticks.load(std::memory_order_relaxed);
+        while (ticks > max &&
+               !h.max_ticks.compare_exchange_weak(max, ticks, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief 各阶段统计快照（未编译计时时返回空）
+     */
+    std::vector<StageTimingStats> snapshot() const;
+
+    /**
+     * @brief 清零所有直方图（基准测试分段统计用）
+     */
+    void reset();
+
+    /**
+     * @brief 每纳秒的tick数
+     */
+    double ticks_per_ns() const;
+
+private:
+    struct alignas(64) Histogram {
+        std::atomic<uint64_t> total_ticks{0};
+        std::atomic<uint64_t> max_ticks{0};
+        std::atomic<uint64_t> buckets[kStageHistogramBuckets] = {};
+    };
+
+    StageTiming();
+
+    Histogram histograms_[kStageCount];
+
+    // TSC校准基准：构造时的 (tick, steady_clock纳秒)
+    uint64_t base_ticks_;
+    int64_t base_ns_;
+};
+
+/**
+ * @brief 作用域计时器
+ *
+ * 线程局部地累计子作用域耗时，析构时记录 总耗时-子阶段耗时，
+ * 并把总耗时计入外层作用域的子阶段耗时
+ */
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(Stage stage)
+        : stage_(stage), saved_child_ticks_(child_ticks_), start_(read_stage_ticks()) {
+        child_ticks_ = 0;
+    }
+
+    ~ScopedStageTimer() {
+        uint64_t elapsed = read_stage_ticks() - start_;
+        uint64_t self = elapsed > child_ticks_ ? elapsed - child_ticks_ : 0;
+        child_ticks_ = saved_child_ticks_ + elapsed;
+        StageTiming::instance().record(stage_, self);
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    static thread_local uint64_t child_ticks_;
+
+    Stage stage_;
+    uint64_t saved_child_ticks_;
+    uint64_t start_;
+};
+
+} // namespace mpquic_fec
+
+#define MPQUIC_FEC_STAGE_CONCAT_INNER(a, b) a##b
+#define MPQUIC_FEC_STAGE_CONCAT(a, b) MPQUIC_FEC_STAGE_CONCAT_INNER(a, b)
+
+#if MPQUIC_FEC_STAGE_TIMING
+#define MPQUIC_FEC_STAGE_SCOPE(stage)                                              \
+    mpquic_fec::ScopedStageTimer MPQUIC_FEC_STAGE_CONCAT(mpquic_fec_stage_timer_,  \
+                                                         __LINE__)(stage)
+#else
+#define MPQUIC_FEC_STAGE_SCOPE(stage) static_cast<void>(0)
+#endif
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "path_scheduler.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace mpquic_fec {
+
+/**
+ * @brief 链路Trace采样点
+ *
+ * 对应 experiments/traces/README.md 中定义的字段
+ */
+struct LinkTraceSample {
+    double timestamp_s;      // 相对时间戳（秒）
+    double rtt_ms;           // 往返时延
+    double loss_rate;        // 丢包率 [0, 1]
+    double bandwidth_mbps;   // 带宽
+
+    LinkTraceSample()
+        : timestamp_s(0), rtt_ms(0), loss_rate(0), bandwidth_mbps(0) {}
+};
+
+/**
+ * @brief 内存映射的链路Trace文件
+ *
+ * 文件通过mmap只读映射，不做预解析；多个TraceReplayer可以
+ * 共享同一个LinkTrace，各自维护独立的解析游标
+ */
+class LinkTrace {
+public:
+    enum class Format {
+        CSV,
+        JSON
+    };
+
+    /**
+     * @brief 打开并映射Trace文件
+     *
+     * 格式由内容推断：以 '{' 开头视为JSON，否则视为CSV
+     * @throws std::runtime_error 文件无法打开或为空
+     */
+    static std::shared_ptr<LinkTrace> open(const std::string& path);
+
+    ~LinkTrace();
+
+    LinkTrace(const LinkTrace&) = delete;
+    LinkTrace& operator=(const LinkTrace&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    Format format() const { return format_; }
+    const std::string& path() const { return path_; }
+
+private:
+    LinkTrace() = default;
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    Format format_ = Format::CSV;
+    std::string path_;
+};
+
+/**
+ * @brief Trace回放器
+ *
+ * 按时间推进游标，惰性解析下一条采样；采样之间保持阶梯值。
+ * 到达文件末尾后可循环回放（时间轴连续递增）
+ */
+class TraceReplayer {
+public:
+    explicit TraceReplayer(std::shared_ptr<LinkTrace> trace, bool loop = true);
+
+    /**
+     * @brief 获取指定时刻生效的采样
+     * @param elapsed_s 自回放开始经过的时间（秒），应单调不减
+     */
+    const LinkTraceSample& sample_at(double elapsed_s);
+
+    /**
+     * @brief 回到Trace开头
+     */
+    void rewind();
+
+    /**
+     * @brief 已解析的采样数
+     */
+    uint64_t samples_parsed() const { return samples_parsed_; }
+
+private:
+    std::shared_ptr<LinkTrace> trace_;
+    bool loop_;
+
+    // 解析游标
+    size_t cursor_;
+    bool header_parsed_;
+    int columns_[4];           // CSV列号：timestamp, rtt_ms, loss_rate, bandwidth_mbps
+    int column_count_;
+
+    // 当前生效的采样与下一条待生效的采样
+    LinkTraceSample current_;
+    LinkTraceSample next_;
+    bool has_next_;
+    bool exhausted_;
+
+    // 循环回放时的时间偏移
+    double loop_offset_s_;
+    double first_ts_s_;        // 文件中首条采样的原始时间戳（不含偏移）
+    double last_interval_s_;
+    double last_parsed_ts_;
+    uint64_t samples_parsed_;
+
+    bool parse_next(LinkTraceSample& out);
+    bool parse_csv_line(LinkTraceSample& out);
+    bool parse_json_object(LinkTraceSample& out);
+    void parse_csv_header();
+};
+
+/**
+ * @brief 将Trace采样转换为调度器使用的路径状态
+ */
+PathState make_path_state(uint32_t path_id, const LinkTraceSample& sample);
+
+} // namespace mpquic_fec
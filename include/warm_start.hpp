@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mpquic_fec {
+
+/**
+ * @brief 单条路径学到的链路模型
+ */
+struct PathWarmState {
+    double rtt_ms;
+    double loss_rate;
+    double bandwidth_mbps;
+    double jitter_ms;
+    double weight;               // PathScheduler权重（恢复后重新归一化）
+    double gradient;             // OCO梯度累积
+    uint64_t updated_unix_s;     // 最后一次保存的时间
+
+    PathWarmState()
+        : rtt_ms(0), loss_rate(0), bandwidth_mbps(0), jitter_ms(0), weight(0),
+          gradient(0), updated_unix_s(0) {}
+
+    /**
+     * @brief 各字段均为有限值且在合法范围内（loss_rate∈[0,1]，其余非负，gradient不限符号）
+     */
+    bool valid() const;
+};
+
+/**
+ * @brief 一组路径（网络）上最后的冗余决策
+ */
+struct NetworkWarmState {
+    uint32_t k;
+    uint32_t m;
+    double redundancy_rate;
+    uint64_t updated_unix_s;
+
+    NetworkWarmState() : k(0), m(0), redundancy_rate(0), updated_unix_s(0) {}
+
+    /**
+     * @brief k, m > 0、k+m ≤ kMaxFECBlocks 且冗余率为非负有限值
+     */
+    bool valid() const;
+};
+
+/**
+ * @brief 相关系数为有限值且在[-1, 1]内
+ */
+bool valid_correlation(double rho);
+
+/**
+ * @brief 按路径指纹保存的预热状态
+ *
+ * 路径记录以指纹为键（见path_fingerprint），相关系数以指纹对为键，
+ * 冗余决策以整组路径指纹排序拼接后的网络键为键（见network_key）。
+ *
+ * 二进制格式（大端）：
+ *   "MQWS" | u16 版本 | u16 保留
+ *   u32 路径数   { str 指纹 | f64 rtt/loss/bw/jitter/weight/gradient | u64 时间 }
+ *   u32 指纹对数 { str a | str b | f64 rho | u64 时间 }
+ *   u32 网络数   { str 网络键 | u32 k | u32 m | f64 rate | u64 时间 }
+ *   u32 FNV-1a校验（覆盖之前的全部字节）
+ * 其中 str 为 u16 长度 + 字节
+ */
+class WarmStartStore {
+public:
+    static constexpr uint16_t kFormatVersion = 1;
+
+    /**
+     * @throws std::runtime_error 魔数、版本、长度或校验不符时
+     */
+    static WarmStartStore deserialize(const uint8_t* data, size_t size);
+
+    std::vector<uint8_t> serialize() const;
+
+    /**
+     * @brief 从文件加载（替换当前内容）
+     * @return 文件不存在时返回false；内容损坏时记录警告并返回false
+     */
+    bool load(const std::string& path);
+
+    /**
+     * @brief 写入文件（先写临时文件再rename，不会留下半个文件）
+     * @throws std::runtime_error 写入失败时
+     */
+    void save(const std::string& path) const;
+
+    void put_path(const std::string& fingerprint, const PathWarmState& state);
+    const PathWarmState* find_path(const std::string& fingerprint) const;
+
+    /**
+     * @brief 相关系数与指纹顺序无关
+     */
+    void put_correlation(const std::string& a, const std::string& b, double rho);
+    bool find_correlation(const std::string& a, const std::string& b, double& rho) const;
+
+    void put_network(const std::string& key, const NetworkWarmState& state);
+    const NetworkWarmState* find_network(const std::string& key) const;
+
+    /**
+     * @brief 删除早于 now_unix_s - max_age_s 的记录
+     * @return 删除的记录数
+     */
+    size_t prune(uint64_t now_unix_s, uint64_t max_age_s);
+
+    size_t path_count() const { return paths_.size(); }
+    bool empty() const { return paths_.empty() && correlations_.empty() && networks_.empty(); }
+
+    /**
+     * @brief 网络键：指纹排序后以','拼接
+     */
+    static std::string network_key(std::vector<std::string> fingerprints);
+
+private:
+    struct CorrelationRecord {
+        double rho = 0;
+        uint64_t updated_unix_s = 0;
+    };
+
+    static std::pair<std::string, std::string> pair_key(const std::string& a,
+                                                        const std::string& b);
+
+    std::map<std::string, PathWarmState> paths_;
+    std::map<std::pair<std::string, std::string>, CorrelationRecord> correlations_;
+    std::map<std::string, NetworkWarmState> networks_;
+};
+
+/**
+ * @brief 路径指纹：本地地址 + 远端前缀（IPv4 /24，IPv6 /64，其他按原样）
+ *
+ * 同一接口连到同一远端网络的路径得到相同指纹，不受远端端口和主机位变化影响。
+ * 本地地址为通配地址时接口无法区分，改用本地端口标识路径
+ */
+std::string path_fingerprint(const std::string& local_addr, uint16_t local_port,
+                             const std::string& remote_addr);
+
+} // namespace mpquic_fec
@@ -0,0 +1,515 @@
+#include "packet_hook.hpp"
+#include "loss_model.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mpquic_fec;
+
+/**
+ * @brief FEC恢复效率的蒙特卡洛基准
+ *
+ * 多线程驱动真实的 PacketSendHook/FECGroupManager 编码和 PacketReceiveHook 解码，
+ * 帧按调度策略分配到各路径，经丢包模型判定后交给接收端。
+ * 块很小（默认16字节），耗时集中在组管理和编解码逻辑上，吞吐随线程数线性扩展；
+ * 恢复与否只取决于到达的块数，与块大小无关。每个解码出的组都与发送内容逐块比对。
+ *
+ * 丢包模型：
+ * - bernoulli：各路径独立同分布丢包
+ * - ge：各路径独立的Gilbert-Elliott突发丢包（--burst 平均突发长度）
+ * - correlated：每个发送时隙以概率rho让所有路径共用同一条GE链的结果，
+ *   否则各用自己的GE链；两路径丢包指示的相关系数约为rho。
+ *   各路径在一个组内依次发出的第i个帧同属第i个时隙
+ *
+ * 调度策略：
+ * - single：全部块走路径0
+ * - split：源块走路径0，冗余块走路径1（与控制器默认分配一致）
+ * - spread：第i个块走路径 i % paths
+ *
+ * 输出每个 模型 × 策略 × (k, m) × 丢包率 的组失败率、残余丢包率与效率
+ * （效率 = 最终可用源包数 / 发送总包数），可写成CSV作为OCO调参的效率曲线。
+ *
+ * 用法：
+ *   bench_fec_montecarlo [--models bernoulli,ge,correlated] [--policies single,split,spread]
+ *                        [--k 4,8,16] [--m 1,2,4] [--loss 0.01,0.05,0.1] [--paths N]
+ *                        [--burst LEN] [--rho R] [--groups N] [--threads N]
+ *                        [--block-size BYTES] [--csv FILE]
+ */
+
+namespace {
+
+enum class LossKind {
+    BERNOULLI,
+    GILBERT_ELLIOTT,
+    CORRELATED
+};
+
+enum class Policy {
+    SINGLE,
+    SPLIT,
+    SPREAD
+};
+
+struct BenchConfig {
+    std::vector<LossKind> models = {LossKind::BERNOULLI, LossKind::GILBERT_ELLIOTT,
+                                    LossKind::CORRELATED};
+    std::vector<Policy> policies = {Policy::SINGLE, Policy::SPLIT, Policy::SPREAD};
+    std::vector<uint32_t> k_values = {4, 8, 16};
+    std::vector<uint32_t> m_values = {1, 2, 4};
+    std::vector<double> loss_rates = {0.01, 0.05, 0.10};
+    uint32_t paths = 2;
+    double burst_len = 4.0;
+    double rho = 0.5;
+    size_t groups = 200000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t block_size = 16;
+    std::string csv_path;
+};
+
+struct Counters {
+    uint64_t groups = 0;
+    uint64_t failed_groups = 0;
+    uint64_t source_blocks = 0;
+    uint64_t unrecovered_sources = 0;   // 失败组中丢失的源块（系统码：到达的源块仍可用）
+    uint64_t frames_sent = 0;
+    uint64_t frames_lost = 0;
+    uint64_t blocks_recovered = 0;
+    uint64_t decode_mismatches = 0;
+
+    void add(const Counters& o) {
+        groups += o.groups;
+        failed_groups += o.failed_groups;
+        source_blocks += o.source_blocks;
+        unrecovered_sources += o.unrecovered_sources;
+        frames_sent += o.frames_sent;
+        frames_lost += o.frames_lost;
+        blocks_recovered += o.blocks_recovered;
+        decode_mismatches += o.decode_mismatches;
+    }
+};
+
+struct ScenarioResult {
+    LossKind model;
+    Policy policy;
+    uint32_t k = 0;
+    uint32_t m = 0;
+    double loss = 0;
+    Counters counters;
+    double wall_seconds = 0;
+};
+
+const char* model_name(LossKind kind) {
+    switch (kind) {
+        case LossKind::BERNOULLI:       return "bernoulli";
+        case LossKind::GILBERT_ELLIOTT: return "ge";
+        case LossKind::CORRELATED:      return "correlated";
+        default:                        return "unknown";
+    }
+}
+
+const char* policy_name(Policy policy) {
+    switch (policy) {
+        case Policy::SINGLE: return "single";
+        case Policy::SPLIT:  return "split";
+        case Policy::SPREAD: return "spread";
+        default:             return "unknown";
+    }
+}
+
+LossKind parse_model(const std::string& name) {
+    if (name == "bernoulli") return LossKind::BERNOULLI;
+    if (name == "ge") return LossKind::GILBERT_ELLIOTT;
+    if (name == "correlated") return LossKind::CORRELATED;
+    throw std::invalid_argument("Unknown loss model: " + name);
+}
+
+Policy parse_policy(const std::string& name) {
+    if (name == "single") return Policy::SINGLE;
+    if (name == "split") return Policy::SPLIT;
+    if (name == "spread") return Policy::SPREAD;
+    throw std::invalid_argument("Unknown policy: " + name);
+}
+
+std::vector<std::string> split_list(const std::string& arg) {
+    std::vector<std::string> items;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    if (items.empty()) {
+        throw std::invalid_argument("Empty list: " + arg);
+    }
+    return items;
+}
+
+template<typename T>
+std::vector<T> parse_list(const std::string& arg) {
+    std::vector<T> values;
+    for (const auto& item : split_list(arg)) {
+        values.push_back(static_cast<T>(std::stod(item)));
+    }
+    return values;
+}
+
+/**
+ * @brief 多路径丢包信道
+ */
+class MultipathChannel {
+public:
+    MultipathChannel(LossKind kind, double loss, double burst_len, double rho, uint32_t paths)
+        : kind_(kind), rho_(rho) {
+        auto make = [&]() {
+            return kind == LossKind::BERNOULLI ? GilbertElliottModel::bernoulli(loss)
+                                               : GilbertElliottModel::from_loss_rate(loss, burst_len);
+        };
+        for (uint32_t p = 0; p < paths; ++p) {
+            per_path_.push_back(make());
+        }
+        shared_ = make();
+        next_slot_.resize(paths, 0);
+    }
+
+    /**
+     * @brief 开始一个新组：各路径的时隙从0重新计数
+     */
+    void begin_group() {
+        std::fill(next_slot_.begin(), next_slot_.end(), 0);
+        slots_.clear();
+    }
+
+    template<typename RNG>
+    bool lost(uint32_t path, RNG& rng) {
+        bool own = per_path_[path].next_lost(rng);
+        if (kind_ != LossKind::CORRELATED) {
+            return own;
+        }
+        // 共享链每个时隙推进一次，本时隙内各路径看到同一结果与同一次抽签
+        size_t slot = next_slot_[path]++;
+        while (slots_.size() <= slot) {
+            SlotState state;
+            state.shared_lost = shared_.next_lost(rng);
+            state.use_shared = coin_(rng) < rho_;
+            slots_.push_back(state);
+        }
+        return slots_[slot].use_shared ? slots_[slot].shared_lost : own;
+    }
+
+private:
+    struct SlotState {
+        bool shared_lost = false;
+        bool use_shared = false;
+    };
+
+    LossKind kind_;
+    double rho_;
+    std::vector<GilbertElliottModel> per_path_;
+    GilbertElliottModel shared_;
+    std::vector<size_t> next_slot_;    // 各路径本组内下一帧所在的时隙
+    std::vector<SlotState> slots_;     // 本组已抽取的时隙
+    std::uniform_real_distribution<double> coin_{0.0, 1.0};
+};
+
+uint32_t path_for(Policy policy, const FECFrame& frame, uint32_t paths) {
+    switch (policy) {
+        case Policy::SINGLE:
+            return 0;
+        case Policy::SPLIT:
+            return frame.is_source_frame() ? 0 : std::min<uint32_t>(1, paths - 1);
+        case Policy::SPREAD:
+        default:
+            return frame.header.block_index % paths;
+    }
+}
+
+/**
+ * @brief 源块内容：组序号和块号写入前16字节，便于核对解码结果
+ */
+void fill_block(std::vector<uint8_t>& block, uint64_t seq, uint32_t index) {
+    std::fill(block.begin(), block.end(), static_cast<uint8_t>(seq * 31 + index));
+    std::memcpy(block.data(), &seq, std::min(block.size(), sizeof(seq)));
+    if (block.size() >= sizeof(seq) + sizeof(index)) {
+        std::memcpy(block.data() + sizeof(seq), &index, sizeof(index));
+    }
+}
+
+Counters run_worker(const BenchConfig& config, LossKind model, Policy policy,
+                    uint32_t k, uint32_t m, double loss, size_t groups, uint64_t seed) {
+    // 每个线程一套独立的编解码对象，避免锁竞争
+    auto group_mgr = std::make_shared<FECGroupManager>(k, m, config.block_size);
+    PacketSendHook send_hook(group_mgr);
+    PacketReceiveHook receive_hook;
+    MultipathChannel channel(model, loss, config.burst_len, config.rho, config.paths);
+    std::mt19937_64 rng(seed);
+
+    Counters c;
+    std::vector<uint8_t> block(config.block_size);
+    std::vector<FECFrame> frames;
+    std::vector<bool> source_lost(k);
+    std::vector<uint8_t> expected(config.block_size);
+    uint64_t packet_num = 0;
+
+    for (size_t g = 0; g < groups; ++g) {
+        frames.clear();
+        for (uint32_t i = 0; i < k; ++i) {
+            fill_block(block, g, i);
+            send_hook.on_packet_send(packet_num++, 0, block, frames);
+        }
+        if (frames.size() != k + m) {
+            throw std::runtime_error("Expected a complete group after k source packets");
+        }
+
+        std::vector<std::vector<uint8_t>> decoded;
+        uint32_t lost_sources = 0;
+        channel.begin_group();
+        for (const auto& frame : frames) {
+            bool lost = channel.lost(path_for(policy, frame, config.paths), rng);
+            ++c.frames_sent;
+            if (frame.is_source_frame()) {
+                source_lost[frame.header.block_index] = lost;
+                lost_sources += lost ? 1 : 0;
+            }
+            if (lost) {
+                ++c.frames_lost;
+                continue;
+            }
+            auto result = receive_hook.on_frame_received(frame);
+            if (!result.empty()) {
+                decoded = std::move(result);
+            }
+        }
+
+        ++c.groups;
+        c.source_blocks += k;
+        if (decoded.empty()) {
+            ++c.failed_groups;
+            c.unrecovered_sources += lost_sources;
+        } else {
+            for (uint32_t i = 0; i < k; ++i) {
+                fill_block(expected, g, i);
+                if (i >= decoded.size() || decoded[i] != expected) {
+                    ++c.decode_mismatches;
+                }
+            }
+        }
+
+        // 定期回收两端的组缓存
+        if ((g & 255) == 255) {
+            uint64_t next_group = group_mgr->next_group_id();
+            group_mgr->cleanup_old_groups(next_group);
+            receive_hook.cleanup_old_groups(next_group);
+        }
+    }
+
+    c.blocks_recovered = receive_hook.get_statistics().blocks_recovered;
+    return c;
+}
+
+ScenarioResult run_scenario(const BenchConfig& config, LossKind model, Policy policy,
+                            uint32_t k, uint32_t m, double loss) {
+    ScenarioResult result;
+    result.model = model;
+    result.policy = policy;
+    result.k = k;
+    result.m = m;
+    result.loss = loss;
+
+    unsigned threads = static_cast<unsigned>(
+        std::min<size_t>(config.threads, std::max<size_t>(1, config.groups)));
+    std::vector<Counters> partial(threads);
+    std::vector<std::thread> workers;
+    std::atomic<bool> failed{false};
+    std::string error;
+    std::mutex error_mutex;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; ++t) {
+        size_t share = config.groups / threads + (t < config.groups % threads ? 1 : 0);
+        uint64_t seed = 0x5eed ^ (static_cast<uint64_t>(k) << 40) ^
+                        (static_cast<uint64_t>(m) << 32) ^
+                        (static_cast<uint64_t>(loss * 1e6) << 8) ^ t;
+        workers.emplace_back([&, t, share, seed]() {
+            try {
+                partial[t] = run_worker(config, model, policy, k, m, loss, share, seed);
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                error = e.what();
+                failed.store(true);
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    result.wall_seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    if (failed.load()) {
+        throw std::runtime_error(error);
+    }
+    for (const auto& c : partial) {
+        result.counters.add(c);
+    }
+    return result;
+}
+
+double ratio(uint64_t num, uint64_t den) {
+    return den > 0 ? static_cast<double>(num) / den : 0.0;
+}
+
+void write_csv(std::ostream& out, const BenchConfig& config,
+               const std::vector<ScenarioResult>& results) {
+    out << "model,policy,k,m,loss,burst,rho,paths,overhead,frame_loss,group_failure_rate,"
+           "residual_loss,efficiency,groups,groups_per_sec\n";
+    out << std::setprecision(8);
+    for (const auto& r : results) {
+        const auto& c = r.counters;
+        double residual = ratio(c.unrecovered_sources, c.source_blocks);
+        out << model_name(r.model) << ',' << policy_name(r.policy) << ','
+            << r.k << ',' << r.m << ',' << r.loss << ','
+            << (r.model == LossKind::BERNOULLI ? 1.0 : config.burst_len) << ','
+            << (r.model == LossKind::CORRELATED ? config.rho : 0.0) << ','
+            << config.paths << ','
+            << static_cast<double>(r.m) / r.k << ','
+            << ratio(c.frames_lost, c.frames_sent) << ','
+            << ratio(c.failed_groups, c.groups) << ','
+            << residual << ','
+            << ratio(c.source_blocks - c.unrecovered_sources, c.frames_sent) << ','
+            << c.groups << ','
+            << (r.wall_seconds > 0 ? c.groups / r.wall_seconds : 0.0) << "\n";
+    }
+}
+
+void print_usage(const char* prog) {
+    std::cout << "Usage: " << prog << " [--models LIST] [--policies LIST] [--k LIST] [--m LIST]\n"
+              << "       [--loss LIST] [--paths N] [--burst LEN] [--rho R] [--groups N]\n"
+              << "       [--threads N] [--block-size BYTES] [--csv FILE]\n"
+              << "  models   = bernoulli,ge,correlated\n"
+              << "  policies = single,split,spread\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                print_usage(argv[0]);
+                return 0;
+            }
+            if (i + 1 >= argc) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--models") {
+                config.models.clear();
+                for (const auto& name : split_list(value)) config.models.push_back(parse_model(name));
+            } else if (arg == "--policies") {
+                config.policies.clear();
+                for (const auto& name : split_list(value)) config.policies.push_back(parse_policy(name));
+            }
+            else if (arg == "--k") config.k_values = parse_list<uint32_t>(value);
+            else if (arg == "--m") config.m_values = parse_list<uint32_t>(value);
+            else if (arg == "--loss") config.loss_rates = parse_list<double>(value);
+            else if (arg == "--paths") config.paths = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--burst") config.burst_len = std::stod(value);
+            else if (arg == "--rho") config.rho = std::stod(value);
+            else if (arg == "--groups") config.groups = std::stoul(value);
+            else if (arg == "--threads") config.threads = static_cast<unsigned>(std::stoul(value));
+            else if (arg == "--block-size") config.block_size = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--csv") config.csv_path = value;
+            else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid argument: " << e.what() << "\n";
+        return 1;
+    }
+
+    if (config.paths == 0 || config.threads == 0 || config.block_size == 0) {
+        std::cerr << "--paths, --threads and --block-size must be positive\n";
+        return 1;
+    }
+
+    // 基准只关心数字，关闭组件初始化日志
+    Logger::instance().set_level(LogLevel::WARN);
+
+    std::cout << "threads=" << config.threads << " groups/scenario=" << config.groups
+              << " paths=" << config.paths << " burst=" << config.burst_len
+              << " rho=" << config.rho << " block=" << config.block_size << "B\n";
+    std::cout << std::left << std::setw(12) << "model" << std::setw(8) << "policy"
+              << std::setw(5) << "k" << std::setw(5) << "m" << std::setw(8) << "loss"
+              << std::right << std::setw(12) << "group_fail" << std::setw(12) << "residual"
+              << std::setw(10) << "effic" << std::setw(12) << "groups/s" << "\n";
+
+    std::vector<ScenarioResult> results;
+    uint64_t mismatches = 0;
+    try {
+        for (LossKind model : config.models) {
+            for (Policy policy : config.policies) {
+                for (uint32_t k : config.k_values) {
+                    for (uint32_t m : config.m_values) {
+                        for (double loss : config.loss_rates) {
+                            auto r = run_scenario(config, model, policy, k, m, loss);
+                            const auto& c = r.counters;
+                            mismatches += c.decode_mismatches;
+                            std::cout << std::left << std::setw(12) << model_name(model)
+                                      << std::setw(8) << policy_name(policy)
+                                      << std::setw(5) << k << std::setw(5) << m
+                                      << std::setw(8) << loss << std::right
+                                      << std::scientific << std::setprecision(3)
+                                      << std::setw(12) << ratio(c.failed_groups, c.groups)
+                                      << std::setw(12) << ratio(c.unrecovered_sources, c.source_blocks)
+                                      << std::fixed << std::setprecision(4)
+                                      << std::setw(10)
+                                      << ratio(c.source_blocks - c.unrecovered_sources, c.frames_sent)
+                                      << std::setprecision(0) << std::setw(12)
+                                      << (r.wall_seconds > 0 ? c.groups / r.wall_seconds : 0.0)
+                                      << std::defaultfloat << "\n";
+                            results.push_back(r);
+                        }
+                    }
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Simulation failed: " << e.what() << "\n";
+        return 1;
+    }
+
+    if (mismatches > 0) {
+        std::cerr << "ERROR: " << mismatches << " decoded blocks differ from the source\n";
+        return 1;
+    }
+
+    if (!config.csv_path.empty()) {
+        std::ofstream out(config.csv_path);
+        if (!out) {
+            std::cerr << "Cannot write " << config.csv_path << "\n";
+            return 1;
+        }
+        write_csv(out, config, results);
+        std::cout << "Efficiency curves written to " << config.csv_path << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,740 @@
+#include "clock.hpp"
+#include "fec_encoder.hpp"
+#include "fec_frame.hpp"
+#include "mpquic_fec_controller.hpp"
+#include "oco_controller.hpp"
+#include "packet_hook.hpp"
+#include "path_scheduler.hpp"
+#include "quic_connection.hpp"
+#include "logger.hpp"
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace mpquic_fec;
+
+/**
+ * @brief 发送流水线组合方式的开销对比
+ *
+ * 同一组源块分别经过三种发送路径，网络与接收端不参与：
+ * - controller: MPQUICFECController::send_stream_data()（加锁、shared_ptr、包号映射）
+ * - runtime:    RuntimeFECPipeline（FECGroupManager + PathScheduler + OCO + IQUICConnection）
+ * - static:     DirectCodec + RoundRobinPaths<2> + FixedRedundancy<8,2> + 回调传输
+ *
+ * 三者都把每帧序列化一次后丢弃（runtime经由一个只计数的连接）。(k, m)固定为8+2，
+ * 运行期变体不调用update()，OCO不会在测量中切换参数。输出按线程CPU时间计算的
+ * 每秒源块数（Mpps）。
+ *
+ * 用法：
+ *   bench_fec_pipeline [--packets N] [--size BYTES]
+ */
+
+namespace {
+
+/**
+ * @brief 编译期组合的FEC发送流水线
+ *
+ * [数据] -> Codec(分组编码) -> RedundancyPolicy(k, m) -> Scheduler(路径) -> Transport
+ *
+ * 各环节以策略类型作为模板参数并按值持有，调用在编译期绑定：配置在构建时
+ * 已知的使用方选用下面的静态策略，热路径上没有虚调用、shared_ptr引用计数和锁，
+ * 可以整条内联。RuntimeFECPipeline 是由运行期组件（FECGroupManager、
+ * PathScheduler、OCO、IQUICConnection）组成的实例化，行为与MPQUICFECController
+ * 的发送路径一致。只用于本基准对比组合方式的开销，生产发送路径是MPQUICFECController。
+ *
+ * 策略需要提供的接口：
+ * - Codec: encode(data, size, frames)、flush(frames)、set_params(k, m, frames)、
+ *          params()、block_size()；组完成时把源帧和修复帧追加到frames
+ * - Scheduler: select_source(size)、select_repair(source_path, size)、
+ *              on_sent(path, now_us)、on_acked(path, rtt_us, now_us)
+ * - RedundancyPolicy: initial_params(k, m)，构造时即确定参数的策略返回true；
+ *                     decide(now_us, k, m)，需要切换参数时返回true
+ * - ClockPolicy: now_us()
+ * - Transport: transmit(path, frame)，交给传输层成功时返回true
+ *
+ * 不加锁，每个实例由一个线程驱动；需要多线程共享时使用MPQUICFECController
+ */
+template<typename Codec, typename Scheduler, typename RedundancyPolicy,
+         typename ClockPolicy, typename Transport>
+class BasicFECPipeline {
+public:
+    struct Statistics {
+        uint64_t source_frames_sent = 0;
+        uint64_t repair_frames_sent = 0;
+        uint64_t transmit_failures = 0;
+        uint64_t param_updates = 0;
+    };
+
+    BasicFECPipeline(Codec codec, Scheduler scheduler, RedundancyPolicy redundancy,
+                     Transport transport, ClockPolicy clock = ClockPolicy())
+        : codec_(std::move(codec)), scheduler_(std::move(scheduler)),
+          redundancy_(std::move(redundancy)), clock_(std::move(clock)),
+          transport_(std::move(transport)) {
+        // 冗余策略给出的参数优先于构造Codec时的参数（此时尚无数据，不会产生帧）
+        uint32_t k = 0;
+        uint32_t m = 0;
+        if (redundancy_.initial_params(k, m) && std::make_pair(k, m) != codec_.params()) {
+            codec_.set_params(k, m, frames_);
+        }
+    }
+
+    /**
+     * @brief 送入一个源块（不超过block_size()），组完成时编码并发出整组
+     * @return 本次交给传输层的帧数
+     * @throws std::invalid_argument 数据超过块大小
+     */
+    size_t send(const uint8_t* data, size_t size) {
+        codec_.encode(data, size, frames_);
+        return transmit_frames();
+    }
+
+    size_t send(const std::vector<uint8_t>& data) {
+        return send(data.data(), data.size());
+    }
+
+    /**
+     * @brief 强制完成当前未满的组并发出
+     */
+    size_t flush() {
+        codec_.flush(frames_);
+        return transmit_frames();
+    }
+
+    /**
+     * @brief 定期调用：按冗余策略切换(k, m)，以旧参数完成的组随即发出
+     */
+    size_t update() {
+        uint32_t k = 0;
+        uint32_t m = 0;
+        if (redundancy_.decide(clock_.now_us(), k, m) &&
+            std::make_pair(k, m) != codec_.params()) {
+            codec_.set_params(k, m, frames_);
+            ++stats_.param_updates;
+        }
+        return transmit_frames();
+    }
+
+    /**
+     * @brief 路径确认反馈（RTT样本，微秒）
+     */
+    void on_ack(uint32_t path_id, uint64_t rtt_us) {
+        scheduler_.on_acked(path_id, rtt_us, clock_.now_us());
+    }
+
+    const Statistics& statistics() const { return stats_; }
+
+    Codec& codec() { return codec_; }
+    Scheduler& scheduler() { return scheduler_; }
+    RedundancyPolicy& redundancy() { return redundancy_; }
+    ClockPolicy& clock() { return clock_; }
+    Transport& transport() { return transport_; }
+
+private:
+    // 与MPQUICFECController一致：同一批帧共用一次路径选择和一个发送时刻
+    size_t transmit_frames() {
+        if (frames_.empty()) {
+            return 0;
+        }
+
+        uint32_t size = codec_.block_size();
+        uint32_t source_path = scheduler_.select_source(size);
+        uint32_t repair_path = scheduler_.select_repair(source_path, size);
+        uint64_t now_us = clock_.now_us();
+
+        size_t sent = 0;
+        for (const auto& frame : frames_) {
+            bool is_repair = frame.is_repair_frame();
+            uint32_t path_id = is_repair ? repair_path : source_path;
+            if (!transport_.transmit(path_id, frame)) {
+                ++stats_.transmit_failures;
+                continue;
+            }
+            scheduler_.on_sent(path_id, now_us);
+            ++(is_repair ? stats_.repair_frames_sent : stats_.source_frames_sent);
+            ++sent;
+        }
+
+        frames_.clear();
+        return sent;
+    }
+
+    Codec codec_;
+    Scheduler scheduler_;
+    RedundancyPolicy redundancy_;
+    ClockPolicy clock_;
+    Transport transport_;
+
+    std::vector<FECFrame> frames_;   // 编码输出的暂存，逐批复用
+    Statistics stats_;
+};
+
+// ========== Codec ==========
+
+/**
+ * @brief 运行期编码策略：FECGroupManager + PacketSendHook（与控制器同一套组件）
+ */
+class GroupManagerCodec {
+public:
+    explicit GroupManagerCodec(std::shared_ptr<FECGroupManager> group_manager)
+        : group_manager_(std::move(group_manager)),
+          send_hook_(std::make_unique<PacketSendHook>(group_manager_)) {}
+
+    GroupManagerCodec(uint32_t k, uint32_t m, uint32_t block_size)
+        : GroupManagerCodec(std::make_shared<FECGroupManager>(k, m, block_size)) {}
+
+    void encode(const uint8_t* data, size_t size, std::vector<FECFrame>& out_frames) {
+        if (send_hook_->on_packet_send(next_packet_number_++, 0, data, size, out_frames)) {
+            cleanup_groups();
+        }
+    }
+
+    void flush(std::vector<FECFrame>& out_frames) {
+        send_hook_->flush(out_frames);
+    }
+
+    void set_params(uint32_t k, uint32_t m, std::vector<FECFrame>& out_frames) {
+        // 以旧参数完成当前组后再切换
+        send_hook_->flush(out_frames);
+        group_manager_->update_coding_params(k, m);
+    }
+
+    std::pair<uint32_t, uint32_t> params() const { return group_manager_->get_coding_params(); }
+    uint32_t block_size() const { return group_manager_->block_size(); }
+
+    std::shared_ptr<FECGroupManager> group_manager() const { return group_manager_; }
+
+private:
+    // 发送侧不需要补发时保留最近500个已编码组，与控制器的清理窗口相同
+    void cleanup_groups() {
+        uint64_t next_id = group_manager_->next_group_id();
+        if (group_sequence(next_id) > 1000 && group_sequence(next_id) % 500 == 0) {
+            group_manager_->cleanup_old_groups(next_id - 500);
+        }
+    }
+
+    std::shared_ptr<FECGroupManager> group_manager_;
+    std::unique_ptr<PacketSendHook> send_hook_;
+    uint64_t next_packet_number_ = 1;
+};
+
+/**
+ * @brief 静态编码策略：直接持有FECEncoder，不缓存已编码组，不加锁
+ *
+ * 输出的帧与GroupManagerCodec逐字节相同（同样的组ID布局、块补零和帧头），
+ * 接收端不需要区分。不支持按组重建帧（路径失效补发需要运行期编码策略）
+ */
+class DirectCodec {
+public:
+    /**
+     * @throws std::invalid_argument k或m为0，或k+m超过kMaxFECBlocks
+     */
+    DirectCodec(uint32_t k, uint32_t m, uint32_t block_size, uint32_t stream_slot = 0)
+        : block_size_(block_size), stream_slot_(stream_slot) {
+        validate_params(k, m);
+        reset_encoder(k, m);
+    }
+
+    void encode(const uint8_t* data, size_t size, std::vector<FECFrame>& out_frames) {
+        if (size > block_size_) {
+            throw std::invalid_argument("Source packet larger than FEC block size");
+        }
+
+        auto& block = blocks_[filled_++];
+        std::memcpy(block.data(), data, size);
+        std::memset(block.data() + size, 0, block_size_ - size);
+
+        if (filled_ == k_) {
+            complete_group(*encoder_, out_frames);
+        }
+    }
+
+    void flush(std::vector<FECFrame>& out_frames) {
+        if (filled_ == 0) {
+            return;
+        }
+        // 与FECGroupManager一致：未满组按实际源块数编码为(s, m)组，不发送补零块
+        FECEncoder short_encoder(static_cast<uint32_t>(filled_), m_, block_size_);
+        complete_group(short_encoder, out_frames);
+    }
+
+    /**
+     * @throws std::invalid_argument 参数非法时（当前组保持不变，不会被提前发出）
+     */
+    void set_params(uint32_t k, uint32_t m, std::vector<FECFrame>& out_frames) {
+        validate_params(k, m);
+        flush(out_frames);
+        reset_encoder(k, m);
+    }
+
+    std::pair<uint32_t, uint32_t> params() const { return {k_, m_}; }
+    uint32_t block_size() const { return block_size_; }
+
+private:
+    // 与FECEncoder的参数检查一致
+    static void validate_params(uint32_t k, uint32_t m) {
+        if (k == 0 || m == 0) {
+            throw std::invalid_argument("k and m must be greater than 0");
+        }
+        if (k + m > kMaxFECBlocks) {
+            throw std::invalid_argument("k + m must not exceed 256 in GF(2^8)");
+        }
+    }
+
+    void reset_encoder(uint32_t k, uint32_t m) {
+        encoder_ = std::make_unique<FECEncoder>(k, m, block_size_);
+        k_ = k;
+        m_ = m;
+        blocks_.assign(k, std::vector<uint8_t>(block_size_));
+        filled_ = 0;
+    }
+
+    void complete_group(FECEncoder& encoder, std::vector<FECFrame>& out_frames) {
+        uint32_t k = encoder.get_k();
+        uint64_t group_id = make_stream_group_id(stream_slot_, next_sequence_++);
+
+        data_ptrs_.clear();
+        for (uint32_t i = 0; i < k; ++i) {
+            FECFrame& frame = append_frame(FrameType::FEC_SOURCE_FRAME, group_id, i, k, out_frames);
+            frame.payload.assign(blocks_[i].begin(), blocks_[i].end());
+            data_ptrs_.push_back(blocks_[i].data());
+        }
+
+        // 冗余块直接编码进修复帧的负载
+        size_t first_repair = out_frames.size();
+        for (uint32_t i = 0; i < m_; ++i) {
+            append_frame(FrameType::FEC_REPAIR_FRAME, group_id, k + i, k, out_frames)
+                .payload.resize(block_size_);
+        }
+        parity_ptrs_.clear();
+        for (uint32_t i = 0; i < m_; ++i) {
+            parity_ptrs_.push_back(out_frames[first_repair + i].payload.data());
+        }
+        encoder.encode(data_ptrs_.data(), parity_ptrs_.data());
+        filled_ = 0;
+    }
+
+    FECFrame& append_frame(FrameType type, uint64_t group_id, uint32_t block_index,
+                           uint32_t source_blocks, std::vector<FECFrame>& out_frames) {
+        out_frames.emplace_back();
+        FECFrame& frame = out_frames.back();
+        frame.header.frame_type = type;
+        frame.header.group_id = group_id;
+        frame.header.block_index = block_index;
+        frame.header.total_blocks = source_blocks + m_;
+        frame.header.payload_length = block_size_;
+        frame.header.source_blocks = source_blocks;
+        return frame;
+    }
+
+    uint32_t k_ = 0;
+    uint32_t m_ = 0;
+    uint32_t block_size_;
+    uint32_t stream_slot_;
+    uint64_t next_sequence_ = 1;
+
+    std::unique_ptr<FECEncoder> encoder_;
+    std::vector<std::vector<uint8_t>> blocks_;   // 当前组的k个源块，逐组复用
+    size_t filled_ = 0;
+    std::vector<const uint8_t*> data_ptrs_;      // 编码时的块地址，逐组复用
+    std::vector<uint8_t*> parity_ptrs_;
+};
+
+// ========== Scheduler ==========
+
+/**
+ * @brief 运行期调度策略：PathScheduler（路径权重、丢包相关性与活性）
+ */
+class PathSchedulerPolicy {
+public:
+    explicit PathSchedulerPolicy(std::shared_ptr<PathScheduler> scheduler)
+        : scheduler_(std::move(scheduler)) {}
+
+    uint32_t select_source(uint32_t size) { return scheduler_->select_source_path(size); }
+
+    uint32_t select_repair(uint32_t source_path, uint32_t size) {
+        return scheduler_->select_repair_path(source_path, size);
+    }
+
+    void on_sent(uint32_t path_id, uint64_t now_us) {
+        scheduler_->on_packet_sent(path_id, now_us);
+    }
+
+    void on_acked(uint32_t path_id, uint64_t rtt_us, uint64_t now_us) {
+        scheduler_->on_packet_acked(path_id, rtt_us, now_us);
+    }
+
+    std::shared_ptr<PathScheduler> scheduler() const { return scheduler_; }
+
+private:
+    std::shared_ptr<PathScheduler> scheduler_;
+};
+
+/**
+ * @brief 静态调度策略：源块按批在路径0..PathCount-1间轮转，修复块走下一条路径
+ */
+template<uint32_t PathCount>
+class RoundRobinPaths {
+    static_assert(PathCount > 0, "RoundRobinPaths needs at least one path");
+
+public:
+    uint32_t select_source(uint32_t) {
+        uint32_t path_id = next_path_;
+        next_path_ = (next_path_ + 1) % PathCount;
+        return path_id;
+    }
+
+    uint32_t select_repair(uint32_t source_path, uint32_t) {
+        return (source_path + 1) % PathCount;
+    }
+
+    void on_sent(uint32_t, uint64_t) {}
+    void on_acked(uint32_t, uint64_t, uint64_t) {}
+
+private:
+    uint32_t next_path_ = 0;
+};
+
+// ========== RedundancyPolicy ==========
+
+/**
+ * @brief 运行期冗余策略：按间隔向OCO控制器取最优(k, m)
+ */
+class OCORedundancyPolicy {
+public:
+    explicit OCORedundancyPolicy(std::shared_ptr<OCORedundancyController> controller,
+                                 uint64_t interval_us = 100000)
+        : controller_(std::move(controller)), interval_us_(interval_us) {}
+
+    // 首次update()时才向OCO取参数，构造时沿用Codec的参数
+    bool initial_params(uint32_t&, uint32_t&) const { return false; }
+
+    bool decide(uint64_t now_us, uint32_t& k, uint32_t& m) {
+        if (now_us < next_decision_us_) {
+            return false;
+        }
+        next_decision_us_ = now_us + interval_us_;
+
+        RedundancyDecision decision = controller_->compute_optimal_redundancy();
+        k = decision.k;
+        m = decision.m;
+        return true;
+    }
+
+    std::shared_ptr<OCORedundancyController> controller() const { return controller_; }
+
+private:
+    std::shared_ptr<OCORedundancyController> controller_;
+    uint64_t interval_us_;
+    uint64_t next_decision_us_ = 0;
+};
+
+/**
+ * @brief 静态冗余策略：(k, m)在构建时确定，流水线构造时写入Codec，之后从不切换
+ */
+template<uint32_t K, uint32_t M>
+class FixedRedundancy {
+    static_assert(K > 0 && M > 0 && K + M <= kMaxFECBlocks, "FEC parameters out of range");
+
+public:
+    static constexpr uint32_t k = K;
+    static constexpr uint32_t m = M;
+
+    bool initial_params(uint32_t& out_k, uint32_t& out_m) const {
+        out_k = K;
+        out_m = M;
+        return true;
+    }
+
+    bool decide(uint64_t, uint32_t&, uint32_t&) { return false; }
+};
+
+// ========== ClockPolicy ==========
+
+/**
+ * @brief 进程时钟（Clock::now_us()，可被VirtualClock替换、受ClockBatch缓存）
+ */
+struct ProcessClock {
+    uint64_t now_us() const { return Clock::now_us(); }
+};
+
+/**
+ * @brief 直接读取steady_clock，不经过可替换的时间源
+ */
+struct SteadyClock {
+    uint64_t now_us() const { return steady_now_us(); }
+};
+
+// ========== Transport ==========
+
+/**
+ * @brief 经由QUIC连接以DATAGRAM发出帧
+ *
+ * Connection为IQUICConnection时是虚调用；传入final的具体连接类型时调用在编译期绑定
+ */
+template<typename Connection = IQUICConnection>
+class ConnectionTransport {
+public:
+    explicit ConnectionTransport(Connection& connection) : connection_(&connection) {}
+
+    bool transmit(uint32_t path_id, const FECFrame& frame) {
+        return connection_->send_datagram_on_path(path_id, frame.serialize()) > 0;
+    }
+
+private:
+    Connection* connection_;
+};
+
+/**
+ * @brief 把帧交给可调用对象（fn(path_id, frame) -> bool），便于内联到自定义发送路径
+ */
+template<typename Fn>
+class CallbackTransport {
+public:
+    explicit CallbackTransport(Fn fn) : fn_(std::move(fn)) {}
+
+    bool transmit(uint32_t path_id, const FECFrame& frame) { return fn_(path_id, frame); }
+
+private:
+    Fn fn_;
+};
+
+template<typename Fn>
+CallbackTransport<Fn> make_callback_transport(Fn fn) {
+    return CallbackTransport<Fn>(std::move(fn));
+}
+
+/**
+ * @brief 运行期配置的流水线：与MPQUICFECController的发送路径使用同一套组件
+ */
+using RuntimeFECPipeline = BasicFECPipeline<GroupManagerCodec, PathSchedulerPolicy,
+                                            OCORedundancyPolicy, ProcessClock,
+                                            ConnectionTransport<IQUICConnection>>;
+
+// ========== 基准 ==========
+
+constexpr uint32_t kBenchK = 8;
+constexpr uint32_t kBenchM = 2;
+constexpr uint32_t kBenchPaths = 2;
+
+struct BenchConfig {
+    size_t packets = 200000;
+    uint32_t packet_size = 1200;
+};
+
+struct VariantResult {
+    std::string name;
+    uint32_t k = 0;
+    uint32_t m = 0;
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    double cpu_seconds = 0;
+};
+
+double thread_cpu_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief 只计数的连接：数据报交给它即视为发出
+ */
+class NullConnection final : public IQUICConnection {
+public:
+    bool connect(const std::string&, uint16_t) override { return true; }
+    bool listen(const std::string&, uint16_t) override { return true; }
+    StreamID create_stream() override { return 0; }
+
+    size_t send(StreamID, const std::vector<uint8_t>& data, bool) override {
+        return count(data.size());
+    }
+
+    size_t send_on_path(PathID, StreamID, const std::vector<uint8_t>& data, bool) override {
+        return count(data.size());
+    }
+
+    bool supports_datagrams() const override { return true; }
+    size_t max_datagram_size() const override { return 65535; }
+
+    size_t send_datagram_on_path(PathID, const std::vector<uint8_t>& data) override {
+        return count(data.size());
+    }
+
+    void close_stream(StreamID) override {}
+    void close(uint32_t, const std::string&) override {}
+    int process_events(int) override { return 0; }
+
+    PathID add_path(const std::string&, uint16_t, const std::string&, uint16_t) override {
+        return 0;
+    }
+
+    void remove_path(PathID) override {}
+    std::vector<QUICPathInfo> get_paths() const override { return {}; }
+    QUICState get_state() const override { return QUICState::CONNECTED; }
+    void set_data_recv_callback(DataRecvCallback) override {}
+    void set_datagram_recv_callback(DatagramRecvCallback) override {}
+    void set_state_change_callback(StateChangeCallback) override {}
+    std::string get_stats() const override { return ""; }
+
+    uint64_t frames() const { return frames_; }
+    uint64_t bytes() const { return bytes_; }
+
+private:
+    size_t count(size_t size) {
+        ++frames_;
+        bytes_ += size;
+        return size;
+    }
+
+    uint64_t frames_ = 0;
+    uint64_t bytes_ = 0;
+};
+
+PathState bench_path(uint32_t path_id) {
+    PathState state;
+    state.path_id = path_id;
+    state.rtt_ms = 20 + 10.0 * path_id;
+    state.loss_rate = 0.01;
+    state.bandwidth_mbps = 100;
+    return state;
+}
+
+VariantResult run_controller(const BenchConfig& config, const std::vector<uint8_t>& data) {
+    MPQUICFECController controller(kBenchK, kBenchM, config.packet_size);
+    controller.initialize();
+    for (uint32_t p = 0; p < kBenchPaths; ++p) {
+        controller.add_path(p, bench_path(p));
+    }
+
+    VariantResult result;
+    result.name = "controller";
+    std::tie(result.k, result.m) = controller.get_coding_params(0);
+
+    std::vector<uint8_t> wire(FECFrameHeader::HEADER_SIZE + config.packet_size);
+    double cpu_start = thread_cpu_seconds();
+    for (size_t i = 0; i < config.packets; ++i) {
+        for (const auto& meta : controller.send_stream_data(data, 0, 0)) {
+            result.bytes += meta.frame.serialize_to(wire.data());
+            ++result.frames;
+        }
+    }
+    result.cpu_seconds = thread_cpu_seconds() - cpu_start;
+    return result;
+}
+
+VariantResult run_runtime(const BenchConfig& config, const std::vector<uint8_t>& data) {
+    auto scheduler = std::make_shared<PathScheduler>();
+    auto oco = std::make_shared<OCORedundancyController>();
+    for (uint32_t p = 0; p < kBenchPaths; ++p) {
+        scheduler->update_path_state(bench_path(p));
+    }
+    NullConnection connection;
+
+    RuntimeFECPipeline pipeline(GroupManagerCodec(kBenchK, kBenchM, config.packet_size),
+                                PathSchedulerPolicy(scheduler), OCORedundancyPolicy(oco),
+                                ConnectionTransport<IQUICConnection>(connection));
+
+    VariantResult result;
+    result.name = "runtime";
+    std::tie(result.k, result.m) = pipeline.codec().params();
+
+    double cpu_start = thread_cpu_seconds();
+    for (size_t i = 0; i < config.packets; ++i) {
+        pipeline.send(data);
+    }
+    result.cpu_seconds = thread_cpu_seconds() - cpu_start;
+    result.frames = connection.frames();
+    result.bytes = connection.bytes();
+    return result;
+}
+
+VariantResult run_static(const BenchConfig& config, const std::vector<uint8_t>& data) {
+    VariantResult result;
+    result.name = "static";
+
+    std::vector<uint8_t> wire(FECFrameHeader::HEADER_SIZE + config.packet_size);
+    auto transport = make_callback_transport([&](uint32_t, const FECFrame& frame) {
+        result.bytes += frame.serialize_to(wire.data());
+        ++result.frames;
+        return true;
+    });
+
+    // Codec以任意参数构造，由FixedRedundancy在流水线构造时改写为8+2
+    BasicFECPipeline<DirectCodec, RoundRobinPaths<kBenchPaths>,
+                     FixedRedundancy<kBenchK, kBenchM>, SteadyClock, decltype(transport)>
+        pipeline(DirectCodec(1, 1, config.packet_size), RoundRobinPaths<kBenchPaths>(),
+                 FixedRedundancy<kBenchK, kBenchM>(), std::move(transport));
+    std::tie(result.k, result.m) = pipeline.codec().params();
+
+    double cpu_start = thread_cpu_seconds();
+    for (size_t i = 0; i < config.packets; ++i) {
+        pipeline.send(data);
+    }
+    result.cpu_seconds = thread_cpu_seconds() - cpu_start;
+    return result;
+}
+
+void print_usage(const char* prog) {
+    std::cout << "Usage: " << prog << " [--packets N] [--size BYTES]\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--packets") config.packets = std::stoul(value);
+        else if (arg == "--size") config.packet_size = static_cast<uint32_t>(std::stoul(value));
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // 基准只关心数字，关闭组件初始化日志
+    Logger::instance().set_level(LogLevel::WARN);
+
+    std::vector<uint8_t> data(config.packet_size);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i * 31 + 7);
+    }
+
+    std::vector<VariantResult> results = {
+        run_controller(config, data),
+        run_runtime(config, data),
+        run_static(config, data),
+    };
+
+    std::cout << std::left << std::setw(12) << "variant" << std::setw(4) << "k"
+              << std::setw(4) << "m" << std::right << std::setw(12) << "frames"
+              << std::setw(10) << "cpu_s" << std::setw(10) << "Mpps" << std::setw(10)
+              << "ns/pkt" << "\n";
+    for (const auto& r : results) {
+        double mpps = r.cpu_seconds > 0 ? config.packets / r.cpu_seconds / 1e6 : 0;
+        std::cout << std::left << std::setw(12) << r.name << std::setw(4) << r.k
+                  << std::setw(4) << r.m << std::right << std::setw(12) << r.frames
+                  << std::fixed << std::setprecision(3) << std::setw(10) << r.cpu_seconds
+                  << std::setw(10) << mpps << std::setprecision(0) << std::setw(10)
+                  << r.cpu_seconds * 1e9 / config.packets << std::defaultfloat << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,437 @@
+#include "mpquic_fec_controller.hpp"
+#include "loss_model.hpp"
+#include "logger.hpp"
+#include "instrumented_mutex.hpp"
+#include "stage_timing.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace mpquic_fec;
+
+/**
+ * @brief 端到端流水线基准
+ *
+ * 单线程驱动完整路径：MPQUICFECController发送（编码+路径分配）→ 帧序列化 →
+ * 模拟多路径网络（单向时延 + Bernoulli/Gilbert-Elliott丢包）→ 帧反序列化 →
+ * 控制器接收解码。网络时间是虚拟的（按发包速率推进，不睡眠），CPU时间是真实的。
+ *
+ * 对每个 (k, m) × 路径数 × 丢包率 场景输出：
+ * - 每核每秒处理包数（按线程CPU时间计算）
+ * - 发送侧（含编码）与接收侧（含解码）的CPU占比
+ * - 交付时延与恢复时延的 p50/p99/p999（虚拟时间，毫秒）
+ *
+ * 用法：
+ *   bench_pipeline [--k 4,8,16] [--m 1,2,4] [--paths 1,2,3] [--loss 0,0.01,0.05]
+ *                  [--burst LEN] [--packets N] [--size BYTES] [--rate PPS] [--json FILE]
+ */
+
+namespace {
+
+struct BenchConfig {
+    std::vector<uint32_t> k_values = {4, 8, 16};
+    std::vector<uint32_t> m_values = {1, 2, 4};
+    std::vector<uint32_t> path_counts = {1, 2, 3};
+    std::vector<double> loss_rates = {0.0, 0.01, 0.05};
+    double burst_len = 1.0;       // 1 = Bernoulli独立丢包
+    size_t packets = 50000;
+    uint32_t packet_size = 1200;
+    double rate_pps = 20000;      // 虚拟发包速率
+    std::string json_path;
+};
+
+struct Percentiles {
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+};
+
+struct ScenarioResult {
+    uint32_t k = 0;
+    uint32_t m = 0;
+    uint32_t paths = 0;
+    double loss = 0;
+    size_t packets = 0;
+    size_t delivered = 0;
+    size_t recovered = 0;
+    size_t lost_frames = 0;
+    double pps_per_core = 0;
+    double encode_cpu_share = 0;
+    double decode_cpu_share = 0;
+    Percentiles delivery_ms;
+    Percentiles recovery_ms;
+};
+
+/**
+ * @brief 一个在途帧
+ */
+struct InFlight {
+    double arrival_ms;
+    uint64_t seq;              // 同一时刻到达的帧保持发送顺序
+    uint32_t path_id;
+    std::vector<uint8_t> wire;
+
+    bool operator>(const InFlight& other) const {
+        return arrival_ms != other.arrival_ms ? arrival_ms > other.arrival_ms
+                                              : seq > other.seq;
+    }
+};
+
+/**
+ * @brief 接收侧跟踪的组状态
+ */
+struct GroupTrack {
+    std::vector<double> submit_ms;          // 各源块的应用提交时刻
+    std::vector<double> expected_ms;        // 各源块若未丢失的到达时刻
+    std::vector<bool> arrived;              // 源块是否直接到达
+};
+
+template<typename T>
+std::vector<T> parse_list(const std::string& arg) {
+    std::vector<T> values;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            values.push_back(static_cast<T>(std::stod(item)));
+        }
+    }
+    if (values.empty()) {
+        throw std::invalid_argument("Empty list: " + arg);
+    }
+    return values;
+}
+
+Percentiles percentiles(std::vector<double>& samples) {
+    Percentiles p;
+    if (samples.empty()) {
+        return p;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double q) {
+        size_t idx = static_cast<size_t>(q * (samples.size() - 1) + 0.5);
+        return samples[std::min(idx, samples.size() - 1)];
+    };
+    p.p50 = at(0.50);
+    p.p99 = at(0.99);
+    p.p999 = at(0.999);
+    return p;
+}
+
+double thread_cpu_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ScenarioResult run_scenario(const BenchConfig& config, uint32_t k, uint32_t m,
+                            uint32_t path_count, double loss) {
+    ScenarioResult result;
+    result.k = k;
+    result.m = m;
+    result.paths = path_count;
+    result.loss = loss;
+    result.packets = config.packets;
+
+    MPQUICFECController controller(k, m, config.packet_size);
+    controller.initialize();
+
+    // 路径i：RTT = 20 + 10i ms，各路径独立丢包
+    std::vector<double> one_way_ms(path_count);
+    std::vector<GilbertElliottModel> loss_models;
+    for (uint32_t p = 0; p < path_count; ++p) {
+        PathState state;
+        state.path_id = p;
+        state.rtt_ms = 20.0 + 10.0 * p;
+        state.loss_rate = loss;
+        state.bandwidth_mbps = 100.0;
+        controller.add_path(p, state);
+        one_way_ms[p] = state.rtt_ms / 2;
+        loss_models.push_back(config.burst_len > 1.0
+            ? GilbertElliottModel::from_loss_rate(loss, config.burst_len)
+            : GilbertElliottModel::bernoulli(loss));
+    }
+
+    std::mt19937_64 rng(0x5eed + k * 131 + m * 17 + path_count);
+    std::vector<uint8_t> payload(config.packet_size);
+    for (auto& b : payload) {
+        b = static_cast<uint8_t>(rng());
+    }
+
+    std::priority_queue<InFlight, std::vector<InFlight>, std::greater<InFlight>> network;
+    std::deque<double> unassigned_submits;                  // 已提交、尚未编入已发送组的包
+    std::unordered_map<uint64_t, GroupTrack> groups;
+
+    std::vector<double> delivery_samples;
+    std::vector<double> recovery_samples;
+    delivery_samples.reserve(config.packets);
+
+    uint64_t send_ns = 0;
+    uint64_t recv_ns = 0;
+    uint64_t next_seq = 0;
+    double cpu_start = thread_cpu_seconds();
+
+    auto transmit = [&](std::vector<SendPacketMeta>& metas, double now_ms) {
+        for (auto& meta : metas) {
+            const auto& header = meta.frame.header;
+            if (meta.frame.is_source_frame()) {
+                auto& track = groups[header.group_id];
+                if (track.submit_ms.empty()) {
+                    track.submit_ms.assign(header.source_blocks, now_ms);
+                    track.expected_ms.assign(header.source_blocks, now_ms);
+                    track.arrived.assign(header.source_blocks, false);
+                }
+                if (header.block_index < track.submit_ms.size() && !unassigned_submits.empty()) {
+                    track.submit_ms[header.block_index] = unassigned_submits.front();
+                    unassigned_submits.pop_front();
+                }
+                if (header.block_index < track.expected_ms.size()) {
+                    track.expected_ms[header.block_index] = now_ms + one_way_ms[meta.path_id];
+                }
+            }
+
+            if (loss_models[meta.path_id].next_lost(rng)) {
+                ++result.lost_frames;
+                continue;
+            }
+            uint64_t t0 = now_ns();
+            InFlight frame{now_ms + one_way_ms[meta.path_id], next_seq++, meta.path_id,
+                           meta.frame.serialize()};
+            send_ns += now_ns() - t0;
+            network.push(std::move(frame));
+        }
+    };
+
+    auto receive_until = [&](double until_ms) {
+        while (!network.empty() && network.top().arrival_ms <= until_ms) {
+            InFlight frame = std::move(const_cast<InFlight&>(network.top()));
+            network.pop();
+
+            uint64_t t0 = now_ns();
+            FECFrame fec = FECFrame::deserialize(frame.wire.data(), frame.wire.size());
+            auto decoded = controller.receive_fec_frame(fec, frame.path_id);
+            recv_ns += now_ns() - t0;
+
+            auto it = groups.find(fec.header.group_id);
+            if (it == groups.end()) {
+                continue;
+            }
+            auto& track = it->second;
+            if (fec.is_source_frame() && fec.header.block_index < track.arrived.size()) {
+                track.arrived[fec.header.block_index] = true;
+            }
+            if (decoded.empty()) {
+                continue;
+            }
+
+            // 组完成：全部源块在此刻交付
+            for (size_t i = 0; i < track.submit_ms.size(); ++i) {
+                delivery_samples.push_back(frame.arrival_ms - track.submit_ms[i]);
+                ++result.delivered;
+                if (!track.arrived[i]) {
+                    recovery_samples.push_back(
+                        std::max(0.0, frame.arrival_ms - track.expected_ms[i]));
+                    ++result.recovered;
+                }
+            }
+            groups.erase(it);
+        }
+    };
+
+    double interval_ms = 1000.0 / config.rate_pps;
+    for (size_t i = 0; i < config.packets; ++i) {
+        double now_ms = i * interval_ms;
+        receive_until(now_ms);
+
+        unassigned_submits.push_back(now_ms);
+        uint64_t t0 = now_ns();
+        auto metas = controller.send_stream_data(payload);
+        send_ns += now_ns() - t0;
+        transmit(metas, now_ms);
+    }
+
+    double end_ms = config.packets * interval_ms;
+    uint64_t t0 = now_ns();
+    auto tail = controller.flush_pending_groups();
+    send_ns += now_ns() - t0;
+    transmit(tail, end_ms);
+    receive_until(end_ms + 10000.0);
+
+    double cpu_seconds = thread_cpu_seconds() - cpu_start;
+    result.pps_per_core = cpu_seconds > 0 ? config.packets / cpu_seconds : 0;
+    result.encode_cpu_share = cpu_seconds > 0 ? send_ns / 1e9 / cpu_seconds : 0;
+    result.decode_cpu_share = cpu_seconds > 0 ? recv_ns / 1e9 / cpu_seconds : 0;
+
+    result.delivery_ms = percentiles(delivery_samples);
+    result.recovery_ms = percentiles(recovery_samples);
+    return result;
+}
+
+void write_percentiles(std::ostream& out, const char* name, const Percentiles& p) {
+    out << "\"" << name << "\":{\"p50\":" << p.p50 << ",\"p99\":" << p.p99
+        << ",\"p999\":" << p.p999 << "}";
+}
+
+void write_json(std::ostream& out, const BenchConfig& config,
+                const std::vector<ScenarioResult>& results) {
+    out << std::fixed << std::setprecision(4);
+    out << "{\n  \"config\":{\"packets\":" << config.packets
+        << ",\"packet_size\":" << config.packet_size
+        << ",\"rate_pps\":" << config.rate_pps
+        << ",\"burst_len\":" << config.burst_len << "},\n  \"scenarios\":[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << "    {\"k\":" << r.k << ",\"m\":" << r.m << ",\"paths\":" << r.paths
+            << ",\"loss\":" << r.loss
+            << ",\"packets\":" << r.packets
+            << ",\"delivered\":" << r.delivered
+            << ",\"recovered\":" << r.recovered
+            << ",\"lost_frames\":" << r.lost_frames
+            << ",\"residual_loss_rate\":"
+            << (r.packets > 0 ? 1.0 - static_cast<double>(r.delivered) / r.packets : 0.0)
+            << ",\"pps_per_core\":" << r.pps_per_core
+            << ",\"encode_cpu_share\":" << r.encode_cpu_share
+            << ",\"decode_cpu_share\":" << r.decode_cpu_share << ",";
+        write_percentiles(out, "delivery_latency_ms", r.delivery_ms);
+        out << ",";
+        write_percentiles(out, "recovery_latency_ms", r.recovery_ms);
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+void print_usage(const char* prog) {
+    std::cout << "Usage: " << prog << " [--k LIST] [--m LIST] [--paths LIST] [--loss LIST]\n"
+              << "       [--burst LEN] [--packets N] [--size BYTES] [--rate PPS] [--json FILE]\n"
+              << "  LIST = comma separated values, e.g. --k 4,8,16 --loss 0,0.01,0.05\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--k") config.k_values = parse_list<uint32_t>(value);
+        else if (arg == "--m") config.m_values = parse_list<uint32_t>(value);
+        else if (arg == "--paths") config.path_counts = parse_list<uint32_t>(value);
+        else if (arg == "--loss") config.loss_rates = parse_list<double>(value);
+        else if (arg == "--burst") config.burst_len = std::stod(value);
+        else if (arg == "--packets") config.packets = std::stoul(value);
+        else if (arg == "--size") config.packet_size = static_cast<uint32_t>(std::stoul(value));
+        else if (arg == "--rate") config.rate_pps = std::stod(value);
+        else if (arg == "--json") config.json_path = value;
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // 基准只关心数字，关闭组件初始化日志
+    Logger::instance().set_level(LogLevel::WARN);
+
+    std::vector<ScenarioResult> results;
+    std::cout << std::left << std::setw(6) << "k" << std::setw(6) << "m"
+              << std::setw(7) << "paths" << std::setw(8) << "loss"
+              << std::right << std::setw(12) << "pps/core" << std::setw(8) << "enc%"
+              << std::setw(8) << "dec%" << std::setw(10) << "p50ms" << std::setw(10) << "p99ms"
+              << std::setw(10) << "p999ms" << std::setw(11) << "rec_p99" << std::setw(10)
+              << "residual" << "\n";
+
+    for (uint32_t k : config.k_values) {
+        for (uint32_t m : config.m_values) {
+            for (uint32_t paths : config.path_counts) {
+                for (double loss : config.loss_rates) {
+                    auto r = run_scenario(config, k, m, paths, loss);
+                    results.push_back(r);
+
+                    double residual = r.packets > 0
+                        ? 1.0 - static_cast<double>(r.delivered) / r.packets : 0.0;
+                    std::cout << std::left << std::setw(6) << k << std::setw(6) << m
+                              << std::setw(7) << paths << std::setw(8) << loss << std::right
+                              << std::fixed << std::setprecision(0)
+                              << std::setw(12) << r.pps_per_core
+                              << std::setprecision(1)
+                              << std::setw(8) << r.encode_cpu_share * 100
+                              << std::setw(8) << r.decode_cpu_share * 100
+                              << std::setprecision(2)
+                              << std::setw(10) << r.delivery_ms.p50
+                              << std::setw(10) << r.delivery_ms.p99
+                              << std::setw(10) << r.delivery_ms.p999
+                              << std::setw(11) << r.recovery_ms.p99
+                              << std::setprecision(5) << std::setw(10) << residual
+                              << std::defaultfloat << "\n";
+                }
+            }
+        }
+    }
+
+    // 开启 MPQUIC_FEC_STAGE_TIMING 编译时附带各阶段自身耗时（所有场景合计）
+    if (StageTiming::compiled_in()) {
+        std::cout << "\n" << std::left << std::setw(24) << "stage" << std::right
+                  << std::setw(12) << "count" << std::setw(10) << "mean_ns"
+                  << std::setw(10) << "p50_ns" << std::setw(10) << "p99_ns"
+                  << std::setw(12) << "max_ns" << "\n";
+        for (const auto& stage : StageTiming::instance().snapshot()) {
+            std::cout << std::left << std::setw(24) << stage.name << std::right
+                      << std::fixed << std::setprecision(0)
+                      << std::setw(12) << stage.count << std::setw(10) << stage.mean_ns
+                      << std::setw(10) << stage.p50_ns << std::setw(10) << stage.p99_ns
+                      << std::setw(12) << stage.max_ns << std::defaultfloat << "\n";
+        }
+    }
+
+    // 开启 MPQUIC_FEC_LOCK_PROFILING 编译时附带各加锁位置的获取与持有时间
+    if (LockProfiler::compiled_in()) {
+        std::cout << "\n" << std::left << std::setw(24) << "lock" << std::right
+                  << std::setw(12) << "acquired" << std::setw(11) << "contended"
+                  << std::setw(13) << "wait_p99_ns" << std::setw(13) << "hold_p50_ns"
+                  << std::setw(13) << "hold_p99_ns" << std::setw(13) << "hold_max_ns" << "\n";
+        for (const auto& lock : LockProfiler::instance().snapshot()) {
+            std::cout << std::left << std::setw(24) << lock.name << std::right
+                      << std::fixed << std::setprecision(0)
+                      << std::setw(12) << lock.acquisitions << std::setw(11) << lock.contended
+                      << std::setw(13) << lock.wait_p99_ns << std::setw(13) << lock.hold_p50_ns
+                      << std::setw(13) << lock.hold_p99_ns << std::setw(13) << lock.hold_max_ns
+                      << std::defaultfloat << "\n";
+        }
+    }
+
+    if (!config.json_path.empty()) {
+        std::ofstream out(config.json_path);
+        if (!out) {
+            std::cerr << "Cannot write " << config.json_path << "\n";
+            return 1;
+        }
+        write_json(out, config, results);
+        std::cout << "Results written to " << config.json_path << "\n";
+    }
+    return 0;
+}
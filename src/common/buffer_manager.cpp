@@ -1,22 +1,42 @@
 #include "buffer_manager.hpp"
+#include "hugepage_arena.hpp"
 #include "logger.hpp"
+#include <algorithm>
 
 namespace mpquic_fec {
 
+// ========== Buffer 实现 ==========
+
+void Buffer::StorageDeleter::operator()(uint8_t* ptr) const {
+    if (arena_bytes > 0) {
+        HugePageArena::instance().deallocate(ptr, arena_bytes);
+    } else {
+        delete[] ptr;
+    }
+}
+
 Buffer::Buffer(uint32_t capacity)
-    : data_(std::make_unique<uint8_t[]>(capacity)),
+    : data_(new uint8_t[capacity](), StorageDeleter{}),
       capacity_(capacity) {
 }
 
+Buffer::Buffer(uint8_t* storage, uint32_t capacity, uint8_t size_class)
+    : data_(storage, StorageDeleter{capacity}),
+      capacity_(capacity),
+      size_class_(size_class) {
+}
+
 Buffer::~Buffer() {
 }
 
 Buffer::Buffer(Buffer&& other) noexcept
     : data_(std::move(other.data_)),
       size_(other.size_),
-      capacity_(other.capacity_) {
+      capacity_(other.capacity_),
+      size_class_(other.size_class_) {
     other.size_ = 0;
     other.capacity_ = 0;
+    other.size_class_ = kNoSizeClass;
 }
 
 Buffer& Buffer::operator=(Buffer&& other) noexcept {
@@ -24,8 +44,10 @@ Buffer& Buffer::operator=(Buffer&& other) noexcept {
         data_ = std::move(other.data_);
         size_ = other.size_;
         capacity_ = other.capacity_;
+        size_class_ = other.size_class_;
         other.size_ = 0;
         other.capacity_ = 0;
+        other.size_class_ = kNoSizeClass;
     }
     return *this;
 }
@@ -40,26 +62,257 @@ void Buffer::write(const uint8_t* data, uint32_t size) {
     size_ = size;
 }
 
+void Buffer::resize(uint32_t size) {
+    if (size > capacity_) {
+        throw std::runtime_error("Buffer overflow: requested " + 
+                               std::to_string(size) + " bytes, capacity " + 
+                               std::to_string(capacity_));
+    }
+    size_ = size;
+}
+
 void Buffer::reset() {
     size_ = 0;
 }
 
+// ========== BufferPool 实现 ==========
+
+constexpr std::array<uint32_t, BufferPool::kNumSizeClasses> BufferPool::kSizeClasses;
+
 BufferPool& BufferPool::instance() {
     static BufferPool pool;
     return pool;
 }
 
+BufferPool::BufferPool()
+    : high_water_(kDefaultHighWater),
+      heap_allocations_(0),
+      heap_frees_(0),
+      depot_refills_(0),
+      depot_spills_(0),
+      oversize_allocations_(0) {
+    for (auto& depot : depots_) {
+        depot = std::make_unique<LockFreeRing<uint8_t*>>(kDepotCapacity);
+    }
+}
+
+BufferPool::~BufferPool() {
+    for (size_t c = 0; c < kNumSizeClasses; ++c) {
+        trim_class(c, 0);
+    }
+}
+
+BufferPool::Magazine::~Magazine() {
+    // 线程退出：缓存的缓冲区交还仓库，供其他线程复用
+    auto& pool = BufferPool::instance();
+    for (size_t c = 0; c < kNumSizeClasses; ++c) {
+        pool.spill(*this, c, counts[c]);
+    }
+}
+
+BufferPool::Magazine& BufferPool::local_magazine() {
+    thread_local Magazine magazine;
+    return magazine;
+}
+
+size_t BufferPool::size_class_for(uint32_t size) {
+    for (size_t c = 0; c < kNumSizeClasses; ++c) {
+        if (size <= kSizeClasses[c]) {
+            return c;
+        }
+    }
+    return kNumSizeClasses;
+}
+
 Buffer BufferPool::acquire(uint32_t size) {
-    // 简化实现：直接创建新缓冲区
-    // 实际应从池中查找可重用的缓冲区
-    LOG_DEBUG("Acquired buffer of size ", size);
-    return Buffer(size);
+    size_t size_class = size_class_for(size);
+    if (size_class == kNumSizeClasses) {
+        oversize_allocations_.fetch_add(1, std::memory_order_relaxed);
+        LOG_DEBUG("Acquired oversize buffer of size ", size);
+        return Buffer(size);
+    }
+
+    auto& magazine = local_magazine();
+    size_t& count = magazine.counts[size_class];
+    if (count == 0 && refill(magazine, size_class) == 0) {
+        allocate_slab(magazine, size_class);
+    }
+
+    uint8_t* storage = magazine.slots[size_class][--count];
+    return Buffer(storage, kSizeClasses[size_class], static_cast<uint8_t>(size_class));
 }
 
 void BufferPool::release(Buffer&& buffer) {
-    // 简化实现：让缓冲区自动释放
-    // 实际应将缓冲区放回池中以供重用
-    LOG_DEBUG("Released buffer of size ", buffer.capacity());
+    size_t size_class = buffer.size_class_;
+    if (size_class == Buffer::kNoSizeClass) {
+        // 外部构造或超大缓冲区：存储来自new[]而非Arena，随buffer析构释放
+        return;
+    }
+
+    auto& magazine = local_magazine();
+    size_t& count = magazine.counts[size_class];
+    if (count == kMagazineCapacity) {
+        spill(magazine, size_class, kMagazineBatch);
+    }
+
+    magazine.slots[size_class][count++] = buffer.data_.release();
+    buffer.size_ = 0;
+    buffer.capacity_ = 0;
+    buffer.size_class_ = Buffer::kNoSizeClass;
+}
+
+void BufferPool::allocate_slab(Magazine& magazine, size_t size_class) {
+    // 一次从Arena取一整块slab切成kMagazineBatch个缓冲区；
+    // 切分步长与Arena对齐粒度一致，每个缓冲区之后可以单独归还
+    size_t stride = (kSizeClasses[size_class] + HugePageArena::kAlignment - 1) &
+                    ~(HugePageArena::kAlignment - 1);
+    auto* slab = static_cast<uint8_t*>(
+        HugePageArena::instance().allocate(stride * kMagazineBatch));
+
+    size_t& count = magazine.counts[size_class];
+    for (size_t i = 0; i < kMagazineBatch; ++i) {
+        magazine.slots[size_class][count++] = slab + i * stride;
+    }
+    heap_allocations_.fetch_add(kMagazineBatch, std::memory_order_relaxed);
+}
+
+void BufferPool::free_storage(uint8_t* storage, size_t size_class) {
+    HugePageArena::instance().deallocate(storage, kSizeClasses[size_class]);
+}
+
+size_t BufferPool::refill(Magazine& magazine, size_t size_class) {
+    auto& depot = *depots_[size_class];
+    size_t& count = magazine.counts[size_class];
+    auto& slots = magazine.slots[size_class];
+
+    size_t taken = depot.drain([&](uint8_t*&& storage) {
+        slots[count++] = storage;
+    }, kMagazineBatch - count);
+
+    if (taken > 0) {
+        depot_refills_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return taken;
+}
+
+void BufferPool::spill(Magazine& magazine, size_t size_class, size_t count) {
+    auto& depot = *depots_[size_class];
+    size_t& held = magazine.counts[size_class];
+    size_t limit = high_water_.load(std::memory_order_relaxed);
+    count = std::min(count, held);
+
+    size_t freed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t* storage = magazine.slots[size_class][--held];
+        if (depot.size_approx() >= limit || !depot.try_push(storage)) {
+            free_storage(storage, size_class);  // 超过高水位：直接归还Arena
+            ++freed;
+        }
+    }
+
+    if (count > 0) {
+        depot_spills_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (freed > 0) {
+        heap_frees_.fetch_add(freed, std::memory_order_relaxed);
+    }
+}
+
+size_t BufferPool::trim_class(size_t size_class, size_t keep) {
+    auto& depot = *depots_[size_class];
+    size_t freed = 0;
+    uint8_t* storage = nullptr;
+    while (depot.size_approx() > keep && depot.try_pop(storage)) {
+        free_storage(storage, size_class);
+        ++freed;
+    }
+    if (freed > 0) {
+        heap_frees_.fetch_add(freed, std::memory_order_relaxed);
+    }
+    return freed;
+}
+
+void BufferPool::reserve(uint32_t size, size_t count) {
+    size_t size_class = size_class_for(size);
+    if (size_class == kNumSizeClasses) {
+        throw std::invalid_argument("Cannot reserve buffers larger than " +
+                                    std::to_string(kSizeClasses.back()) + " bytes");
+    }
+
+    auto& depot = *depots_[size_class];
+    count = std::min(count, high_water_.load(std::memory_order_relaxed));
+    size_t added = 0;
+    auto& arena = HugePageArena::instance();
+    while (depot.size_approx() < count) {
+        auto* storage = static_cast<uint8_t*>(arena.allocate(kSizeClasses[size_class]));
+        if (!depot.try_push(storage)) {
+            free_storage(storage, size_class);
+            break;
+        }
+        ++added;
+    }
+    heap_allocations_.fetch_add(added, std::memory_order_relaxed);
+
+    LOG_DEBUG("Reserved ", added, " buffers of ", kSizeClasses[size_class], " bytes");
+}
+
+void BufferPool::set_high_water(size_t max_buffers_per_class) {
+    high_water_.store(std::min(max_buffers_per_class, kDepotCapacity),
+                      std::memory_order_relaxed);
+    trim();
+}
+
+size_t BufferPool::trim() {
+    size_t keep = high_water_.load(std::memory_order_relaxed);
+    size_t freed = 0;
+    for (size_t c = 0; c < kNumSizeClasses; ++c) {
+        freed += trim_class(c, keep);
+    }
+    if (freed > 0) {
+        LOG_DEBUG("Trimmed ", freed, " pooled buffers above high-water mark ", keep);
+    }
+    return freed;
+}
+
+BufferPool::Statistics BufferPool::get_statistics() const {
+    Statistics stats;
+    stats.heap_allocations = heap_allocations_.load(std::memory_order_relaxed);
+    stats.heap_frees = heap_frees_.load(std::memory_order_relaxed);
+    stats.depot_refills = depot_refills_.load(std::memory_order_relaxed);
+    stats.depot_spills = depot_spills_.load(std::memory_order_relaxed);
+    stats.oversize_allocations = oversize_allocations_.load(std::memory_order_relaxed);
+    for (size_t c = 0; c < kNumSizeClasses; ++c) {
+        stats.depot_buffers[c] = depots_[c]->size_approx();
+    }
+    return stats;
+}
+
+// ========== PooledBuffer 实现 ==========
+
+PooledBuffer::PooledBuffer(uint32_t size)
+    : buffer_(BufferPool::instance().acquire(size)) {
+    buffer_.resize(size);
+}
+
+PooledBuffer::PooledBuffer(const uint8_t* data, uint32_t size)
+    : buffer_(BufferPool::instance().acquire(size)) {
+    buffer_.resize(size);
+    if (size > 0) {
+        std::memcpy(buffer_.mutable_data(), data, size);
+    }
+}
+
+PooledBuffer::~PooledBuffer() {
+    // 已被移走的缓冲区不属于任何档位，release直接忽略
+    BufferPool::instance().release(std::move(buffer_));
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+        BufferPool::instance().release(std::move(buffer_));
+        buffer_ = std::move(other.buffer_);
+    }
+    return *this;
 }
 
 } // namespace mpquic_fec
@@ -0,0 +1,136 @@
+#include "clock.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace mpquic_fec {
+
+// ========== TscClock 实现 ==========
+
+TscClock::TscClock()
+    : origin_ticks_(read_tsc()), origin_us_(steady_now_us()) {
+    store_anchor(Anchor{origin_ticks_, origin_us_, 0.0, 0});
+}
+
+uint64_t TscClock::now_us() {
+    uint64_t ticks = read_tsc();
+    Anchor anchor = load_anchor();
+    if (anchor.us_per_tick <= 0 || ticks >= anchor.recalibrate_ticks) {
+        return recalibrate(ticks);
+    }
+    return extrapolate(anchor, ticks);
+}
+
+double TscClock::ticks_per_us() const {
+    double us_per_tick = load_anchor().us_per_tick;
+    return us_per_tick > 0 ? 1.0 / us_per_tick : 0.0;
+}
+
+uint64_t TscClock::extrapolate(const Anchor& anchor, uint64_t ticks) {
+    // 读取tick后锚点可能已被其他线程前移，差值按有符号处理
+    auto delta = static_cast<int64_t>(ticks - anchor.base_ticks);
+    return anchor.base_us +
+           static_cast<int64_t>(static_cast<double>(delta) * anchor.us_per_tick);
+}
+
+TscClock::Anchor TscClock::load_anchor() const {
+    Anchor anchor;
+    for (;;) {
+        uint64_t seq = seq_.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+        anchor.base_ticks = base_ticks_.load(std::memory_order_relaxed);
+        anchor.base_us = base_us_.load(std::memory_order_relaxed);
+        anchor.us_per_tick = us_per_tick_.load(std::memory_order_relaxed);
+        anchor.recalibrate_ticks = recalibrate_ticks_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) == seq) {
+            return anchor;
+        }
+    }
+}
+
+void TscClock::store_anchor(const Anchor& anchor) {
+    uint64_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    base_ticks_.store(anchor.base_ticks, std::memory_order_relaxed);
+    base_us_.store(anchor.base_us, std::memory_order_relaxed);
+    us_per_tick_.store(anchor.us_per_tick, std::memory_order_relaxed);
+    recalibrate_ticks_.store(anchor.recalibrate_ticks, std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+uint64_t TscClock::recalibrate(uint64_t ticks) {
+    uint64_t now = steady_now_us();
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    Anchor anchor = load_anchor();
+    
+    // 其他线程正在或刚刚完成重新锚定：沿用现有锚点
+    if (!lock.owns_lock() || (anchor.us_per_tick > 0 && ticks < anchor.recalibrate_ticks)) {
+        return anchor.us_per_tick > 0 ? extrapolate(anchor, ticks) : now;
+    }
+    
+    // 频率按自构造以来的总增量估计，间隔越长越准
+    uint64_t elapsed_us = now - origin_us_;
+    if (elapsed_us < kInitialCalibrationUs || ticks <= origin_ticks_) {
+        return now;
+    }
+    double ticks_per_us = static_cast<double>(ticks - origin_ticks_) /
+                          static_cast<double>(elapsed_us);
+    double nominal_us_per_tick = 1.0 / ticks_per_us;
+    
+    Anchor next;
+    next.base_ticks = ticks;
+    next.us_per_tick = nominal_us_per_tick;
+    next.recalibrate_ticks = ticks + static_cast<uint64_t>(kRecalibrateUs * ticks_per_us);
+    
+    if (anchor.us_per_tick <= 0) {
+        next.base_us = now;
+    } else {
+        uint64_t predicted = extrapolate(anchor, ticks);
+        if (now >= predicted) {
+            // 落后于steady_clock：直接向前对齐
+            next.base_us = now;
+        } else {
+            // 超前：保持连续，在下一个间隔内放慢速率消化偏差（最多消化一半间隔）
+            double lead = std::min<double>(static_cast<double>(predicted - now),
+                                           kRecalibrateUs / 2.0);
+            next.base_us = predicted;
+            next.us_per_tick = nominal_us_per_tick * (kRecalibrateUs - lead) / kRecalibrateUs;
+        }
+    }
+    
+    store_anchor(next);
+    return next.base_us;
+}
+
+// ========== VirtualClock 实现 ==========
+
+void VirtualClock::set(uint64_t now_us) {
+    uint64_t current = now_us_.load(std::memory_order_relaxed);
+    while (now_us > current &&
+           !now_us_.compare_exchange_weak(current, now_us, std::memory_order_acq_rel)) {
+    }
+}
+
+// ========== Clock 实现 ==========
+
+TscClock& Clock::tsc() {
+    static TscClock* clock = new TscClock();
+    return *clock;
+}
+
+void Clock::set_source(std::shared_ptr<ClockSource> source) {
+    // 替换下来的时间源可能仍被其他线程读取，因此保留到进程退出
+    static std::mutex* retain_mutex = new std::mutex();
+    static auto* retained = new std::vector<std::shared_ptr<ClockSource>>();
+    
+    std::lock_guard<std::mutex> lock(*retain_mutex);
+    if (source) {
+        retained->push_back(source);
+    }
+    source_.store(source.get(), std::memory_order_release);
+}
+
+} // namespace mpquic_fec
@@ -0,0 +1,253 @@
+#include "event_trace.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace mpquic_fec {
+
+constexpr char EventTracer::kMagic[8];
+
+// ========== EventTracer 实现 ==========
+
+EventTracer& EventTracer::instance() {
+    static EventTracer* tracer = new EventTracer();
+    return *tracer;
+}
+
+EventTracer::ThreadBufferHandle::~ThreadBufferHandle() {
+    if (buffer) {
+        buffer->retired.store(true, std::memory_order_release);
+    }
+}
+
+EventTracer::ThreadBuffer& EventTracer::local_buffer() {
+    thread_local ThreadBufferHandle handle;
+    if (!handle.buffer) {
+        handle.buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(handle.buffer);
+    }
+    return *handle.buffer;
+}
+
+void EventTracer::start(const std::string& path) {
+    std::lock_guard<std::mutex> lock(sink_mutex_);
+    if (sink_open_.load(std::memory_order_acquire)) {
+        throw std::runtime_error("Event trace already recording");
+    }
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot create event trace " + path + ": " +
+                                 std::strerror(errno));
+    }
+
+    window_offset_ = 0;
+    window_used_ = 0;
+    records_written_.store(0, std::memory_order_relaxed);
+    if (!map_window()) {
+        ::close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Cannot map event trace " + path);
+    }
+
+    auto now_unix = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    start_steady_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    TraceFileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(header.magic));
+    header.version = kVersion;
+    header.record_size = sizeof(TraceRecord);
+    header.start_unix_ns = now_unix;
+    std::memcpy(window_, &header, sizeof(header));
+    window_used_ = sizeof(header);
+
+    // 丢弃上次停止后才写入线程缓冲区的事件（时间基准已变）
+    {
+        std::lock_guard<std::mutex> buffers_lock(buffers_mutex_);
+        for (auto& buffer : buffers_) {
+            buffer->tail.store(buffer->head.load(std::memory_order_acquire),
+                               std::memory_order_release);
+        }
+    }
+
+    if (!exit_hook_registered_) {
+        exit_hook_registered_ = true;
+        std::atexit([]() { EventTracer::instance().stop(); });
+    }
+
+    flusher_running_.store(true, std::memory_order_release);
+    flusher_ = std::thread([this]() { run_flusher(); });
+
+    sink_open_.store(true, std::memory_order_release);
+    enabled_.store(true, std::memory_order_release);
+
+    LOG_INFO("Event trace recording to ", path);
+}
+
+bool EventTracer::start_from_env() {
+    const char* path = std::getenv("MPQUIC_FEC_EVENT_TRACE");
+    if (path == nullptr || *path == '\0') {
+        return false;
+    }
+    start(path);
+    return true;
+}
+
+void EventTracer::stop() {
+    if (!sink_open_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    enabled_.store(false, std::memory_order_release);
+
+    flusher_running_.store(false, std::memory_order_release);
+    flusher_cv_.notify_one();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+
+    // 写出停止前已进入线程缓冲区的事件
+    drain_buffers();
+
+    std::lock_guard<std::mutex> lock(sink_mutex_);
+    close_sink();
+
+    auto stats = get_statistics();
+    LOG_INFO("Event trace stopped: ", stats.records_written, " records, ",
+             stats.records_dropped, " dropped");
+}
+
+bool EventTracer::map_window() {
+    if (::ftruncate(fd_, static_cast<off_t>(window_offset_ + kFileGrowBytes)) != 0) {
+        LOG_ERROR("Event trace ftruncate failed: ", std::strerror(errno));
+        return false;
+    }
+    void* window = ::mmap(nullptr, kFileGrowBytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          fd_, static_cast<off_t>(window_offset_));
+    if (window == MAP_FAILED) {
+        LOG_ERROR("Event trace mmap failed: ", std::strerror(errno));
+        window_ = nullptr;
+        return false;
+    }
+    window_ = static_cast<uint8_t*>(window);
+    return true;
+}
+
+void EventTracer::append_records(const TraceRecord* records, size_t count) {
+    // 调用方持有sink_mutex_
+    while (count > 0 && window_ != nullptr) {
+        if (window_used_ == kFileGrowBytes) {
+            ::munmap(window_, kFileGrowBytes);
+            window_offset_ += kFileGrowBytes;
+            window_used_ = 0;
+            if (!map_window()) {
+                return;
+            }
+        }
+
+        size_t fit = std::min(count, (kFileGrowBytes - window_used_) / sizeof(TraceRecord));
+        std::memcpy(window_ + window_used_, records, fit * sizeof(TraceRecord));
+        window_used_ += fit * sizeof(TraceRecord);
+        records_written_.fetch_add(fit, std::memory_order_relaxed);
+        records += fit;
+        count -= fit;
+    }
+}
+
+size_t EventTracer::drain_buffers() {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers = buffers_;
+    }
+
+    size_t moved = 0;
+    {
+        std::lock_guard<std::mutex> lock(sink_mutex_);
+        for (auto& buffer : buffers) {
+            uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            while (tail < head) {
+                // 环形回绕处分两段拷贝
+                size_t index = tail % kThreadRingRecords;
+                size_t count = std::min<uint64_t>(head - tail, kThreadRingRecords - index);
+                append_records(&buffer->records[index], count);
+                tail += count;
+                moved += count;
+            }
+            buffer->tail.store(tail, std::memory_order_release);
+        }
+    }
+
+    // 回收已退出且排空的线程缓冲区
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    auto it = std::remove_if(buffers_.begin(), buffers_.end(),
+        [this](const std::shared_ptr<ThreadBuffer>& buffer) {
+            bool done = buffer->retired.load(std::memory_order_acquire) &&
+                        buffer->tail.load(std::memory_order_relaxed) ==
+                            buffer->head.load(std::memory_order_acquire);
+            if (done) {
+                retired_dropped_ += buffer->dropped.load(std::memory_order_relaxed);
+            }
+            return done;
+        });
+    buffers_.erase(it, buffers_.end());
+    return moved;
+}
+
+void EventTracer::run_flusher() {
+    while (flusher_running_.load(std::memory_order_acquire)) {
+        if (drain_buffers() > 0) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(flusher_mutex_);
+        flusher_cv_.wait_for(lock, std::chrono::milliseconds(10));
+    }
+}
+
+void EventTracer::close_sink() {
+    // 调用方持有sink_mutex_
+    if (fd_ < 0) {
+        return;
+    }
+
+    size_t file_size = window_offset_ + window_used_;
+    if (window_ != nullptr) {
+        ::munmap(window_, kFileGrowBytes);
+        window_ = nullptr;
+    }
+
+    // 回填记录数并截掉未使用的预留空间
+    uint64_t count = records_written_.load(std::memory_order_relaxed);
+    ssize_t written = ::pwrite(fd_, &count, sizeof(count),
+                               offsetof(TraceFileHeader, record_count));
+    if (written != static_cast<ssize_t>(sizeof(count)) ||
+        ::ftruncate(fd_, static_cast<off_t>(file_size)) != 0) {
+        LOG_WARN("Event trace finalization failed: ", std::strerror(errno));
+    }
+    ::close(fd_);
+    fd_ = -1;
+}
+
+EventTracer::Statistics EventTracer::get_statistics() const {
+    Statistics stats;
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    stats.records_dropped = retired_dropped_;
+    for (const auto& buffer : buffers_) {
+        stats.records_dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    stats.threads = buffers_.size();
+    stats.records_written = records_written_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace mpquic_fec
@@ -0,0 +1,305 @@
+#include "hugepage_arena.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <sys/mman.h>
+
+namespace mpquic_fec {
+
+namespace {
+
+// 线程缓存每累计这么多次分配或释放，向全局统计汇总一次
+constexpr uint32_t kStatisticsBatch = 64;
+
+} // namespace
+
+// ========== HugePageArena 实现 ==========
+
+HugePageArena& HugePageArena::instance() {
+    static HugePageArena* arena = new HugePageArena();
+    return *arena;
+}
+
+HugePageArena::HugePageArena()
+    : huge_pages_enabled_(true),
+      chunk_cursor_(nullptr),
+      chunk_end_(nullptr),
+      free_lists_(kMaxSmallAllocation / kAlignment + 1, nullptr) {
+}
+
+HugePageArena::ThreadCache* HugePageArena::local_cache() {
+    // 快速路径只读一个平凡析构的thread_local指针，无需初始化检查
+    thread_local ThreadCache* current = nullptr;
+    thread_local bool retired = false;
+    if (current) {
+        return current;
+    }
+    if (retired) {
+        return nullptr;
+    }
+
+    // 线程退出时holder先于其它thread_local对象析构；之后的分配与释放走全局路径
+    struct Holder {
+        ThreadCache cache;
+        ~Holder() {
+            HugePageArena::instance().release_thread_cache(cache);
+            current = nullptr;
+            retired = true;
+        }
+    };
+    thread_local Holder holder;
+    current = &holder.cache;
+    return current;
+}
+
+void HugePageArena::set_huge_pages_enabled(bool enabled) {
+    huge_pages_enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void* HugePageArena::map_region(size_t bytes) {
+    void* region = MAP_FAILED;
+    bool huge_pages = huge_pages_enabled_.load(std::memory_order_relaxed);
+
+#ifdef MAP_HUGETLB
+    if (huge_pages) {
+        region = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (region != MAP_FAILED) {
+            hugetlb_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+            mapped_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+            return region;
+        }
+    }
+#endif
+
+    region = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        LOG_ERROR("HugePageArena: mmap of ", bytes, " bytes failed");
+        throw std::bad_alloc();
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (huge_pages && madvise(region, bytes, MADV_HUGEPAGE) == 0) {
+        thp_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+#else
+    (void)huge_pages;
+#endif
+
+    mapped_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    return region;
+}
+
+void HugePageArena::push_free_locked(void* ptr, size_t rounded) {
+    FreeNode* node = static_cast<FreeNode*>(ptr);
+    node->next = free_lists_[rounded / kAlignment];
+    free_lists_[rounded / kAlignment] = node;
+}
+
+void* HugePageArena::allocate_locked(size_t rounded) {
+    FreeNode*& head = free_lists_[rounded / kAlignment];
+    if (head) {
+        void* ptr = head;
+        head = head->next;
+        return ptr;
+    }
+
+    if (static_cast<size_t>(chunk_end_ - chunk_cursor_) < rounded) {
+        // 旧块剩余的尾部（不足本次请求）挂入对应尺寸的空闲链表
+        if (chunk_cursor_ != chunk_end_) {
+            push_free_locked(chunk_cursor_, chunk_end_ - chunk_cursor_);
+        }
+        chunk_cursor_ = static_cast<uint8_t*>(map_region(kHugePageSize));
+        chunk_end_ = chunk_cursor_ + kHugePageSize;
+        LOG_DEBUG("HugePageArena mapped new ", kHugePageSize, "-byte chunk");
+    }
+
+    void* ptr = chunk_cursor_;
+    chunk_cursor_ += rounded;
+    return ptr;
+}
+
+void HugePageArena::retire_thread_segment(ThreadCache& cache) {
+    if (cache.cursor != cache.end) {
+        push_free_locked(cache.cursor, cache.end - cache.cursor);
+    }
+    cache.cursor = nullptr;
+    cache.end = nullptr;
+}
+
+void* HugePageArena::refill_thread_cache(ThreadCache& cache, size_t rounded) {
+    size_t size_class = rounded / kAlignment;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // 先从全局空闲链表批量取回：第一个直接返回，其余挂入线程缓存
+    FreeNode*& global_head = free_lists_[size_class];
+    if (global_head) {
+        void* ptr = global_head;
+        global_head = global_head->next;
+        for (size_t i = 1; i < kThreadCacheBatch && global_head; ++i) {
+            FreeNode* node = global_head;
+            global_head = node->next;
+            node->next = cache.heads[size_class];
+            cache.heads[size_class] = node;
+            ++cache.counts[size_class];
+        }
+        return ptr;
+    }
+
+    // 私有段用尽：尾部归还全局，再切一段新的
+    retire_thread_segment(cache);
+    cache.cursor = static_cast<uint8_t*>(allocate_locked(kThreadChunkSize));
+    cache.end = cache.cursor + kThreadChunkSize;
+
+    void* ptr = cache.cursor;
+    cache.cursor += rounded;
+    return ptr;
+}
+
+void HugePageArena::spill_thread_cache(ThreadCache& cache, size_t size_class, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < count && cache.heads[size_class]; ++i) {
+        FreeNode* node = cache.heads[size_class];
+        cache.heads[size_class] = node->next;
+        --cache.counts[size_class];
+        push_free_locked(node, size_class * kAlignment);
+    }
+}
+
+void HugePageArena::release_thread_cache(ThreadCache& cache) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t size_class = 1; size_class < kCachedClasses; ++size_class) {
+            while (FreeNode* node = cache.heads[size_class]) {
+                cache.heads[size_class] = node->next;
+                push_free_locked(node, size_class * kAlignment);
+            }
+            cache.counts[size_class] = 0;
+        }
+        retire_thread_segment(cache);
+    }
+    flush_statistics(cache);
+}
+
+void HugePageArena::record(int64_t in_use_delta, uint64_t allocations, uint64_t deallocations) {
+    if (allocations > 0) {
+        allocations_.fetch_add(allocations, std::memory_order_relaxed);
+    }
+    if (deallocations > 0) {
+        deallocations_.fetch_add(deallocations, std::memory_order_relaxed);
+    }
+
+    // 各线程分别汇总，瞬时值可能为负（分配尚未汇总而释放已汇总）
+    int64_t in_use = in_use_bytes_.fetch_add(in_use_delta, std::memory_order_relaxed) +
+                     in_use_delta;
+    if (in_use > 0) {
+        uint64_t peak = peak_in_use_bytes_.load(std::memory_order_relaxed);
+        while (static_cast<uint64_t>(in_use) > peak &&
+               !peak_in_use_bytes_.compare_exchange_weak(peak, in_use,
+                                                         std::memory_order_relaxed)) {
+        }
+    }
+}
+
+void HugePageArena::flush_statistics(ThreadCache& cache) {
+    record(cache.pending_in_use, cache.pending_allocations, cache.pending_deallocations);
+    cache.pending_in_use = 0;
+    cache.pending_allocations = 0;
+    cache.pending_deallocations = 0;
+}
+
+void* HugePageArena::allocate(size_t bytes) {
+    size_t rounded = round_up(std::max<size_t>(bytes, 1));
+
+    if (rounded > kMaxSmallAllocation) {
+        void* ptr = map_region(round_up_mapping(rounded));
+        record(static_cast<int64_t>(rounded), 1, 0);
+        return ptr;
+    }
+
+    ThreadCache* cache = rounded <= kMaxCachedAllocation ? local_cache() : nullptr;
+    if (cache == nullptr) {
+        void* ptr = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ptr = allocate_locked(rounded);
+        }
+        record(static_cast<int64_t>(rounded), 1, 0);
+        return ptr;
+    }
+
+    // 快速路径：线程本地空闲链表，其次私有段指针碰撞
+    size_t size_class = rounded / kAlignment;
+    void* ptr = nullptr;
+    if (FreeNode* head = cache->heads[size_class]) {
+        cache->heads[size_class] = head->next;
+        --cache->counts[size_class];
+        ptr = head;
+    } else if (static_cast<size_t>(cache->end - cache->cursor) >= rounded) {
+        ptr = cache->cursor;
+        cache->cursor += rounded;
+    } else {
+        ptr = refill_thread_cache(*cache, rounded);
+    }
+
+    cache->pending_in_use += static_cast<int64_t>(rounded);
+    if (++cache->pending_allocations >= kStatisticsBatch) {
+        flush_statistics(*cache);
+    }
+    return ptr;
+}
+
+void HugePageArena::deallocate(void* ptr, size_t bytes) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    size_t rounded = round_up(std::max<size_t>(bytes, 1));
+
+    if (rounded > kMaxSmallAllocation) {
+        size_t mapped = round_up_mapping(rounded);
+        munmap(ptr, mapped);
+        mapped_bytes_.fetch_sub(mapped, std::memory_order_relaxed);
+        record(-static_cast<int64_t>(rounded), 0, 1);
+        return;
+    }
+
+    ThreadCache* cache = rounded <= kMaxCachedAllocation ? local_cache() : nullptr;
+    if (cache == nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            push_free_locked(ptr, rounded);
+        }
+        record(-static_cast<int64_t>(rounded), 0, 1);
+        return;
+    }
+
+    size_t size_class = rounded / kAlignment;
+    if (cache->counts[size_class] == kThreadCacheCapacity) {
+        spill_thread_cache(*cache, size_class, kThreadCacheBatch);
+    }
+    FreeNode* node = static_cast<FreeNode*>(ptr);
+    node->next = cache->heads[size_class];
+    cache->heads[size_class] = node;
+    ++cache->counts[size_class];
+
+    cache->pending_in_use -= static_cast<int64_t>(rounded);
+    if (++cache->pending_deallocations >= kStatisticsBatch) {
+        flush_statistics(*cache);
+    }
+}
+
+HugePageArena::Statistics HugePageArena::get_statistics() const {
+    Statistics stats;
+    stats.mapped_bytes = mapped_bytes_.load(std::memory_order_relaxed);
+    stats.hugetlb_bytes = hugetlb_bytes_.load(std::memory_order_relaxed);
+    stats.thp_bytes = thp_bytes_.load(std::memory_order_relaxed);
+    stats.in_use_bytes = static_cast<uint64_t>(
+        std::max<int64_t>(0, in_use_bytes_.load(std::memory_order_relaxed)));
+    stats.peak_in_use_bytes = peak_in_use_bytes_.load(std::memory_order_relaxed);
+    stats.allocations = allocations_.load(std::memory_order_relaxed);
+    stats.deallocations = deallocations_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace mpquic_fec
@@ -0,0 +1,82 @@
+#include "instrumented_mutex.hpp"
+
+namespace mpquic_fec {
+
+// ========== LockProfiler 实现 ==========
+
+LockProfiler& LockProfiler::instance() {
+    static LockProfiler* profiler = new LockProfiler();
+    return *profiler;
+}
+
+const char* LockProfiler::site_name(LockSite site) {
+    switch (site) {
+        case LockSite::GROUP_MANAGER:   return "group_manager";
+        case LockSite::SEND_QUEUE:      return "send_queue";
+        case LockSite::RECEIVE_HOOK:    return "receive_hook";
+        case LockSite::CONTROLLER:      return "controller";
+        case LockSite::MANAGER_RECEIVE: return "manager_receive";
+        case LockSite::MOCK_CONNECTION: return "mock_connection";
+        case LockSite::SHM_EGRESS:      return "shm_egress";
+        case LockSite::MANAGER_SEND:    return "manager_send";
+        case LockSite::COALESCER:       return "coalescer";
+        default:                        return "unknown";
+    }
+}
+
+std::vector<LockSiteStats> LockProfiler::snapshot() const {
+    std::vector<LockSiteStats> result;
+    if (!compiled_in()) {
+        return result;
+    }
+
+    // 与阶段计时共用TSC校准
+    double tpn = StageTiming::instance().ticks_per_ns();
+    result.reserve(kLockSiteCount);
+    for (size_t i = 0; i < kLockSiteCount; ++i) {
+        const Site& s = sites_[i];
+        LockSiteStats stats;
+        stats.site = static_cast<LockSite>(i);
+        stats.name = site_name(stats.site);
+        stats.ticks_per_ns = tpn;
+        stats.acquisitions = s.acquisitions.load(std::memory_order_relaxed);
+        stats.contended = s.contended.load(std::memory_order_relaxed);
+
+        for (size_t b = 0; b < kStageHistogramBuckets; ++b) {
+            stats.wait_buckets[b] = s.wait.buckets[b].load(std::memory_order_relaxed);
+            stats.hold_buckets[b] = s.hold.buckets[b].load(std::memory_order_relaxed);
+            stats.hold_count += stats.hold_buckets[b];
+        }
+        stats.wait_total_ns = s.wait.total_ticks.load(std::memory_order_relaxed) / tpn;
+        stats.wait_max_ns = s.wait.max_ticks.load(std::memory_order_relaxed) / tpn;
+        stats.hold_total_ns = s.hold.total_ticks.load(std::memory_order_relaxed) / tpn;
+        stats.hold_max_ns = s.hold.max_ticks.load(std::memory_order_relaxed) / tpn;
+
+        stats.wait_p50_ns = StageTiming::percentile_ns(stats.wait_buckets, stats.contended,
+                                                       0.50, tpn, stats.wait_max_ns);
+        stats.wait_p99_ns = StageTiming::percentile_ns(stats.wait_buckets, stats.contended,
+                                                       0.99, tpn, stats.wait_max_ns);
+        stats.hold_p50_ns = StageTiming::percentile_ns(stats.hold_buckets, stats.hold_count,
+                                                       0.50, tpn, stats.hold_max_ns);
+        stats.hold_p99_ns = StageTiming::percentile_ns(stats.hold_buckets, stats.hold_count,
+                                                       0.99, tpn, stats.hold_max_ns);
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void LockProfiler::reset() {
+    for (auto& s : sites_) {
+        s.acquisitions.store(0, std::memory_order_relaxed);
+        s.contended.store(0, std::memory_order_relaxed);
+        for (Histogram* h : {&s.wait, &s.hold}) {
+            h->total_ticks.store(0, std::memory_order_relaxed);
+            h->max_ticks.store(0, std::memory_order_relaxed);
+            for (auto& bucket : h->buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+} // namespace mpquic_fec
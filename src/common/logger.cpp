@@ -0,0 +1,245 @@
+#include "logger.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+
+namespace mpquic_fec {
+
+// ========== Logger 实现 ==========
+
+Logger::Logger()
+    : ring_(kRingCapacity) {
+    running_.store(true, std::memory_order_release);
+    worker_ = std::thread([this]() { run(); });
+    std::atexit([]() { Logger::instance().shutdown(); });
+}
+
+bool Logger::admit(LogSite& site, int64_t now_ns, uint32_t& suppressed) {
+    uint32_t limit = rate_limit_.load(std::memory_order_relaxed);
+    if (limit == 0) {
+        return true;
+    }
+
+    // 每个调用点1秒一个窗口；新窗口的第一条日志带出上个窗口被抑制的条数
+    int64_t start = site.window_start_ns.load(std::memory_order_relaxed);
+    if (now_ns - start >= 1000000000LL &&
+        site.window_start_ns.compare_exchange_strong(start, now_ns,
+                                                     std::memory_order_relaxed)) {
+        site.window_count.store(0, std::memory_order_relaxed);
+        suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+    if (site.window_count.fetch_add(1, std::memory_order_relaxed) >= limit) {
+        site.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void Logger::submit(Record&& record) {
+    if (!running_.load(std::memory_order_acquire)) {
+        std::string line;
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        format_record(record, line);
+        std::cout << line << std::flush;
+        return;
+    }
+
+    if (!ring_.try_push(std::move(record))) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (consumer_sleeping_.load(std::memory_order_relaxed)) {
+        wake_cv_.notify_one();
+    }
+}
+
+void Logger::flush() {
+    if (!running_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        std::cout << std::flush;
+        return;
+    }
+
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        seq = ++flush_requested_;
+    }
+
+    // 标记记录排在此前所有日志之后，后台线程写到它时即完成flush
+    Record marker;
+    marker.flush_marker = true;
+    marker.flush_seq = seq;
+    while (!ring_.try_push(std::move(marker))) {
+        std::this_thread::yield();
+    }
+    wake_cv_.notify_one();
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    flushed_cv_.wait(lock, [this, seq]() {
+        return flush_completed_ >= seq || !running_.load(std::memory_order_acquire);
+    });
+}
+
+void Logger::shutdown() {
+    if (!running_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    wake_cv_.notify_one();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    flushed_cv_.notify_all();
+}
+
+void Logger::run() {
+    std::string batch;
+    uint64_t reported_drops = 0;
+
+    auto drain = [&]() {
+        // 时间前缀缓存与同步写出共享，格式化期间同样持有output_mutex_
+        std::lock_guard<std::mutex> out_lock(output_mutex_);
+        uint64_t completed = 0;
+        size_t count = ring_.drain([&](Record&& record) {
+            if (record.flush_marker) {
+                completed = record.flush_seq;
+                return;
+            }
+            format_record(record, batch);
+        }, kRingCapacity);
+
+        uint64_t drops = dropped_.load(std::memory_order_relaxed);
+        if (drops != reported_drops) {
+            int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            append_prefix(LogLevel::WARN, now_ns, batch);
+            batch += "Logger queue full, dropped " + std::to_string(drops - reported_drops) +
+                     " records\n";
+            reported_drops = drops;
+        }
+
+        if (!batch.empty()) {
+            std::cout << batch << std::flush;
+            batch.clear();
+        }
+
+        if (completed > 0) {
+            {
+                std::lock_guard<std::mutex> lock(wake_mutex_);
+                flush_completed_ = std::max(flush_completed_, completed);
+            }
+            flushed_cv_.notify_all();
+        }
+        return count;
+    };
+
+    while (running_.load(std::memory_order_acquire)) {
+        if (drain() > 0) {
+            continue;
+        }
+
+        // 队列为空：休眠等待生产者唤醒，超时兜底避免错过通知
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        consumer_sleeping_.store(true, std::memory_order_relaxed);
+        wake_cv_.wait_for(lock, std::chrono::milliseconds(20));
+        consumer_sleeping_.store(false, std::memory_order_relaxed);
+    }
+
+    // 退出前写出剩余日志
+    while (drain() > 0) {
+    }
+}
+
+void Logger::append_prefix(LogLevel level, int64_t timestamp_ns, std::string& out) {
+    int64_t second = timestamp_ns / 1000000000LL;
+    if (second != cached_second_) {
+        std::time_t time = static_cast<std::time_t>(second);
+        std::tm tm_buf;
+        localtime_r(&time, &tm_buf);
+        std::strftime(cached_time_, sizeof(cached_time_), "%Y-%m-%d %H:%M:%S", &tm_buf);
+        cached_second_ = second;
+    }
+
+    out += '[';
+    out += cached_time_;
+    out += "] [";
+    out += level_to_string(level);
+    out += "] ";
+}
+
+void Logger::format_record(const Record& record, std::string& out) {
+    append_prefix(record.level, record.timestamp_ns, out);
+
+    std::ostringstream oss;
+    size_t pos = 0;
+    while (pos < record.length) {
+        auto type = static_cast<ArgType>(record.payload[pos++]);
+        switch (type) {
+            case ArgType::INT: {
+                int64_t v;
+                std::memcpy(&v, record.payload + pos, sizeof(v));
+                oss << v;
+                pos += sizeof(v);
+                break;
+            }
+            case ArgType::UINT: {
+                uint64_t v;
+                std::memcpy(&v, record.payload + pos, sizeof(v));
+                oss << v;
+                pos += sizeof(v);
+                break;
+            }
+            case ArgType::DOUBLE: {
+                double v;
+                std::memcpy(&v, record.payload + pos, sizeof(v));
+                oss << v;
+                pos += sizeof(v);
+                break;
+            }
+            case ArgType::BOOL: {
+                bool v;
+                std::memcpy(&v, record.payload + pos, sizeof(v));
+                oss << v;
+                pos += sizeof(v);
+                break;
+            }
+            case ArgType::CHAR:
+                oss << record.payload[pos];
+                pos += 1;
+                break;
+            case ArgType::STRING: {
+                uint16_t len;
+                std::memcpy(&len, record.payload + pos, sizeof(len));
+                oss.write(record.payload + pos + sizeof(len), len);
+                pos += sizeof(len) + len;
+                break;
+            }
+        }
+    }
+
+    out += oss.str();
+    if (record.suppressed > 0) {
+        out += " (suppressed " + std::to_string(record.suppressed) + " similar messages)";
+    }
+    out += '\n';
+}
+
+void Logger::write_line(LogLevel level, int64_t timestamp_ns, uint32_t suppressed,
+                        const std::string& message) {
+    std::string line;
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    append_prefix(level, timestamp_ns, line);
+    line += message;
+    if (suppressed > 0) {
+        line += " (suppressed " + std::to_string(suppressed) + " similar messages)";
+    }
+    line += '\n';
+    std::cout << line << std::flush;
+}
+
+} // namespace mpquic_fec
@@ -0,0 +1,78 @@
+#include "memory_accounting.hpp"
+
+namespace mpquic_fec {
+
+const char* memory_tag_name(MemoryTag tag) {
+    switch (tag) {
+        case MemoryTag::ENCODE_GROUPS:  return "encode_groups";
+        case MemoryTag::RECEIVE_GROUPS: return "receive_groups";
+        case MemoryTag::PACKET_MAPPING: return "packet_mapping";
+        case MemoryTag::DECODERS:       return "decoders";
+        default:                        return "unknown";
+    }
+}
+
+// ========== MemoryAccount 实现 ==========
+
+MemoryAccount& MemoryAccount::process() {
+    static MemoryAccount* account = new MemoryAccount(nullptr);
+    return *account;
+}
+
+MemoryAccount::MemoryAccount(MemoryAccount* parent)
+    : parent_(parent) {
+}
+
+MemoryAccount::~MemoryAccount() {
+    if (!parent_) {
+        return;
+    }
+    for (size_t i = 0; i < kMemoryTagCount; ++i) {
+        uint64_t remaining = used_[i].load(std::memory_order_relaxed);
+        if (remaining > 0) {
+            parent_->release(static_cast<MemoryTag>(i), remaining);
+        }
+    }
+}
+
+void MemoryAccount::charge(MemoryTag tag, size_t bytes) {
+    auto& counter = used_[index(tag)];
+    uint64_t now = counter.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    raise_peak(peak_[index(tag)], now);
+    raise_peak(total_peak_, total_.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+
+    if (parent_) {
+        parent_->charge(tag, bytes);
+    }
+}
+
+void MemoryAccount::release(MemoryTag tag, size_t bytes) {
+    // 估算值在极端情况下可能与charge不完全对称，计数不允许下溢
+    auto& counter = used_[index(tag)];
+    uint64_t current = counter.load(std::memory_order_relaxed);
+    uint64_t released;
+    do {
+        released = bytes < current ? bytes : current;
+    } while (!counter.compare_exchange_weak(current, current - released,
+                                            std::memory_order_relaxed));
+    total_.fetch_sub(released, std::memory_order_relaxed);
+
+    if (parent_) {
+        parent_->release(tag, released);
+    }
+}
+
+MemoryAccount::Snapshot MemoryAccount::snapshot() const {
+    Snapshot snap;
+    for (size_t i = 0; i < kMemoryTagCount; ++i) {
+        snap.used[i] = used_[i].load(std::memory_order_relaxed);
+        snap.peak[i] = peak_[i].load(std::memory_order_relaxed);
+        snap.budget[i] = budget_[i].load(std::memory_order_relaxed);
+    }
+    snap.total = total_.load(std::memory_order_relaxed);
+    snap.total_peak = total_peak_.load(std::memory_order_relaxed);
+    snap.total_budget = total_budget_.load(std::memory_order_relaxed);
+    return snap;
+}
+
+} // namespace mpquic_fec
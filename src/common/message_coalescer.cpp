@@ -0,0 +1,70 @@
+#include "message_coalescer.hpp"
+#include <stdexcept>
+
+namespace mpquic_fec {
+
+MessageCoalescer::MessageCoalescer(size_t block_size, size_t headroom, uint64_t max_delay_us)
+    : block_size_(block_size), headroom_(headroom), max_delay_us_(max_delay_us) {
+    if (headroom + kRecordHeaderSize >= block_size) {
+        throw std::invalid_argument("Coalescer block too small for a record");
+    }
+    block_.reserve(block_size);
+}
+
+void MessageCoalescer::append(const uint8_t* data, size_t size, uint64_t now_us,
+                              std::vector<std::vector<uint8_t>>& out_blocks) {
+    if (!accepts(size)) {
+        throw std::invalid_argument("Message does not fit in a coalesced block");
+    }
+
+    if (messages_ > 0 && block_.size() + kRecordHeaderSize + size > block_size_) {
+        out_blocks.emplace_back();
+        take(out_blocks.back());
+    }
+
+    if (messages_ == 0) {
+        block_.assign(headroom_, 0);
+        first_append_us_ = now_us;
+    }
+    block_.push_back(static_cast<uint8_t>(size >> 8));
+    block_.push_back(static_cast<uint8_t>(size & 0xFF));
+    block_.insert(block_.end(), data, data + size);
+    ++messages_;
+
+    // 连一条1字节的记录都放不下，不必再等
+    if (block_.size() + kRecordHeaderSize + 1 > block_size_) {
+        out_blocks.emplace_back();
+        take(out_blocks.back());
+    }
+}
+
+bool MessageCoalescer::take(std::vector<uint8_t>& out_block) {
+    if (messages_ == 0) {
+        return false;
+    }
+
+    out_block.swap(block_);
+    block_.clear();
+    block_.reserve(block_size_);
+    messages_ = 0;
+    return true;
+}
+
+size_t MessageCoalescer::split(const uint8_t* records, size_t size,
+                               std::vector<std::vector<uint8_t>>& out_messages) {
+    size_t count = 0;
+    size_t offset = 0;
+    while (offset + kRecordHeaderSize <= size) {
+        size_t length = (static_cast<size_t>(records[offset]) << 8) | records[offset + 1];
+        offset += kRecordHeaderSize;
+        if (length == 0 || length > size - offset) {
+            break;
+        }
+        out_messages.emplace_back(records + offset, records + offset + length);
+        offset += length;
+        ++count;
+    }
+    return count;
+}
+
+} // namespace mpquic_fec
@@ -0,0 +1,346 @@
+#include "metrics_exporter.hpp"
+#include "logger.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace mpquic_fec {
+
+namespace {
+
+// 单个抓取请求的读取上限与超时（只需要请求行，正文忽略）
+constexpr size_t kMaxRequestBytes = 8192;
+constexpr int kClientTimeoutMs = 200;
+
+std::string format_value(double value) {
+    if (std::isnan(value)) return "NaN";
+    if (std::isinf(value)) return value > 0 ? "+Inf" : "-Inf";
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.17g", value);
+    return buf;
+}
+
+void escape_label_value(const std::string& value, std::string& out) {
+    for (char c : value) {
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"':  out += "\\\""; break;
+            case '\n': out += "\\n"; break;
+            default:   out += c; break;
+        }
+    }
+}
+
+const char* type_name(MetricType type) {
+    switch (type) {
+        case MetricType::COUNTER:   return "counter";
+        case MetricType::GAUGE:     return "gauge";
+        case MetricType::HISTOGRAM: return "histogram";
+        default:                    return "untyped";
+    }
+}
+
+bool write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+// ========== MetricsSnapshot 实现 ==========
+
+MetricsSnapshot::Family& MetricsSnapshot::family(const std::string& name,
+                                                 const std::string& help, MetricType type) {
+    for (auto& f : families_) {
+        if (f.name == name) {
+            if (f.type != type) {
+                throw std::invalid_argument("Metric " + name + " registered with two types");
+            }
+            return f;
+        }
+    }
+    families_.push_back(Family{name, help, type, {}});
+    return families_.back();
+}
+
+std::string MetricsSnapshot::format_labels(const MetricLabels& labels,
+                                           const std::string& extra_name,
+                                           const std::string& extra_value) {
+    if (labels.empty() && extra_name.empty()) {
+        return "";
+    }
+
+    std::string out = "{";
+    bool first = true;
+    auto append = [&](const std::string& name, const std::string& value) {
+        if (!first) out += ',';
+        first = false;
+        out += name;
+        out += "=\"";
+        escape_label_value(value, out);
+        out += '"';
+    };
+    for (const auto& [name, value] : labels) {
+        append(name, value);
+    }
+    if (!extra_name.empty()) {
+        append(extra_name, extra_value);
+    }
+    out += '}';
+    return out;
+}
+
+void MetricsSnapshot::counter(const std::string& name, const std::string& help,
+                              const MetricLabels& labels, double value) {
+    family(name, help, MetricType::COUNTER).samples.push_back(
+        Sample{"", format_labels(labels), value});
+}
+
+void MetricsSnapshot::gauge(const std::string& name, const std::string& help,
+                            const MetricLabels& labels, double value) {
+    family(name, help, MetricType::GAUGE).samples.push_back(
+        Sample{"", format_labels(labels), value});
+}
+
+void MetricsSnapshot::histogram(const std::string& name, const std::string& help,
+                                const MetricLabels& labels,
+                                const std::vector<std::pair<double, uint64_t>>& buckets,
+                                double sum, uint64_t count) {
+    auto& f = family(name, help, MetricType::HISTOGRAM);
+    for (const auto& [le, cumulative] : buckets) {
+        f.samples.push_back(Sample{"_bucket", format_labels(labels, "le", format_value(le)),
+                                   static_cast<double>(cumulative)});
+    }
+    f.samples.push_back(Sample{"_bucket", format_labels(labels, "le", "+Inf"),
+                               static_cast<double>(count)});
+    f.samples.push_back(Sample{"_sum", format_labels(labels), sum});
+    f.samples.push_back(Sample{"_count", format_labels(labels), static_cast<double>(count)});
+}
+
+std::string MetricsSnapshot::render() const {
+    std::string out;
+    out.reserve(families_.size() * 256);
+    for (const auto& f : families_) {
+        out += "# HELP " + f.name + " " + f.help + "\n";
+        out += "# TYPE " + f.name + " " + type_name(f.type) + "\n";
+        for (const auto& s : f.samples) {
+            out += f.name;
+            out += s.suffix;
+            out += s.labels;
+            out += ' ';
+            out += format_value(s.value);
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+// ========== MetricsExporter 实现 ==========
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+void MetricsExporter::listen_unix(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Unix socket path too long: " + path);
+    }
+
+    // 只替换遗留的套接字文件，路径误指向普通文件等时拒绝而不是删除
+    struct stat st{};
+    if (::lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            throw std::runtime_error("Cannot listen on " + path +
+                                     ": path exists and is not a socket");
+        }
+        if (::unlink(path.c_str()) < 0) {
+            throw std::runtime_error("Cannot remove stale socket " + path + ": " +
+                                     std::strerror(errno));
+        }
+    } else if (errno != ENOENT) {
+        throw std::runtime_error("Cannot stat " + path + ": " + std::strerror(errno));
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(fd, 16) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot listen on " + path + ": " + std::strerror(err));
+    }
+
+    listen_fds_.push_back(fd);
+    unix_path_ = path;
+    LOG_INFO("Metrics endpoint listening on unix:", path);
+}
+
+uint16_t MetricsExporter::listen_tcp(uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    // 只监听回环地址，指标端点不对外暴露
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    socklen_t len = sizeof(addr);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(fd, 16) < 0 ||
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot listen on 127.0.0.1:" + std::to_string(port) +
+                                 ": " + std::strerror(err));
+    }
+
+    listen_fds_.push_back(fd);
+    uint16_t bound_port = ntohs(addr.sin_port);
+    LOG_INFO("Metrics endpoint listening on 127.0.0.1:", bound_port);
+    return bound_port;
+}
+
+void MetricsExporter::start() {
+    if (running_.load(std::memory_order_acquire)) {
+        return;
+    }
+    if (listen_fds_.empty()) {
+        throw std::runtime_error("MetricsExporter::start() called without a listener");
+    }
+    if (::pipe2(wake_pipe_, O_CLOEXEC | O_NONBLOCK) < 0) {
+        throw std::runtime_error(std::string("pipe2: ") + std::strerror(errno));
+    }
+
+    running_.store(true, std::memory_order_release);
+    server_ = std::thread([this]() { run(); });
+}
+
+void MetricsExporter::stop() {
+    if (running_.exchange(false, std::memory_order_acq_rel)) {
+        char c = 0;
+        ssize_t ignored = ::write(wake_pipe_[1], &c, 1);
+        (void)ignored;
+        if (server_.joinable()) {
+            server_.join();
+        }
+    }
+
+    for (int fd : listen_fds_) {
+        ::close(fd);
+    }
+    listen_fds_.clear();
+    for (int& fd : wake_pipe_) {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    if (!unix_path_.empty()) {
+        ::unlink(unix_path_.c_str());
+        unix_path_.clear();
+    }
+}
+
+void MetricsExporter::publish(MetricsSnapshot snapshot) {
+    std::atomic_store(&snapshot_,
+                      std::shared_ptr<const MetricsSnapshot>(
+                          std::make_shared<MetricsSnapshot>(std::move(snapshot))));
+}
+
+std::string MetricsExporter::scrape() const {
+    auto snapshot = std::atomic_load(&snapshot_);
+    return snapshot ? snapshot->render() : std::string();
+}
+
+void MetricsExporter::run() {
+    std::vector<pollfd> fds;
+    for (int fd : listen_fds_) {
+        fds.push_back(pollfd{fd, POLLIN, 0});
+    }
+    fds.push_back(pollfd{wake_pipe_[0], POLLIN, 0});
+
+    while (running_.load(std::memory_order_acquire)) {
+        int ready = ::poll(fds.data(), fds.size(), -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Metrics endpoint poll failed: ", std::strerror(errno));
+            break;
+        }
+
+        for (size_t i = 0; i + 1 < fds.size(); ++i) {
+            if (!(fds[i].revents & POLLIN)) {
+                continue;
+            }
+            int client = ::accept4(fds[i].fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client >= 0) {
+                serve_client(client);
+                ::close(client);
+            }
+        }
+    }
+}
+
+void MetricsExporter::serve_client(int fd) {
+    // 读到请求头结束即可；慢客户端超时后直接放弃，不拖住服务线程
+    timeval tv{0, kClientTimeoutMs * 1000};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    std::string request;
+    char buf[1024];
+    while (request.size() < kMaxRequestBytes &&
+           request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            break;
+        }
+        request.append(buf, static_cast<size_t>(n));
+    }
+
+    std::string status = "200 OK";
+    std::string body;
+    if (request.compare(0, 4, "GET ") != 0) {
+        status = "405 Method Not Allowed";
+    } else {
+        body = scrape();
+        scrapes_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    write_all(fd, response.data(), response.size());
+}
+
+} // namespace mpquic_fec
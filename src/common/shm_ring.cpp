@@ -0,0 +1,430 @@
+#include "shm_ring.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mpquic_fec {
+
+namespace {
+
+constexpr uint32_t kRingMagic = 0x4D515352;   // "MQSR"
+constexpr uint32_t kRingVersion = 1;
+constexpr size_t kHeaderBytes = 4096;         // 头部独占一页，槽位从页边界开始
+constexpr size_t kSlotAlign = 64;
+constexpr int kRingFdCount = 3;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+              std::atomic<uint32_t>::is_always_lock_free,
+              "Shared-memory cursors require lock-free atomics");
+
+std::runtime_error system_error(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+size_t round_up(size_t value, size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+} // namespace
+
+/**
+ * @brief 共享内存头部（位于memfd起始处）
+ *
+ * 生产者游标与消费者游标分处不同缓存行，各自只由一侧写入
+ */
+struct ShmRing::Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t slot_count;
+    uint64_t slot_size;
+    uint64_t headroom;
+    uint64_t slot_stride;
+
+    alignas(64) std::atomic<uint64_t> head;              // 下一个写入位置（生产者）
+    std::atomic<uint32_t> producer_waiting;
+    alignas(64) std::atomic<uint64_t> tail;              // 下一个读取位置（消费者）
+    std::atomic<uint32_t> consumer_waiting;
+};
+
+struct ShmRing::SlotMeta {
+    uint32_t length;
+    uint32_t stream_id;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+// ========== ShmRing 实现 ==========
+
+std::unique_ptr<ShmRing> ShmRing::create(size_t slot_count, size_t slot_size, size_t headroom) {
+    static_assert(sizeof(Header) <= kHeaderBytes, "ShmRing header exceeds one page");
+
+    if (slot_count < 2) {
+        throw std::invalid_argument("ShmRing needs at least 2 slots");
+    }
+    if (slot_size == 0 || slot_size > UINT32_MAX || headroom > kHeaderBytes) {
+        throw std::invalid_argument("Invalid ShmRing slot geometry: " +
+                                    std::to_string(slot_size) + "+" + std::to_string(headroom));
+    }
+
+    size_t rounded = 1;
+    while (rounded < slot_count) {
+        rounded <<= 1;
+    }
+    size_t stride = round_up(sizeof(SlotMeta) + headroom + slot_size, kSlotAlign);
+    size_t bytes = kHeaderBytes + rounded * stride;
+
+    int memory_fd = memfd_create("mpquic_fec_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memory_fd < 0) {
+        throw system_error("memfd_create");
+    }
+    int data_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    int space_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    std::unique_ptr<ShmRing> ring(new ShmRing(memory_fd, data_fd, space_fd));
+    if (data_fd < 0 || space_fd < 0) {
+        throw system_error("eventfd");
+    }
+
+    if (ftruncate(memory_fd, static_cast<off_t>(bytes)) != 0) {
+        throw system_error("ftruncate");
+    }
+    // 封印大小：对端无法截断文件让我们访问映射时触发SIGBUS
+    if (fcntl(memory_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        throw system_error("F_ADD_SEALS");
+    }
+
+    ring->map(bytes);
+    Header* header = new (ring->base_) Header();
+    header->magic = kRingMagic;
+    header->version = kRingVersion;
+    header->slot_count = rounded;
+    header->slot_size = slot_size;
+    header->headroom = headroom;
+    header->slot_stride = stride;
+    header->head.store(0, std::memory_order_relaxed);
+    header->tail.store(0, std::memory_order_relaxed);
+    header->producer_waiting.store(0, std::memory_order_relaxed);
+    header->consumer_waiting.store(0, std::memory_order_release);
+
+    ring->header_ = header;
+    ring->slot_count_ = rounded;
+    ring->slot_size_ = slot_size;
+    ring->headroom_ = headroom;
+    ring->slot_stride_ = stride;
+
+    LOG_INFO("Created shared-memory ring: ", rounded, " slots x ", slot_size, " bytes (",
+             bytes, " bytes mapped)");
+    return ring;
+}
+
+std::unique_ptr<ShmRing> ShmRing::attach(int memory_fd, int data_event_fd, int space_event_fd) {
+    std::unique_ptr<ShmRing> ring(new ShmRing(memory_fd, data_event_fd, space_event_fd));
+
+    int seals = fcntl(memory_fd, F_GET_SEALS);
+    if (seals < 0 || (seals & F_SEAL_SHRINK) == 0) {
+        throw std::runtime_error("Shared-memory ring is not sealed against shrinking");
+    }
+
+    struct stat st;
+    if (fstat(memory_fd, &st) != 0) {
+        throw system_error("fstat");
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    if (bytes < kHeaderBytes) {
+        throw std::runtime_error("Shared-memory ring too small: " + std::to_string(bytes));
+    }
+    ring->map(bytes);
+
+    Header* header = reinterpret_cast<Header*>(ring->base_);
+    uint64_t count = header->slot_count;
+    uint64_t size = header->slot_size;
+    uint64_t room = header->headroom;
+    uint64_t stride = header->slot_stride;
+    if (header->magic != kRingMagic || header->version != kRingVersion) {
+        throw std::runtime_error("Not a shared-memory ring (bad magic or version)");
+    }
+    if (count < 2 || (count & (count - 1)) != 0 || size == 0 || size > UINT32_MAX ||
+        room > kHeaderBytes || stride % kSlotAlign != 0 || stride < sizeof(SlotMeta) + room + size ||
+        count > (bytes - kHeaderBytes) / stride) {
+        throw std::runtime_error("Shared-memory ring header is inconsistent with its size");
+    }
+
+    ring->header_ = header;
+    ring->slot_count_ = count;
+    ring->slot_size_ = size;
+    ring->headroom_ = room;
+    ring->slot_stride_ = stride;
+    return ring;
+}
+
+std::unique_ptr<ShmRing> ShmRing::receive(int unix_socket) {
+    char byte;
+    iovec iov{&byte, 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kRingFdCount)];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n;
+    do {
+        n = recvmsg(unix_socket, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        throw system_error("recvmsg");
+    }
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        throw std::runtime_error("No file descriptors received for shared-memory ring");
+    }
+    size_t fd_count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    int fds[kRingFdCount];
+    std::memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * std::min<size_t>(fd_count, kRingFdCount));
+    if (fd_count != kRingFdCount || (msg.msg_flags & MSG_CTRUNC) != 0) {
+        for (size_t i = 0; i < std::min<size_t>(fd_count, kRingFdCount); ++i) {
+            close(fds[i]);
+        }
+        throw std::runtime_error("Expected 3 file descriptors for shared-memory ring, got " +
+                                 std::to_string(fd_count));
+    }
+
+    return attach(fds[0], fds[1], fds[2]);
+}
+
+ShmRing::ShmRing(int memory_fd, int data_event_fd, int space_event_fd)
+    : memory_fd_(memory_fd), data_event_fd_(data_event_fd), space_event_fd_(space_event_fd) {
+}
+
+ShmRing::~ShmRing() {
+    if (base_) {
+        munmap(base_, mapped_bytes_);
+    }
+    for (int fd : {memory_fd_, data_event_fd_, space_event_fd_}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void ShmRing::send_fds(int unix_socket) const {
+    char byte = 'R';
+    iovec iov{&byte, 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kRingFdCount)] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * kRingFdCount);
+    int fds[kRingFdCount] = {memory_fd_, data_event_fd_, space_event_fd_};
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize_t n;
+    do {
+        n = sendmsg(unix_socket, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        throw system_error("sendmsg");
+    }
+}
+
+uint8_t* ShmRing::try_reserve() {
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    uint64_t tail = header_->tail.load(std::memory_order_acquire);
+    if (head - tail >= slot_count_) {
+        return nullptr;
+    }
+    reserved_ = true;
+    return payload(slot(head));
+}
+
+void ShmRing::commit(uint32_t length, uint32_t stream_id, uint32_t flags) {
+    if (!reserved_) {
+        throw std::invalid_argument("ShmRing::commit() without a reserved slot");
+    }
+    if (length > slot_size_) {
+        throw std::invalid_argument("ShmRing entry of " + std::to_string(length) +
+                                    " bytes exceeds slot size " + std::to_string(slot_size_));
+    }
+
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    SlotMeta* meta = slot(head);
+    meta->length = length;
+    meta->stream_id = stream_id;
+    meta->flags = flags;
+    reserved_ = false;
+
+    header_->head.store(head + 1, std::memory_order_release);
+
+    // 与消费者 wait_for_data() 的 "置等待标志 -> fence -> 读head" 配对，二者至少一方看到对方
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header_->consumer_waiting.load(std::memory_order_relaxed)) {
+        ring_doorbell(data_event_fd_);
+    }
+}
+
+bool ShmRing::try_write(const uint8_t* data, size_t length, uint32_t stream_id,
+                        uint32_t flags) {
+    if (length > slot_size_) {
+        throw std::invalid_argument("ShmRing entry of " + std::to_string(length) +
+                                    " bytes exceeds slot size " + std::to_string(slot_size_));
+    }
+    uint8_t* dst = try_reserve();
+    if (!dst) {
+        return false;
+    }
+    std::memcpy(dst, data, length);
+    commit(static_cast<uint32_t>(length), stream_id, flags);
+    return true;
+}
+
+bool ShmRing::wait_for_space(int timeout_ms) {
+    auto has_space = [this]() {
+        return header_->head.load(std::memory_order_relaxed) -
+               header_->tail.load(std::memory_order_acquire) < slot_count_;
+    };
+
+    do {
+        if (has_space()) {
+            return true;
+        }
+        header_->producer_waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool ready = has_space() || wait_doorbell(space_event_fd_, timeout_ms);
+        header_->producer_waiting.store(0, std::memory_order_relaxed);
+        if (ready && has_space()) {
+            return true;
+        }
+    } while (timeout_ms < 0);
+
+    return has_space();
+}
+
+bool ShmRing::peek(ShmRingEntry& entry) {
+    uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    if (head - tail > slot_count_) {
+        throw std::runtime_error("Shared-memory ring cursors corrupted by peer");
+    }
+
+    // 元数据只读一次，之后对端再改也不影响这里的边界检查
+    SlotMeta* meta = slot(tail);
+    uint32_t length = meta->length;
+    if (length > slot_size_) {
+        throw std::runtime_error("Shared-memory ring entry length " + std::to_string(length) +
+                                 " exceeds slot size");
+    }
+
+    entry.data = payload(meta);
+    entry.length = length;
+    entry.stream_id = meta->stream_id;
+    entry.flags = meta->flags;
+    entry.headroom = static_cast<uint32_t>(headroom_);
+    return true;
+}
+
+void ShmRing::release() {
+    uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    if (tail == header_->head.load(std::memory_order_acquire)) {
+        return;
+    }
+    header_->tail.store(tail + 1, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header_->producer_waiting.load(std::memory_order_relaxed)) {
+        ring_doorbell(space_event_fd_);
+    }
+}
+
+bool ShmRing::wait_for_data(int timeout_ms) {
+    auto has_data = [this]() {
+        return header_->head.load(std::memory_order_acquire) !=
+               header_->tail.load(std::memory_order_relaxed);
+    };
+
+    do {
+        if (has_data()) {
+            return true;
+        }
+        header_->consumer_waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool ready = has_data() || wait_doorbell(data_event_fd_, timeout_ms);
+        header_->consumer_waiting.store(0, std::memory_order_relaxed);
+        if (ready && has_data()) {
+            return true;
+        }
+    } while (timeout_ms < 0);
+
+    return has_data();
+}
+
+size_t ShmRing::size() const {
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    uint64_t tail = header_->tail.load(std::memory_order_acquire);
+    return static_cast<size_t>(std::min<uint64_t>(head - tail, slot_count_));
+}
+
+void ShmRing::map(size_t bytes) {
+    void* region = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd_, 0);
+    if (region == MAP_FAILED) {
+        throw system_error("mmap of shared-memory ring");
+    }
+    base_ = static_cast<uint8_t*>(region);
+    mapped_bytes_ = bytes;
+}
+
+ShmRing::SlotMeta* ShmRing::slot(uint64_t index) const {
+    return reinterpret_cast<SlotMeta*>(base_ + kHeaderBytes +
+                                       (index & (slot_count_ - 1)) * slot_stride_);
+}
+
+uint8_t* ShmRing::payload(SlotMeta* meta) const {
+    return reinterpret_cast<uint8_t*>(meta) + sizeof(SlotMeta) + headroom_;
+}
+
+void ShmRing::ring_doorbell(int event_fd) {
+    uint64_t one = 1;
+    ssize_t n;
+    do {
+        n = write(event_fd, &one, sizeof(one));
+    } while (n < 0 && errno == EINTR);
+    // EAGAIN表示计数已满，对端必然会被唤醒，无需处理
+}
+
+bool ShmRing::wait_doorbell(int event_fd, int timeout_ms) {
+    pollfd pfd{event_fd, POLLIN, 0};
+    int n;
+    do {
+        n = poll(&pfd, 1, timeout_ms);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        return false;
+    }
+
+    uint64_t count;
+    ssize_t r = read(event_fd, &count, sizeof(count));
+    (void)r;  // 非阻塞读，仅用于清零计数
+    return true;
+}
+
+} // namespace mpquic_fec
@@ -0,0 +1,140 @@
+#include "stage_timing.hpp"
+#include <cmath>
+#include <thread>
+
+namespace mpquic_fec {
+
+namespace {
+
+int64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 校准窗口不足时补足的最短间隔
+constexpr int64_t kMinCalibrationNs = 2000000;
+
+} // namespace
+
+// ========== ScopedStageTimer 实现 ==========
+
+thread_local uint64_t ScopedStageTimer::child_ticks_ = 0;
+
+// ========== StageTiming 实现 ==========
+
+StageTiming& StageTiming::instance() {
+    static StageTiming* timing = new StageTiming();
+    return *timing;
+}
+
+StageTiming::StageTiming()
+    : base_ticks_(read_stage_ticks()), base_ns_(steady_now_ns()) {
+}
+
+const char* StageTiming::stage_name(Stage stage) {
+    switch (stage) {
+        case Stage::SEND_HOOK_INGEST:       return "send.hook_ingest";
+        case Stage::SEND_GROUP_ACCUMULATE:  return "send.group_accumulate";
+        case Stage::SEND_ENCODE:            return "send.encode";
+        case Stage::SEND_PATH_SELECT:       return "send.path_select";
+        case Stage::SEND_PN_MAPPING:        return "send.pn_mapping";
+        case Stage::SEND_TRANSPORT_HANDOFF: return "send.transport_handoff";
+        case Stage::RECV_TRANSPORT_INGEST:  return "recv.transport_ingest";
+        case Stage::RECV_FRAME_INGEST:      return "recv.frame_ingest";
+        case Stage::RECV_DECODE:            return "recv.decode";
+        case Stage::RECV_REASSEMBLY:        return "recv.reassembly";
+        default:                            return "unknown";
+    }
+}
+
+double StageTiming::bucket_lower(size_t bucket) {
+    if (bucket < kStageHistogramSubBuckets) {
+        return static_cast<double>(bucket);
+    }
+    int octave = static_cast<int>(bucket / kStageHistogramSubBuckets) + 1;
+    double sub = static_cast<double>(bucket % kStageHistogramSubBuckets);
+    return std::ldexp(kStageHistogramSubBuckets + sub, octave - 2);
+}
+
+double StageTiming::bucket_upper(size_t bucket) {
+    if (bucket < kStageHistogramSubBuckets) {
+        return static_cast<double>(bucket + 1);
+    }
+    int octave = static_cast<int>(bucket / kStageHistogramSubBuckets) + 1;
+    return bucket_lower(bucket) + std::ldexp(1.0, octave - 2);
+}
+
+double StageTiming::percentile_ns(const std::array<uint64_t, kStageHistogramBuckets>& buckets,
+                                  uint64_t count, double q, double ticks_per_ns, double max_ns) {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * (count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kStageHistogramBuckets; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            double upper = bucket_upper(b) / ticks_per_ns;
+            return upper < max_ns ? upper : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+double StageTiming::ticks_per_ns() const {
+#if defined(__x86_64__) || defined(__i386__)
+    // 用自构造以来的TSC增量与steady_clock增量之比估计频率，间隔越长越准
+    int64_t elapsed_ns = steady_now_ns() - base_ns_;
+    if (elapsed_ns < kMinCalibrationNs) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(kMinCalibrationNs - elapsed_ns));
+    }
+    uint64_t ticks = read_stage_ticks();
+    elapsed_ns = steady_now_ns() - base_ns_;
+    return static_cast<double>(ticks - base_ticks_) / static_cast<double>(elapsed_ns);
+#else
+    return 1.0;
+#endif
+}
+
+std::vector<StageTimingStats> StageTiming::snapshot() const {
+    std::vector<StageTimingStats> result;
+    if (!compiled_in()) {
+        return result;
+    }
+
+    double tpn = ticks_per_ns();
+    result.reserve(kStageCount);
+    for (size_t i = 0; i < kStageCount; ++i) {
+        const Histogram& h = histograms_[i];
+        StageTimingStats stats;
+        stats.stage = static_cast<Stage>(i);
+        stats.name = stage_name(stats.stage);
+        stats.ticks_per_ns = tpn;
+        for (size_t b = 0; b < kStageHistogramBuckets; ++b) {
+            stats.buckets[b] = h.buckets[b].load(std::memory_order_relaxed);
+            stats.count += stats.buckets[b];
+        }
+        stats.total_ns = h.total_ticks.load(std::memory_order_relaxed) / tpn;
+        stats.max_ns = h.max_ticks.load(std::memory_order_relaxed) / tpn;
+
+        if (stats.count > 0) {
+            stats.mean_ns = stats.total_ns / stats.count;
+            stats.p50_ns = percentile_ns(stats.buckets, stats.count, 0.50, tpn, stats.max_ns);
+            stats.p99_ns = percentile_ns(stats.buckets, stats.count, 0.99, tpn, stats.max_ns);
+        }
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void StageTiming::reset() {
+    for (auto& h : histograms_) {
+        h.total_ticks.store(0, std::memory_order_relaxed);
+        h.max_ticks.store(0, std::memory_order_relaxed);
+        for (auto& bucket : h.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace mpquic_fec
@@ -0,0 +1,318 @@
+#include "trace_replay.hpp"
+#include "logger.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mpquic_fec {
+
+namespace {
+
+// CSV列名与采样字段的对应关系
+const char* const kFieldNames[4] = {"timestamp", "rtt_ms", "loss_rate", "bandwidth_mbps"};
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * @brief 从映射区解析一个数字（映射区不保证以'\0'结尾，先拷贝到栈上）
+ */
+const char* parse_number(const char* p, const char* end, double& out) {
+    while (p < end && is_space(*p)) ++p;
+
+    char buf[64];
+    size_t n = 0;
+    while (p < end && n < sizeof(buf) - 1 &&
+           ((*p >= '0' && *p <= '9') || *p == '.' || *p == '-' ||
+            *p == '+' || *p == 'e' || *p == 'E')) {
+        buf[n++] = *p++;
+    }
+    buf[n] = '\0';
+    out = n > 0 ? std::strtod(buf, nullptr) : 0.0;
+    return p;
+}
+
+int field_index(const char* name, size_t len) {
+    for (int i = 0; i < 4; ++i) {
+        if (std::strlen(kFieldNames[i]) == len &&
+            std::memcmp(kFieldNames[i], name, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void assign_field(LinkTraceSample& sample, int index, double value) {
+    switch (index) {
+        case 0: sample.timestamp_s = value; break;
+        case 1: sample.rtt_ms = value; break;
+        case 2: sample.loss_rate = value; break;
+        case 3: sample.bandwidth_mbps = value; break;
+        default: break;
+    }
+}
+
+} // namespace
+
+// ========== LinkTrace 实现 ==========
+
+std::shared_ptr<LinkTrace> LinkTrace::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open trace file: " + path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("Trace file is empty: " + path);
+    }
+
+    void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("Cannot mmap trace file: " + path);
+    }
+
+    // 顺序读取，提示内核预读
+    ::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    std::shared_ptr<LinkTrace> trace(new LinkTrace());
+    trace->data_ = static_cast<const char*>(addr);
+    trace->size_ = static_cast<size_t>(st.st_size);
+    trace->path_ = path;
+
+    size_t i = 0;
+    while (i < trace->size_ && (is_space(trace->data_[i]) || trace->data_[i] == '\n')) ++i;
+    trace->format_ = (i < trace->size_ && trace->data_[i] == '{') ? Format::JSON : Format::CSV;
+
+    LOG_INFO("Mapped trace ", path, " (", trace->size_, " bytes, ",
+             (trace->format_ == Format::JSON ? "JSON" : "CSV"), ")");
+    return trace;
+}
+
+LinkTrace::~LinkTrace() {
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+// ========== TraceReplayer 实现 ==========
+
+TraceReplayer::TraceReplayer(std::shared_ptr<LinkTrace> trace, bool loop)
+    : trace_(std::move(trace)), loop_(loop), cursor_(0), header_parsed_(false),
+      columns_{0, 1, 2, 3}, column_count_(4), has_next_(false), exhausted_(false),
+      loop_offset_s_(0), first_ts_s_(0), last_interval_s_(0), last_parsed_ts_(0), samples_parsed_(0) {
+
+    if (!trace_) {
+        throw std::invalid_argument("TraceReplayer requires a trace");
+    }
+    rewind();
+}
+
+void TraceReplayer::rewind() {
+    cursor_ = 0;
+    header_parsed_ = false;
+    exhausted_ = false;
+    loop_offset_s_ = 0;
+    first_ts_s_ = 0;
+    last_interval_s_ = 0;
+    last_parsed_ts_ = 0;
+    samples_parsed_ = 0;
+
+    current_ = LinkTraceSample();
+    if (parse_next(current_)) {
+        has_next_ = parse_next(next_);
+    } else {
+        has_next_ = false;
+        LOG_WARN("Trace ", trace_->path(), " contains no samples");
+    }
+}
+
+const LinkTraceSample& TraceReplayer::sample_at(double elapsed_s) {
+    while (has_next_ && next_.timestamp_s <= elapsed_s) {
+        current_ = next_;
+        has_next_ = parse_next(next_);
+    }
+    return current_;
+}
+
+bool TraceReplayer::parse_next(LinkTraceSample& out) {
+    if (exhausted_) {
+        return false;
+    }
+
+    double prev_ts = last_parsed_ts_;
+
+    bool ok = (trace_->format() == LinkTrace::Format::JSON)
+                  ? parse_json_object(out) : parse_csv_line(out);
+
+    if (!ok && loop_ && samples_parsed_ > 1) {
+        // 循环回放：时间轴在上一轮末尾之后继续（Trace不一定从0开始）
+        double interval = last_interval_s_ > 0 ? last_interval_s_ : 0.1;
+        double last_ts = prev_ts - loop_offset_s_;
+        loop_offset_s_ += last_ts - first_ts_s_ + interval;
+        cursor_ = 0;
+        header_parsed_ = false;
+        ok = (trace_->format() == LinkTrace::Format::JSON)
+                 ? parse_json_object(out) : parse_csv_line(out);
+    }
+
+    if (!ok) {
+        exhausted_ = true;
+        return false;
+    }
+
+    if (samples_parsed_ == 0) {
+        first_ts_s_ = out.timestamp_s;
+    }
+    out.timestamp_s += loop_offset_s_;
+    if (samples_parsed_ > 0 && out.timestamp_s > prev_ts) {
+        last_interval_s_ = out.timestamp_s - prev_ts;
+    }
+    last_parsed_ts_ = out.timestamp_s;
+    ++samples_parsed_;
+    return true;
+}
+
+void TraceReplayer::parse_csv_header() {
+    header_parsed_ = true;
+
+    const char* base = trace_->data();
+    const char* end = base + trace_->size();
+    const char* p = base + cursor_;
+
+    // 跳过空行和注释
+    while (p < end && (*p == '\n' || is_space(*p) || *p == '#')) {
+        if (*p == '#') {
+            while (p < end && *p != '\n') ++p;
+        } else {
+            ++p;
+        }
+    }
+
+    // 首行以字母开头则视为表头
+    if (p >= end || !((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z'))) {
+        cursor_ = static_cast<size_t>(p - base);
+        return;
+    }
+
+    column_count_ = 0;
+    while (p < end && *p != '\n' && column_count_ < 4) {
+        while (p < end && is_space(*p)) ++p;
+        const char* name = p;
+        while (p < end && *p != ',' && *p != '\n' && !is_space(*p)) ++p;
+        int index = field_index(name, static_cast<size_t>(p - name));
+        while (p < end && *p != ',' && *p != '\n') ++p;
+        columns_[column_count_++] = index;
+        if (p < end && *p == ',') ++p;
+    }
+    while (p < end && *p != '\n') ++p;
+    cursor_ = static_cast<size_t>(p - base);
+}
+
+bool TraceReplayer::parse_csv_line(LinkTraceSample& out) {
+    if (!header_parsed_) {
+        parse_csv_header();
+    }
+
+    const char* base = trace_->data();
+    const char* end = base + trace_->size();
+    const char* p = base + cursor_;
+
+    while (p < end) {
+        // 跳过空行与注释行
+        while (p < end && (*p == '\n' || is_space(*p))) ++p;
+        if (p >= end) break;
+        if (*p == '#') {
+            while (p < end && *p != '\n') ++p;
+            continue;
+        }
+
+        out = LinkTraceSample();
+        for (int col = 0; p < end && *p != '\n'; ++col) {
+            double value = 0;
+            p = parse_number(p, end, value);
+            if (col < column_count_) {
+                assign_field(out, columns_[col], value);
+            }
+            while (p < end && *p != ',' && *p != '\n') ++p;
+            if (p < end && *p == ',') ++p;
+        }
+
+        cursor_ = static_cast<size_t>(p - base);
+        return true;
+    }
+
+    cursor_ = trace_->size();
+    return false;
+}
+
+bool TraceReplayer::parse_json_object(LinkTraceSample& out) {
+    const char* base = trace_->data();
+    const char* end = base + trace_->size();
+
+    if (!header_parsed_) {
+        // 定位到 "samples": [
+        header_parsed_ = true;
+        const char* key = "\"samples\"";
+        size_t key_len = std::strlen(key);
+        const char* p = base;
+        while (p + key_len <= end && std::memcmp(p, key, key_len) != 0) ++p;
+        while (p < end && *p != '[') ++p;
+        cursor_ = (p < end) ? static_cast<size_t>(p - base) + 1 : trace_->size();
+    }
+
+    const char* p = base + cursor_;
+    while (p < end && *p != '{' && *p != ']') ++p;
+    if (p >= end || *p == ']') {
+        cursor_ = trace_->size();
+        return false;
+    }
+    ++p;
+
+    out = LinkTraceSample();
+    while (p < end && *p != '}') {
+        if (*p != '"') {
+            ++p;
+            continue;
+        }
+        const char* name = ++p;
+        while (p < end && *p != '"') ++p;
+        int index = field_index(name, static_cast<size_t>(p - name));
+        while (p < end && *p != ':' && *p != '}') ++p;
+        if (p < end && *p == ':') {
+            ++p;
+            while (p < end && (is_space(*p) || *p == '\n')) ++p;
+            if (p < end && *p == '"') {
+                // 非数值字段（如注释字符串）直接跳过
+                ++p;
+                while (p < end && *p != '"') ++p;
+                if (p < end) ++p;
+                continue;
+            }
+            double value = 0;
+            p = parse_number(p, end, value);
+            assign_field(out, index, value);
+        }
+    }
+
+    cursor_ = (p < end) ? static_cast<size_t>(p - base) + 1 : trace_->size();
+    return true;
+}
+
+PathState make_path_state(uint32_t path_id, const LinkTraceSample& sample) {
+    PathState state;
+    state.path_id = path_id;
+    state.rtt_ms = sample.rtt_ms;
+    state.loss_rate = sample.loss_rate;
+    state.bandwidth_mbps = sample.bandwidth_mbps;
+    return state;
+}
+
+} // namespace mpquic_fec
@@ -0,0 +1,376 @@
+#include "warm_start.hpp"
+#include "fec_encoder.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace mpquic_fec {
+
+namespace {
+
+constexpr char kMagic[4] = {'M', 'Q', 'W', 'S'};
+
+uint32_t fnv1a(const uint8_t* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+class Writer {
+public:
+    void u16(uint16_t v) { put(v, 2); }
+    void u32(uint32_t v) { put(v, 4); }
+    void u64(uint64_t v) { put(v, 8); }
+
+    void f64(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        u64(bits);
+    }
+
+    void str(const std::string& s) {
+        if (s.size() > 0xFFFF) {
+            throw std::invalid_argument("Warm-start key too long: " + s.substr(0, 32) + "...");
+        }
+        u16(static_cast<uint16_t>(s.size()));
+        data.insert(data.end(), s.begin(), s.end());
+    }
+
+    std::vector<uint8_t> data;
+
+private:
+    void put(uint64_t v, int bytes) {
+        for (int i = bytes - 1; i >= 0; --i) {
+            data.push_back(static_cast<uint8_t>((v >> (i * 8)) & 0xFF));
+        }
+    }
+};
+
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    uint16_t u16() { return static_cast<uint16_t>(get(2)); }
+    uint32_t u32() { return static_cast<uint32_t>(get(4)); }
+    uint64_t u64() { return get(8); }
+
+    double f64() {
+        uint64_t bits = u64();
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    std::string str() {
+        size_t len = u16();
+        need(len);
+        std::string s(reinterpret_cast<const char*>(data_ + offset_), len);
+        offset_ += len;
+        return s;
+    }
+
+private:
+    void need(size_t bytes) const {
+        if (size_ - offset_ < bytes) {
+            throw std::runtime_error("Truncated warm-start state");
+        }
+    }
+
+    uint64_t get(int bytes) {
+        need(static_cast<size_t>(bytes));
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; ++i) {
+            v = (v << 8) | data_[offset_++];
+        }
+        return v;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_ = 0;
+};
+
+// 前缀长度的地址段数：IPv4取前3段（/24），IPv6取前4段（/64）
+std::string address_prefix(const std::string& addr) {
+    char sep = addr.find(':') != std::string::npos ? ':' : '.';
+    size_t keep = sep == ':' ? 4 : 3;
+    if (sep == '.' && std::count(addr.begin(), addr.end(), '.') != 3) {
+        return addr;  // 主机名等非IPv4字面量
+    }
+    if (sep == ':' && addr.find("::") != std::string::npos) {
+        // 压缩写法只保留"::"之前的部分（不足4段时即为实际前缀）
+        std::string head = addr.substr(0, addr.find("::"));
+        if (static_cast<size_t>(std::count(head.begin(), head.end(), ':')) + 1 < keep) {
+            return head + "::/64";
+        }
+    }
+
+    size_t pos = 0;
+    for (size_t i = 0; i < keep; ++i) {
+        pos = addr.find(sep, pos);
+        if (pos == std::string::npos) {
+            return addr;
+        }
+        ++pos;
+    }
+    return addr.substr(0, pos - 1) + (sep == ':' ? "::/64" : ".0/24");
+}
+
+} // namespace
+
+// ========== 记录校验 ==========
+
+bool PathWarmState::valid() const {
+    auto non_negative = [](double v) { return std::isfinite(v) && v >= 0; };
+    return non_negative(rtt_ms) && non_negative(bandwidth_mbps) && non_negative(jitter_ms) &&
+           non_negative(weight) && std::isfinite(gradient) &&
+           std::isfinite(loss_rate) && loss_rate >= 0 && loss_rate <= 1;
+}
+
+bool NetworkWarmState::valid() const {
+    return k > 0 && m > 0 && k + m <= kMaxFECBlocks &&
+           std::isfinite(redundancy_rate) && redundancy_rate >= 0;
+}
+
+bool valid_correlation(double rho) {
+    return std::isfinite(rho) && rho >= -1 && rho <= 1;
+}
+
+// ========== WarmStartStore 实现 ==========
+
+std::vector<uint8_t> WarmStartStore::serialize() const {
+    Writer w;
+    w.data.insert(w.data.end(), std::begin(kMagic), std::end(kMagic));
+    w.u16(kFormatVersion);
+    w.u16(0);
+
+    w.u32(static_cast<uint32_t>(paths_.size()));
+    for (const auto& [fingerprint, path] : paths_) {
+        w.str(fingerprint);
+        w.f64(path.rtt_ms);
+        w.f64(path.loss_rate);
+        w.f64(path.bandwidth_mbps);
+        w.f64(path.jitter_ms);
+        w.f64(path.weight);
+        w.f64(path.gradient);
+        w.u64(path.updated_unix_s);
+    }
+
+    w.u32(static_cast<uint32_t>(correlations_.size()));
+    for (const auto& [key, record] : correlations_) {
+        w.str(key.first);
+        w.str(key.second);
+        w.f64(record.rho);
+        w.u64(record.updated_unix_s);
+    }
+
+    w.u32(static_cast<uint32_t>(networks_.size()));
+    for (const auto& [key, network] : networks_) {
+        w.str(key);
+        w.u32(network.k);
+        w.u32(network.m);
+        w.f64(network.redundancy_rate);
+        w.u64(network.updated_unix_s);
+    }
+
+    w.u32(fnv1a(w.data.data(), w.data.size()));
+    return std::move(w.data);
+}
+
+WarmStartStore WarmStartStore::deserialize(const uint8_t* data, size_t size) {
+    if (size < sizeof(kMagic) + 8 || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a warm-start state file");
+    }
+
+    Reader checksum_reader(data + size - 4, 4);
+    if (checksum_reader.u32() != fnv1a(data, size - 4)) {
+        throw std::runtime_error("Warm-start state checksum mismatch");
+    }
+
+    Reader r(data + sizeof(kMagic), size - sizeof(kMagic) - 4);
+    uint16_t version = r.u16();
+    if (version != kFormatVersion) {
+        throw std::runtime_error("Unsupported warm-start state version " +
+                                 std::to_string(version));
+    }
+    r.u16();
+
+    WarmStartStore store;
+    for (uint32_t n = r.u32(); n > 0; --n) {
+        std::string fingerprint = r.str();
+        PathWarmState path;
+        path.rtt_ms = r.f64();
+        path.loss_rate = r.f64();
+        path.bandwidth_mbps = r.f64();
+        path.jitter_ms = r.f64();
+        path.weight = r.f64();
+        path.gradient = r.f64();
+        path.updated_unix_s = r.u64();
+        if (!path.valid()) {
+            LOG_WARN("Skipping invalid warm-start record for path ", fingerprint);
+            continue;
+        }
+        store.paths_[fingerprint] = path;
+    }
+    for (uint32_t n = r.u32(); n > 0; --n) {
+        std::string a = r.str();
+        std::string b = r.str();
+        CorrelationRecord record;
+        record.rho = r.f64();
+        record.updated_unix_s = r.u64();
+        if (!valid_correlation(record.rho)) {
+            LOG_WARN("Skipping invalid warm-start correlation ", record.rho, " for ", a,
+                     " / ", b);
+            continue;
+        }
+        store.correlations_[pair_key(a, b)] = record;
+    }
+    for (uint32_t n = r.u32(); n > 0; --n) {
+        std::string key = r.str();
+        NetworkWarmState network;
+        network.k = r.u32();
+        network.m = r.u32();
+        network.redundancy_rate = r.f64();
+        network.updated_unix_s = r.u64();
+        if (!network.valid()) {
+            LOG_WARN("Skipping invalid warm-start coding parameters k=", network.k,
+                     ", m=", network.m, ", rate=", network.redundancy_rate);
+            continue;
+        }
+        store.networks_[key] = network;
+    }
+    return store;
+}
+
+bool WarmStartStore::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+
+    try {
+        *this = deserialize(bytes.data(), bytes.size());
+    } catch (const std::exception& e) {
+        LOG_WARN("Ignoring warm-start state ", path, ": ", e.what());
+        return false;
+    }
+
+    LOG_INFO("Loaded warm-start state for ", paths_.size(), " paths from ", path);
+    return true;
+}
+
+void WarmStartStore::save(const std::string& path) const {
+    std::vector<uint8_t> bytes = serialize();
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(bytes.data()),
+                  static_cast<std::streamsize>(bytes.size()));
+        if (!out) {
+            throw std::runtime_error("Cannot write " + tmp_path);
+        }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot replace " + path + ": " + std::strerror(errno));
+    }
+}
+
+void WarmStartStore::put_path(const std::string& fingerprint, const PathWarmState& state) {
+    paths_[fingerprint] = state;
+}
+
+const PathWarmState* WarmStartStore::find_path(const std::string& fingerprint) const {
+    auto it = paths_.find(fingerprint);
+    return it != paths_.end() ? &it->second : nullptr;
+}
+
+void WarmStartStore::put_correlation(const std::string& a, const std::string& b, double rho) {
+    // 没有时间参数：与同一次导出中路径记录的时间一致即可，取两端中较新的
+    CorrelationRecord record;
+    record.rho = rho;
+    for (const auto* fingerprint : {&a, &b}) {
+        if (const PathWarmState* path = find_path(*fingerprint)) {
+            record.updated_unix_s = std::max(record.updated_unix_s, path->updated_unix_s);
+        }
+    }
+    correlations_[pair_key(a, b)] = record;
+}
+
+bool WarmStartStore::find_correlation(const std::string& a, const std::string& b,
+                                      double& rho) const {
+    auto it = correlations_.find(pair_key(a, b));
+    if (it == correlations_.end()) {
+        return false;
+    }
+    rho = it->second.rho;
+    return true;
+}
+
+void WarmStartStore::put_network(const std::string& key, const NetworkWarmState& state) {
+    networks_[key] = state;
+}
+
+const NetworkWarmState* WarmStartStore::find_network(const std::string& key) const {
+    auto it = networks_.find(key);
+    return it != networks_.end() ? &it->second : nullptr;
+}
+
+size_t WarmStartStore::prune(uint64_t now_unix_s, uint64_t max_age_s) {
+    uint64_t cutoff = now_unix_s > max_age_s ? now_unix_s - max_age_s : 0;
+    size_t removed = 0;
+    auto prune_map = [&](auto& records, auto updated) {
+        for (auto it = records.begin(); it != records.end();) {
+            if (updated(it->second) < cutoff) {
+                it = records.erase(it);
+                ++removed;
+            } else {
+                ++it;
+            }
+        }
+    };
+    prune_map(paths_, [](const PathWarmState& s) { return s.updated_unix_s; });
+    prune_map(correlations_, [](const CorrelationRecord& s) { return s.updated_unix_s; });
+    prune_map(networks_, [](const NetworkWarmState& s) { return s.updated_unix_s; });
+    return removed;
+}
+
+std::string WarmStartStore::network_key(std::vector<std::string> fingerprints) {
+    std::sort(fingerprints.begin(), fingerprints.end());
+    std::string key;
+    for (const auto& fingerprint : fingerprints) {
+        if (!key.empty()) {
+            key += ',';
+        }
+        key += fingerprint;
+    }
+    return key;
+}
+
+std::pair<std::string, std::string> WarmStartStore::pair_key(const std::string& a,
+                                                             const std::string& b) {
+    return a < b ? std::make_pair(a, b) : std::make_pair(b, a);
+}
+
+std::string path_fingerprint(const std::string& local_addr, uint16_t local_port,
+                             const std::string& remote_addr) {
+    std::string local = local_addr;
+    if (local.empty() || local == "0.0.0.0") {
+        local += ":" + std::to_string(local_port);
+    } else if (local == "::") {
+        local = "[::]:" + std::to_string(local_port);
+    }
+    return local + "|" + address_prefix(remote_addr);
+}
+
+} // namespace mpquic_fec
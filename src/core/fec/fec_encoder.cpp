@@ -6,24 +6,157 @@
 
 namespace mpquic_fec {
 
-// 简化版Reed-Solomon编码实现（生产环境应使用ISA-L库）
-FECEncoder::FECEncoder(uint32_t k, uint32_t m, uint32_t block_size)
-    : k_(k), m_(m), block_size_(block_size), encode_matrix_(nullptr) {
-    
+// ========== GF(2^8) 运算 ==========
+
+namespace {
+
+/**
+ * @brief GF(2^8) 查找表（本原多项式 x^8+x^4+x^3+x^2+1，与ISA-L一致）
+ */
+struct GF256Tables {
+    uint8_t exp[512];
+    uint8_t log[256];
+    uint8_t mul[256][256];   // 完整乘法表，区域运算时按行取用
+
+    GF256Tables() {
+        uint32_t x = 1;
+        for (uint32_t i = 0; i < 255; ++i) {
+            exp[i] = static_cast<uint8_t>(x);
+            log[x] = static_cast<uint8_t>(i);
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11D;
+            }
+        }
+        for (uint32_t i = 255; i < 512; ++i) {
+            exp[i] = exp[i - 255];
+        }
+        log[0] = 0;
+
+        for (uint32_t a = 0; a < 256; ++a) {
+            for (uint32_t b = 0; b < 256; ++b) {
+                mul[a][b] = (a == 0 || b == 0) ? 0 : exp[log[a] + log[b]];
+            }
+        }
+    }
+};
+
+const GF256Tables& gf() {
+    static const GF256Tables tables;
+    return tables;
+}
+
+uint8_t gf_inv(uint8_t a) {
+    return gf().exp[255 - gf().log[a]];
+}
+
+/**
+ * @brief dst ^= c · src（按字节区域运算）
+ */
+void gf_region_mul_add(uint8_t* dst, const uint8_t* src, uint8_t c, size_t len) {
+    if (c == 0) {
+        return;
+    }
+    if (c == 1) {
+        for (size_t i = 0; i < len; ++i) {
+            dst[i] ^= src[i];
+        }
+        return;
+    }
+    const uint8_t* row = gf().mul[c];
+    for (size_t i = 0; i < len; ++i) {
+        dst[i] ^= row[src[i]];
+    }
+}
+
+/**
+ * @brief 生成Cauchy编码矩阵的冗余部分：a[p][d] = 1 / ((k+p) ^ d)
+ */
+std::vector<uint8_t> make_cauchy_matrix(uint32_t k, uint32_t m) {
+    std::vector<uint8_t> matrix(static_cast<size_t>(m) * k);
+    for (uint32_t p = 0; p < m; ++p) {
+        for (uint32_t d = 0; d < k; ++d) {
+            matrix[p * k + d] = gf_inv(static_cast<uint8_t>((k + p) ^ d));
+        }
+    }
+    return matrix;
+}
+
+/**
+ * @brief GF(2^8) 上的 n×n 矩阵求逆（Gauss-Jordan），不可逆时返回false
+ */
+bool gf_invert_matrix(std::vector<uint8_t> a, std::vector<uint8_t>& inv, uint32_t n) {
+    inv.assign(static_cast<size_t>(n) * n, 0);
+    for (uint32_t i = 0; i < n; ++i) {
+        inv[i * n + i] = 1;
+    }
+
+    for (uint32_t col = 0; col < n; ++col) {
+        // 选主元
+        uint32_t pivot = col;
+        while (pivot < n && a[pivot * n + col] == 0) {
+            ++pivot;
+        }
+        if (pivot == n) {
+            return false;
+        }
+        if (pivot != col) {
+            for (uint32_t j = 0; j < n; ++j) {
+                std::swap(a[col * n + j], a[pivot * n + j]);
+                std::swap(inv[col * n + j], inv[pivot * n + j]);
+            }
+        }
+
+        // 主元归一
+        uint8_t scale = gf_inv(a[col * n + col]);
+        for (uint32_t j = 0; j < n; ++j) {
+            a[col * n + j] = gf().mul[scale][a[col * n + j]];
+            inv[col * n + j] = gf().mul[scale][inv[col * n + j]];
+        }
+
+        // 消去其他行
+        for (uint32_t row = 0; row < n; ++row) {
+            uint8_t factor = a[row * n + col];
+            if (row == col || factor == 0) {
+                continue;
+            }
+            for (uint32_t j = 0; j < n; ++j) {
+                a[row * n + j] ^= gf().mul[factor][a[col * n + j]];
+                inv[row * n + j] ^= gf().mul[factor][inv[col * n + j]];
+            }
+        }
+    }
+    return true;
+}
+
+void validate_params(uint32_t k, uint32_t m) {
     if (k == 0 || m == 0) {
         throw std::invalid_argument("k and m must be greater than 0");
     }
-    
+    if (k + m > kMaxFECBlocks) {
+        throw std::invalid_argument("k + m must not exceed 256 in GF(2^8)");
+    }
+}
+
+} // namespace
+
+// ========== FECEncoder 实现 ==========
+
+FECEncoder::FECEncoder(uint32_t k, uint32_t m, uint32_t block_size)
+    : k_(k), m_(m), block_size_(block_size) {
+
+    validate_params(k, m);
+    encode_matrix_ = make_cauchy_matrix(k_, m_);
+
     LOG_INFO("FECEncoder initialized: k=", k_, ", m=", m_, ", block_size=", block_size_);
 }
 
 FECEncoder::~FECEncoder() {
-    // 释放编码矩阵资源
 }
 
 std::vector<std::vector<uint8_t>> FECEncoder::encode(
     const std::vector<std::vector<uint8_t>>& data_blocks) {
-    
+
     if (data_blocks.size() != k_) {
         throw std::invalid_argument("Expected " + std::to_string(k_) + " data blocks");
     }
@@ -35,40 +168,54 @@ std::vector<std::vector<uint8_t>> FECEncoder::encode(
         }
     }
 
-    // 简化实现：使用XOR生成冗余块（实际应使用ISA-L的RS码）
-    std::vector<std::vector<uint8_t>> parity_blocks(m_, std::vector<uint8_t>(block_size_, 0));
+    std::vector<const uint8_t*> data_ptrs(k_);
+    for (uint32_t d = 0; d < k_; ++d) {
+        data_ptrs[d] = data_blocks[d].data();
+    }
 
+    std::vector<std::vector<uint8_t>> parity_blocks(m_, std::vector<uint8_t>(block_size_));
+    std::vector<uint8_t*> parity_ptrs(m_);
     for (uint32_t p = 0; p < m_; ++p) {
-        for (uint32_t i = 0; i < block_size_; ++i) {
-            uint8_t value = 0;
-            // 简单的XOR组合（演示用）
-            for (uint32_t d = 0; d < k_; ++d) {
-                value ^= data_blocks[d][i] * (p + d + 1);
-            }
-            parity_blocks[p][i] = value;
+        parity_ptrs[p] = parity_blocks[p].data();
+    }
+
+    encode(data_ptrs.data(), parity_ptrs.data());
+    return parity_blocks;
+}
+
+void FECEncoder::encode(const uint8_t* const* data_blocks, uint8_t* const* parity_blocks) {
+    // parity[p] = Σ_d a[p][d] · data[d]
+    for (uint32_t p = 0; p < m_; ++p) {
+        uint8_t* dst = parity_blocks[p];
+        std::memset(dst, 0, block_size_);
+        for (uint32_t d = 0; d < k_; ++d) {
+            gf_region_mul_add(dst, data_blocks[d], encode_matrix_[p * k_ + d], block_size_);
         }
     }
 
     LOG_DEBUG("Generated ", m_, " parity blocks from ", k_, " data blocks");
-    return parity_blocks;
 }
 
+// ========== FECDecoder 实现 ==========
+
 FECDecoder::FECDecoder(uint32_t k, uint32_t m, uint32_t block_size)
-    : k_(k), m_(m), block_size_(block_size), decode_matrix_(nullptr) {
-    
+    : k_(k), m_(m), block_size_(block_size), last_recovered_count_(0) {
+
+    validate_params(k, m);
+    encode_matrix_ = make_cauchy_matrix(k_, m_);
+
     LOG_INFO("FECDecoder initialized: k=", k_, ", m=", m_, ", block_size=", block_size_);
 }
 
 FECDecoder::~FECDecoder() {
-    // 释放解码矩阵资源
 }
 
 std::vector<std::vector<uint8_t>> FECDecoder::decode(
     const std::vector<std::vector<uint8_t>>& received_blocks,
     const std::vector<uint32_t>& block_ids) {
-    
+
     if (received_blocks.size() < k_) {
-        throw std::invalid_argument("Not enough blocks to decode (need at least k=" + 
+        throw std::invalid_argument("Not enough blocks to decode (need at least k=" +
                                    std::to_string(k_) + ")");
     }
 
@@ -76,22 +223,90 @@ std::vector<std::vector<uint8_t>> FECDecoder::decode(
         throw std::invalid_argument("Block count mismatch");
     }
 
-    // 简化实现：假设我们有足够的数据块
-    // 实际应使用ISA-L的矩阵求解算法
-    std::vector<std::vector<uint8_t>> recovered_blocks;
-    
-    for (size_t i = 0; i < block_ids.size() && recovered_blocks.size() < k_; ++i) {
-        if (block_ids[i] < k_) {  // 这是数据块
-            recovered_blocks.push_back(received_blocks[i]);
+    const size_t block_len = received_blocks[0].size();
+    for (const auto& block : received_blocks) {
+        if (block.size() != block_len) {
+            throw std::invalid_argument("Block size mismatch");
         }
     }
 
-    // 如果数据块不够，需要从冗余块重建（这里简化处理）
-    while (recovered_blocks.size() < k_) {
-        recovered_blocks.push_back(std::vector<uint8_t>(block_size_, 0));
+    // 1. 选取k个块：优先数据块，不足部分用冗余块补齐
+    std::vector<int> data_pos(k_, -1);
+    std::vector<size_t> chosen;
+    chosen.reserve(k_);
+    for (size_t i = 0; i < block_ids.size(); ++i) {
+        uint32_t id = block_ids[i];
+        if (id < k_ && data_pos[id] < 0) {
+            data_pos[id] = static_cast<int>(i);
+            chosen.push_back(i);
+        }
+    }
+
+    std::vector<bool> parity_used(m_, false);
+    for (size_t i = 0; i < block_ids.size() && chosen.size() < k_; ++i) {
+        uint32_t id = block_ids[i];
+        if (id >= k_ && id < k_ + m_ && !parity_used[id - k_]) {
+            parity_used[id - k_] = true;
+            chosen.push_back(i);
+        }
+    }
+
+    if (chosen.size() < k_) {
+        throw std::invalid_argument("Not enough distinct blocks to decode");
+    }
+
+    std::vector<std::vector<uint8_t>> recovered_blocks(k_);
+    last_recovered_count_ = 0;
+    for (uint32_t d = 0; d < k_; ++d) {
+        if (data_pos[d] >= 0) {
+            recovered_blocks[d] = received_blocks[data_pos[d]];
+        } else {
+            ++last_recovered_count_;
+        }
+    }
+
+    if (last_recovered_count_ == 0) {
+        return recovered_blocks;  // 数据块齐全，无需求解
+    }
+
+    // 2. 构造所选块对应的k×k子矩阵并求逆（丢失模式不变时复用）
+    std::vector<uint32_t> rows;
+    rows.reserve(k_);
+    for (size_t idx : chosen) {
+        rows.push_back(block_ids[idx]);
+    }
+
+    if (rows != cached_rows_) {
+        std::vector<uint8_t> sub(static_cast<size_t>(k_) * k_, 0);
+        for (uint32_t r = 0; r < k_; ++r) {
+            if (rows[r] < k_) {
+                sub[r * k_ + rows[r]] = 1;
+            } else {
+                std::memcpy(&sub[r * k_], &encode_matrix_[(rows[r] - k_) * k_], k_);
+            }
+        }
+        if (!gf_invert_matrix(std::move(sub), decode_matrix_, k_)) {
+            cached_rows_.clear();
+            throw std::runtime_error("Decode matrix is singular");
+        }
+        cached_rows_ = rows;
+    }
+
+    // 3. 只重建丢失的数据块：data[d] = Σ_r inv[d][r] · chosen[r]
+    for (uint32_t d = 0; d < k_; ++d) {
+        if (data_pos[d] >= 0) {
+            continue;
+        }
+        recovered_blocks[d].assign(block_len, 0);
+        uint8_t* dst = recovered_blocks[d].data();
+        for (uint32_t r = 0; r < k_; ++r) {
+            gf_region_mul_add(dst, received_blocks[chosen[r]].data(),
+                              decode_matrix_[d * k_ + r], block_len);
+        }
     }
 
-    LOG_DEBUG("Decoded ", recovered_blocks.size(), " blocks from ", received_blocks.size(), " received");
+    LOG_DEBUG("Decoded ", k_, " blocks from ", received_blocks.size(), " received, ",
+              last_recovered_count_, " rebuilt from parity");
     return recovered_blocks;
 }
 
@@ -8,6 +8,11 @@ namespace mpquic_fec {
 // FECFrameHeader 序列化
 std::vector<uint8_t> FECFrameHeader::serialize() const {
     std::vector<uint8_t> data(HEADER_SIZE);
+    serialize_to(data.data());
+    return data;
+}
+
+void FECFrameHeader::serialize_to(uint8_t* data) const {
     size_t offset = 0;
     
     // Frame Type (1 byte)
@@ -33,7 +38,10 @@ std::vector<uint8_t> FECFrameHeader::serialize() const {
         data[offset++] = static_cast<uint8_t>((payload_length >> (i * 8)) & 0xFF);
     }
     
-    return data;
+    // Source Blocks (4 bytes)
+    for (int i = 3; i >= 0; --i) {
+        data[offset++] = static_cast<uint8_t>((source_blocks >> (i * 8)) & 0xFF);
+    }
 }
 
 // FECFrameHeader 反序列化
@@ -72,21 +80,30 @@ FECFrameHeader FECFrameHeader::deserialize(const uint8_t* data, size_t len) {
         header.payload_length = (header.payload_length << 8) | data[offset++];
     }
     
+    // Source Blocks
+    header.source_blocks = 0;
+    for (int i = 0; i < 4; ++i) {
+        header.source_blocks = (header.source_blocks << 8) | data[offset++];
+    }
+    
     return header;
 }
 
 // FECFrame 序列化
 std::vector<uint8_t> FECFrame::serialize() const {
-    auto header_data = header.serialize();
-    std::vector<uint8_t> frame_data;
-    frame_data.reserve(header_data.size() + payload.size());
-    
-    frame_data.insert(frame_data.end(), header_data.begin(), header_data.end());
-    frame_data.insert(frame_data.end(), payload.begin(), payload.end());
-    
+    std::vector<uint8_t> frame_data(total_size());
+    serialize_to(frame_data.data());
     return frame_data;
 }
 
+size_t FECFrame::serialize_to(uint8_t* out) const {
+    header.serialize_to(out);
+    if (!payload.empty()) {
+        std::memcpy(out + FECFrameHeader::HEADER_SIZE, payload.data(), payload.size());
+    }
+    return total_size();
+}
+
 // FECFrame 反序列化
 FECFrame FECFrame::deserialize(const uint8_t* data, size_t len) {
     FECFrame frame;
@@ -115,8 +132,20 @@ void PacketNumberMapper::add_mapping(uint64_t group_id, uint32_t block_idx,
     mapping.is_repair = is_repair;
     
     auto key = std::make_pair(path_id, pkt_num);
+    bool new_packet = pkt_to_mapping_.find(key) == pkt_to_mapping_.end();
     pkt_to_mapping_[key] = mapping;
-    group_to_mappings_[group_id].push_back(mapping);
+    
+    auto& group_mappings = group_to_mappings_[group_id];
+    if (group_mappings.empty()) {
+        group_order_.push_back(group_id);
+        if (memory_account_) {
+            memory_account_->charge(MemoryTag::PACKET_MAPPING, kGroupBytes);
+        }
+    }
+    group_mappings.push_back(mapping);
+    if (memory_account_ && new_packet) {
+        memory_account_->charge(MemoryTag::PACKET_MAPPING, kMappingBytes);
+    }
     
     LOG_DEBUG("Added mapping: Group ", group_id, ", Block ", block_idx,
               ", Path ", path_id, ", Pkt ", pkt_num, ", Repair=", is_repair);
@@ -141,27 +170,56 @@ PacketNumberMapper::find_by_group(uint64_t group_id) {
     return {};
 }
 
-void PacketNumberMapper::cleanup_old_mappings(uint64_t before_group_id) {
-    // 清理指定group_id之前的所有映射
-    std::vector<uint64_t> groups_to_remove;
-    
-    for (auto& [gid, mappings] : group_to_mappings_) {
-        if (gid < before_group_id) {
-            groups_to_remove.push_back(gid);
-            
-            // 从pkt_to_mapping_中移除
-            for (const auto& mapping : mappings) {
-                auto key = std::make_pair(mapping.path_id, mapping.packet_number);
-                pkt_to_mapping_.erase(key);
-            }
-        }
+void PacketNumberMapper::cleanup_old_mappings(uint64_t before_group_id, uint64_t from_group_id) {
+    // 清理 [from_group_id, before_group_id) 范围内的所有映射
+    size_t removed = 0;
+    auto it = group_to_mappings_.lower_bound(from_group_id);
+    while (it != group_to_mappings_.end() && it->first < before_group_id) {
+        auto next = std::next(it);
+        erase_group(it);
+        it = next;
+        ++removed;
     }
     
-    for (auto gid : groups_to_remove) {
-        group_to_mappings_.erase(gid);
+    // 顺序队列中已清理的组在队首时顺带弹出，避免无限增长
+    while (!group_order_.empty() &&
+           group_to_mappings_.find(group_order_.front()) == group_to_mappings_.end()) {
+        group_order_.pop_front();
+    }
+    
+    LOG_DEBUG("Cleaned up ", removed, " old FEC groups");
+}
+
+size_t PacketNumberMapper::evict_oldest(size_t bytes) {
+    size_t freed = 0;
+    while (freed < bytes && !group_order_.empty()) {
+        auto it = group_to_mappings_.find(group_order_.front());
+        group_order_.pop_front();
+        if (it != group_to_mappings_.end()) {
+            freed += erase_group(it);
+        }
     }
+    return freed;
+}
+
+size_t PacketNumberMapper::erase_group(
+    std::map<uint64_t, std::vector<PacketMapping>>::iterator it) {
+    size_t freed = kGroupBytes;
+    for (const auto& mapping : it->second) {
+        auto key = std::make_pair(mapping.path_id, mapping.packet_number);
+        auto pkt_it = pkt_to_mapping_.find(key);
+        // 包号可能已被后登记的映射覆盖，只删除仍指向本组的条目
+        if (pkt_it != pkt_to_mapping_.end() && pkt_it->second.group_id == it->first) {
+            pkt_to_mapping_.erase(pkt_it);
+            freed += kMappingBytes;
+        }
+    }
+    group_to_mappings_.erase(it);
     
-    LOG_DEBUG("Cleaned up ", groups_to_remove.size(), " old FEC groups");
+    if (memory_account_) {
+        memory_account_->release(MemoryTag::PACKET_MAPPING, freed);
+    }
+    return freed;
 }
 
 } // namespace mpquic_fec
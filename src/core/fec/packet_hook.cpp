@@ -1,16 +1,45 @@
 #include "packet_hook.hpp"
 #include "logger.hpp"
-#include <chrono>
+#include "clock.hpp"
+#include "stage_timing.hpp"
 #include <algorithm>
+#include <stdexcept>
 
 namespace mpquic_fec {
 
+namespace {
+
+// 已编码组的估算占用：组对象 + map节点 + 源块和冗余块的负载
+size_t encoding_group_footprint(const EncodingGroup& group) {
+    size_t bytes = sizeof(EncodingGroup) + kMapNodeOverhead;
+    for (const auto& packet : group.source_packets) {
+        bytes += sizeof(PendingPacket) + packet.data.capacity();
+    }
+    for (const auto& frame : group.repair_frames) {
+        bytes += sizeof(FECFrame) + frame.payload.capacity();
+    }
+    return bytes;
+}
+
+size_t received_frame_footprint(const PooledBuffer& payload) {
+    return sizeof(PooledBuffer) + payload.capacity() + kMapNodeOverhead;
+}
+
+// 解码器的估算占用：对象本身 + 编码矩阵 + 逆矩阵及其展开表
+size_t decoder_footprint(uint32_t k, uint32_t m) {
+    return sizeof(FECDecoder) + kMapNodeOverhead +
+           static_cast<size_t>(m) * k + static_cast<size_t>(k) * sizeof(uint32_t) +
+           32 * static_cast<size_t>(k) * k;
+}
+
+} // namespace
+
 // ========== FECGroupManager 实现 ==========
 
 FECGroupManager::FECGroupManager(uint32_t default_k, uint32_t default_m, 
-                                 uint32_t block_size)
+                                 uint32_t block_size, uint64_t first_group_id)
     : current_k_(default_k), current_m_(default_m), block_size_(block_size),
-      next_group_id_(1) {
+      next_group_id_(first_group_id) {
     
     encoder_ = std::make_unique<FECEncoder>(current_k_, current_m_, block_size_);
     current_group_ = create_new_group();
@@ -20,10 +49,21 @@ FECGroupManager::FECGroupManager(uint32_t default_k, uint32_t default_m,
 }
 
 uint64_t FECGroupManager::add_source_packet(const PendingPacket& packet) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    return add_source_packet(PendingPacket(packet));
+}
+
+uint64_t FECGroupManager::add_source_packet(PendingPacket&& packet) {
+    MPQUIC_FEC_STAGE_SCOPE(Stage::SEND_GROUP_ACCUMULATE);
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
+    
+    if (packet.data.size() > block_size_) {
+        throw std::invalid_argument("Source packet of " + std::to_string(packet.data.size()) +
+                                    " bytes exceeds block size " + std::to_string(block_size_));
+    }
     
-    // 添加到当前组
-    current_group_->source_packets.push_back(packet);
+    // 添加到当前组（编码要求等长块，不足部分补零）
+    current_group_->source_packets.push_back(std::move(packet));
+    current_group_->source_packets.back().data.resize(block_size_, 0);
     
     LOG_DEBUG("Added packet to group ", current_group_->group_id, 
               " (", current_group_->source_packets.size(), "/", current_k_, ")");
@@ -36,12 +76,12 @@ uint64_t FECGroupManager::add_source_packet(const PendingPacket& packet) {
         perform_encoding(current_group_);
         
         // 保存到已完成列表
-        encoded_groups_[completed_group_id] = current_group_;
+        store_encoded_group(current_group_);
         
         // 创建新的编码组
         current_group_ = create_new_group();
         
-        LOG_INFO("Completed FEC encoding for group ", completed_group_id);
+        LOG_DEBUG("Completed FEC encoding for group ", completed_group_id);
         return completed_group_id;
     }
     
@@ -49,7 +89,7 @@ uint64_t FECGroupManager::add_source_packet(const PendingPacket& packet) {
 }
 
 std::shared_ptr<EncodingGroup> FECGroupManager::get_encoded_group(uint64_t group_id) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
     auto it = encoded_groups_.find(group_id);
     if (it != encoded_groups_.end()) {
         return it->second;
@@ -58,58 +98,62 @@ std::shared_ptr<EncodingGroup> FECGroupManager::get_encoded_group(uint64_t group
 }
 
 std::vector<uint64_t> FECGroupManager::flush_pending_groups() {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
     std::vector<uint64_t> flushed_ids;
     
-    // 如果当前组有数据但不满k个，强制编码
+    // 如果当前组有数据但不满k个，按实际源块数s编码为(s, m)组，不发送补零块；
+    // 帧头的source_blocks即为s，接收端据此选用对应的解码器
     if (!current_group_->source_packets.empty()) {
-        // 填充空包到k个
-        while (current_group_->source_packets.size() < current_k_) {
-            PendingPacket padding;
-            padding.packet_number = 0;
-            padding.path_id = 0;
-            padding.data.resize(block_size_, 0);
-            padding.timestamp_us = get_timestamp_us();
-            current_group_->source_packets.push_back(padding);
-        }
+        current_group_->info.k = static_cast<uint32_t>(current_group_->source_packets.size());
         
         uint64_t group_id = current_group_->group_id;
         perform_encoding(current_group_);
-        encoded_groups_[group_id] = current_group_;
+        store_encoded_group(current_group_);
         flushed_ids.push_back(group_id);
         
         current_group_ = create_new_group();
         
-        LOG_INFO("Flushed incomplete group ", group_id);
+        LOG_DEBUG("Flushed incomplete group ", group_id);
     }
     
     return flushed_ids;
 }
 
-void FECGroupManager::update_coding_params(uint32_t k, uint32_t m) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+std::vector<uint64_t> FECGroupManager::update_coding_params(uint32_t k, uint32_t m) {
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
+    std::vector<uint64_t> flushed_ids;
     
     if (k != current_k_ || m != current_m_) {
         LOG_INFO("Updating FEC params: k=", k, ", m=", m, 
                  " (was k=", current_k_, ", m=", current_m_, ")");
         
+        // 先按旧参数完成当前未满的组
+        flushed_ids = flush_pending_groups();
+        
         current_k_ = k;
         current_m_ = m;
         
         // 重新创建编码器
         encoder_ = std::make_unique<FECEncoder>(current_k_, current_m_, block_size_);
+        short_encoders_.clear();
         
-        // 刷新当前未完成的组
-        flush_pending_groups();
+        // 当前（空）组改用新参数
+        current_group_->info.k = current_k_;
+        current_group_->info.m = current_m_;
     }
+    
+    return flushed_ids;
 }
 
 void FECGroupManager::cleanup_old_groups(uint64_t before_group_id) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
     
     auto it = encoded_groups_.begin();
     while (it != encoded_groups_.end()) {
         if (it->first < before_group_id) {
+            if (memory_account_) {
+                memory_account_->release(MemoryTag::ENCODE_GROUPS, it->second->accounted_bytes);
+            }
             it = encoded_groups_.erase(it);
         } else {
             ++it;
@@ -119,56 +163,126 @@ void FECGroupManager::cleanup_old_groups(uint64_t before_group_id) {
     LOG_DEBUG("Cleaned up old FEC groups before ", before_group_id);
 }
 
+size_t FECGroupManager::evict_oldest(size_t bytes) {
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
+    
+    // 组ID在同一流内单调递增，map的开头即最旧的组
+    size_t freed = 0;
+    size_t evicted = 0;
+    while (freed < bytes && !encoded_groups_.empty()) {
+        auto it = encoded_groups_.begin();
+        freed += it->second->accounted_bytes;
+        if (memory_account_) {
+            memory_account_->release(MemoryTag::ENCODE_GROUPS, it->second->accounted_bytes);
+        }
+        encoded_groups_.erase(it);
+        ++evicted;
+    }
+    
+    if (evicted > 0) {
+        LOG_DEBUG("Evicted ", evicted, " encoded FEC groups (", freed, " bytes)");
+    }
+    return freed;
+}
+
+void FECGroupManager::set_memory_account(std::shared_ptr<MemoryAccount> account) {
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
+    
+    // 已缓存的组从旧账户转到新账户
+    for (auto& [group_id, group] : encoded_groups_) {
+        if (memory_account_) {
+            memory_account_->release(MemoryTag::ENCODE_GROUPS, group->accounted_bytes);
+        }
+        group->accounted_bytes = account ? encoding_group_footprint(*group) : 0;
+        if (account) {
+            account->charge(MemoryTag::ENCODE_GROUPS, group->accounted_bytes);
+        }
+    }
+    memory_account_ = std::move(account);
+}
+
+void FECGroupManager::store_encoded_group(const std::shared_ptr<EncodingGroup>& group) {
+    if (memory_account_) {
+        group->accounted_bytes = encoding_group_footprint(*group);
+        memory_account_->charge(MemoryTag::ENCODE_GROUPS, group->accounted_bytes);
+    }
+    encoded_groups_[group->group_id] = group;
+    
+    // 调用方长时间不清理时（如发送积压、periodic_update未被调用）缓存也不无限增长
+    while (encoded_groups_.size() > kMaxEncodedGroups) {
+        auto oldest = encoded_groups_.begin();
+        if (memory_account_) {
+            memory_account_->release(MemoryTag::ENCODE_GROUPS, oldest->second->accounted_bytes);
+        }
+        encoded_groups_.erase(oldest);
+    }
+}
+
 void FECGroupManager::perform_encoding(std::shared_ptr<EncodingGroup> group) {
-    // 准备编码数据
-    std::vector<std::vector<uint8_t>> data_blocks;
+    MPQUIC_FEC_STAGE_SCOPE(Stage::SEND_ENCODE);
+    
+    const uint32_t k = group->info.k;
+    const uint32_t m = group->info.m;
+    
+    // 源块已补齐到block_size，直接按地址编码，不复制
+    std::vector<const uint8_t*> data_blocks;
+    data_blocks.reserve(k);
     for (const auto& packet : group->source_packets) {
-        data_blocks.push_back(packet.data);
+        data_blocks.push_back(packet.data.data());
     }
     
-    // 执行FEC编码
-    auto parity_blocks = encoder_->encode(data_blocks);
-    
-    // 创建修复帧
+    // 修复帧负载在Arena中分配，编码结果直接写入
     group->repair_frames.clear();
-    for (size_t i = 0; i < parity_blocks.size(); ++i) {
-        FECFrame repair_frame;
+    group->repair_frames.resize(m);
+    std::vector<uint8_t*> parity_blocks(m);
+    for (uint32_t i = 0; i < m; ++i) {
+        FECFrame& repair_frame = group->repair_frames[i];
         repair_frame.header.frame_type = FrameType::FEC_REPAIR_FRAME;
         repair_frame.header.group_id = group->group_id;
-        repair_frame.header.block_index = current_k_ + i;
-        repair_frame.header.total_blocks = current_k_ + current_m_;
-        repair_frame.header.payload_length = parity_blocks[i].size();
-        repair_frame.payload = parity_blocks[i];
-        
-        group->repair_frames.push_back(repair_frame);
+        repair_frame.header.block_index = k + i;
+        repair_frame.header.total_blocks = k + m;
+        repair_frame.header.payload_length = block_size_;
+        repair_frame.header.source_blocks = k;
+        repair_frame.payload.resize(block_size_);
+        parity_blocks[i] = repair_frame.payload.data();
     }
     
+    // 执行FEC编码
+    encoder_for(k).encode(data_blocks.data(), parity_blocks.data());
+    
     group->is_encoded = true;
     
-    LOG_DEBUG("Encoded group ", group->group_id, ": ", current_k_, " source + ",
-              current_m_, " repair blocks");
+    LOG_DEBUG("Encoded group ", group->group_id, ": ", k, " source + ",
+              m, " repair blocks");
+}
+
+FECEncoder& FECGroupManager::encoder_for(uint32_t k) {
+    if (k == current_k_) {
+        return *encoder_;
+    }
+    // 编码矩阵依赖k，未满组需要独立的(k, m)编码器；按k缓存，参数变化时清空
+    auto& encoder = short_encoders_[k];
+    if (!encoder) {
+        encoder = std::make_unique<FECEncoder>(k, current_m_, block_size_);
+    }
+    return *encoder;
 }
 
 std::shared_ptr<EncodingGroup> FECGroupManager::create_new_group() {
-    auto group = std::make_shared<EncodingGroup>();
+    auto group = std::allocate_shared<EncodingGroup>(ArenaAllocator<EncodingGroup>());
     group->group_id = next_group_id_++;
     group->info.group_id = group->group_id;
     group->info.k = current_k_;
     group->info.m = current_m_;
     group->info.block_size = block_size_;
-    group->info.timestamp_us = get_timestamp_us();
+    group->info.timestamp_us = Clock::now_us();
     group->is_encoded = false;
     group->created_time_us = group->info.timestamp_us;
+    group->source_packets.reserve(current_k_);
     
     return group;
 }
 
-uint64_t FECGroupManager::get_timestamp_us() const {
-    auto now = std::chrono::steady_clock::now();
-    auto duration = now.time_since_epoch();
-    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
-}
-
 // ========== PacketSendHook 实现 ==========
 
 PacketSendHook::PacketSendHook(std::shared_ptr<FECGroupManager> group_mgr)
@@ -180,56 +294,103 @@ PacketSendHook::PacketSendHook(std::shared_ptr<FECGroupManager> group_mgr)
 bool PacketSendHook::on_packet_send(uint64_t packet_num, uint32_t path_id,
                                     const std::vector<uint8_t>& stream_data,
                                     std::vector<FECFrame>& out_packets) {
+    return on_packet_send(packet_num, path_id, stream_data.data(), stream_data.size(),
+                          out_packets);
+}
+
+bool PacketSendHook::on_packet_send(uint64_t packet_num, uint32_t path_id,
+                                    const uint8_t* data, size_t size,
+                                    std::vector<FECFrame>& out_packets) {
     if (!fec_enabled_) {
         // FEC未启用，直接返回
         return false;
     }
     
-    // 1. 创建待编码包
+    // 1. 创建待编码包（按块大小预留，补零时不再重新分配）
     PendingPacket pending;
     pending.packet_number = packet_num;
     pending.path_id = path_id;
-    pending.data = stream_data;
-    pending.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
-        std::chrono::steady_clock::now().time_since_epoch()).count();
+    pending.data.reserve(std::max<size_t>(size, group_manager_->block_size()));
+    pending.data.assign(data, data + size);
+    pending.timestamp_us = Clock::now_us();
     
     // 2. 添加到编码组管理器
-    uint64_t completed_group_id = group_manager_->add_source_packet(pending);
+    uint64_t completed_group_id = group_manager_->add_source_packet(std::move(pending));
     
     // 3. 如果形成了完整编码组，获取编码结果
-    if (completed_group_id > 0) {
-        auto group = group_manager_->get_encoded_group(completed_group_id);
-        if (group && group->is_encoded) {
-            // 生成源帧
-            for (size_t i = 0; i < group->source_packets.size(); ++i) {
-                FECFrame source_frame = wrap_source_frame(
-                    group->group_id, i, 
-                    group->info.k + group->info.m,
-                    group->source_packets[i].data);
-                out_packets.push_back(source_frame);
-            }
-            
-            // 添加修复帧
-            for (const auto& repair_frame : group->repair_frames) {
-                out_packets.push_back(repair_frame);
-            }
-            
-            LOG_INFO("Generated ", out_packets.size(), " FEC frames for group ",
-                     completed_group_id);
+    if (completed_group_id > 0 && append_group_frames(completed_group_id, out_packets)) {
+        LOG_DEBUG("Generated ", out_packets.size(), " FEC frames for group ",
+                  completed_group_id);
+        return true;
+    }
+    
+    return false;
+}
+
+bool PacketSendHook::flush(std::vector<FECFrame>& out_packets) {
+    if (!fec_enabled_) {
+        return false;
+    }
+    
+    bool flushed = false;
+    for (uint64_t group_id : group_manager_->flush_pending_groups()) {
+        flushed |= append_group_frames(group_id, out_packets);
+    }
+    
+    return flushed;
+}
+
+bool PacketSendHook::append_group_frames(uint64_t group_id, std::vector<FECFrame>& out_packets) {
+    auto group = group_manager_->get_encoded_group(group_id);
+    if (!group || !group->is_encoded) {
+        return false;
+    }
+    
+    // 生成源帧
+    for (size_t i = 0; i < group->source_packets.size(); ++i) {
+        out_packets.push_back(wrap_source_frame(
+            group->group_id, i, group->info.k, group->info.k + group->info.m,
+            group->source_packets[i].data));
+    }
+    
+    // 添加修复帧
+    for (const auto& repair_frame : group->repair_frames) {
+        out_packets.push_back(repair_frame);
+    }
+    
+    return true;
+}
+
+bool PacketSendHook::rebuild_frame(uint64_t group_id, uint32_t block_index,
+                                   FECFrame& out_frame) {
+    auto group = group_manager_->get_encoded_group(group_id);
+    if (!group || !group->is_encoded) {
+        return false;
+    }
+    
+    if (block_index < group->source_packets.size()) {
+        out_frame = wrap_source_frame(group->group_id, block_index, group->info.k,
+                                      group->info.k + group->info.m,
+                                      group->source_packets[block_index].data);
+        return true;
+    }
+    
+    for (const auto& repair_frame : group->repair_frames) {
+        if (repair_frame.header.block_index == block_index) {
+            out_frame = repair_frame;
             return true;
         }
     }
-    
     return false;
 }
 
 bool PacketSendHook::has_pending_frames() const {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
+    std::lock_guard<ProfiledMutex> lock(queue_mutex_);
     return !pending_frames_.empty();
 }
 
 std::vector<FECFrame> PacketSendHook::pop_pending_frames() {
-    std::lock_guard<std::mutex> lock(queue_mutex_);
+    std::lock_guard<ProfiledMutex> lock(queue_mutex_);
     std::vector<FECFrame> frames;
     
     while (!pending_frames_.empty()) {
@@ -241,14 +402,15 @@ std::vector<FECFrame> PacketSendHook::pop_pending_frames() {
 }
 
 FECFrame PacketSendHook::wrap_source_frame(uint64_t group_id, uint32_t block_idx,
-                                          uint32_t total_blocks,
-                                          const std::vector<uint8_t>& data) {
+                                          uint32_t source_blocks, uint32_t total_blocks,
+                                          const ArenaBytes& data) {
     FECFrame frame;
     frame.header.frame_type = FrameType::FEC_SOURCE_FRAME;
     frame.header.group_id = group_id;
     frame.header.block_index = block_idx;
     frame.header.total_blocks = total_blocks;
     frame.header.payload_length = data.size();
+    frame.header.source_blocks = source_blocks;
     frame.payload = data;
     
     return frame;
@@ -261,23 +423,59 @@ PacketReceiveHook::PacketReceiveHook() {
 }
 
 std::vector<std::vector<uint8_t>> PacketReceiveHook::on_frame_received(const FECFrame& frame) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
     
     uint64_t group_id = frame.header.group_id;
+    stats_.frames_received++;
+    
+    uint32_t total = frame.header.total_blocks;
+    uint32_t k = frame.header.source_blocks;
+    if (k == 0 || k >= total) {
+        // 旧版帧头未携带k，按k:m = 2:1推断
+        k = (total * 2) / 3;
+    }
+    uint32_t m = total - k;
+    if (k == 0 || m == 0 || total > kMaxFECBlocks || frame.header.block_index >= total) {
+        // 对端的帧头不可信，不合法的组参数不能交给解码器
+        stats_.decode_failures++;
+        LOG_WARN("Dropping FEC frame with invalid header: group ", group_id, ", block ",
+                 frame.header.block_index, "/", total, ", k=", frame.header.source_blocks);
+        return {};
+    }
     
     // 获取或创建接收组
-    auto& recv_group = received_groups_[group_id];
+    auto [group_it, inserted] = received_groups_.try_emplace(group_id);
+    auto& recv_group = group_it->second;
+    if (inserted) {
+        arrival_order_.push_back(group_id);
+        recv_group.accounted_bytes = sizeof(ReceivedGroup) + kMapNodeOverhead;
+        charge(MemoryTag::RECEIVE_GROUPS, recv_group.accounted_bytes);
+    }
     
-    // 存储接收到的帧
-    recv_group.received_frames[frame.header.block_index] = frame;
+    // 已解码的组不再缓存迟到的帧
+    if (recv_group.is_complete) {
+        return {};
+    }
+    
+    // 存储接收到的帧负载（重复的块只替换内容，按新负载重新记账）
+    uint32_t payload_size = static_cast<uint32_t>(frame.payload.size());
+    auto [frame_it, new_block] = recv_group.received_frames.try_emplace(
+        frame.header.block_index, frame.payload.data(), payload_size);
+    if (!new_block) {
+        size_t old_bytes = received_frame_footprint(frame_it->second);
+        recv_group.accounted_bytes -= old_bytes;
+        release(MemoryTag::RECEIVE_GROUPS, old_bytes);
+        frame_it->second = PooledBuffer(frame.payload.data(), payload_size);
+    }
+    size_t frame_bytes = received_frame_footprint(frame_it->second);
+    recv_group.accounted_bytes += frame_bytes;
+    charge(MemoryTag::RECEIVE_GROUPS, frame_bytes);
     
     // 更新组信息
     if (recv_group.info.group_id == 0) {
         recv_group.info.group_id = group_id;
-        // 从帧头推断k和m（简化处理）
-        uint32_t total = frame.header.total_blocks;
-        recv_group.info.k = (total * 2) / 3;  // 假设k:m = 2:1
-        recv_group.info.m = total - recv_group.info.k;
+        recv_group.info.k = k;
+        recv_group.info.m = m;
         recv_group.info.block_size = frame.payload.size();
     }
     
@@ -294,7 +492,7 @@ std::vector<std::vector<uint8_t>> PacketReceiveHook::on_frame_received(const FEC
 }
 
 bool PacketReceiveHook::can_decode_group(uint64_t group_id) {
-    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
     auto it = received_groups_.find(group_id);
     if (it != received_groups_.end()) {
         return it->second.received_frames.size() >= it->second.info.k;
@@ -302,39 +500,140 @@ bool PacketReceiveHook::can_decode_group(uint64_t group_id) {
     return false;
 }
 
+void PacketReceiveHook::cleanup_old_groups(uint64_t before_group_id, uint64_t from_group_id) {
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
+    
+    if (before_group_id <= from_group_id) {
+        return;
+    }
+    auto first = received_groups_.lower_bound(from_group_id);
+    auto last = received_groups_.lower_bound(before_group_id);
+    for (auto it = first; it != last; ++it) {
+        release(MemoryTag::RECEIVE_GROUPS, it->second.accounted_bytes);
+    }
+    received_groups_.erase(first, last);
+    
+    while (!arrival_order_.empty() &&
+           received_groups_.find(arrival_order_.front()) == received_groups_.end()) {
+        arrival_order_.pop_front();
+    }
+}
+
+size_t PacketReceiveHook::evict_oldest(size_t bytes) {
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
+    
+    // 多条流的组ID带槽位前缀，按ID排序并不等于按时间排序，因此按到达顺序驱逐
+    size_t freed = 0;
+    while (freed < bytes && !arrival_order_.empty()) {
+        auto it = received_groups_.find(arrival_order_.front());
+        arrival_order_.pop_front();
+        if (it == received_groups_.end()) {
+            continue;
+        }
+        if (!it->second.is_complete) {
+            stats_.groups_evicted++;
+        }
+        freed += it->second.accounted_bytes;
+        release(MemoryTag::RECEIVE_GROUPS, it->second.accounted_bytes);
+        received_groups_.erase(it);
+    }
+    return freed;
+}
+
+size_t PacketReceiveHook::evict_decoders() {
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
+    
+    size_t freed = 0;
+    for (const auto& [key, decoder] : decoders_) {
+        freed += decoder_footprint(key.first, key.second);
+    }
+    decoders_.clear();
+    release(MemoryTag::DECODERS, freed);
+    return freed;
+}
+
+void PacketReceiveHook::set_memory_account(std::shared_ptr<MemoryAccount> account) {
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
+    
+    uint64_t group_bytes = 0;
+    for (const auto& [group_id, group] : received_groups_) {
+        group_bytes += group.accounted_bytes;
+    }
+    uint64_t decoder_bytes = 0;
+    for (const auto& [key, decoder] : decoders_) {
+        decoder_bytes += decoder_footprint(key.first, key.second);
+    }
+    
+    release(MemoryTag::RECEIVE_GROUPS, group_bytes);
+    release(MemoryTag::DECODERS, decoder_bytes);
+    memory_account_ = std::move(account);
+    charge(MemoryTag::RECEIVE_GROUPS, group_bytes);
+    charge(MemoryTag::DECODERS, decoder_bytes);
+}
+
+void PacketReceiveHook::charge(MemoryTag tag, size_t bytes) {
+    if (memory_account_ && bytes > 0) {
+        memory_account_->charge(tag, bytes);
+    }
+}
+
+void PacketReceiveHook::release(MemoryTag tag, size_t bytes) {
+    if (memory_account_ && bytes > 0) {
+        memory_account_->release(tag, bytes);
+    }
+}
+
+PacketReceiveHook::Statistics PacketReceiveHook::get_statistics() {
+    std::lock_guard<ProfiledRecursiveMutex> lock(mutex_);
+    return stats_;
+}
+
 std::vector<std::vector<uint8_t>> PacketReceiveHook::try_decode_group(uint64_t group_id) {
+    MPQUIC_FEC_STAGE_SCOPE(Stage::RECV_DECODE);
+    
     auto& recv_group = received_groups_[group_id];
     
     if (recv_group.is_complete) {
         return {};  // 已解码过
     }
     
-    // 获取或创建解码器
-    auto key = std::make_pair(recv_group.info.k, recv_group.info.m);
-    if (decoders_.find(key) == decoders_.end()) {
-        decoders_[key] = std::make_unique<FECDecoder>(
-            recv_group.info.k, recv_group.info.m, recv_group.info.block_size);
-    }
-    
     // 准备解码数据
     std::vector<std::vector<uint8_t>> received_blocks;
     std::vector<uint32_t> block_ids;
     
-    for (const auto& [block_idx, frame] : recv_group.received_frames) {
-        received_blocks.push_back(frame.payload);
+    for (const auto& [block_idx, payload] : recv_group.received_frames) {
+        received_blocks.emplace_back(payload.data(), payload.data() + payload.size());
         block_ids.push_back(block_idx);
     }
     
-    // 执行解码
+    // 获取或创建解码器并执行解码
     try {
-        auto decoded = decoders_[key]->decode(received_blocks, block_ids);
+        auto key = std::make_pair(recv_group.info.k, recv_group.info.m);
+        auto decoder_it = decoders_.find(key);
+        if (decoder_it == decoders_.end()) {
+            // 构造失败时不留下空表项
+            auto created = std::make_unique<FECDecoder>(
+                recv_group.info.k, recv_group.info.m, recv_group.info.block_size);
+            decoder_it = decoders_.emplace(key, std::move(created)).first;
+            charge(MemoryTag::DECODERS, decoder_footprint(key.first, key.second));
+        }
+        auto& decoder = decoder_it->second;
+        auto decoded = decoder->decode(received_blocks, block_ids);
         recv_group.is_complete = true;
+        recv_group.received_frames.clear();  // 释放已解码组的帧缓存
+        size_t frame_bytes = recv_group.accounted_bytes - (sizeof(ReceivedGroup) + kMapNodeOverhead);
+        recv_group.accounted_bytes -= frame_bytes;
+        release(MemoryTag::RECEIVE_GROUPS, frame_bytes);
+        
+        stats_.groups_decoded++;
+        stats_.blocks_recovered += decoder->last_recovered_count();
         
-        LOG_INFO("Successfully decoded group ", group_id, ", recovered ",
-                 decoded.size(), " blocks");
+        LOG_DEBUG("Successfully decoded group ", group_id, ", recovered ",
+                  decoder->last_recovered_count(), " of ", decoded.size(), " blocks");
         
         return decoded;
     } catch (const std::exception& e) {
+        stats_.decode_failures++;
         LOG_ERROR("Failed to decode group ", group_id, ": ", e.what());
         return {};
     }
@@ -1,44 +1,62 @@
 #include "mpquic_fec_controller.hpp"
 #include "logger.hpp"
-#include <chrono>
+#include "clock.hpp"
+#include "event_trace.hpp"
+#include "stage_timing.hpp"
+#include <limits>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
 
 namespace mpquic_fec {
 
 MPQUICFECController::MPQUICFECController(uint32_t default_k, uint32_t default_m,
                                          uint32_t block_size)
-    : fec_enabled_(true), block_size_(block_size), last_update_time_us_(0) {
+    : memory_pressure_(false), redundancy_degraded_(false),
+      last_source_path_(std::numeric_limits<uint32_t>::max()), fec_enabled_(true),
+      block_size_(block_size), default_k_(default_k), default_m_(default_m),
+      last_update_time_us_(0) {
+    
+    current_decision_.k = default_k;
+    current_decision_.m = default_m;
+    current_decision_.redundancy_rate = static_cast<double>(default_m) / default_k;
     
     // 创建核心组件
-    group_manager_ = std::make_shared<FECGroupManager>(default_k, default_m, block_size);
-    send_hook_ = std::make_shared<PacketSendHook>(group_manager_);
+    flat_stream_slots_.assign(kFlatStreamIds, -1);
     receive_hook_ = std::make_shared<PacketReceiveHook>();
     path_scheduler_ = std::make_shared<PathScheduler>();
     oco_controller_ = std::make_shared<OCORedundancyController>();
     pkt_mapper_ = std::make_shared<PacketNumberMapper>();
     fec_strategy_ = std::make_shared<AdaptiveFECStrategy>();
+    memory_account_ = std::make_shared<MemoryAccount>();
     
     // 连接组件
     path_scheduler_->set_oco_controller(oco_controller_);
+    receive_hook_->set_memory_account(memory_account_);
+    pkt_mapper_->set_memory_account(memory_account_);
+    
+    // 默认流
+    open_stream(0, TrafficClass::STREAMING);
     
     LOG_INFO("MPQUICFECController initialized with k=", default_k, ", m=", default_m);
 }
 
 void MPQUICFECController::initialize() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     
     // 初始化决策
-    current_decision_.k = 4;
-    current_decision_.m = 2;
-    current_decision_.redundancy_rate = 0.5;
+    current_decision_.k = default_k_;
+    current_decision_.m = default_m_;
+    current_decision_.redundancy_rate = static_cast<double>(default_m_) / default_k_;
     
-    last_update_time_us_ = get_timestamp_us();
+    last_update_time_us_ = Clock::now_us();
     
     LOG_INFO("MPQUICFECController initialized successfully");
 }
 
 void MPQUICFECController::add_path(uint32_t path_id, const PathState& state) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     
     path_scheduler_->update_path_state(state);
     
@@ -57,8 +75,22 @@ void MPQUICFECController::add_path(uint32_t path_id, const PathState& state) {
     LOG_INFO("Added path ", path_id, " to FEC controller");
 }
 
-void MPQUICFECController::update_path_state(const PathState& state) {
-    std::lock_guard<std::mutex> lock(mutex_);
+void MPQUICFECController::update_path_state(const PathState& reported) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    
+    PathState state = reported;
+    auto seed = warm_seeds_.find(state.path_id);
+    if (seed != warm_seeds_.end()) {
+        if (state.bytes_sent == 0) {
+            // 尚未发送数据，上报值只是默认估计，沿用预热值
+            state.rtt_ms = seed->second.rtt_ms;
+            state.loss_rate = seed->second.loss_rate;
+            state.bandwidth_mbps = seed->second.bandwidth_mbps;
+            state.jitter_ms = seed->second.jitter_ms;
+        } else {
+            warm_seeds_.erase(seed);
+        }
+    }
     
     path_scheduler_->update_path_state(state);
     
@@ -76,7 +108,7 @@ void MPQUICFECController::update_path_state(const PathState& state) {
 }
 
 void MPQUICFECController::update_loss_correlation(uint32_t path_i, uint32_t path_j, double rho) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     
     path_scheduler_->update_path_correlation(path_i, path_j, rho);
     oco_controller_->update_loss_correlation(path_i, path_j, rho);
@@ -84,11 +116,60 @@ void MPQUICFECController::update_loss_correlation(uint32_t path_i, uint32_t path
     LOG_DEBUG("Updated loss correlation: ", path_i, " <-> ", path_j, " = ", rho);
 }
 
+uint32_t MPQUICFECController::open_stream(uint64_t stream_id, TrafficClass traffic_class) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    
+    auto [k, m] = class_coding_params(traffic_class, current_decision_);
+    
+    if (StreamContext* existing = find_stream(stream_id)) {
+        if (existing->traffic_class != traffic_class) {
+            existing->traffic_class = traffic_class;
+            flush_groups_locked(*existing, pending_packets_);
+            existing->group_manager->update_coding_params(k, m);
+        }
+        return existing->slot;
+    }
+    
+    // 组ID高16位存放槽位
+    if (streams_.size() >= (uint64_t(1) << (64 - kGroupSequenceBits))) {
+        throw std::runtime_error("Too many FEC streams");
+    }
+    
+    auto stream = std::make_unique<StreamContext>();
+    stream->stream_id = stream_id;
+    stream->slot = static_cast<uint32_t>(streams_.size());
+    stream->traffic_class = traffic_class;
+    stream->group_manager = std::make_shared<FECGroupManager>(
+        k, m, block_size_, make_stream_group_id(stream->slot, 1));
+    stream->group_manager->set_memory_account(memory_account_);
+    stream->send_hook = std::make_shared<PacketSendHook>(stream->group_manager);
+    stream->send_hook->set_fec_enabled(fec_enabled_);
+    
+    if (stream_id < kFlatStreamIds) {
+        flat_stream_slots_[stream_id] = static_cast<int32_t>(stream->slot);
+    } else {
+        stream_slots_[stream_id] = stream->slot;
+    }
+    
+    uint32_t slot = stream->slot;
+    streams_.push_back(std::move(stream));
+    
+    LOG_INFO("Opened FEC stream ", stream_id, " (slot ", slot, ", k=", k, ", m=", m, ")");
+    return slot;
+}
+
 std::vector<SendPacketMeta> MPQUICFECController::send_stream_data(
-    const std::vector<uint8_t>& stream_data, uint32_t original_path_id) {
+    const std::vector<uint8_t>& stream_data, uint32_t original_path_id, uint64_t stream_id) {
+    return send_stream_data(stream_data.data(), stream_data.size(), original_path_id, stream_id);
+}
+
+std::vector<SendPacketMeta> MPQUICFECController::send_stream_data(
+    const uint8_t* data, size_t size, uint32_t original_path_id, uint64_t stream_id) {
     
-    std::lock_guard<std::mutex> lock(mutex_);
+    MPQUIC_FEC_STAGE_SCOPE(Stage::SEND_HOOK_INGEST);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     
+    StreamContext& stream = stream_for(stream_id);
     std::vector<SendPacketMeta> result;
     
     if (!fec_enabled_) {
@@ -96,55 +177,373 @@ std::vector<SendPacketMeta> MPQUICFECController::send_stream_data(
         SendPacketMeta meta;
         meta.packet_number = get_next_packet_number(original_path_id);
         meta.path_id = original_path_id;
-        // 创建简单的源帧
-        meta.frame.header.frame_type = FrameType::FEC_SOURCE_FRAME;
-        meta.frame.payload = stream_data;
-        meta.send_time_us = get_timestamp_us();
+        // 不经FEC编码，直接封装为流帧（组ID只携带流槽位）
+        meta.frame.header.frame_type = FrameType::STREAM_FRAME;
+        meta.frame.header.group_id = make_stream_group_id(stream.slot, 0);
+        meta.frame.header.payload_length = size;
+        meta.frame.payload.assign(data, data + size);
+        meta.send_time_us = Clock::now_us();
         meta.is_repair = false;
         
         result.push_back(meta);
         return result;
     }
     
-    // 步骤1：Hook拦截 - 将数据提交给FEC编码组管理器
+    // 步骤1：Hook拦截 - 将数据提交给该流的FEC编码组管理器
     std::vector<FECFrame> fec_frames;
     uint64_t fake_pkt_num = get_next_packet_number(original_path_id) - 1;
     
-    bool has_encoded = send_hook_->on_packet_send(
-        fake_pkt_num, original_path_id, stream_data, fec_frames);
+    bool has_encoded = stream.send_hook->on_packet_send(
+        fake_pkt_num, original_path_id, data, size, fec_frames);
     
     // 步骤2：如果完成了编码组，进行路径分配
     if (has_encoded && !fec_frames.empty()) {
         assign_packets_to_paths(fec_frames, result);
         stats_.fec_groups_created++;
         
-        LOG_INFO("Encoded and assigned ", result.size(), " packets (",
-                 stats_.source_packets_sent, " source + ", 
-                 stats_.repair_packets_sent, " repair)");
+        LOG_DEBUG("Encoded and assigned ", result.size(), " packets (",
+                  stats_.source_packets_sent, " source + ", 
+                  stats_.repair_packets_sent, " repair)");
+        
+        enforce_memory_budgets_locked();
     }
     
     return result;
 }
 
+std::vector<SendPacketMeta> MPQUICFECController::flush_pending_groups() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    
+    std::vector<SendPacketMeta> result;
+    for (auto& stream : streams_) {
+        flush_groups_locked(*stream, result);
+    }
+    return result;
+}
+
+std::vector<SendPacketMeta> MPQUICFECController::flush_pending_groups(uint64_t stream_id) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    
+    std::vector<SendPacketMeta> result;
+    flush_groups_locked(stream_for(stream_id), result);
+    return result;
+}
+
+std::vector<SendPacketMeta> MPQUICFECController::pop_pending_packets() {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    
+    std::vector<SendPacketMeta> result;
+    result.swap(pending_packets_);
+    return result;
+}
+
+MPQUICFECController::Statistics MPQUICFECController::get_statistics() const {
+    Statistics stats;
+    {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        stats = stats_;
+        stats.memory_pressure = memory_pressure_;
+        stats.redundancy_degraded = redundancy_degraded_;
+    }
+    
+    auto arena_stats = HugePageArena::instance().get_statistics();
+    stats.arena_mapped_bytes = arena_stats.mapped_bytes;
+    stats.arena_huge_page_bytes = std::min(arena_stats.mapped_bytes,
+                                           arena_stats.hugetlb_bytes + arena_stats.thp_bytes);
+    stats.arena_in_use_bytes = arena_stats.in_use_bytes;
+    stats.arena_peak_in_use_bytes = arena_stats.peak_in_use_bytes;
+    
+    auto memory = memory_account_->snapshot();
+    stats.memory_in_use_bytes = memory.total;
+    stats.memory_peak_bytes = memory.total_peak;
+    stats.groups_evicted = receive_hook_->get_statistics().groups_evicted;
+    return stats;
+}
+
+std::vector<StageTimingStats> MPQUICFECController::get_stage_timings() const {
+    return StageTiming::instance().snapshot();
+}
+
+std::vector<LockSiteStats> MPQUICFECController::get_lock_profile() const {
+    return LockProfiler::instance().snapshot();
+}
+
+MemoryAccount::Snapshot MPQUICFECController::get_memory_usage() const {
+    return memory_account_->snapshot();
+}
+
+void MPQUICFECController::set_memory_budget(MemoryTag tag, uint64_t bytes) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    memory_account_->set_budget(tag, bytes);
+    enforce_memory_budgets_locked();
+    
+    LOG_INFO("Memory budget of ", memory_tag_name(tag), " set to ", bytes, " bytes");
+}
+
+void MPQUICFECController::set_memory_budget(uint64_t total_bytes) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    memory_account_->set_total_budget(total_bytes);
+    enforce_memory_budgets_locked();
+    
+    LOG_INFO("Total memory budget set to ", total_bytes, " bytes");
+}
+
+void MPQUICFECController::set_path_fingerprint(uint32_t path_id, const std::string& fingerprint) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    
+    auto it = path_fingerprints_.find(path_id);
+    if (it != path_fingerprints_.end() && it->second != fingerprint) {
+        // 路径换到了另一个网络，允许按新指纹重新预热
+        warm_started_paths_.erase(path_id);
+        warm_seeds_.erase(path_id);
+    }
+    path_fingerprints_[path_id] = fingerprint;
+}
+
+void MPQUICFECController::export_warm_start(WarmStartStore& store) const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    
+    uint64_t now_unix_s = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    auto weights = path_scheduler_->get_path_weights();
+    
+    std::vector<std::pair<uint32_t, std::string>> exported;
+    for (const auto& metrics : oco_controller_->get_all_metrics()) {
+        auto fingerprint = path_fingerprints_.find(metrics.path_id);
+        if (fingerprint == path_fingerprints_.end()) {
+            continue;
+        }
+        
+        PathWarmState state;
+        state.rtt_ms = metrics.rtt_ms;
+        state.loss_rate = metrics.loss_rate;
+        state.bandwidth_mbps = metrics.bandwidth_mbps;
+        state.jitter_ms = metrics.jitter_ms;
+        auto weight = weights.find(metrics.path_id);
+        state.weight = weight != weights.end() ? weight->second : 0.0;
+        state.gradient = oco_controller_->get_gradient_accumulator(metrics.path_id);
+        state.updated_unix_s = now_unix_s;
+        store.put_path(fingerprint->second, state);
+        exported.emplace_back(metrics.path_id, fingerprint->second);
+    }
+    if (exported.empty()) {
+        return;
+    }
+    
+    std::vector<std::string> fingerprints;
+    for (size_t i = 0; i < exported.size(); ++i) {
+        fingerprints.push_back(exported[i].second);
+        for (size_t j = i + 1; j < exported.size(); ++j) {
+            store.put_correlation(exported[i].second, exported[j].second,
+                                  oco_controller_->get_loss_correlation(exported[i].first,
+                                                                        exported[j].first));
+        }
+    }
+    
+    NetworkWarmState network;
+    network.k = current_decision_.k;
+    network.m = current_decision_.m;
+    network.redundancy_rate = current_decision_.redundancy_rate;
+    network.updated_unix_s = now_unix_s;
+    store.put_network(WarmStartStore::network_key(std::move(fingerprints)), network);
+    
+    LOG_DEBUG("Exported warm-start state of ", exported.size(), " paths");
+}
+
+size_t MPQUICFECController::apply_warm_start(const WarmStartStore& store) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    
+    std::vector<uint32_t> seeded;
+    for (const auto& [path_id, fingerprint] : path_fingerprints_) {
+        if (warm_started_paths_.count(path_id) > 0) {
+            continue;
+        }
+        const PathWarmState* saved = store.find_path(fingerprint);
+        if (!saved) {
+            continue;
+        }
+        if (!saved->valid()) {
+            // 存储经put_path写入时未经加载校验，这里同样跳过越界记录
+            LOG_WARN("Ignoring invalid warm-start state for path ", path_id, " (",
+                     fingerprint, ")");
+            continue;
+        }
+        warm_started_paths_.insert(path_id);
+        
+        PathState state;
+        for (const auto& path : path_scheduler_->get_all_paths()) {
+            if (path.path_id == path_id) {
+                state = path;
+            }
+        }
+        if (state.bytes_sent > 0) {
+            continue;  // 已有实测数据，保存值只会更旧
+        }
+        
+        state.path_id = path_id;
+        state.rtt_ms = saved->rtt_ms;
+        state.loss_rate = saved->loss_rate;
+        state.bandwidth_mbps = saved->bandwidth_mbps;
+        state.jitter_ms = saved->jitter_ms;
+        path_scheduler_->update_path_state(state);
+        path_scheduler_->set_path_weight(path_id, saved->weight);
+        
+        LinkMetrics metrics;
+        metrics.path_id = path_id;
+        metrics.rtt_ms = saved->rtt_ms;
+        metrics.loss_rate = saved->loss_rate;
+        metrics.bandwidth_mbps = saved->bandwidth_mbps;
+        metrics.jitter_ms = saved->jitter_ms;
+        oco_controller_->update_link_metrics(metrics);
+        oco_controller_->set_gradient_accumulator(path_id, saved->gradient);
+        
+        warm_seeds_[path_id] = *saved;
+        seeded.push_back(path_id);
+        
+        LOG_INFO("Warm-started path ", path_id, " (", fingerprint, "): RTT=", saved->rtt_ms,
+                 "ms, Loss=", saved->loss_rate * 100, "%, BW=", saved->bandwidth_mbps, "Mbps");
+    }
+    if (seeded.empty()) {
+        return 0;
+    }
+    
+    // 调度器的相关性更新会同步到OCO控制器
+    std::vector<std::string> fingerprints;
+    for (const auto& [path_id, fingerprint] : path_fingerprints_) {
+        fingerprints.push_back(fingerprint);
+        for (uint32_t seeded_id : seeded) {
+            double rho;
+            if (path_id != seeded_id &&
+                store.find_correlation(path_fingerprints_.at(seeded_id), fingerprint, rho) &&
+                valid_correlation(rho)) {
+                path_scheduler_->update_path_correlation(seeded_id, path_id, rho);
+            }
+        }
+    }
+    
+    const NetworkWarmState* network =
+        store.find_network(WarmStartStore::network_key(std::move(fingerprints)));
+    if (network && network->valid()) {
+        current_decision_.k = network->k;
+        current_decision_.m = network->m;
+        current_decision_.redundancy_rate = network->redundancy_rate;
+    } else {
+        if (network) {
+            // 存储过期或损坏：这样的参数会让编码器构造失败，改用OCO的默认决策
+            LOG_WARN("Ignoring invalid warm-start coding parameters k=", network->k,
+                     ", m=", network->m, ", rate=", network->redundancy_rate);
+        }
+        current_decision_ = oco_controller_->compute_optimal_redundancy();
+    }
+    apply_coding_params_locked();
+    
+    return seeded.size();
+}
+
+PathLiveness MPQUICFECController::get_path_liveness(uint32_t path_id) const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return path_scheduler_->get_path_liveness(path_id);
+}
+
+std::pair<uint32_t, uint32_t> MPQUICFECController::get_coding_params(uint64_t stream_id) const {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    return stream_for(stream_id).group_manager->get_coding_params();
+}
+
+MPQUICFECController::StreamContext* MPQUICFECController::find_stream(uint64_t stream_id) const {
+    if (stream_id < kFlatStreamIds) {
+        int32_t slot = flat_stream_slots_[stream_id];
+        return slot >= 0 ? streams_[slot].get() : nullptr;
+    }
+    
+    auto it = stream_slots_.find(stream_id);
+    return it != stream_slots_.end() ? streams_[it->second].get() : nullptr;
+}
+
+MPQUICFECController::StreamContext& MPQUICFECController::stream_for(uint64_t stream_id) const {
+    StreamContext* stream = find_stream(stream_id);
+    if (!stream) {
+        throw std::invalid_argument("FEC stream " + std::to_string(stream_id) + " is not open");
+    }
+    return *stream;
+}
+
+std::pair<uint32_t, uint32_t> MPQUICFECController::class_coding_params(
+    TrafficClass traffic_class, const RedundancyDecision& base) {
+    
+    double rate = base.k > 0 ? static_cast<double>(base.m) / base.k : 0.5;
+    
+    switch (traffic_class) {
+        case TrafficClass::INTERACTIVE: {
+            // 小组：最多等待4个包即可编码；冗余率提高50%弥补小组的统计劣势
+            uint32_t k = std::max<uint32_t>(1, std::min<uint32_t>(4, base.k / 2));
+            uint32_t m = std::max<uint32_t>(1, static_cast<uint32_t>(std::ceil(k * rate * 1.5)));
+            return {k, std::min(m, kMaxFECBlocks - k)};
+        }
+        case TrafficClass::BULK: {
+            // 大组：同样冗余率下可容忍更长的突发丢包
+            uint32_t k = std::min<uint32_t>(32, base.k * 2);
+            uint32_t m = std::max<uint32_t>(1, static_cast<uint32_t>(std::ceil(k * rate)));
+            return {k, std::min(m, kMaxFECBlocks - k)};
+        }
+        case TrafficClass::STREAMING:
+        default:
+            return {base.k, base.m};
+    }
+}
+
+void MPQUICFECController::flush_groups_locked(StreamContext& stream,
+                                              std::vector<SendPacketMeta>& out_packets) {
+    std::vector<FECFrame> fec_frames;
+    if (!stream.send_hook->flush(fec_frames)) {
+        return;
+    }
+    
+    for (const auto& frame : fec_frames) {
+        if (frame.is_source_frame() && frame.header.block_index == 0) {
+            stats_.fec_groups_created++;
+        }
+    }
+    assign_packets_to_paths(fec_frames, out_packets);
+}
+
 std::vector<std::vector<uint8_t>> MPQUICFECController::receive_fec_frame(
-    const FECFrame& frame, uint32_t from_path_id [[maybe_unused]]) {
+    const FECFrame& frame, uint32_t from_path_id) {
     
-    std::lock_guard<std::mutex> lock(mutex_);
+    MPQUIC_FEC_STAGE_SCOPE(Stage::RECV_FRAME_INGEST);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     
     // 调用接收Hook进行解码
-    auto recovered = receive_hook_->on_frame_received(frame);
+    auto decoded = receive_hook_->on_frame_received(frame);
     
-    if (!recovered.empty()) {
-        stats_.packets_recovered += recovered.size();
-        LOG_INFO("Recovered ", recovered.size(), " packets from FEC decoding");
+    if (!decoded.empty()) {
+        auto recv_stats = receive_hook_->get_statistics();
+        uint64_t recovered = recv_stats.blocks_recovered - stats_.packets_recovered;
+        if (recovered > 0) {
+            LOG_DEBUG("Recovered ", recovered, " packets in group ", frame.header.group_id);
+        }
+        trace_event(TraceEventType::GROUP_DECODED, frame.header.group_id, from_path_id,
+                    recovered, 0, static_cast<uint8_t>(decoded.size()),
+                    static_cast<uint8_t>(frame.header.total_blocks - decoded.size()));
+        stats_.packets_recovered = recv_stats.blocks_recovered;
+        stats_.groups_decoded = recv_stats.groups_decoded;
+        
+        // 接收窗口只保留该流最近的组
+        uint64_t group_id = frame.header.group_id;
+        if (group_sequence(group_id) > 1000) {
+            receive_hook_->cleanup_old_groups(
+                group_id - 1000, make_stream_group_id(group_stream_slot(group_id), 0));
+        }
     }
     
-    return recovered;
+    enforce_memory_budgets_locked();
+    
+    return decoded;
 }
 
 void MPQUICFECController::on_ack_received(uint32_t path_id, uint64_t packet_number, 
                                          uint64_t rtt_us) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     
     // 查找包映射
     auto mapping = pkt_mapper_->find_by_packet(path_id, packet_number);
@@ -152,6 +551,16 @@ void MPQUICFECController::on_ack_received(uint32_t path_id, uint64_t packet_numb
     if (mapping) {
         LOG_DEBUG("ACK received: Path ", path_id, ", Pkt ", packet_number,
                   ", Group ", mapping->group_id, ", RTT ", rtt_us / 1000.0, "ms");
+        trace_event(TraceEventType::PACKET_ACKED, mapping->group_id, path_id, rtt_us,
+                    static_cast<uint8_t>(mapping->block_index), 0, 0,
+                    mapping->is_repair ? kTraceRepair : 0);
+    }
+    
+    // 路径活性：更新平滑RTT，清除静默；已退出调度的路径恢复
+    path_scheduler_->on_packet_acked(path_id, rtt_us, Clock::now_us());
+    auto path_frames = in_flight_.find(path_id);
+    if (path_frames != in_flight_.end()) {
+        path_frames->second.erase(packet_number);
     }
     
     // 反馈到OCO控制器
@@ -159,14 +568,17 @@ void MPQUICFECController::on_ack_received(uint32_t path_id, uint64_t packet_numb
 }
 
 void MPQUICFECController::on_packet_lost(uint32_t path_id, uint64_t packet_number) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     
     auto mapping = pkt_mapper_->find_by_packet(path_id, packet_number);
     
     if (mapping) {
-        LOG_INFO("Packet lost: Path ", path_id, ", Pkt ", packet_number,
-                 ", Group ", mapping->group_id, 
-                 ", Type ", (mapping->is_repair ? "REPAIR" : "SOURCE"));
+        LOG_DEBUG("Packet lost: Path ", path_id, ", Pkt ", packet_number,
+                  ", Group ", mapping->group_id, 
+                  ", Type ", (mapping->is_repair ? "REPAIR" : "SOURCE"));
+        trace_event(TraceEventType::PACKET_LOST, mapping->group_id, path_id, packet_number,
+                    static_cast<uint8_t>(mapping->block_index), 0, 0,
+                    mapping->is_repair ? kTraceRepair : 0);
         
         // 如果是源包丢失，可能需要从修复包恢复
         if (!mapping->is_repair) {
@@ -176,43 +588,74 @@ void MPQUICFECController::on_packet_lost(uint32_t path_id, uint64_t packet_numbe
 }
 
 void MPQUICFECController::periodic_update() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    
+    uint64_t now = Clock::now_us();
+    
+    // 活性检查需要RTT级的响应，不受下面的100ms间隔限制
+    check_path_liveness_locked(now);
     
-    uint64_t now = get_timestamp_us();
     uint64_t elapsed_ms = (now - last_update_time_us_) / 1000;
     
     if (elapsed_ms < 100) {
         return;  // 至少间隔100ms
     }
     
-    // 步骤1：OCO决策更新
+    // 步骤1：检查内存预算（决定本轮是否降冗余），再做OCO决策更新
+    enforce_memory_budgets_locked();
     update_fec_parameters();
     
-    // 步骤2：刷新未完成的编码组
-    auto flushed = group_manager_->flush_pending_groups();
+    // 步骤2：刷新各流未完成的编码组，产生的包由pop_pending_packets()取出
+    size_t pending_before = pending_packets_.size();
+    for (auto& stream : streams_) {
+        flush_groups_locked(*stream, pending_packets_);
+    }
     
-    // 步骤3：清理过期映射
-    if (stats_.fec_groups_created > 1000) {
-        uint64_t cleanup_before = stats_.fec_groups_created - 500;
-        pkt_mapper_->cleanup_old_mappings(cleanup_before);
-        group_manager_->cleanup_old_groups(cleanup_before);
+    // 步骤3：按流清理过期映射
+    for (auto& stream : streams_) {
+        uint64_t next_id = stream->group_manager->next_group_id();
+        if (group_sequence(next_id) > 1000) {
+            uint64_t cleanup_before = next_id - 500;
+            pkt_mapper_->cleanup_old_mappings(cleanup_before,
+                                              make_stream_group_id(stream->slot, 0));
+            stream->group_manager->cleanup_old_groups(cleanup_before);
+        }
     }
     
     last_update_time_us_ = now;
     
-    LOG_DEBUG("Periodic update completed, flushed ", flushed.size(), " groups");
+    LOG_DEBUG("Periodic update completed, ", pending_packets_.size() - pending_before,
+              " packets flushed");
+}
+
+void MPQUICFECController::set_redundancy_degraded(bool degraded) {
+    std::lock_guard<ProfiledMutex> lock(mutex_);
+    if (redundancy_degraded_ == degraded) {
+        return;
+    }
+    
+    redundancy_degraded_ = degraded;
+    apply_coding_params_locked();
+    
+    if (degraded) {
+        LOG_WARN("Send backlog, reducing redundancy");
+    } else {
+        LOG_INFO("Send backlog cleared, restoring redundancy");
+    }
 }
 
 void MPQUICFECController::set_fec_enabled(bool enabled) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     fec_enabled_ = enabled;
-    send_hook_->set_fec_enabled(enabled);
+    for (auto& stream : streams_) {
+        stream->send_hook->set_fec_enabled(enabled);
+    }
     
     LOG_INFO("FEC ", (enabled ? "enabled" : "disabled"));
 }
 
 void MPQUICFECController::set_fec_strategy(AdaptiveFECStrategy::Strategy strategy) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<ProfiledMutex> lock(mutex_);
     
     // 根据策略调整冗余率约束
     auto [min_rate, max_rate] = fec_strategy_->get_strategy_redundancy_range(strategy);
@@ -225,70 +668,300 @@ void MPQUICFECController::set_fec_strategy(AdaptiveFECStrategy::Strategy strateg
 void MPQUICFECController::update_fec_parameters() {
     // 调用OCO控制器计算最优冗余度
     current_decision_ = oco_controller_->compute_optimal_redundancy();
+    apply_coding_params_locked();
+}
+
+void MPQUICFECController::apply_coding_params_locked() {
+    stats_.current_redundancy_rate = current_decision_.redundancy_rate;
+    
+    // 按各流的流量类别更新编码组管理器的参数
+    for (auto& stream : streams_) {
+        auto [k, m] = class_coding_params(stream->traffic_class, current_decision_);
+        if (memory_pressure_ || redundancy_degraded_) {
+            // 内存超预算或发送积压：冗余块减半，减少编码缓存和冗余帧的占用
+            m = std::max<uint32_t>(1, m / 2);
+        }
+        auto [current_k, current_m] = stream->group_manager->get_coding_params();
+        
+        if (current_k != k || current_m != m) {
+            // 以旧参数完成当前组后再切换
+            flush_groups_locked(*stream, pending_packets_);
+            stream->group_manager->update_coding_params(k, m);
+            
+            LOG_INFO("Updated FEC parameters of stream ", stream->stream_id, ": k=", k,
+                     ", m=", m, " (redundancy=", current_decision_.redundancy_rate * 100, "%)");
+            trace_event(TraceEventType::PARAMS_UPDATED, stream->slot, 0,
+                        static_cast<uint64_t>(current_decision_.redundancy_rate * 1e6), 0,
+                        static_cast<uint8_t>(k), static_cast<uint8_t>(m));
+        }
+    }
+}
+
+void MPQUICFECController::enforce_memory_budgets_locked() {
+    // 快速路径：未超预算时只有几次relaxed读
+    uint64_t total_excess = memory_account_->total_excess();
+    bool tag_excess = false;
+    for (size_t i = 0; i < kMemoryTagCount; ++i) {
+        tag_excess = tag_excess || memory_account_->excess(static_cast<MemoryTag>(i)) > 0;
+    }
+    
+    if (total_excess == 0 && !tag_excess) {
+        uint64_t total_budget = memory_account_->total_budget();
+        if (memory_pressure_ &&
+            (total_budget == 0 || memory_account_->total() < total_budget / 4 * 3)) {
+            memory_pressure_ = false;
+            LOG_INFO("Memory usage back under budget, restoring redundancy");
+            apply_coding_params_locked();
+        }
+        return;
+    }
     
-    // 更新编码组管理器的参数
-    auto [current_k, current_m] = group_manager_->get_coding_params();
+    // 多驱逐预算的1/8作为回差，避免每个包都触发一次驱逐
+    auto evict = [this](MemoryTag tag, size_t bytes) -> size_t {
+        switch (tag) {
+            case MemoryTag::RECEIVE_GROUPS:
+                return receive_hook_->evict_oldest(bytes);
+            case MemoryTag::PACKET_MAPPING:
+                return pkt_mapper_->evict_oldest(bytes);
+            case MemoryTag::ENCODE_GROUPS: {
+                size_t freed = 0;
+                for (auto& stream : streams_) {
+                    if (freed >= bytes) break;
+                    freed += stream->group_manager->evict_oldest(bytes - freed);
+                }
+                return freed;
+            }
+            case MemoryTag::DECODERS:
+                return receive_hook_->evict_decoders();
+            default:
+                return 0;
+        }
+    };
+    
+    uint64_t freed = 0;
+    for (size_t i = 0; i < kMemoryTagCount; ++i) {
+        auto tag = static_cast<MemoryTag>(i);
+        uint64_t excess = memory_account_->excess(tag);
+        if (excess > 0) {
+            freed += evict(tag, excess + memory_account_->budget(tag) / 8);
+        }
+    }
     
-    if (current_k != current_decision_.k || current_m != current_decision_.m) {
-        group_manager_->update_coding_params(current_decision_.k, current_decision_.m);
-        stats_.current_redundancy_rate = current_decision_.redundancy_rate;
+    total_excess = memory_account_->total_excess();
+    if (total_excess > 0) {
+        uint64_t target = total_excess + memory_account_->total_budget() / 8;
+        for (auto tag : {MemoryTag::RECEIVE_GROUPS, MemoryTag::PACKET_MAPPING,
+                         MemoryTag::ENCODE_GROUPS, MemoryTag::DECODERS}) {
+            uint64_t tag_freed = evict(tag, target);
+            freed += tag_freed;
+            target -= std::min(target, tag_freed);
+            if (target == 0) break;
+        }
         
-        LOG_INFO("Updated FEC parameters: k=", current_decision_.k, 
-                 ", m=", current_decision_.m,
-                 " (redundancy=", current_decision_.redundancy_rate * 100, "%)");
+        if (!memory_pressure_) {
+            memory_pressure_ = true;
+            LOG_WARN("Memory budget exceeded by ", total_excess,
+                     " bytes, evicting caches and reducing redundancy");
+            // 立即切换参数，不等下一次periodic_update，此后完成的组即按减半的m编码
+            apply_coding_params_locked();
+        }
     }
+    
+    stats_.memory_evicted_bytes += freed;
 }
 
 void MPQUICFECController::assign_packets_to_paths(const std::vector<FECFrame>& frames,
                                                   std::vector<SendPacketMeta>& out_packets) {
     // 获取路径选择
-    uint32_t source_path = path_scheduler_->select_source_path(block_size_);
-    uint32_t repair_path = path_scheduler_->select_repair_path(source_path, block_size_);
+    uint32_t source_path;
+    uint32_t repair_path;
+    {
+        MPQUIC_FEC_STAGE_SCOPE(Stage::SEND_PATH_SELECT);
+        source_path = path_scheduler_->select_source_path(block_size_);
+        repair_path = path_scheduler_->select_repair_path(source_path, block_size_);
+        
+        if (source_path != last_source_path_) {
+            if (last_source_path_ != std::numeric_limits<uint32_t>::max()) {
+                trace_event(TraceEventType::PATH_SWITCH, 0, source_path, last_source_path_);
+            }
+            last_source_path_ = source_path;
+        }
+    }
     
+    MPQUIC_FEC_STAGE_SCOPE(Stage::SEND_PN_MAPPING);
+    // 同一批帧共用一个发送时刻
+    uint64_t send_time_us = Clock::now_us();
     for (const auto& frame : frames) {
-        SendPacketMeta meta;
-        meta.frame = frame;
-        meta.send_time_us = get_timestamp_us();
-        
         // 根据帧类型选择路径
         if (frame.is_source_frame()) {
-            meta.path_id = source_path;
-            meta.is_repair = false;
-            meta.packet_number = get_next_packet_number(source_path);
-            stats_.source_packets_sent++;
+            emit_packet_locked(frame, source_path, false, send_time_us, out_packets);
         } else {
-            meta.path_id = repair_path;
-            meta.is_repair = true;
-            meta.packet_number = get_next_packet_number(repair_path);
-            stats_.repair_packets_sent++;
+            emit_packet_locked(frame, repair_path, true, send_time_us, out_packets);
+        }
+    }
+    
+    LOG_DEBUG("Assigned ", frames.size(), " packets: ",
+              "Source -> Path ", source_path, ", Repair -> Path ", repair_path);
+}
+
+void MPQUICFECController::emit_packet_locked(const FECFrame& frame, uint32_t path_id,
+                                             bool is_repair, uint64_t send_time_us,
+                                             std::vector<SendPacketMeta>& out_packets) {
+    SendPacketMeta meta;
+    meta.frame = frame;
+    meta.send_time_us = send_time_us;
+    meta.path_id = path_id;
+    meta.is_repair = is_repair;
+    meta.packet_number = get_next_packet_number(path_id);
+    
+    if (is_repair) {
+        stats_.repair_packets_sent++;
+    } else {
+        stats_.source_packets_sent++;
+    }
+    stats_.total_packets_sent++;
+    
+    // 记录包号映射
+    pkt_mapper_->add_mapping(
+        frame.header.group_id,
+        frame.header.block_index,
+        meta.path_id,
+        meta.packet_number,
+        meta.is_repair
+    );
+    
+    // 记录在途块，路径失效时据此补发
+    path_scheduler_->on_packet_sent(path_id, send_time_us);
+    if (path_scheduler_->is_liveness_monitored()) {
+        auto& path_frames = in_flight_[path_id];
+        path_frames[meta.packet_number] = {frame.header.group_id, frame.header.block_index,
+                                           frame.header.source_blocks, is_repair, send_time_us};
+        if (path_frames.size() > kMaxInFlightFrames) {
+            path_frames.erase(path_frames.begin());
+        }
+    }
+    
+    trace_event(TraceEventType::PACKET_SENT, frame.header.group_id, meta.path_id,
+                meta.packet_number, static_cast<uint8_t>(frame.header.block_index),
+                static_cast<uint8_t>(frame.header.source_blocks),
+                static_cast<uint8_t>(frame.header.total_blocks - frame.header.source_blocks),
+                meta.is_repair ? kTraceRepair : 0);
+    
+    out_packets.push_back(std::move(meta));
+}
+
+void MPQUICFECController::check_path_liveness_locked(uint64_t now_us) {
+    if (!path_scheduler_->is_liveness_monitored()) {
+        return;  // 传输层没有ACK反馈
+    }
+    
+    auto check = path_scheduler_->check_liveness(now_us);
+    for (uint32_t path_id : check.failed_paths) {
+        stats_.path_failures++;
+        reroute_in_flight_locked(path_id, now_us);
+    }
+    
+    // 探测包：在静默路径上重发其最近的未应答块，收到应答即恢复调度
+    for (uint32_t path_id : check.probe_paths) {
+        auto path_frames = in_flight_.find(path_id);
+        if (path_frames == in_flight_.end()) {
+            continue;
         }
         
-        stats_.total_packets_sent++;
+        for (auto it = path_frames->second.rbegin(); it != path_frames->second.rend(); ++it) {
+            FECFrame frame;
+            if (rebuild_frame_locked(it->second.group_id, it->second.block_index, frame)) {
+                emit_packet_locked(frame, path_id, it->second.is_repair, now_us, pending_packets_);
+                stats_.probe_packets_sent++;
+                break;
+            }
+        }
+    }
+}
+
+void MPQUICFECController::reroute_in_flight_locked(uint32_t failed_path, uint64_t now_us) {
+    auto path_frames = in_flight_.find(failed_path);
+    if (path_frames == in_flight_.end() || path_frames->second.empty()) {
+        return;
+    }
+    const auto& unacked = path_frames->second;
+    
+    // 只补发最近两个PTO内发出的块；更早的未应答块属于普通丢包，由FEC自身处理
+    uint64_t window_us = 2 * path_scheduler_->get_pto_us(failed_path);
+    uint64_t since_us = now_us > window_us ? now_us - window_us : 0;
+    
+    std::map<uint64_t, std::vector<InFlightFrame>> lost_by_group;
+    for (const auto& [packet_number, frame] : unacked) {
+        if (frame.send_time_us >= since_us) {
+            lost_by_group[frame.group_id].push_back(frame);
+        }
+    }
+    if (lost_by_group.empty()) {
+        return;
+    }
+    
+    uint32_t source_path = path_scheduler_->select_source_path(block_size_);
+    if (!path_scheduler_->is_path_available(source_path)) {
+        LOG_WARN("Path ", failed_path, " failed with no surviving path, ",
+                 lost_by_group.size(), " groups left to FEC");
+        return;
+    }
+    uint32_t repair_path = path_scheduler_->select_repair_path(source_path, block_size_);
+    
+    size_t rerouted = 0;
+    for (auto& [group_id, lost] : lost_by_group) {
+        // 预计仍能送达的块：其他可用路径上的块，以及失效路径上已应答的块
+        std::set<uint32_t> reachable;
+        for (const auto& mapping : pkt_mapper_->find_by_group(group_id)) {
+            bool delivered = mapping.path_id == failed_path
+                                 ? unacked.count(mapping.packet_number) == 0
+                                 : path_scheduler_->is_path_available(mapping.path_id);
+            if (delivered) {
+                reachable.insert(mapping.block_index);
+            }
+        }
         
-        // 记录包号映射
-        pkt_mapper_->add_mapping(
-            frame.header.group_id,
-            frame.header.block_index,
-            meta.path_id,
-            meta.packet_number,
-            meta.is_repair
-        );
+        uint32_t k = lost.front().source_blocks;
+        size_t missing = k > reachable.size() ? k - reachable.size() : 0;
         
-        out_packets.push_back(meta);
+        // 优先补发冗余块：任意m个冗余块都能顶替同样数量的源块
+        std::stable_partition(lost.begin(), lost.end(),
+                              [](const InFlightFrame& frame) { return frame.is_repair; });
+        for (const auto& block : lost) {
+            if (missing == 0) break;
+            if (!reachable.insert(block.block_index).second) {
+                continue;
+            }
+            
+            FECFrame frame;
+            if (!rebuild_frame_locked(group_id, block.block_index, frame)) {
+                break;  // 组已被清理
+            }
+            emit_packet_locked(frame, block.is_repair ? repair_path : source_path,
+                               block.is_repair, now_us, pending_packets_);
+            --missing;
+            ++rerouted;
+        }
     }
     
-    LOG_DEBUG("Assigned ", frames.size(), " packets: ",
-              "Source -> Path ", source_path, ", Repair -> Path ", repair_path);
+    stats_.reroute_packets_sent += rerouted;
+    
+    LOG_INFO("Rerouted ", rerouted, " blocks of ", lost_by_group.size(),
+             " groups in flight on failed path ", failed_path, " to paths ", source_path,
+             "/", repair_path);
 }
 
-uint64_t MPQUICFECController::get_next_packet_number(uint32_t path_id) {
-    return next_packet_numbers_[path_id]++;
+bool MPQUICFECController::rebuild_frame_locked(uint64_t group_id, uint32_t block_index,
+                                               FECFrame& out_frame) {
+    uint32_t slot = group_stream_slot(group_id);
+    if (slot >= streams_.size()) {
+        return false;
+    }
+    return streams_[slot]->send_hook->rebuild_frame(group_id, block_index, out_frame);
 }
 
-uint64_t MPQUICFECController::get_timestamp_us() const {
-    auto now = std::chrono::steady_clock::now();
-    auto duration = now.time_since_epoch();
-    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+uint64_t MPQUICFECController::get_next_packet_number(uint32_t path_id) {
+    return next_packet_numbers_[path_id]++;
 }
 
 void MPQUICFECController::update_statistics(const std::vector<SendPacketMeta>& packets) {
@@ -120,14 +120,14 @@ RedundancyDecision OCORedundancyController::compute_optimal_redundancy() {
     const auto& repair_metrics = link_metrics_[decision.repair_path];
     double cost = compute_cost(k, m, source_metrics, repair_metrics);
     
-    LOG_INFO("OCO Decision: k=", k, ", m=", m, ", redundancy=", 
-             decision.redundancy_rate * 100, "%, cost=", cost);
-    LOG_INFO("  Source Path: ", decision.source_path, 
-             " (RTT=", source_metrics.rtt_ms, "ms, Loss=", 
-             source_metrics.loss_rate * 100, "%)");
-    LOG_INFO("  Repair Path: ", decision.repair_path,
-             " (correlation=", correlation_matrix_.get_correlation(
-                 decision.source_path, decision.repair_path), ")");
+    LOG_DEBUG("OCO Decision: k=", k, ", m=", m, ", redundancy=", 
+              decision.redundancy_rate * 100, "%, cost=", cost);
+    LOG_DEBUG("  Source Path: ", decision.source_path, 
+              " (RTT=", source_metrics.rtt_ms, "ms, Loss=", 
+              source_metrics.loss_rate * 100, "%)");
+    LOG_DEBUG("  Repair Path: ", decision.repair_path,
+              " (correlation=", correlation_matrix_.get_correlation(
+                  decision.source_path, decision.repair_path), ")");
     
     return decision;
 }
@@ -184,6 +184,19 @@ std::vector<LinkMetrics> OCORedundancyController::get_all_metrics() const {
     return result;
 }
 
+double OCORedundancyController::get_loss_correlation(uint32_t path_i, uint32_t path_j) const {
+    return correlation_matrix_.get_correlation(path_i, path_j);
+}
+
+double OCORedundancyController::get_gradient_accumulator(uint32_t path_id) const {
+    auto it = gradient_accumulator_.find(path_id);
+    return it != gradient_accumulator_.end() ? it->second : 0.0;
+}
+
+void OCORedundancyController::set_gradient_accumulator(uint32_t path_id, double value) {
+    gradient_accumulator_[path_id] = value;
+}
+
 double OCORedundancyController::compute_cost(uint32_t k, uint32_t m,
                                              const LinkMetrics& source_metrics,
                                              const LinkMetrics& repair_metrics) const {
@@ -338,13 +351,13 @@ AdaptiveFECStrategy::Strategy AdaptiveFECStrategy::select_strategy(
     
     // 根据丢包率选择策略
     if (max_loss > aggressive_loss_threshold_) {
-        LOG_INFO("Selected AGGRESSIVE strategy (max_loss=", max_loss * 100, "%)");
+        LOG_DEBUG("Selected AGGRESSIVE strategy (max_loss=", max_loss * 100, "%)");
         return Strategy::AGGRESSIVE;
     } else if (avg_loss < conservative_loss_threshold_) {
-        LOG_INFO("Selected CONSERVATIVE strategy (avg_loss=", avg_loss * 100, "%)");
+        LOG_DEBUG("Selected CONSERVATIVE strategy (avg_loss=", avg_loss * 100, "%)");
         return Strategy::CONSERVATIVE;
     } else {
-        LOG_INFO("Selected BALANCED strategy (avg_loss=", avg_loss * 100, "%)");
+        LOG_DEBUG("Selected BALANCED strategy (avg_loss=", avg_loss * 100, "%)");
         return Strategy::BALANCED;
     }
 }
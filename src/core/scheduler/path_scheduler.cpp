@@ -33,13 +33,15 @@ uint32_t PathScheduler::select_path(uint32_t packet_size) {
         throw std::runtime_error("No paths available");
     }
 
-    // 使用加权随机选择
+    // 使用加权随机选择（有可用路径时跳过不可用路径）
+    bool available_only = has_available_path();
     std::vector<uint32_t> path_ids;
     std::vector<double> cumulative_weights;
     double sum = 0.0;
 
     for (const auto& [path_id, weight] : weights_) {
-        if (paths_.find(path_id) != paths_.end()) {
+        if (paths_.find(path_id) != paths_.end() &&
+            (!available_only || is_path_available(path_id))) {
             path_ids.push_back(path_id);
             sum += weight;
             cumulative_weights.push_back(sum);
@@ -73,10 +75,15 @@ uint32_t PathScheduler::select_source_path(uint32_t packet_size) {
     }
     
     // 为源包选择最优路径：优先考虑低RTT和低丢包率
+    bool available_only = has_available_path();
     uint32_t best_path = paths_.begin()->first;
     double best_score = -1e9;
     
     for (const auto& [path_id, state] : paths_) {
+        if (available_only && !is_path_available(path_id)) {
+            continue;
+        }
+        
         // 评分：低RTT + 低丢包率 + 高带宽
         double score = -0.4 * state.rtt_ms                   // RTT权重更高
                       -0.5 * state.loss_rate * 1000
@@ -101,18 +108,12 @@ uint32_t PathScheduler::select_repair_path(uint32_t source_path_id, uint32_t pac
         return paths_.begin()->first;  // 只有一条路径
     }
     
-    // 策略：选择与源路径相关性最低的路径
-    uint32_t repair_path = find_least_correlated_path(source_path_id);
+    // 策略：选择与源路径相关性最低的可用路径
+    uint32_t repair_path = find_least_correlated_path(source_path_id, true);
     
-    // 如果找到的路径与源路径相同（只有一条路径），则返回源路径
-    if (repair_path == source_path_id && paths_.size() > 1) {
-        // 选择除源路径外的第一条可用路径
-        for (const auto& [path_id, _] : paths_) {
-            if (path_id != source_path_id) {
-                repair_path = path_id;
-                break;
-            }
-        }
+    // 除源路径外没有可用路径：源路径可用时随源包发送，否则退回到任一其他路径
+    if (repair_path == source_path_id && !is_path_available(source_path_id)) {
+        repair_path = find_least_correlated_path(source_path_id, false);
     }
     
     double correlation = get_path_correlation(source_path_id, repair_path);
@@ -145,11 +146,138 @@ bool PathScheduler::is_path_available(uint32_t path_id) const {
         return false;
     }
     
+    // ACK静默的路径在重新收到ACK之前不参与调度
+    auto live = liveness_.find(path_id);
+    if (live != liveness_.end() && live->second.status != PathLiveness::ALIVE) {
+        return false;
+    }
+    
     // 检查路径是否处于可用状态（丢包率不太高，带宽充足）
     const auto& state = it->second;
     return state.loss_rate < 0.5 && state.bandwidth_mbps > 0.1;
 }
 
+bool PathScheduler::has_available_path() const {
+    for (const auto& [path_id, _] : paths_) {
+        if (is_path_available(path_id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PathScheduler::on_packet_sent(uint32_t path_id, uint64_t now_us) {
+    if (!liveness_monitored_) {
+        return;
+    }
+    
+    // 满时保留最早的发送时刻（静默从它算起）
+    auto& state = liveness_[path_id];
+    if (state.unacked_send_us.size() < kMaxTrackedSends) {
+        state.unacked_send_us.push_back(now_us);
+    }
+}
+
+bool PathScheduler::on_packet_acked(uint32_t path_id, uint64_t rtt_us, uint64_t now_us) {
+    liveness_monitored_ = true;
+    auto& state = liveness_[path_id];
+    
+    // RFC 9002 平滑RTT
+    if (!state.rtt_sampled) {
+        state.srtt_us = rtt_us;
+        state.rttvar_us = rtt_us / 2;
+        state.rtt_sampled = true;
+    } else {
+        uint64_t deviation = state.srtt_us > rtt_us ? state.srtt_us - rtt_us
+                                                    : rtt_us - state.srtt_us;
+        state.rttvar_us = (3 * state.rttvar_us + deviation) / 4;
+        state.srtt_us = (7 * state.srtt_us + rtt_us) / 8;
+    }
+    state.last_ack_us = now_us;
+    
+    // 该包发出之前的在途包已应答或已丢失，都不再代表路径静默
+    uint64_t acked_send_us = now_us > rtt_us ? now_us - rtt_us : 0;
+    while (!state.unacked_send_us.empty() && state.unacked_send_us.front() <= acked_send_us) {
+        state.unacked_send_us.pop_front();
+    }
+    
+    if (state.status == PathLiveness::ALIVE) {
+        return false;
+    }
+    
+    LOG_INFO("Path ", path_id, " acknowledged again after ", state.probe_count,
+             " probes, back in scheduling");
+    state.status = PathLiveness::ALIVE;
+    state.probe_count = 0;
+    return true;
+}
+
+LivenessCheck PathScheduler::check_liveness(uint64_t now_us) {
+    LivenessCheck result;
+    
+    for (auto& [path_id, state] : liveness_) {
+        if (paths_.find(path_id) == paths_.end() || state.unacked_send_us.empty()) {
+            continue;  // 空闲路径没有可判定的静默
+        }
+        
+        uint64_t pto = pto_us(path_id, state);
+        
+        if (state.status == PathLiveness::ALIVE) {
+            uint64_t silent_since = std::max(state.unacked_send_us.front(), state.last_ack_us);
+            if (now_us < silent_since + pto) {
+                continue;
+            }
+            
+            state.status = PathLiveness::PROBING;
+            state.probe_count = 1;
+            state.last_probe_us = now_us;
+            result.failed_paths.push_back(path_id);
+            result.probe_paths.push_back(path_id);
+            LOG_WARN("Path ", path_id, " silent for ", (now_us - silent_since) / 1000.0,
+                     "ms (PTO ", pto / 1000.0, "ms), removed from scheduling");
+            continue;
+        }
+        
+        uint64_t backoff = pto << std::min(state.probe_count, kMaxProbeBackoff);
+        if (now_us < state.last_probe_us + backoff) {
+            continue;
+        }
+        
+        if (state.status == PathLiveness::PROBING && state.probe_count >= kMaxProbes) {
+            state.status = PathLiveness::DEAD;
+            LOG_WARN("Path ", path_id, " declared dead after ", state.probe_count,
+                     " unanswered probes");
+        }
+        state.probe_count++;
+        state.last_probe_us = now_us;
+        result.probe_paths.push_back(path_id);
+    }
+    
+    return result;
+}
+
+PathLiveness PathScheduler::get_path_liveness(uint32_t path_id) const {
+    auto it = liveness_.find(path_id);
+    return it != liveness_.end() ? it->second.status : PathLiveness::ALIVE;
+}
+
+uint64_t PathScheduler::get_pto_us(uint32_t path_id) const {
+    auto it = liveness_.find(path_id);
+    return pto_us(path_id, it != liveness_.end() ? it->second : LivenessState());
+}
+
+uint64_t PathScheduler::pto_us(uint32_t path_id, const LivenessState& state) const {
+    uint64_t srtt = state.srtt_us;
+    uint64_t rttvar = state.rttvar_us;
+    if (!state.rtt_sampled) {
+        auto path = paths_.find(path_id);
+        srtt = path != paths_.end() && path->second.rtt_ms > 0
+                   ? static_cast<uint64_t>(path->second.rtt_ms * 1000.0) : kInitialRttUs;
+        rttvar = srtt / 2;
+    }
+    return srtt + std::max(4 * rttvar, kTimerGranularityUs) + kMaxAckDelayUs;
+}
+
 double PathScheduler::get_path_correlation(uint32_t path_i, uint32_t path_j) const {
     if (path_i == path_j) {
         return 1.0;  // 自相关
@@ -164,7 +292,7 @@ double PathScheduler::get_path_correlation(uint32_t path_i, uint32_t path_j) con
     return 0.0;  // 默认假设独立
 }
 
-uint32_t PathScheduler::find_least_correlated_path(uint32_t path_id) const {
+uint32_t PathScheduler::find_least_correlated_path(uint32_t path_id, bool available_only) const {
     if (paths_.size() <= 1) {
         return path_id;
     }
@@ -173,7 +301,7 @@ uint32_t PathScheduler::find_least_correlated_path(uint32_t path_id) const {
     uint32_t best_path = path_id;
     
     for (const auto& [candidate_id, _] : paths_) {
-        if (candidate_id == path_id) {
+        if (candidate_id == path_id || (available_only && !is_path_available(candidate_id))) {
             continue;
         }
         
@@ -191,6 +319,29 @@ std::map<uint32_t, double> PathScheduler::get_path_weights() const {
     return weights_;
 }
 
+void PathScheduler::set_path_weight(uint32_t path_id, double weight) {
+    if (weights_.find(path_id) == weights_.end()) {
+        return;
+    }
+    if (weights_.size() == 1) {
+        weights_[path_id] = 1.0;
+        return;
+    }
+
+    weight = std::max(0.001, std::min(0.999, weight));
+    double others = 0.0;
+    for (const auto& [id, w] : weights_) {
+        if (id != path_id) {
+            others += w;
+        }
+    }
+    for (auto& [id, w] : weights_) {
+        w = id == path_id ? weight : w * (1.0 - weight) / std::max(0.001, others);
+    }
+
+    LOG_DEBUG("Path ", path_id, " weight set to ", weight);
+}
+
 std::vector<PathState> PathScheduler::get_all_paths() const {
     std::vector<PathState> result;
     for (const auto& [_, state] : paths_) {
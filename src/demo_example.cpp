@@ -62,6 +62,7 @@ void demo_fec_encoding() {
     auto recovered = decoder.decode(received_blocks, block_ids);
     LOG_INFO("成功恢复 ", recovered.size(), " 个数据块");
     
+    Logger::instance().flush();
     std::cout << std::endl;
 }
 
@@ -126,6 +127,7 @@ void demo_path_scheduling() {
         LOG_INFO("  路径 ", path_id, ": ", weight * 100, "%");
     }
     
+    Logger::instance().flush();
     std::cout << std::endl;
 }
 
@@ -151,6 +153,19 @@ void demo_buffer_management() {
     pool.release(std::move(buffer2));
     LOG_INFO("缓冲区已归还到池中");
     
+    // 稳态收发：缓冲区在线程本地弹匣中循环，不再触发堆分配
+    pool.reserve(1400, 64);
+    auto before = pool.get_statistics();
+    for (int i = 0; i < 10000; ++i) {
+        auto packet = pool.acquire(1400);
+        packet.write(test_data.data(), test_data.size());
+        pool.release(std::move(packet));
+    }
+    auto after = pool.get_statistics();
+    LOG_INFO("稳态10000次获取/归还的堆分配次数: ",
+             after.heap_allocations - before.heap_allocations);
+    
+    Logger::instance().flush();
     std::cout << std::endl;
 }
 
@@ -230,6 +245,7 @@ void demo_integrated_scenario() {
         LOG_WARN("✗ 数据丢失过多，无法完全恢复");
     }
     
+    Logger::instance().flush();
     std::cout << std::endl;
 }
 
@@ -1,4 +1,5 @@
 #include "mpquic_fec_controller.hpp"
+#include "clock.hpp"
 #include "logger.hpp"
 #include <iostream>
 #include <thread>
@@ -11,6 +12,7 @@ using namespace mpquic_fec;
  * @brief 打印系统Banner
  */
 void print_banner() {
+    Logger::instance().flush();
     std::cout << "\n";
     std::cout << "╔══════════════════════════════════════════════════════════════╗\n";
     std::cout << "║         MP-QUIC FEC 系统 - 动态融合机制演示                 ║\n";
@@ -70,6 +72,7 @@ void simulate_5g_environment(MPQUICFECController& controller) {
     controller.update_loss_correlation(1, 2, 0.03);
     
     LOG_INFO("✓ 路径相关性已配置");
+    Logger::instance().flush();
     std::cout << std::endl;
 }
 
@@ -109,6 +112,7 @@ void demo_integrated_fec_flow(MPQUICFECController& controller) {
         }
     }
     
+    Logger::instance().flush();
     std::cout << std::endl;
 }
 
@@ -118,6 +122,10 @@ void demo_integrated_fec_flow(MPQUICFECController& controller) {
 void demo_dynamic_redundancy(MPQUICFECController& controller) {
     LOG_INFO("========== 演示: 动态冗余调整 (OCO) ==========");
     
+    // 用虚拟时钟推进时间：periodic_update的100ms间隔不依赖真实等待，每次运行结果一致
+    auto virtual_clock = std::make_shared<VirtualClock>(Clock::now_us());
+    Clock::set_source(virtual_clock);
+    
     // 场景1: 链路质量恶化
     LOG_INFO("\n>>> 场景1: 路径1 丢包率上升 (3% -> 15%)");
     PathState path1_degraded;
@@ -129,13 +137,14 @@ void demo_dynamic_redundancy(MPQUICFECController& controller) {
     controller.update_path_state(path1_degraded);
     
     // 触发周期性更新，让OCO重新计算
+    virtual_clock->advance(200000);
     controller.periodic_update();
     
     // 发送数据观察冗余度变化
     std::vector<uint8_t> test_data(1200, 0xAA);
     auto packets1 = controller.send_stream_data(test_data);
     
-    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    virtual_clock->advance(200000);
     
     // 场景2: 链路质量恢复
     LOG_INFO("\n>>> 场景2: 路径1 丢包率恢复 (15% -> 2%)");
@@ -151,6 +160,9 @@ void demo_dynamic_redundancy(MPQUICFECController& controller) {
     
     auto packets2 = controller.send_stream_data(test_data);
     
+    Clock::set_source(nullptr);
+    
+    Logger::instance().flush();
     std::cout << std::endl;
 }
 
@@ -174,6 +186,7 @@ void demo_cross_path_redundancy() {
     LOG_INFO("         冗余包 -> 路径2 (Wi-Fi) [相关性=0.03]");
     LOG_INFO("         原因: 避免路径0 (与mmWave相关性0.4)");
     
+    Logger::instance().flush();
     std::cout << std::endl;
 }
 
@@ -203,6 +216,7 @@ void demo_fec_recovery(MPQUICFECController& controller) {
     LOG_INFO("  ✓ 使用ISA-L解码器恢复丢失的源包");
     LOG_INFO("  ✓ 成功恢复完整数据流");
     
+    Logger::instance().flush();
     std::cout << std::endl;
 }
 
@@ -212,6 +226,7 @@ void demo_fec_recovery(MPQUICFECController& controller) {
 void show_statistics(const MPQUICFECController& controller) {
     auto stats = controller.get_statistics();
     
+    Logger::instance().flush();
     std::cout << "\n";
     std::cout << "┌─────────────────────────────────────────────────────────┐\n";
     std::cout << "│                    系统统计信息                         │\n";
@@ -272,6 +287,7 @@ int main() {
         LOG_INFO("  4. 跨路径调度: 基于相关性分配Source/Repair");
         LOG_INFO("  5. 包号映射: 解决多路径独立空间问题");
         
+        Logger::instance().flush();
         std::cout << "\n✓ 系统运行正常，所有模块集成成功！\n" << std::endl;
         
     } catch (const std::exception& e) {
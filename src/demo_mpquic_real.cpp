@@ -1,9 +1,17 @@
 #include "mpquic_manager.hpp"
 #include "logger.hpp"
+#include "event_trace.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace mpquic_fec;
 
@@ -17,7 +25,7 @@ using namespace mpquic_fec;
  * 4. 展示路径调度和冗余恢复
  */
 
-void run_client_demo() {
+void run_client_demo(const std::string& trace_file = "") {
     LOG_INFO("========== MPQUIC Client Demo ==========");
     
     // 创建MPQUIC管理器（使用模拟QUIC）
@@ -44,10 +52,35 @@ void run_client_demo() {
         LOG_INFO("Added path 3 (模拟5G链路3)");
     }
     
+    // 可选：所有路径回放同一条链路Trace
+    if (!trace_file.empty()) {
+        for (PathID path_id : {PathID(0), path2, path3}) {
+            if (path_id != static_cast<PathID>(-1)) {
+                manager.attach_path_trace(path_id, trace_file);
+            }
+        }
+    }
+    
     // 配置FEC参数
     manager.configure_fec(8, 4, 1024);  // 8个数据块，4个冗余块
     manager.enable_fec(true);
     
+    // 可选：开启指标端点，curl --unix-socket $MPQUIC_FEC_METRICS_SOCKET http://localhost/metrics
+    if (const char* metrics_socket = std::getenv("MPQUIC_FEC_METRICS_SOCKET")) {
+        manager.enable_metrics_endpoint(metrics_socket);
+    }
+    
+    // 可选：保存/恢复路径模型，第二次运行时从上次学到的状态开始
+    if (const char* warm_state = std::getenv("MPQUIC_FEC_WARM_START")) {
+        manager.enable_warm_start(warm_state);
+    }
+    
+    // 模拟连接把发出的帧回送给本端，可直接观察解码结果
+    manager.set_data_received_callback([](const std::vector<uint8_t>& data) {
+        std::string message(data.begin(), data.end());
+        LOG_INFO("[Client] Decoded message (", data.size(), " bytes): \"", message, "\"");
+    });
+    
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
     
     // 准备测试数据
@@ -72,7 +105,9 @@ void run_client_demo() {
     }
     
     // 等待传输完成
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    for (int i = 0; i < 10; ++i) {
+        manager.process_events(50);
+    }
     
     // 更新路径指标
     manager.update_path_metrics();
@@ -165,20 +200,146 @@ void run_integrated_demo() {
     LOG_INFO("=================================================");
 }
 
+/**
+ * @brief 共享内存生产者进程：把消息就地写入入口环，再从出口环读回解码结果
+ */
+void run_shm_producer(int control_socket) {
+    auto ingress = ShmRing::receive(control_socket);
+    auto egress = ShmRing::receive(control_socket);
+    close(control_socket);
+    
+    std::vector<std::string> messages = {
+        "Frame 1: keyframe header",
+        std::string(3000, 'V'),           // 跨多个槽位的大消息
+        "Frame 3: delta update",
+    };
+    
+    for (const auto& message : messages) {
+        size_t offset = 0;
+        do {
+            if (!ingress->wait_for_space(1000)) {
+                LOG_ERROR("[Producer] Ingress ring stayed full");
+                return;
+            }
+            // 直接写进共享内存槽位，不经过本进程的中间缓冲区
+            uint8_t* slot = ingress->try_reserve();
+            size_t chunk = std::min(ingress->slot_size(), message.size() - offset);
+            std::memcpy(slot, message.data() + offset, chunk);
+            
+            uint32_t flags = 0;
+            if (offset == 0) flags |= kRingMessageStart;
+            if (offset + chunk == message.size()) flags |= kRingMessageEnd;
+            ingress->commit(static_cast<uint32_t>(chunk), 0, flags);
+            offset += chunk;
+        } while (offset < message.size());
+    }
+    LOG_INFO("[Producer] Wrote ", messages.size(), " messages into the ingress ring");
+    
+    // 出口环：按首尾标记拼回消息
+    size_t matched = 0;
+    size_t received = 0;
+    std::string current;
+    ShmRingEntry entry;
+    while (received < messages.size() && egress->wait_for_data(3000)) {
+        while (egress->peek(entry)) {
+            if (entry.flags & kRingMessageStart) {
+                current.clear();
+            }
+            current.append(reinterpret_cast<const char*>(entry.data), entry.length);
+            if (entry.flags & kRingMessageEnd) {
+                matched += current == messages[received] ? 1 : 0;
+                ++received;
+            }
+            egress->release();
+        }
+    }
+    
+    LOG_INFO("[Producer] Read back ", received, "/", messages.size(), " messages from the egress ring, ",
+             matched, " intact");
+}
+
+/**
+ * @brief 共享内存入口/出口演示：生产者在独立进程中，经memfd环与FEC引擎交换数据
+ */
+void run_shm_demo(const char* self_path) {
+    LOG_INFO("========== Shared-Memory Ingress Demo ==========");
+    
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+        LOG_ERROR("socketpair failed: ", std::strerror(errno));
+        return;
+    }
+    
+    MPQUICManager manager(false);
+    if (!manager.connect_as_client("127.0.0.1", 4433)) {
+        LOG_ERROR("Failed to connect to server");
+        return;
+    }
+    manager.add_path("0.0.0.0", 12346, "127.0.0.1", 4434);
+    manager.configure_fec(8, 4, 1024);
+    manager.enable_fec(true);
+    
+    // 入口槽位 = FEC块负载，4字节headroom留给块头
+    auto ingress = std::shared_ptr<ShmRing>(ShmRing::create(64, 1024 - 4, 4));
+    auto egress = std::shared_ptr<ShmRing>(ShmRing::create(64, 1024));
+    manager.attach_ingress_ring(ingress);
+    manager.attach_egress_ring(egress);
+    
+    // 以新程序启动生产者（fork后只调用exec，避免在多线程进程的子进程里做其他事）
+    pid_t pid = fork();
+    if (pid == 0) {
+        int child_socket = dup(sockets[1]);   // dup不带CLOEXEC，可跨exec保留
+        std::string fd_arg = std::to_string(child_socket);
+        execl(self_path, self_path, "shm-producer", fd_arg.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    close(sockets[1]);
+    if (pid < 0) {
+        LOG_ERROR("fork failed: ", std::strerror(errno));
+        close(sockets[0]);
+        return;
+    }
+    
+    ingress->send_fds(sockets[0]);
+    egress->send_fds(sockets[0]);
+    close(sockets[0]);
+    
+    int status = 0;
+    for (int i = 0; i < 200 && waitpid(pid, &status, WNOHANG) == 0; ++i) {
+        manager.process_events(20);
+    }
+    
+    LOG_INFO("\n", manager.get_statistics());
+    manager.close();
+    
+    LOG_INFO("\n========== Shared-Memory Demo Completed ==========");
+}
+
 int main(int argc, char* argv[]) {
     // 设置日志级别
     Logger::instance().set_level(LogLevel::INFO);
     
+    // 设置 MPQUIC_FEC_EVENT_TRACE=文件 时记录二进制事件，用 trace2qlog 转换
+    EventTracer::instance().start_from_env();
+    
     std::string mode = "integrated";
+    std::string trace_file;
     
     if (argc > 1) {
         mode = argv[1];
     }
+    if (argc > 2) {
+        trace_file = argv[2];
+    }
     
     if (mode == "client") {
-        run_client_demo();
+        run_client_demo(trace_file);
     } else if (mode == "server") {
         run_server_demo();
+    } else if (mode == "shm") {
+        run_shm_demo(argv[0]);
+    } else if (mode == "shm-producer" && argc > 2) {
+        run_shm_producer(std::atoi(argv[2]));
     } else {
         run_integrated_demo();
     }
@@ -0,0 +1,555 @@
+#include "loss_model.hpp"
+#include "trace_replay.hpp"
+#include "logger.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mpquic_fec;
+
+/**
+ * @brief 用户态多路径损伤代理（无需root和tc/netem）
+ *
+ * 每条路径监听一个本地UDP端口，把报文转发到目标地址，
+ * 回程报文按最近一次来源地址送回客户端。两个方向各由一个线程处理，
+ * 独立施加时延、抖动、限速、Gilbert-Elliott丢包和乱序；
+ * 收发使用 recvmmsg/sendmmsg 批量系统调用，报文存放在预分配槽位中
+ *
+ * 用法：
+ *   mpquic_netem_proxy --path 9001:127.0.0.1:4433,delay=20,loss=0.02,burst=3 \
+ *                      --path 9002:127.0.0.1:4434,trace=experiments/traces/5g.csv
+ */
+
+namespace {
+
+constexpr size_t kBatchSize = 64;          // 每次系统调用的最大报文数
+constexpr size_t kSlotSize = 2048;         // 单个报文槽位（覆盖常见MTU）
+constexpr size_t kSlotsPerLink = 16384;    // 每个方向的在途报文上限（32MB）
+
+std::atomic<bool> g_running{true};
+
+void handle_signal(int) {
+    g_running = false;
+}
+
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 单条路径的损伤配置
+ */
+struct PathConfig {
+    uint16_t listen_port = 0;
+    std::string target_host = "127.0.0.1";
+    uint16_t target_port = 0;
+    double delay_ms = 0;        // 单向传播时延
+    double jitter_ms = 0;       // 时延抖动（正态分布标准差）
+    double rate_mbps = 0;       // 限速，0表示不限
+    double loss = 0;            // 平均丢包率
+    double burst = 1;           // 平均突发丢包长度（1即Bernoulli）
+    double reorder = 0;         // 乱序概率
+    double reorder_ms = 5;      // 乱序包额外时延
+    double queue_ms = 200;      // 瓶颈队列容量（以排队时延计）
+    std::string trace;          // Trace文件（覆盖delay/loss/rate）
+};
+
+/**
+ * @brief 解析端口号，不在1~65535内时返回false
+ */
+bool parse_port(const std::string& text, uint16_t& port) {
+    int value = std::stoi(text);
+    if (value < 1 || value > 65535) return false;
+    port = static_cast<uint16_t>(value);
+    return true;
+}
+
+/**
+ * @brief 解析路径规格（数值字段不合法时由std::stoi/std::stod抛出）
+ */
+bool parse_path_fields(const std::string& spec, PathConfig& cfg) {
+    std::stringstream ss(spec);
+    std::string item;
+
+    if (!std::getline(ss, item, ',')) return false;
+
+    // listen_port:target_host:target_port
+    size_t c1 = item.find(':');
+    size_t c2 = item.rfind(':');
+    if (c1 == std::string::npos || c1 == c2) return false;
+    if (!parse_port(item.substr(0, c1), cfg.listen_port)) return false;
+    cfg.target_host = item.substr(c1 + 1, c2 - c1 - 1);
+    if (!parse_port(item.substr(c2 + 1), cfg.target_port)) return false;
+
+    while (std::getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+
+        if (key == "trace") { cfg.trace = value; continue; }
+
+        double v = std::stod(value);
+        if (key == "delay") cfg.delay_ms = v;
+        else if (key == "jitter") cfg.jitter_ms = v;
+        else if (key == "rate") cfg.rate_mbps = v;
+        else if (key == "loss") cfg.loss = v;
+        else if (key == "burst") cfg.burst = v;
+        else if (key == "reorder") cfg.reorder = v;
+        else if (key == "reorder_delay") cfg.reorder_ms = v;
+        else if (key == "queue") cfg.queue_ms = v;
+        else return false;
+    }
+    return true;
+}
+
+bool parse_path_config(const std::string& spec, PathConfig& cfg) {
+    try {
+        return parse_path_fields(spec, cfg);
+    } catch (const std::invalid_argument&) {
+        return false;   // 端口或数值不是数字
+    } catch (const std::out_of_range&) {
+        return false;
+    }
+}
+
+/**
+ * @brief 客户端地址（由正向线程学习，反向线程读取）
+ */
+struct PeerAddress {
+    std::atomic<uint64_t> packed{0};   // (ipv4 << 16) | port，网络字节序
+
+    void store(const sockaddr_in& addr) {
+        uint64_t v = (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port;
+        if (packed.load(std::memory_order_relaxed) != v) {
+            packed.store(v, std::memory_order_release);
+        }
+    }
+
+    bool load(sockaddr_in& addr) const {
+        uint64_t v = packed.load(std::memory_order_acquire);
+        if (v == 0) return false;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = static_cast<uint32_t>(v >> 16);
+        addr.sin_port = static_cast<uint16_t>(v & 0xFFFF);
+        return true;
+    }
+};
+
+/**
+ * @brief 单方向的统计计数
+ */
+struct LinkStats {
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> forwarded{0};
+    std::atomic<uint64_t> lost{0};           // 丢包模型丢弃
+    std::atomic<uint64_t> queue_dropped{0};  // 队列溢出丢弃
+    std::atomic<uint64_t> reordered{0};
+};
+
+/**
+ * @brief 单方向损伤链路
+ *
+ * 线程独占：报文槽位、调度堆和随机数发生器都不需要加锁
+ */
+class ImpairedLink {
+public:
+    ImpairedLink(std::string name, const PathConfig& cfg, int rx_fd, int tx_fd,
+                 PeerAddress* learn_peer, const PeerAddress* dest_peer,
+                 std::shared_ptr<LinkTrace> trace)
+        : name_(std::move(name)), cfg_(cfg), rx_fd_(rx_fd), tx_fd_(tx_fd),
+          learn_peer_(learn_peer), dest_peer_(dest_peer),
+          storage_(kSlotsPerLink * kSlotSize), lengths_(kSlotsPerLink, 0),
+          rng_(std::random_device{}()), link_free_ns_(0), seq_(0) {
+
+        free_slots_.reserve(kSlotsPerLink);
+        for (size_t i = kSlotsPerLink; i > 0; --i) {
+            free_slots_.push_back(static_cast<uint32_t>(i - 1));
+        }
+        if (trace) {
+            replayer_ = std::make_unique<TraceReplayer>(trace);
+        }
+        apply_config(cfg_.delay_ms, cfg_.loss, cfg_.rate_mbps);
+    }
+
+    void run() {
+        mmsghdr rx_msgs[kBatchSize];
+        iovec rx_iov[kBatchSize];
+        sockaddr_in rx_addr[kBatchSize];
+        uint32_t rx_slots[kBatchSize];
+
+        uint64_t start_ns = now_ns();
+        uint64_t next_trace_ns = start_ns;
+
+        while (g_running.load(std::memory_order_relaxed)) {
+            uint64_t now = now_ns();
+
+            // Trace回放：每10ms刷新一次链路参数
+            if (replayer_ && now >= next_trace_ns) {
+                const auto& s = replayer_->sample_at((now - start_ns) / 1e9);
+                apply_config(s.rtt_ms / 2.0, s.loss_rate, s.bandwidth_mbps);
+                next_trace_ns = now + 10'000'000;
+            }
+
+            // 1. 批量接收
+            size_t batch = std::min(kBatchSize, free_slots_.size());
+            for (size_t i = 0; i < batch; ++i) {
+                rx_slots[i] = free_slots_[free_slots_.size() - 1 - i];
+                rx_iov[i].iov_base = slot_data(rx_slots[i]);
+                rx_iov[i].iov_len = kSlotSize;
+                std::memset(&rx_msgs[i].msg_hdr, 0, sizeof(msghdr));
+                rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+                rx_msgs[i].msg_hdr.msg_iovlen = 1;
+                rx_msgs[i].msg_hdr.msg_name = &rx_addr[i];
+                rx_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            }
+
+            int n = batch > 0 ? ::recvmmsg(rx_fd_, rx_msgs, batch, MSG_DONTWAIT, nullptr) : 0;
+            if (n > 0) {
+                free_slots_.resize(free_slots_.size() - n);
+                stats.received.fetch_add(n, std::memory_order_relaxed);
+                if (learn_peer_) {
+                    learn_peer_->store(rx_addr[n - 1]);
+                }
+                for (int i = 0; i < n; ++i) {
+                    lengths_[rx_slots[i]] = static_cast<uint16_t>(rx_msgs[i].msg_len);
+                    schedule(rx_slots[i], rx_msgs[i].msg_len, now);
+                }
+            } else if (batch == 0) {
+                // 槽位耗尽：丢弃内核队列中的报文，保证代理本身不阻塞
+                char sink[kSlotSize];
+                while (::recv(rx_fd_, sink, sizeof(sink), MSG_DONTWAIT) > 0) {
+                    stats.queue_dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            // 2. 批量发送到期报文
+            flush_due(now_ns());
+
+            // 3. 没有新报文时等待：直到可读或下一个报文到期
+            if (n <= 0) {
+                wait_for_work();
+            }
+        }
+    }
+
+    LinkStats stats;
+    const std::string& name() const { return name_; }
+
+private:
+    struct Scheduled {
+        uint64_t due_ns;
+        uint64_t seq;     // 相同到期时间按接收顺序
+        uint32_t slot;
+
+        bool operator>(const Scheduled& other) const {
+            return due_ns != other.due_ns ? due_ns > other.due_ns : seq > other.seq;
+        }
+    };
+
+    std::string name_;
+    PathConfig cfg_;
+    int rx_fd_;
+    int tx_fd_;
+    PeerAddress* learn_peer_;
+    const PeerAddress* dest_peer_;
+
+    // 预分配报文槽位
+    std::vector<uint8_t> storage_;
+    std::vector<uint16_t> lengths_;
+    std::vector<uint32_t> free_slots_;
+
+    std::priority_queue<Scheduled, std::vector<Scheduled>, std::greater<Scheduled>> heap_;
+    std::unique_ptr<TraceReplayer> replayer_;
+    GilbertElliottModel loss_model_;
+    std::mt19937_64 rng_;
+
+    // 当前生效参数（纳秒）
+    uint64_t delay_ns_ = 0;
+    double ns_per_byte_ = 0;
+    uint64_t link_free_ns_;
+    uint64_t seq_;
+
+    uint8_t* slot_data(uint32_t slot) {
+        return storage_.data() + static_cast<size_t>(slot) * kSlotSize;
+    }
+
+    void apply_config(double delay_ms, double loss, double rate_mbps) {
+        delay_ns_ = static_cast<uint64_t>(delay_ms * 1e6);
+        ns_per_byte_ = rate_mbps > 0 ? 8000.0 / rate_mbps : 0.0;
+        loss_model_.set_loss_rate(loss, cfg_.burst);
+    }
+
+    void schedule(uint32_t slot, uint32_t len, uint64_t now) {
+        if (loss_model_.next_lost(rng_)) {
+            stats.lost.fetch_add(1, std::memory_order_relaxed);
+            free_slots_.push_back(slot);
+            return;
+        }
+
+        // 瓶颈链路：串行化排队，超过队列容量则尾部丢弃
+        uint64_t depart = now;
+        if (ns_per_byte_ > 0) {
+            depart = std::max(now, link_free_ns_);
+            if (depart - now > static_cast<uint64_t>(cfg_.queue_ms * 1e6)) {
+                stats.queue_dropped.fetch_add(1, std::memory_order_relaxed);
+                free_slots_.push_back(slot);
+                return;
+            }
+            link_free_ns_ = depart + static_cast<uint64_t>(len * ns_per_byte_);
+            depart = link_free_ns_;
+        }
+
+        double extra_ns = 0;
+        if (cfg_.jitter_ms > 0) {
+            std::normal_distribution<double> jitter(0.0, cfg_.jitter_ms * 1e6);
+            extra_ns += jitter(rng_);
+        }
+        if (cfg_.reorder > 0) {
+            std::uniform_real_distribution<double> dis(0.0, 1.0);
+            if (dis(rng_) < cfg_.reorder) {
+                extra_ns += cfg_.reorder_ms * 1e6;
+                stats.reordered.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        int64_t due = static_cast<int64_t>(depart + delay_ns_) + static_cast<int64_t>(extra_ns);
+        heap_.push({static_cast<uint64_t>(std::max<int64_t>(due, now)), seq_++, slot});
+    }
+
+    void flush_due(uint64_t now) {
+        mmsghdr tx_msgs[kBatchSize];
+        iovec tx_iov[kBatchSize];
+        uint32_t tx_slots[kBatchSize];
+
+        sockaddr_in dest;
+        bool has_dest = dest_peer_ && dest_peer_->load(dest);
+
+        while (!heap_.empty() && heap_.top().due_ns <= now) {
+            size_t count = 0;
+            while (count < kBatchSize && !heap_.empty() && heap_.top().due_ns <= now) {
+                uint32_t slot = heap_.top().slot;
+                heap_.pop();
+
+                // 反向链路尚未学习到客户端地址时无法投递
+                if (dest_peer_ && !has_dest) {
+                    free_slots_.push_back(slot);
+                    continue;
+                }
+
+                tx_slots[count] = slot;
+                tx_iov[count].iov_base = slot_data(slot);
+                tx_iov[count].iov_len = lengths_[slot];
+                std::memset(&tx_msgs[count].msg_hdr, 0, sizeof(msghdr));
+                tx_msgs[count].msg_hdr.msg_iov = &tx_iov[count];
+                tx_msgs[count].msg_hdr.msg_iovlen = 1;
+                if (has_dest) {
+                    tx_msgs[count].msg_hdr.msg_name = &dest;
+                    tx_msgs[count].msg_hdr.msg_namelen = sizeof(dest);
+                }
+                ++count;
+            }
+
+            size_t sent = 0;
+            while (sent < count) {
+                int r = ::sendmmsg(tx_fd_, tx_msgs + sent, count - sent, 0);
+                if (r <= 0) break;
+                sent += r;
+            }
+            stats.forwarded.fetch_add(sent, std::memory_order_relaxed);
+            stats.queue_dropped.fetch_add(count - sent, std::memory_order_relaxed);
+
+            for (size_t i = 0; i < count; ++i) {
+                free_slots_.push_back(tx_slots[i]);
+            }
+        }
+    }
+
+    void wait_for_work() {
+        timespec timeout;
+        timespec* timeout_ptr = &timeout;
+        uint64_t wait_ns = 100'000'000;  // 空闲时最多等待100ms以检查退出标志
+
+        if (!heap_.empty()) {
+            uint64_t now = now_ns();
+            uint64_t due = heap_.top().due_ns;
+            wait_ns = due > now ? std::min(wait_ns, due - now) : 0;
+        }
+        if (wait_ns == 0) {
+            return;
+        }
+        timeout.tv_sec = static_cast<time_t>(wait_ns / 1'000'000'000);
+        timeout.tv_nsec = static_cast<long>(wait_ns % 1'000'000'000);
+
+        pollfd pfd{rx_fd_, POLLIN, 0};
+        ::ppoll(&pfd, 1, timeout_ptr, nullptr);
+    }
+};
+
+int open_udp_socket() {
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+    int buf = 8 * 1024 * 1024;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof(buf));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+    return fd;
+}
+
+sockaddr_in make_address(const std::string& host, uint16_t port) {
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        throw std::runtime_error("Invalid IPv4 address: " + host);
+    }
+    return addr;
+}
+
+void print_usage(const char* prog) {
+    std::cout << "Usage: " << prog << " [--bind ADDR] [--stats SEC] --path SPEC [--path SPEC ...]\n"
+              << "  SPEC = listen_port:target_host:target_port[,key=value...]\n"
+              << "  keys: delay=ms jitter=ms rate=Mbps loss=0..1 burst=N\n"
+              << "        reorder=0..1 reorder_delay=ms queue=ms trace=FILE\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string bind_addr = "127.0.0.1";
+    int stats_interval_s = 1;
+    std::vector<PathConfig> configs;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--path" && i + 1 < argc) {
+            PathConfig cfg;
+            if (!parse_path_config(argv[++i], cfg)) {
+                LOG_ERROR("Invalid path spec: ", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+            configs.push_back(cfg);
+        } else if (arg == "--bind" && i + 1 < argc) {
+            bind_addr = argv[++i];
+        } else if (arg == "--stats" && i + 1 < argc) {
+            try {
+                stats_interval_s = std::stoi(argv[++i]);
+            } catch (const std::exception&) {
+                LOG_ERROR("Invalid stats interval: ", argv[i]);
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else {
+            print_usage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (configs.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+
+    std::vector<std::unique_ptr<PeerAddress>> peers;
+    std::vector<std::unique_ptr<ImpairedLink>> links;
+    std::vector<int> fds;
+
+    try {
+        for (size_t p = 0; p < configs.size(); ++p) {
+            const auto& cfg = configs[p];
+
+            int listen_fd = open_udp_socket();
+            sockaddr_in local = make_address(bind_addr, cfg.listen_port);
+            if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+                throw std::runtime_error("bind port " + std::to_string(cfg.listen_port) +
+                                         ": " + std::strerror(errno));
+            }
+
+            int upstream_fd = open_udp_socket();
+            sockaddr_in target = make_address(cfg.target_host, cfg.target_port);
+            if (::connect(upstream_fd, reinterpret_cast<sockaddr*>(&target), sizeof(target)) != 0) {
+                throw std::runtime_error(std::string("connect: ") + std::strerror(errno));
+            }
+            fds.push_back(listen_fd);
+            fds.push_back(upstream_fd);
+
+            std::shared_ptr<LinkTrace> trace;
+            if (!cfg.trace.empty()) {
+                trace = LinkTrace::open(cfg.trace);
+            }
+
+            peers.push_back(std::make_unique<PeerAddress>());
+            PeerAddress* client = peers.back().get();
+
+            std::string name = "path" + std::to_string(p);
+            links.push_back(std::make_unique<ImpairedLink>(
+                name + " up", cfg, listen_fd, upstream_fd, client, nullptr, trace));
+            links.push_back(std::make_unique<ImpairedLink>(
+                name + " down", cfg, upstream_fd, listen_fd, nullptr, client, trace));
+
+            LOG_INFO("Path ", p, ": ", bind_addr, ":", cfg.listen_port, " <-> ",
+                     cfg.target_host, ":", cfg.target_port,
+                     " (delay=", cfg.delay_ms, "ms, jitter=", cfg.jitter_ms,
+                     "ms, rate=", cfg.rate_mbps, "Mbps, loss=", cfg.loss * 100,
+                     "%, burst=", cfg.burst, ", reorder=", cfg.reorder * 100, "%",
+                     (cfg.trace.empty() ? "" : ", trace=" + cfg.trace), ")");
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Setup failed: ", e.what());
+        for (int fd : fds) ::close(fd);
+        return 1;
+    }
+
+    std::vector<std::thread> workers;
+    for (auto& link : links) {
+        workers.emplace_back([&link]() { link->run(); });
+    }
+
+    // 周期性输出统计
+    uint64_t tick = 0;
+    while (g_running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (stats_interval_s <= 0 || ++tick % (stats_interval_s * 10) != 0) {
+            continue;
+        }
+        for (const auto& link : links) {
+            LOG_INFO("[", link->name(), "] rx=", link->stats.received.load(),
+                     " tx=", link->stats.forwarded.load(),
+                     " lost=", link->stats.lost.load(),
+                     " qdrop=", link->stats.queue_dropped.load(),
+                     " reordered=", link->stats.reordered.load());
+        }
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (int fd : fds) {
+        ::close(fd);
+    }
+
+    LOG_INFO("Proxy stopped");
+    return 0;
+}
@@ -1,11 +1,16 @@
 #include "quic_connection.hpp"
 #include "logger.hpp"
+#include "trace_replay.hpp"
+#include "instrumented_mutex.hpp"
+#include "lockfree_ring.hpp"
+#include <algorithm>
 #include <thread>
 #include <chrono>
 #include <random>
 #include <sstream>
 #include <mutex>
 #include <map>
+#include <vector>
 
 namespace mpquic_fec {
 
@@ -14,18 +19,76 @@ namespace mpquic_fec {
  * 
  * 用于在没有真实liblsquic库的情况下进行开发和测试
  * 模拟多路径、丢包、延迟等网络特性
+ * 
+ * 发出的包回送给本端的接收回调（模拟对端接收）：发送线程把包推入
+ * 无锁交付队列，由 process_events() 在应用线程上批量取出，
+ * 按到达时刻排序后调用回调。设置了确认回调时，包到达后再过单向时延
+ * 报告确认；丢失的数据报在本应到达后同样时刻报告丢失
  */
 class MockQUICConnection : public IQUICConnection {
 private:
-    mutable std::mutex mutex_;
+    /**
+     * @brief 等待交付给接收回调的包
+     */
+    struct PendingDelivery {
+        enum class Kind { STREAM, DATAGRAM, ACK, LOSS };
+        
+        std::chrono::steady_clock::time_point deliver_at;
+        Kind kind = Kind::STREAM;
+        PathID path_id = 0;
+        StreamID stream_id = 0;
+        bool fin = false;
+        std::vector<uint8_t> data;
+        
+        // 确认反馈
+        uint64_t sequence = 0;
+        std::chrono::steady_clock::time_point sent_at;
+        std::chrono::microseconds ack_delay{0};   // 到达后多久发送方收到确认
+    };
+
+    // 按到达时刻排序的最小堆比较器
+    struct DeliverLater {
+        bool operator()(const PendingDelivery& a, const PendingDelivery& b) const {
+            return a.deliver_at > b.deliver_at;
+        }
+    };
+
+    static constexpr size_t kDeliveryRingCapacity = 65536;
+    static constexpr size_t kSendBufferBytes = 1 << 20;   // 每条路径的发送缓冲区
+    static constexpr size_t kDrainBatch = 256;
+
+    mutable ProfiledMutex mutex_{LockSite::MOCK_CONNECTION};
     QUICState state_;
     StreamID next_stream_id_;
     PathID next_path_id_;
     
+    // 传输统计
+    uint64_t stream_retransmissions_;
+    uint64_t datagrams_sent_;
+    uint64_t datagrams_lost_;
+    uint64_t send_buffer_full_;   // 因发送缓冲区满被拒绝的发送
+    
     std::map<PathID, QUICPathInfo> paths_;
     
+    // 按路径挂载的Trace回放器（未挂载的路径保持固定的随机特性）
+    std::map<PathID, std::unique_ptr<TraceReplayer>> path_traces_;
+    std::chrono::steady_clock::time_point trace_start_;
+    
+    // 链路串行化：每条路径上一个包发送完毕的时刻
+    std::map<PathID, std::chrono::steady_clock::time_point> link_free_at_;
+    
+    // 交付队列：任意发送线程写入，process_events()所在线程消费
+    LockFreeRing<PendingDelivery> delivery_ring_;
+    std::vector<PendingDelivery> delivery_heap_;   // 仅消费线程访问
+    uint64_t delivery_overflows_;
+    
+    // 每条路径的发送序号（确认回调按它标识包）
+    std::map<PathID, uint64_t> send_sequences_;
+    
     DataRecvCallback data_recv_callback_;
+    DatagramRecvCallback datagram_recv_callback_;
     StateChangeCallback state_change_callback_;
+    PacketAckCallback packet_ack_callback_;
     
     void change_state(QUICState new_state) {
         QUICState old_state = state_;
@@ -36,11 +99,107 @@ private:
         }
     }
 
+    /**
+     * @brief 按路径丢包率判定本次发送是否丢失
+     */
+    bool simulate_loss(const QUICPathInfo& path) {
+        static std::random_device rd;
+        static std::mt19937 gen(rd());
+        std::uniform_real_distribution<> dis(0.0, 1.0);
+        return dis(gen) < path.loss_rate;
+    }
+
+    /**
+     * @brief 计算包的到达时刻：带宽决定的串行化排队 + 单向时延（调用方需持有mutex_）
+     */
+    std::chrono::steady_clock::time_point schedule_arrival(PathID path_id,
+                                                           const QUICPathInfo& path,
+                                                           size_t bytes) {
+        auto now = std::chrono::steady_clock::now();
+        auto& free_at = link_free_at_[path_id];
+        
+        auto start = std::max(now, free_at);
+        int64_t tx_us = path.bandwidth_mbps > 0
+                            ? static_cast<int64_t>(bytes * 8 / path.bandwidth_mbps) : 0;
+        free_at = start + std::chrono::microseconds(tx_us);
+        
+        return free_at + std::chrono::microseconds(static_cast<int64_t>(path.rtt_ms * 500.0));
+    }
+
+    /**
+     * @brief 路径上排队等待串行化的字节数（调用方需持有mutex_）
+     */
+    size_t queued_bytes(PathID path_id, const QUICPathInfo& path) const {
+        auto it = link_free_at_.find(path_id);
+        if (it == link_free_at_.end() || path.bandwidth_mbps <= 0) {
+            return 0;
+        }
+        auto backlog = std::chrono::duration_cast<std::chrono::microseconds>(
+            it->second - std::chrono::steady_clock::now());
+        // Mbps即每微秒比特数
+        return backlog.count() > 0
+                   ? static_cast<size_t>(backlog.count() * path.bandwidth_mbps / 8) : 0;
+    }
+
+    /**
+     * @brief 发送缓冲区放不下时拒绝发送，与真实套接字的EAGAIN一致（调用方需持有mutex_）
+     */
+    bool send_buffer_full(PathID path_id, const QUICPathInfo& path, size_t bytes) {
+        if (queued_bytes(path_id, path) + bytes <= kSendBufferBytes) {
+            return false;
+        }
+        ++send_buffer_full_;
+        LOG_DEBUG("Send buffer of path ", path_id, " full (simulated)");
+        return true;
+    }
+
+    /**
+     * @brief 填写包的发送序号和确认时延（调用方需持有mutex_）
+     */
+    void stamp_send(PendingDelivery& delivery, const QUICPathInfo& path) {
+        delivery.sequence = ++send_sequences_[delivery.path_id];
+        delivery.sent_at = std::chrono::steady_clock::now();
+        delivery.ack_delay = std::chrono::microseconds(static_cast<int64_t>(path.rtt_ms * 500.0));
+    }
+
+    /**
+     * @brief 推入交付队列（调用方需持有mutex_）
+     */
+    void enqueue_delivery(PendingDelivery&& delivery) {
+        if (!delivery_ring_.try_push(std::move(delivery))) {
+            ++delivery_overflows_;
+            LOG_WARN("Delivery queue full, dropping packet (process_events not keeping up)");
+        }
+    }
+
+    /**
+     * @brief 按Trace刷新路径的网络特性（调用方需持有mutex_）
+     */
+    void apply_path_trace(PathID path_id, QUICPathInfo& path) {
+        auto it = path_traces_.find(path_id);
+        if (it == path_traces_.end()) {
+            return;
+        }
+
+        double elapsed_s = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - trace_start_).count();
+        const auto& sample = it->second->sample_at(elapsed_s);
+        path.rtt_ms = sample.rtt_ms;
+        path.loss_rate = sample.loss_rate;
+        path.bandwidth_mbps = sample.bandwidth_mbps;
+    }
+
 public:
     MockQUICConnection() 
         : state_(QUICState::IDLE),
           next_stream_id_(0),
-          next_path_id_(0) {
+          next_path_id_(0),
+          stream_retransmissions_(0),
+          datagrams_sent_(0),
+          datagrams_lost_(0),
+          send_buffer_full_(0),
+          delivery_ring_(kDeliveryRingCapacity),
+          delivery_overflows_(0) {
         LOG_INFO("MockQUICConnection created (simulated QUIC)");
     }
 
@@ -51,7 +210,7 @@ public:
     }
 
     bool connect(const std::string& host, uint16_t port) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         
         if (state_ != QUICState::IDLE) {
             LOG_ERROR("Cannot connect: connection not in IDLE state");
@@ -85,7 +244,7 @@ public:
     }
 
     bool listen(const std::string& bind_addr, uint16_t port) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         
         if (state_ != QUICState::IDLE) {
             LOG_ERROR("Cannot listen: connection not in IDLE state");
@@ -100,7 +259,7 @@ public:
     }
 
     StreamID create_stream() override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         
         if (state_ != QUICState::CONNECTED) {
             throw std::runtime_error("Cannot create stream: not connected");
@@ -128,7 +287,12 @@ public:
                         StreamID stream_id,
                         const std::vector<uint8_t>& data,
                         bool fin) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        return send_bytes_on_path(path_id, stream_id, data.data(), data.size(), fin);
+    }
+
+    size_t send_bytes_on_path(PathID path_id, StreamID stream_id,
+                              const uint8_t* data, size_t size, bool fin) override {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         
         if (state_ != QUICState::CONNECTED) {
             LOG_ERROR("Cannot send: not connected");
@@ -143,51 +307,114 @@ public:
 
         // 模拟网络传输
         auto& path = it->second;
-        
-        // 模拟丢包
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dis(0.0, 1.0);
-        
-        if (dis(gen) < path.loss_rate) {
-            LOG_WARN("Packet dropped on path ", path_id, " (simulated loss)");
-            return 0;  // 模拟丢包
+        apply_path_trace(path_id, path);
+        if (send_buffer_full(path_id, path, size)) {
+            return 0;
         }
-
-        // 模拟RTT延迟
-        int delay_ms = static_cast<int>(path.rtt_ms / 2);
-        if (delay_ms > 0) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+        
+        // 流是可靠的：丢失的包在超时后重传，表现为额外一个RTT（以及队头阻塞）
+        int64_t retransmit_delay_us = 0;
+        for (int attempt = 0; attempt < 8 && simulate_loss(path); ++attempt) {
+            retransmit_delay_us += static_cast<int64_t>(path.rtt_ms * 1000.0) + 10000;
+            ++stream_retransmissions_;
+            LOG_DEBUG("Stream packet lost on path ", path_id, ", retransmitting (simulated)");
         }
 
         // 更新统计
-        path.bytes_sent += data.size();
+        path.bytes_sent += size;
         
-        LOG_DEBUG("Sent ", data.size(), " bytes on stream ", stream_id, 
+        LOG_DEBUG("Sent ", size, " bytes on stream ", stream_id, 
                  " path ", path_id, " (simulated)");
         
-        // 模拟对端接收（触发回调）
-        if (data_recv_callback_) {
-            // 在真实实现中，这会在接收端触发
-            // 这里为了演示，延迟后触发
-            std::thread([this, stream_id, data, fin]() {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                if (data_recv_callback_) {
-                    data_recv_callback_(stream_id, data, fin);
-                }
-            }).detach();
+        // 模拟对端接收：由process_events()在到达时刻触发回调
+        PendingDelivery delivery;
+        delivery.deliver_at = schedule_arrival(path_id, path, size) +
+                              std::chrono::microseconds(retransmit_delay_us);
+        delivery.path_id = path_id;
+        delivery.stream_id = stream_id;
+        delivery.fin = fin;
+        delivery.data.assign(data, data + size);
+        stamp_send(delivery, path);
+        enqueue_delivery(std::move(delivery));
+        
+        return size;
+    }
+
+    bool supports_datagrams() const override {
+        return true;
+    }
+
+    size_t max_datagram_size() const override {
+        // 1500字节MTU减去IP/UDP/QUIC短包头及DATAGRAM帧头
+        return 1400;
+    }
+
+    size_t send_datagram_on_path(PathID path_id,
+                                 const std::vector<uint8_t>& data) override {
+        return send_datagram_bytes_on_path(path_id, data.data(), data.size());
+    }
+
+    size_t send_datagram_bytes_on_path(PathID path_id, const uint8_t* data,
+                                       size_t size) override {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        
+        if (state_ != QUICState::CONNECTED) {
+            LOG_ERROR("Cannot send datagram: not connected");
+            return 0;
+        }
+
+        if (size > max_datagram_size()) {
+            LOG_ERROR("Datagram too large: ", size, " > ", max_datagram_size());
+            return 0;
         }
+
+        auto it = paths_.find(path_id);
+        if (it == paths_.end()) {
+            LOG_ERROR("Path ", path_id, " not found");
+            return 0;
+        }
+
+        auto& path = it->second;
+        apply_path_trace(path_id, path);
+        if (send_buffer_full(path_id, path, size)) {
+            return 0;
+        }
+        
+        auto arrival = schedule_arrival(path_id, path, size);
+        path.bytes_sent += size;
+        ++datagrams_sent_;
+        
+        PendingDelivery delivery;
+        delivery.deliver_at = arrival;
+        delivery.kind = PendingDelivery::Kind::DATAGRAM;
+        delivery.path_id = path_id;
+        stamp_send(delivery, path);
+        
+        // 数据报不可靠：丢失后不重传，只在设置了确认回调时报告丢失
+        if (simulate_loss(path)) {
+            ++datagrams_lost_;
+            LOG_DEBUG("Datagram dropped on path ", path_id, " (simulated loss)");
+            if (packet_ack_callback_) {
+                delivery.kind = PendingDelivery::Kind::LOSS;
+                delivery.deliver_at += delivery.ack_delay;
+                enqueue_delivery(std::move(delivery));
+            }
+            return size;
+        }
+
+        delivery.data.assign(data, data + size);
+        enqueue_delivery(std::move(delivery));
         
-        return data.size();
+        return size;
     }
 
     void close_stream(StreamID stream_id) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         LOG_DEBUG("Closed stream ", stream_id, " (simulated)");
     }
 
     void close(uint32_t error_code, const std::string& reason) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         
         if (state_ == QUICState::CLOSED) {
             return;
@@ -205,21 +432,93 @@ public:
     }
 
     int process_events(int timeout_ms) override {
-        // 在模拟实现中，事件处理是自动的
-        // 真实实现中，这里会调用liblsquic的事件处理函数
+        // 真实实现中，这里会调用liblsquic的事件处理函数。
+        // 模拟实现：在timeout_ms内交付所有已到达的包，回调在调用线程上执行
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(std::max(timeout_ms, 0));
+        int events = 0;
+        
+        // 推进Trace回放，使get_paths()反映当前时刻的链路特性
+        DataRecvCallback data_cb;
+        DatagramRecvCallback datagram_cb;
+        PacketAckCallback ack_cb;
+        {
+            std::lock_guard<ProfiledMutex> lock(mutex_);
+            for (auto& [path_id, path] : paths_) {
+                apply_path_trace(path_id, path);
+            }
+            data_cb = data_recv_callback_;
+            datagram_cb = datagram_recv_callback_;
+            ack_cb = packet_ack_callback_;
+        }
         
-        if (timeout_ms > 0) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+        for (;;) {
+            // 批量取出新入队的包，放入按到达时刻排序的堆
+            while (delivery_ring_.drain([this](PendingDelivery&& delivery) {
+                       delivery_heap_.push_back(std::move(delivery));
+                       std::push_heap(delivery_heap_.begin(), delivery_heap_.end(),
+                                      DeliverLater());
+                   }, kDrainBatch) == kDrainBatch) {
+            }
+            
+            // 交付已到达的包（不持锁，回调中可以继续发送）
+            auto now = std::chrono::steady_clock::now();
+            while (!delivery_heap_.empty() && delivery_heap_.front().deliver_at <= now) {
+                std::pop_heap(delivery_heap_.begin(), delivery_heap_.end(), DeliverLater());
+                PendingDelivery delivery = std::move(delivery_heap_.back());
+                delivery_heap_.pop_back();
+                
+                using Kind = PendingDelivery::Kind;
+                switch (delivery.kind) {
+                    case Kind::STREAM:
+                        if (data_cb) data_cb(delivery.path_id, delivery.stream_id, delivery.data, delivery.fin);
+                        break;
+                    case Kind::DATAGRAM:
+                        if (datagram_cb) datagram_cb(delivery.path_id, delivery.data);
+                        break;
+                    case Kind::ACK: {
+                        auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(
+                            now - delivery.sent_at);
+                        if (ack_cb) ack_cb(delivery.path_id, delivery.sequence, true, rtt.count());
+                        break;
+                    }
+                    case Kind::LOSS:
+                        if (ack_cb) ack_cb(delivery.path_id, delivery.sequence, false, 0);
+                        break;
+                }
+                ++events;
+                
+                // 对端收到后回送确认
+                if (ack_cb && (delivery.kind == Kind::STREAM || delivery.kind == Kind::DATAGRAM)) {
+                    delivery.kind = Kind::ACK;
+                    delivery.deliver_at += delivery.ack_delay;
+                    delivery.data.clear();
+                    delivery_heap_.push_back(std::move(delivery));
+                    std::push_heap(delivery_heap_.begin(), delivery_heap_.end(), DeliverLater());
+                }
+            }
+            
+            if (now >= deadline) {
+                break;
+            }
+            
+            // 睡到下一个包到达或超时；最多1ms，以便取到其他线程新发送的包
+            auto wake = deadline;
+            if (!delivery_heap_.empty()) {
+                wake = std::min(wake, delivery_heap_.front().deliver_at);
+            }
+            wake = std::min(wake, now + std::chrono::milliseconds(1));
+            std::this_thread::sleep_until(wake);
         }
         
-        return 0;  // 返回处理的事件数
+        return events;  // 返回处理的事件数
     }
 
     PathID add_path(const std::string& local_addr,
                    uint16_t local_port,
                    const std::string& remote_addr,
                    uint16_t remote_port) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         
         if (state_ != QUICState::CONNECTED) {
             LOG_ERROR("Cannot add path: not connected");
@@ -253,17 +552,46 @@ public:
     }
 
     void remove_path(PathID path_id) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         
         auto it = paths_.find(path_id);
         if (it != paths_.end()) {
             paths_.erase(it);
+            path_traces_.erase(path_id);
             LOG_INFO("Removed path ", path_id);
         }
     }
 
+    bool set_path_trace(PathID path_id, const std::string& trace_file) override {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        
+        auto it = paths_.find(path_id);
+        if (it == paths_.end()) {
+            LOG_ERROR("Path ", path_id, " not found");
+            return false;
+        }
+
+        std::unique_ptr<TraceReplayer> replayer;
+        try {
+            replayer = std::make_unique<TraceReplayer>(LinkTrace::open(trace_file));
+        } catch (const std::exception& e) {
+            LOG_ERROR("Failed to load trace for path ", path_id, ": ", e.what());
+            return false;
+        }
+
+        // 所有路径共享同一时间原点，保证多路径回放同步
+        if (path_traces_.empty()) {
+            trace_start_ = std::chrono::steady_clock::now();
+        }
+        path_traces_[path_id] = std::move(replayer);
+        apply_path_trace(path_id, it->second);
+
+        LOG_INFO("Path ", path_id, " now replays trace ", trace_file);
+        return true;
+    }
+
     std::vector<QUICPathInfo> get_paths() const override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         
         std::vector<QUICPathInfo> result;
         for (const auto& [_, path] : paths_) {
@@ -273,26 +601,48 @@ public:
     }
 
     QUICState get_state() const override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         return state_;
     }
 
     void set_data_recv_callback(DataRecvCallback callback) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         data_recv_callback_ = callback;
     }
 
+    void set_datagram_recv_callback(DatagramRecvCallback callback) override {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        datagram_recv_callback_ = callback;
+    }
+
+    bool set_packet_ack_callback(PacketAckCallback callback) override {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        packet_ack_callback_ = callback;
+        return true;
+    }
+
+    size_t get_send_queue_bytes(PathID path_id) const override {
+        std::lock_guard<ProfiledMutex> lock(mutex_);
+        auto it = paths_.find(path_id);
+        return it != paths_.end() ? queued_bytes(path_id, it->second) : 0;
+    }
+
     void set_state_change_callback(StateChangeCallback callback) override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         state_change_callback_ = callback;
     }
 
     std::string get_stats() const override {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<ProfiledMutex> lock(mutex_);
         
         std::ostringstream oss;
         oss << "MockQUIC Connection Stats:\n";
         oss << "  State: " << static_cast<int>(state_) << "\n";
+        oss << "  Stream retransmissions: " << stream_retransmissions_ << "\n";
+        oss << "  Datagrams: sent=" << datagrams_sent_ << ", lost=" << datagrams_lost_ << "\n";
+        oss << "  Send buffer full: " << send_buffer_full_ << "\n";
+        oss << "  Pending deliveries: " << delivery_ring_.size_approx()
+            << " (overflows=" << delivery_overflows_ << ")\n";
         oss << "  Paths: " << paths_.size() << "\n";
         
         for (const auto& [path_id, path] : paths_) {
@@ -300,7 +650,8 @@ public:
                 << "sent=" << path.bytes_sent << " bytes, "
                 << "recv=" << path.bytes_received << " bytes, "
                 << "RTT=" << path.rtt_ms << "ms, "
-                << "Loss=" << (path.loss_rate * 100) << "%\n";
+                << "Loss=" << (path.loss_rate * 100) << "%"
+                << (path_traces_.count(path_id) ? " [trace]" : "") << "\n";
         }
         
         return oss.str();
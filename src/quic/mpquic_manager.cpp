@@ -1,36 +1,118 @@
 #include "mpquic_manager.hpp"
 #include "logger.hpp"
+#include "clock.hpp"
+#include "stage_timing.hpp"
 #include <algorithm>
+#include <cmath>
+#include <future>
+#include <stdexcept>
+#include <thread>
 
 namespace mpquic_fec {
 
+namespace {
+
+// FEC源块头：[u16 有效长度][u8 标志][u8 保留]
+constexpr size_t kBlockHeaderSize = 4;
+constexpr uint8_t kBlockFlagStart = 0x01;   // 消息首块
+constexpr uint8_t kBlockFlagEnd = 0x02;     // 消息尾块
+constexpr uint8_t kBlockFlagRecords = 0x04; // 合并块：数据为长度前缀记录，每条一条完整消息
+
+// 每条路径交给传输层、尚未发出的字节上限；其余留在本层的发送队列中，
+// 以便按策略丢弃，也不让传输层缓冲区里的时延无限增长
+constexpr size_t kTransportQueueBytes = 64 * 1024;
+
+// 队首组无法恢复时，最多等待的后续已解码组数
+constexpr size_t kMaxPendingGroups = 32;
+
+// 队首缺口的最长等待时间（覆盖流重传和路径间时延差）
+constexpr uint64_t kHeadOfLineTimeoutUs = 500000;
+
+// 每条路径最多登记的未确认包（传输层漏报确认时挤出最早的）
+constexpr size_t kMaxSentPacketsPerPath = 16384;
+
+// 流上单个帧的上限；超过时视为帧头损坏，接收缓冲区不再为其增长
+constexpr size_t kMaxStreamFrameBytes = 16 * 1024 * 1024;
+
+/**
+ * @brief 内部对数桶换算为固定的 64ns..67ms 二倍边界，便于跨抓取做rate()
+ */
+std::vector<std::pair<double, uint64_t>> fixed_duration_buckets(
+    const std::array<uint64_t, kStageHistogramBuckets>& counts, double ticks_per_ns) {
+    std::vector<std::pair<double, uint64_t>> buckets;
+    size_t next = 0;
+    uint64_t cumulative = 0;
+    for (int exp = 6; exp <= 26; ++exp) {
+        double le_ns = std::ldexp(1.0, exp);
+        while (next < counts.size() &&
+               StageTiming::bucket_upper(next) / ticks_per_ns <= le_ns) {
+            cumulative += counts[next++];
+        }
+        buckets.emplace_back(le_ns / 1e9, cumulative);
+    }
+    return buckets;
+}
+
+} // namespace
+
 MPQUICManager::MPQUICManager(bool use_real_quic)
     : quic_conn_(create_quic_connection(use_real_quic)),
       scheduler_(std::make_unique<PathScheduler>()),
       data_stream_(0),
       fec_enabled_(true),
+      fec_transport_mode_(FECTransportMode::STREAM),
       fec_k_(4),
       fec_m_(2),
       fec_block_size_(1024),
+      stream_classes_{TrafficClass::STREAMING},
+      quic_streams_{0},
+      quic_stream_created_{false},
+      coalesce_delay_us_(0),
       total_bytes_sent_(0),
       total_bytes_received_(0),
       fec_blocks_sent_(0),
       fec_blocks_recovered_(0) {
     
-    // 初始化FEC编码器/解码器
-    fec_encoder_ = std::make_unique<FECEncoder>(fec_k_, fec_m_, fec_block_size_);
-    fec_decoder_ = std::make_unique<FECDecoder>(fec_k_, fec_m_, fec_block_size_);
+    // 初始化FEC控制器（编码/解码/冗余决策）
+    reset_fec_controller();
     
     // 设置QUIC回调
     quic_conn_->set_data_recv_callback(
-        [this](StreamID stream_id, const std::vector<uint8_t>& data, bool fin) {
-            handle_received_data(stream_id, data, fin);
+        [this](PathID path_id, StreamID stream_id, const std::vector<uint8_t>& data,
+               bool fin) {
+            handle_received_data(path_id, stream_id, data, fin);
         }
     );
+    quic_conn_->set_datagram_recv_callback(
+        [this](PathID path_id, const std::vector<uint8_t>& data) {
+            handle_received_datagram(path_id, data);
+        }
+    );
+    packet_acks_ = quic_conn_->set_packet_ack_callback(
+        [this](PathID path_id, uint64_t sequence, bool acked, uint64_t rtt_us) {
+            handle_packet_ack(path_id, sequence, acked, rtt_us);
+        }
+    );
+    
+    // FEC自身提供可靠性，优先使用不可靠数据报承载
+    if (quic_conn_->supports_datagrams()) {
+        fec_transport_mode_ = FECTransportMode::DATAGRAM;
+    }
     
     LOG_INFO("MPQUICManager initialized with FEC(k=", fec_k_, ", m=", fec_m_, ")");
 }
 
+MPQUICManager::~MPQUICManager() {
+    {
+        std::lock_guard<std::mutex> lock(encode_mutex_);
+        encode_stop_ = true;
+    }
+    encode_cv_.notify_one();
+    if (encode_thread_.joinable()) {
+        encode_thread_.join();
+    }
+}
+
 bool MPQUICManager::connect_as_client(const std::string& host, uint16_t port) {
     LOG_INFO("Connecting to ", host, ":", port);
     
@@ -39,8 +121,16 @@ bool MPQUICManager::connect_as_client(const std::string& host, uint16_t port) {
         return false;
     }
 
-    // 创建数据流
+    // 创建数据流；连接前创建的应用流在此补建各自的QUIC流
     data_stream_ = quic_conn_->create_stream();
+    quic_streams_[0] = data_stream_;
+    quic_stream_created_[0] = true;
+    for (size_t i = 1; i < quic_streams_.size(); ++i) {
+        if (!quic_stream_created_[i]) {
+            quic_streams_[i] = quic_conn_->create_stream();
+            quic_stream_created_[i] = true;
+        }
+    }
     
     // 同步路径状态到调度器
     sync_path_states();
@@ -80,48 +170,154 @@ PathID MPQUICManager::add_path(const std::string& local_addr, uint16_t local_por
     return path_id;
 }
 
-bool MPQUICManager::send_data(const std::vector<uint8_t>& data, bool use_fec) {
-    if (data.empty()) {
-        LOG_WARN("Attempted to send empty data");
+bool MPQUICManager::attach_path_trace(PathID path_id, const std::string& trace_file) {
+    if (!quic_conn_->set_path_trace(path_id, trace_file)) {
+        LOG_WARN("Trace replay not available for path ", path_id);
         return false;
     }
 
-    if (use_fec && fec_enabled_) {
-        return send_with_fec(data);
+    sync_path_states();
+    return true;
+}
+
+StreamID MPQUICManager::create_stream(TrafficClass traffic_class) {
+    StreamID stream_id = stream_classes_.size();
+    fec_controller_->open_stream(stream_id, traffic_class);
+    
+    stream_classes_.push_back(traffic_class);
+    if (quic_conn_->get_state() == QUICState::CONNECTED) {
+        quic_streams_.push_back(quic_conn_->create_stream());
+        quic_stream_created_.push_back(true);
     } else {
-        return send_without_fec(data);
+        quic_streams_.push_back(data_stream_);
+        quic_stream_created_.push_back(false);
     }
+    
+    LOG_INFO("Created stream ", stream_id, " (QUIC stream ", quic_streams_.back(), ")");
+    return stream_id;
 }
 
-bool MPQUICManager::send_data_on_path(PathID path_id, 
-                                      const std::vector<uint8_t>& data) {
-    size_t sent = quic_conn_->send_on_path(path_id, data_stream_, data, false);
+bool MPQUICManager::send_data(const std::vector<uint8_t>& data, bool use_fec,
+                              StreamID stream_id) {
+    return send_message(data, use_fec, stream_id, true) == SendResult::SENT;
+}
+
+SendResult MPQUICManager::try_send(const std::vector<uint8_t>& data, bool use_fec,
+                                   StreamID stream_id) {
+    return send_message(data, use_fec, stream_id, false);
+}
+
+SendResult MPQUICManager::send_message(const std::vector<uint8_t>& data, bool use_fec,
+                                       StreamID stream_id, bool may_block) {
+    if (data.empty()) {
+        LOG_WARN("Attempted to send empty data");
+        return SendResult::FAILED;
+    }
     
-    if (sent > 0) {
-        total_bytes_sent_ += sent;
-        LOG_DEBUG("Sent ", sent, " bytes on path ", path_id);
-        return true;
+    if (stream_id >= stream_classes_.size()) {
+        LOG_ERROR("Stream ", stream_id, " does not exist");
+        return SendResult::FAILED;
+    }
+
+    if (!use_fec || !fec_enabled_) {
+        return send_without_fec(data, stream_id) ? SendResult::SENT : SendResult::FAILED;
     }
     
-    return false;
+    // 整条消息的队列空间在编码前一次获准：获准后各组都会发出，不会留下半条消息
+    size_t reserved = 0;
+    bool pace_groups = false;
+    if (!may_block || backpressure_policy_ == BackpressurePolicy::BLOCK) {
+        reserved = estimate_queued_bytes(data.size(), stream_id);
+        if (!reserve_send_queue(reserved, may_block)) {
+            if (!may_block) {
+                send_would_block_.fetch_add(1, std::memory_order_relaxed);
+                return SendResult::WOULD_BLOCK;
+            }
+            LOG_WARN("Send queue still full after ", block_timeout_ms_, "ms, dropping ",
+                     data.size(), " bytes on stream ", stream_id);
+            return SendResult::FAILED;
+        }
+        pace_groups = may_block && reserved > max_queued_bytes_;
+    }
+    
+    bool ok = send_with_fec(data, stream_id, reserved, pace_groups);
+    release_send_reservation(reserved);
+    return ok ? SendResult::SENT : SendResult::FAILED;
+}
+
+void MPQUICManager::set_backpressure(BackpressurePolicy policy, size_t max_queued_bytes,
+                                     int block_timeout_ms) {
+    if (max_queued_bytes == 0) {
+        throw std::invalid_argument("Send queue limit must be positive");
+    }
+    
+    {
+        std::lock_guard<ProfiledMutex> lock(send_mutex_);
+        backpressure_policy_ = policy;
+        max_queued_bytes_ = max_queued_bytes;
+        block_timeout_ms_ = std::max(block_timeout_ms, 0);
+        if (policy != BackpressurePolicy::BLOCK) {
+            trim_send_queues_locked();
+        }
+    }
+    // 上限或策略变化后，阻塞中的发送方按新配置重新判断
+    send_space_cv_.notify_all();
+    update_redundancy_degradation();
+    
+    LOG_INFO("Send queue limited to ", max_queued_bytes, " bytes, policy ",
+             static_cast<int>(policy));
+}
+
+bool MPQUICManager::send_data_on_path(PathID path_id, 
+                                      const std::vector<uint8_t>& data) {
+    return send_unprotected(path_id, 0, data);
 }
 
 void MPQUICManager::configure_fec(uint32_t k, uint32_t m, uint32_t block_size) {
+    if (block_size <= kBlockHeaderSize || block_size - kBlockHeaderSize > 0xFFFF) {
+        throw std::invalid_argument("FEC block size must be in (" +
+                                    std::to_string(kBlockHeaderSize) + ", " +
+                                    std::to_string(0xFFFF + kBlockHeaderSize) + "]");
+    }
+    
     fec_k_ = k;
     fec_m_ = m;
     fec_block_size_ = block_size;
     
-    fec_encoder_ = std::make_unique<FECEncoder>(k, m, block_size);
-    fec_decoder_ = std::make_unique<FECDecoder>(k, m, block_size);
+    reset_fec_controller();
     
     LOG_INFO("FEC reconfigured: k=", k, ", m=", m, ", block_size=", block_size);
 }
 
+void MPQUICManager::set_message_coalescing(uint32_t max_delay_us) {
+    flush_coalesced_messages(true);
+    {
+        std::lock_guard<ProfiledMutex> lock(coalesce_mutex_);
+        coalescers_.clear();
+        coalesce_delay_us_ = max_delay_us;
+    }
+    
+    LOG_INFO("Message coalescing ",
+             (max_delay_us > 0 ? "up to " + std::to_string(max_delay_us) + "us" : "disabled"));
+}
+
 void MPQUICManager::enable_fec(bool enable) {
     fec_enabled_ = enable;
     LOG_INFO("FEC ", (enable ? "enabled" : "disabled"));
 }
 
+void MPQUICManager::set_fec_transport_mode(FECTransportMode mode) {
+    if (mode == FECTransportMode::DATAGRAM && !quic_conn_->supports_datagrams()) {
+        LOG_WARN("Connection does not support DATAGRAM, FEC stays on streams");
+        fec_transport_mode_ = FECTransportMode::STREAM;
+        return;
+    }
+    
+    fec_transport_mode_ = mode;
+    LOG_INFO("FEC transport mode: ",
+             (mode == FECTransportMode::DATAGRAM ? "DATAGRAM" : "STREAM"));
+}
+
 void MPQUICManager::update_path_metrics() {
     sync_path_states();
 }
@@ -131,6 +327,11 @@ void MPQUICManager::set_data_received_callback(
     data_received_callback_ = callback;
 }
 
+void MPQUICManager::set_stream_data_received_callback(
+    std::function<void(StreamID, const std::vector<uint8_t>&)> callback) {
+    stream_data_received_callback_ = callback;
+}
+
 std::string MPQUICManager::get_statistics() const {
     std::ostringstream oss;
     oss << "=== MPQUIC Manager Statistics ===\n";
@@ -138,19 +339,308 @@ std::string MPQUICManager::get_statistics() const {
     oss << "Total bytes received: " << total_bytes_received_ << "\n";
     oss << "FEC blocks sent: " << fec_blocks_sent_ << "\n";
     oss << "FEC blocks recovered: " << fec_blocks_recovered_ << "\n";
+    auto fec_stats = fec_controller_->get_statistics();
+    oss << "FEC groups decoded: " << fec_stats.groups_decoded << "\n";
     oss << "FEC enabled: " << (fec_enabled_ ? "Yes" : "No") << "\n";
+    oss << "FEC transport: "
+        << (fec_transport_mode_ == FECTransportMode::DATAGRAM ? "DATAGRAM" : "STREAM") << "\n";
+    oss << "Streams: " << stream_classes_.size() << "\n";
+    {
+        std::lock_guard<ProfiledMutex> lock(coalesce_mutex_);
+        if (coalesced_blocks_ > 0) {
+            oss << "Coalescing: " << coalesced_messages_ << " messages in " << coalesced_blocks_
+                << " blocks (" << static_cast<double>(coalesced_messages_) / coalesced_blocks_
+                << " per block)\n";
+        }
+    }
+    oss << "Arena: " << fec_stats.arena_in_use_bytes << " / " << fec_stats.arena_mapped_bytes
+        << " bytes in use (" << fec_stats.arena_huge_page_bytes << " on huge pages, peak "
+        << fec_stats.arena_peak_in_use_bytes << ")\n";
+    oss << "Memory: " << fec_stats.memory_in_use_bytes << " bytes accounted (peak "
+        << fec_stats.memory_peak_bytes << ", evicted " << fec_stats.memory_evicted_bytes
+        << ", " << fec_stats.groups_evicted << " groups dropped"
+        << (fec_stats.memory_pressure ? ", under pressure" : "") << ")\n";
+    if (packet_acks_) {
+        oss << "Path liveness: " << fec_stats.path_failures << " failures, "
+            << fec_stats.probe_packets_sent << " probes, " << fec_stats.reroute_packets_sent
+            << " blocks rerouted\n";
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(send_mutex_);
+        oss << "Send queue: " << send_queued_bytes_.load() << " bytes queued (limit "
+            << max_queued_bytes_ << "), " << send_queue_dropped_.load() << " blocks dropped, "
+            << send_would_block_.load() << " would-block\n";
+    }
+    if (ingress_ring_ || egress_ring_) {
+        oss << "Shared-memory rings: ingress " << ingress_entries_ << " entries ("
+            << ingress_bytes_ << " bytes, paused " << ingress_blocked_
+            << " times by a full send queue), egress " << egress_entries_.load() << " entries ("
+            << egress_dropped_.load() << " messages dropped)\n";
+    }
+    for (const auto& stage : fec_controller_->get_stage_timings()) {
+        if (stage.count == 0) {
+            continue;
+        }
+        oss << "Stage " << stage.name << ": n=" << stage.count
+            << " mean=" << static_cast<uint64_t>(stage.mean_ns)
+            << "ns p50<=" << static_cast<uint64_t>(stage.p50_ns)
+            << "ns p99<=" << static_cast<uint64_t>(stage.p99_ns)
+            << "ns max=" << static_cast<uint64_t>(stage.max_ns) << "ns\n";
+    }
+    for (const auto& lock : fec_controller_->get_lock_profile()) {
+        if (lock.acquisitions == 0) {
+            continue;
+        }
+        oss << "Lock " << lock.name << ": n=" << lock.acquisitions
+            << " contended=" << lock.contended
+            << " wait p99<=" << static_cast<uint64_t>(lock.wait_p99_ns)
+            << "ns max=" << static_cast<uint64_t>(lock.wait_max_ns)
+            << "ns hold p50<=" << static_cast<uint64_t>(lock.hold_p50_ns)
+            << "ns p99<=" << static_cast<uint64_t>(lock.hold_p99_ns)
+            << "ns max=" << static_cast<uint64_t>(lock.hold_max_ns) << "ns\n";
+    }
     oss << "\n" << quic_conn_->get_stats();
     
     return oss.str();
 }
 
+bool MPQUICManager::enable_metrics_endpoint(const std::string& unix_socket_path, int tcp_port,
+                                            int publish_interval_ms) {
+    if (publish_interval_ms <= 0) {
+        throw std::invalid_argument("Metrics publish interval must be positive");
+    }
+    
+    auto exporter = std::make_unique<MetricsExporter>();
+    try {
+        if (!unix_socket_path.empty()) {
+            exporter->listen_unix(unix_socket_path);
+        }
+        if (tcp_port >= 0) {
+            exporter->listen_tcp(static_cast<uint16_t>(tcp_port));
+        }
+        exporter->start();
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to start metrics endpoint: ", e.what());
+        return false;
+    }
+    
+    metrics_exporter_ = std::move(exporter);
+    metrics_interval_ = std::chrono::milliseconds(publish_interval_ms);
+    publish_metrics();
+    return true;
+}
+
+MetricsSnapshot MPQUICManager::collect_metrics() const {
+    MetricsSnapshot snapshot;
+    
+    // 连接级
+    snapshot.counter("mpquic_fec_bytes_sent_total", "Bytes handed to the QUIC connection",
+                     {}, static_cast<double>(total_bytes_sent_));
+    snapshot.counter("mpquic_fec_bytes_received_total", "Bytes received from the QUIC connection",
+                     {}, static_cast<double>(total_bytes_received_));
+    if (ingress_ring_) {
+        snapshot.counter("mpquic_fec_ring_entries_total", "Entries moved through shared-memory rings",
+                         {{"direction", "ingress"}}, static_cast<double>(ingress_entries_));
+        snapshot.counter("mpquic_fec_ring_bytes_total", "Payload bytes read from the ingress ring",
+                         {}, static_cast<double>(ingress_bytes_));
+    }
+    if (egress_ring_) {
+        snapshot.counter("mpquic_fec_ring_entries_total", "Entries moved through shared-memory rings",
+                         {{"direction", "egress"}}, static_cast<double>(egress_entries_.load()));
+        snapshot.counter("mpquic_fec_ring_dropped_total",
+                         "Delivered messages dropped because the egress ring was full", {},
+                         static_cast<double>(egress_dropped_.load()));
+    }
+    
+    auto fec_stats = fec_controller_->get_statistics();
+    snapshot.counter("mpquic_fec_packets_sent_total", "FEC packets emitted by the controller",
+                     {{"kind", "source"}}, static_cast<double>(fec_stats.source_packets_sent));
+    snapshot.counter("mpquic_fec_packets_sent_total", "FEC packets emitted by the controller",
+                     {{"kind", "repair"}}, static_cast<double>(fec_stats.repair_packets_sent));
+    snapshot.counter("mpquic_fec_packets_recovered_total",
+                     "Source packets rebuilt from repair blocks", {},
+                     static_cast<double>(fec_stats.packets_recovered));
+    snapshot.counter("mpquic_fec_groups_created_total", "FEC groups encoded", {},
+                     static_cast<double>(fec_stats.fec_groups_created));
+    snapshot.counter("mpquic_fec_groups_decoded_total", "FEC groups decoded", {},
+                     static_cast<double>(fec_stats.groups_decoded));
+    snapshot.gauge("mpquic_fec_redundancy_ratio", "Current repair-to-source ratio", {},
+                   fec_stats.current_redundancy_rate);
+    snapshot.gauge("mpquic_fec_streams", "Open application streams", {},
+                   static_cast<double>(stream_classes_.size()));
+    snapshot.gauge("mpquic_fec_enabled", "Whether FEC protection is enabled", {},
+                   fec_enabled_ ? 1 : 0);
+    
+    const char* arena_help = "Huge-page arena memory";
+    snapshot.gauge("mpquic_fec_arena_bytes", arena_help, {{"state", "mapped"}},
+                   static_cast<double>(fec_stats.arena_mapped_bytes));
+    snapshot.gauge("mpquic_fec_arena_bytes", arena_help, {{"state", "huge_page"}},
+                   static_cast<double>(fec_stats.arena_huge_page_bytes));
+    snapshot.gauge("mpquic_fec_arena_bytes", arena_help, {{"state", "in_use"}},
+                   static_cast<double>(fec_stats.arena_in_use_bytes));
+    snapshot.gauge("mpquic_fec_arena_bytes", arena_help, {{"state", "peak_in_use"}},
+                   static_cast<double>(fec_stats.arena_peak_in_use_bytes));
+    
+    auto memory = fec_controller_->get_memory_usage();
+    for (size_t i = 0; i < kMemoryTagCount; ++i) {
+        MetricLabels labels = {{"component", memory_tag_name(static_cast<MemoryTag>(i))}};
+        snapshot.gauge("mpquic_fec_memory_bytes", "Accounted memory per component", labels,
+                       static_cast<double>(memory.used[i]));
+        snapshot.gauge("mpquic_fec_memory_peak_bytes", "Peak accounted memory per component",
+                       labels, static_cast<double>(memory.peak[i]));
+        snapshot.gauge("mpquic_fec_memory_budget_bytes", "Memory budget (0 = unlimited)",
+                       labels, static_cast<double>(memory.budget[i]));
+    }
+    snapshot.gauge("mpquic_fec_memory_budget_bytes", "Memory budget (0 = unlimited)",
+                   {{"component", "total"}}, static_cast<double>(memory.total_budget));
+    snapshot.counter("mpquic_fec_memory_evicted_bytes_total",
+                     "Bytes evicted to stay within memory budgets", {},
+                     static_cast<double>(fec_stats.memory_evicted_bytes));
+    snapshot.counter("mpquic_fec_groups_evicted_total",
+                     "Incomplete receive groups dropped by eviction", {},
+                     static_cast<double>(fec_stats.groups_evicted));
+    snapshot.gauge("mpquic_fec_memory_pressure",
+                   "Whether redundancy is reduced because of memory pressure", {},
+                   fec_stats.memory_pressure ? 1 : 0);
+    snapshot.counter("mpquic_fec_path_failures_total",
+                     "Paths removed from scheduling after ACK silence", {},
+                     static_cast<double>(fec_stats.path_failures));
+    snapshot.counter("mpquic_fec_probe_packets_total", "Probe packets sent on silent paths", {},
+                     static_cast<double>(fec_stats.probe_packets_sent));
+    snapshot.counter("mpquic_fec_rerouted_packets_total",
+                     "Blocks in flight on failed paths resent on surviving paths", {},
+                     static_cast<double>(fec_stats.reroute_packets_sent));
+    {
+        std::lock_guard<ProfiledMutex> lock(coalesce_mutex_);
+        snapshot.counter("mpquic_fec_coalesced_messages_total",
+                         "Small messages packed into shared FEC blocks", {},
+                         static_cast<double>(coalesced_messages_));
+        snapshot.counter("mpquic_fec_coalesced_blocks_total", "FEC blocks carrying coalesced messages",
+                         {}, static_cast<double>(coalesced_blocks_));
+    }
+    snapshot.gauge("mpquic_fec_send_queue_bytes", "Bytes queued ahead of the transport", {},
+                   static_cast<double>(send_queued_bytes_.load()));
+    snapshot.counter("mpquic_fec_send_queue_dropped_total",
+                     "Queued blocks dropped by the backpressure policy", {},
+                     static_cast<double>(send_queue_dropped_.load()));
+    snapshot.counter("mpquic_fec_send_would_block_total",
+                     "try_send calls rejected because the send queue was full", {},
+                     static_cast<double>(send_would_block_.load()));
+    
+    // 路径级
+    auto weights = scheduler_->get_path_weights();
+    for (const auto& path : quic_conn_->get_paths()) {
+        MetricLabels labels = {{"path", std::to_string(path.path_id)}};
+        snapshot.gauge("mpquic_fec_path_active", "Whether the path is usable", labels,
+                       path.is_active ? 1 : 0);
+        snapshot.gauge("mpquic_fec_path_rtt_seconds", "Smoothed path RTT", labels,
+                       path.rtt_ms / 1000.0);
+        snapshot.gauge("mpquic_fec_path_loss_ratio", "Estimated path loss rate", labels,
+                       path.loss_rate);
+        snapshot.gauge("mpquic_fec_path_bandwidth_bits_per_second",
+                       "Estimated path bandwidth (0 if unknown)", labels,
+                       path.bandwidth_mbps * 1e6);
+        snapshot.counter("mpquic_fec_path_bytes_sent_total", "Bytes sent on the path", labels,
+                         static_cast<double>(path.bytes_sent));
+        snapshot.counter("mpquic_fec_path_bytes_received_total", "Bytes received on the path",
+                         labels, static_cast<double>(path.bytes_received));
+        auto weight = weights.find(path.path_id);
+        snapshot.gauge("mpquic_fec_path_weight", "Scheduler weight of the path", labels,
+                       weight != weights.end() ? weight->second : 0);
+        snapshot.gauge("mpquic_fec_path_liveness",
+                       "Path liveness (0 = alive, 1 = probing, 2 = dead)", labels,
+                       static_cast<double>(fec_controller_->get_path_liveness(path.path_id)));
+    }
+    
+    // 阶段耗时
+    for (const auto& stage : fec_controller_->get_stage_timings()) {
+        snapshot.histogram("mpquic_fec_stage_duration_seconds",
+                           "Self time of each hot-path stage", {{"stage", stage.name}},
+                           fixed_duration_buckets(stage.buckets, stage.ticks_per_ns),
+                           stage.total_ns / 1e9, stage.count);
+    }
+    
+    // 锁竞争
+    for (const auto& lock : fec_controller_->get_lock_profile()) {
+        MetricLabels labels = {{"lock", lock.name}};
+        snapshot.counter("mpquic_fec_lock_acquisitions_total", "Lock acquisitions", labels,
+                         static_cast<double>(lock.acquisitions));
+        snapshot.histogram("mpquic_fec_lock_wait_seconds",
+                           "Time spent waiting for a contended lock", labels,
+                           fixed_duration_buckets(lock.wait_buckets, lock.ticks_per_ns),
+                           lock.wait_total_ns / 1e9, lock.contended);
+        snapshot.histogram("mpquic_fec_lock_hold_seconds", "Time a lock was held", labels,
+                           fixed_duration_buckets(lock.hold_buckets, lock.ticks_per_ns),
+                           lock.hold_total_ns / 1e9, lock.hold_count);
+    }
+    
+    return snapshot;
+}
+
+void MPQUICManager::publish_metrics() {
+    if (!metrics_exporter_) {
+        return;
+    }
+    metrics_exporter_->publish(collect_metrics());
+    last_metrics_publish_ = std::chrono::steady_clock::now();
+}
+
+bool MPQUICManager::enable_warm_start(const std::string& state_file) {
+    if (state_file.empty()) {
+        throw std::invalid_argument("Warm-start state file must not be empty");
+    }
+    
+    warm_state_file_ = state_file;
+    bool loaded = warm_store_.load(state_file);
+    
+    // 已建立的路径立即预热
+    sync_path_states();
+    return loaded;
+}
+
+void MPQUICManager::save_warm_start() {
+    if (warm_state_file_.empty()) {
+        return;
+    }
+    
+    fec_controller_->export_warm_start(warm_store_);
+    try {
+        warm_store_.save(warm_state_file_);
+        LOG_INFO("Saved warm-start state for ", warm_store_.path_count(), " paths to ",
+                 warm_state_file_);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to save warm-start state: ", e.what());
+    }
+}
+
 void MPQUICManager::close() {
     LOG_INFO("Closing MPQUIC connection");
+    flush_coalesced_messages(true);
+    {
+        // 交出传输层还能接受的块，其余随连接丢弃
+        std::lock_guard<ProfiledMutex> lock(send_mutex_);
+        drain_send_queues_locked();
+        if (send_queued_bytes_ > 0) {
+            LOG_WARN("Discarding ", send_queued_bytes_.load(), " queued bytes on close");
+        }
+    }
+    save_warm_start();
     quic_conn_->close();
 }
 
 void MPQUICManager::process_events(int timeout_ms) {
-    quic_conn_->process_events(timeout_ms);
+    // 合并中的消息不等满整个timeout：先等到最早的截止时刻发出，再等剩余时间
+    uint64_t coalesce_wait_us = flush_coalesced_messages(false);
+    if (coalesce_wait_us < static_cast<uint64_t>(std::max(timeout_ms, 0)) * 1000) {
+        int wait_ms = static_cast<int>((coalesce_wait_us + 999) / 1000);
+        wait_transport_events(wait_ms);
+        flush_coalesced_messages(false);
+        timeout_ms -= wait_ms;
+    }
+    wait_transport_events(timeout_ms);
+    
+    // 等待结束后的定期工作共用一个时刻
+    ClockBatch clock_batch;
     
     // 定期更新路径指标
     static int update_counter = 0;
@@ -158,95 +648,991 @@ void MPQUICManager::process_events(int timeout_ms) {
         update_path_metrics();
         update_counter = 0;
     }
+    
+    if (ingress_ring_) {
+        try {
+            drain_ingress_ring();
+        } catch (const std::runtime_error& e) {
+            LOG_ERROR("Detaching corrupted ingress ring: ", e.what());
+            ingress_ring_.reset();
+        }
+    }
+    
+    // OCO参数调整和定期刷新可能强制完成未满的组，取出后发送
+    if (!quic_conn_->get_paths().empty()) {
+        fec_controller_->periodic_update();
+        send_packets(fec_controller_->pop_pending_packets());
+    }
+    
+    skip_stalled_groups();
+    
+    if (metrics_exporter_ &&
+        std::chrono::steady_clock::now() - last_metrics_publish_ >= metrics_interval_) {
+        publish_metrics();
+    }
 }
 
-bool MPQUICManager::send_with_fec(const std::vector<uint8_t>& data) {
-    LOG_DEBUG("Sending ", data.size(), " bytes with FEC protection");
+bool MPQUICManager::send_with_fec(const std::vector<uint8_t>& data, StreamID stream_id,
+                                  size_t& reserved, bool pace_groups) {
+    LOG_DEBUG("Sending ", data.size(), " bytes with FEC protection on stream ", stream_id);
     
-    // 将数据分块
-    std::vector<std::vector<uint8_t>> data_blocks;
-    size_t offset = 0;
+    const size_t payload_per_block = fec_block_size_ - kBlockHeaderSize;
+    if (coalesce_delay_us_ > 0 && stream_classes_[stream_id] != TrafficClass::INTERACTIVE &&
+        data.size() + MessageCoalescer::kRecordHeaderSize <= payload_per_block) {
+        return coalesce_message(data, stream_id);
+    }
     
-    while (offset < data.size()) {
-        size_t chunk_size = std::min(fec_block_size_, 
-                                    static_cast<uint32_t>(data.size() - offset));
-        std::vector<uint8_t> block(data.begin() + offset, 
-                                  data.begin() + offset + chunk_size);
+    const size_t group_bytes =
+        payload_per_block * fec_controller_->get_coding_params(stream_id).first;
+    bool ok = true;
+    size_t groups = 0;
+    
+    try {
+        // 先发出该流合并中的小消息，保持消息顺序
+        std::vector<SendPacketMeta> coalesced;
+        take_coalesced_block(stream_id, coalesced);
+        ok &= send_packets(coalesced);
+        
+        size_t offset = 0;
         
-        // 如果块不足大小，填充零
-        if (block.size() < fec_block_size_) {
-            block.resize(fec_block_size_, 0);
+        if (data.size() <= group_bytes) {
+            // 单组消息：直接编码发送
+            ok &= send_packets(encode_next_group(data, offset, stream_id), &reserved);
+            groups = 1;
+        } else {
+            // 多组消息：发送第N组时后台编码第N+1组。
+            // 本消息同一时刻只有一个编码任务，组ID顺序与消息顺序一致
+            auto encode = [this, &data, &offset, stream_id]() {
+                return encode_next_group(data, offset, stream_id);
+            };
+            auto pending = submit_encode(encode);
+            
+            while (pending.valid()) {
+                auto packets = pending.get();
+                if (offset < data.size()) {
+                    pending = submit_encode(encode);
+                }
+                
+                // 超过上限的大消息按组等待队列回落；超时后其余组照常入队，不丢弃已开始的消息
+                if (pace_groups && groups > 0 && !wait_for_send_queue()) {
+                    LOG_WARN("Send queue still full after ", block_timeout_ms_, "ms, queueing the ",
+                             "rest of a ", data.size(), " byte message on stream ", stream_id,
+                             " without waiting");
+                    pace_groups = false;
+                }
+                ok &= send_packets(packets, &reserved);
+                ++groups;
+            }
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("FEC send failed: ", e.what());
+        return false;
+    }
+    
+    LOG_DEBUG("Sent ", data.size(), " bytes with FEC in ", groups, " groups (",
+              (data.size() + payload_per_block - 1) / payload_per_block, " source blocks)");
+    
+    return ok;
+}
+
+std::future<std::vector<SendPacketMeta>> MPQUICManager::submit_encode(
+    std::function<std::vector<SendPacketMeta>()> job) {
+    std::packaged_task<std::vector<SendPacketMeta>()> task(std::move(job));
+    auto result = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(encode_mutex_);
+        if (!encode_thread_.joinable()) {
+            encode_thread_ = std::thread(&MPQUICManager::run_encode_worker, this);
         }
+        encode_jobs_.push_back(std::move(task));
+    }
+    encode_cv_.notify_one();
+    return result;
+}
+
+void MPQUICManager::run_encode_worker() {
+    std::unique_lock<std::mutex> lock(encode_mutex_);
+    while (true) {
+        encode_cv_.wait(lock, [this]() { return encode_stop_ || !encode_jobs_.empty(); });
+        if (encode_jobs_.empty()) {
+            return;   // 已停止且没有剩余任务
+        }
+        auto task = std::move(encode_jobs_.front());
+        encode_jobs_.pop_front();
         
-        data_blocks.push_back(block);
+        lock.unlock();
+        task();   // 异常由future带回提交方
+        lock.lock();
+    }
+}
+
+std::vector<SendPacketMeta> MPQUICManager::encode_next_group(const std::vector<uint8_t>& data,
+                                                             size_t& offset, StreamID stream_id) {
+    const size_t payload_per_block = fec_block_size_ - kBlockHeaderSize;
+    
+    // 一组的k个块共用一次时钟读取（可能在后台编码线程上运行）
+    ClockBatch clock_batch;
+    
+    while (offset < data.size()) {
+        size_t chunk_size = std::min(payload_per_block, data.size() - offset);
+        
+        uint8_t flags = 0;
+        if (offset == 0) flags |= kBlockFlagStart;
+        if (offset + chunk_size == data.size()) flags |= kBlockFlagEnd;
+        
+        std::vector<uint8_t> block(kBlockHeaderSize + chunk_size);
+        block[0] = static_cast<uint8_t>(chunk_size >> 8);
+        block[1] = static_cast<uint8_t>(chunk_size & 0xFF);
+        block[2] = flags;
+        std::copy(data.begin() + offset, data.begin() + offset + chunk_size,
+                  block.begin() + kBlockHeaderSize);
         offset += chunk_size;
         
-        if (data_blocks.size() >= fec_k_) {
-            break;  // 凑够一组进行编码
+        // 凑满k块时控制器完成编码并返回整组；k可能被OCO在组间调整
+        auto packets = fec_controller_->send_stream_data(block, 0, stream_id);
+        if (!packets.empty()) {
+            return packets;
+        }
+    }
+    
+    // 消息结尾：立即完成该流未满的组，不等待后续数据
+    return fec_controller_->flush_pending_groups(stream_id);
+}
+
+bool MPQUICManager::coalesce_message(const std::vector<uint8_t>& data, StreamID stream_id) {
+    std::vector<SendPacketMeta> packets;
+    
+    try {
+        std::lock_guard<ProfiledMutex> lock(coalesce_mutex_);
+        auto it = coalescers_.find(stream_id);
+        if (it == coalescers_.end()) {
+            it = coalescers_.emplace(stream_id, MessageCoalescer(fec_block_size_, kBlockHeaderSize,
+                                                                 coalesce_delay_us_)).first;
+        }
+        
+        std::vector<std::vector<uint8_t>> blocks;
+        it->second.append(data.data(), data.size(), Clock::now_us(), blocks);
+        ++coalesced_messages_;
+        for (auto& block : blocks) {
+            encode_coalesced_block_locked(block, stream_id, packets);
         }
+    } catch (const std::exception& e) {
+        LOG_ERROR("FEC send failed: ", e.what());
+        return false;
     }
     
-    // 如果数据块不足k个，填充空块
-    while (data_blocks.size() < fec_k_) {
-        data_blocks.push_back(std::vector<uint8_t>(fec_block_size_, 0));
+    LOG_DEBUG("Coalesced ", data.size(), " bytes on stream ", stream_id);
+    return send_packets(packets);
+}
+
+void MPQUICManager::take_coalesced_block(StreamID stream_id,
+                                         std::vector<SendPacketMeta>& out_packets) {
+    std::lock_guard<ProfiledMutex> lock(coalesce_mutex_);
+    std::vector<uint8_t> block;
+    auto it = coalescers_.find(stream_id);
+    if (it != coalescers_.end() && it->second.take(block)) {
+        encode_coalesced_block_locked(block, stream_id, out_packets);
     }
+}
+
+void MPQUICManager::encode_coalesced_block_locked(std::vector<uint8_t>& block, StreamID stream_id,
+                                                  std::vector<SendPacketMeta>& out_packets) {
+    size_t length = block.size() - kBlockHeaderSize;
+    block[0] = static_cast<uint8_t>(length >> 8);
+    block[1] = static_cast<uint8_t>(length & 0xFF);
+    block[2] = kBlockFlagRecords;
+    block[3] = 0;
+    ++coalesced_blocks_;
     
-    // FEC编码
-    auto parity_blocks = fec_encoder_->encode(data_blocks);
-    LOG_DEBUG("Generated ", parity_blocks.size(), " FEC parity blocks");
+    auto packets = fec_controller_->send_stream_data(block, 0, stream_id);
+    out_packets.insert(out_packets.end(), std::make_move_iterator(packets.begin()),
+                       std::make_move_iterator(packets.end()));
+}
+
+uint64_t MPQUICManager::flush_coalesced_messages(bool force) {
+    std::vector<SendPacketMeta> packets;
+    uint64_t next_deadline_us = std::numeric_limits<uint64_t>::max();
+    uint64_t now_us = Clock::now_us();
+    
+    try {
+        std::lock_guard<ProfiledMutex> lock(coalesce_mutex_);
+        for (auto& [stream_id, coalescer] : coalescers_) {
+            if (coalescer.empty()) {
+                continue;
+            }
+            if (!force && !coalescer.due(now_us)) {
+                next_deadline_us = std::min(next_deadline_us, coalescer.deadline_us());
+                continue;
+            }
+            
+            std::vector<uint8_t> block;
+            coalescer.take(block);
+            encode_coalesced_block_locked(block, stream_id, packets);
+            
+            // 等待已到上限：立即完成该流未满的组，不再等待后续数据
+            auto flushed = fec_controller_->flush_pending_groups(stream_id);
+            packets.insert(packets.end(), std::make_move_iterator(flushed.begin()),
+                           std::make_move_iterator(flushed.end()));
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("FEC send of coalesced messages failed: ", e.what());
+    }
+    
+    send_packets(packets);
     
-    // 发送数据块（选择最优路径）
-    for (size_t i = 0; i < data_blocks.size(); ++i) {
-        PathID path_id = scheduler_->select_source_path(data_blocks[i].size());
+    if (next_deadline_us == std::numeric_limits<uint64_t>::max()) {
+        return next_deadline_us;
+    }
+    return next_deadline_us > now_us ? next_deadline_us - now_us : 0;
+}
+
+bool MPQUICManager::send_without_fec(const std::vector<uint8_t>& data, StreamID stream_id) {
+    LOG_DEBUG("Sending ", data.size(), " bytes without FEC on stream ", stream_id);
+    
+    // 选择最优路径
+    PathID path_id = scheduler_->select_path(data.size());
+    
+    return send_unprotected(path_id, stream_id, data);
+}
+
+bool MPQUICManager::send_unprotected(PathID path_id, StreamID stream_id,
+                                     const std::vector<uint8_t>& data) {
+    if (FECFrameHeader::HEADER_SIZE + data.size() > kMaxStreamFrameBytes) {
+        LOG_ERROR("Unprotected message of ", data.size(), " bytes exceeds the frame limit");
+        return false;
+    }
+    
+    // 不受FEC保护的数据封装为STREAM_FRAME，组ID只携带流槽位；直接序列化到池中的缓冲区
+    FECFrameHeader header;
+    header.frame_type = FrameType::STREAM_FRAME;
+    header.group_id = make_stream_group_id(static_cast<uint32_t>(stream_id), 0);
+    header.payload_length = data.size();
+    
+    PooledBuffer bytes(static_cast<uint32_t>(FECFrameHeader::HEADER_SIZE + data.size()));
+    header.serialize_to(bytes.mutable_data());
+    std::copy(data.begin(), data.end(), bytes.mutable_data() + FECFrameHeader::HEADER_SIZE);
+    
+    return send_raw_on_path(path_id, quic_stream_for(stream_id), bytes);
+}
+
+bool MPQUICManager::send_packets(const std::vector<SendPacketMeta>& packets, size_t* reserved) {
+    bool ok;
+    {
+        std::lock_guard<ProfiledMutex> lock(send_mutex_);
+        size_t queued = 0;
+        for (const auto& meta : packets) {
+            MPQUIC_FEC_STAGE_SCOPE(Stage::SEND_TRANSPORT_HANDOFF);
+            QueuedBlock block{quic_stream_for(group_stream_slot(meta.frame.header.group_id)),
+                              PooledBuffer(static_cast<uint32_t>(meta.frame.total_size())),
+                              meta.packet_number, ++send_queue_order_, meta.is_repair};
+            meta.frame.serialize_to(block.bytes.mutable_data());
+            send_queued_bytes_ += block.bytes.size();
+            queued += block.bytes.size();
+            send_queues_[meta.path_id].push_back(std::move(block));
+        }
+        if (reserved) {
+            // 预留转为实际排队量，同一把锁内完成，其他发送方不会重复计算
+            size_t used = std::min(queued, *reserved);
+            send_reserved_bytes_ -= used;
+            *reserved -= used;
+        }
         
-        if (!send_data_on_path(path_id, data_blocks[i])) {
-            LOG_ERROR("Failed to send data block ", i);
-            return false;
+        ok = drain_send_queues_locked();
+        if (backpressure_policy_ != BackpressurePolicy::BLOCK) {
+            trim_send_queues_locked();
+        }
+    }
+    
+    update_redundancy_degradation();
+    return ok;
+}
+
+bool MPQUICManager::drain_send_queues_locked() {
+    bool ok = true;
+    bool freed = false;
+    
+    for (auto& [path_id, queue] : send_queues_) {
+        // 传输层缓冲区达到水位的路径留在队列中，等下一次交出
+        while (!queue.empty() && quic_conn_->get_send_queue_bytes(path_id) < kTransportQueueBytes) {
+            QueuedBlock& block = queue.front();
+            if (!send_fec_block_locked(path_id, block.quic_stream, block.bytes,
+                                       block.packet_number)) {
+                if (block.is_repair) {
+                    // 冗余块发送失败不算致命错误
+                    LOG_WARN("Failed to send repair block on path ", path_id);
+                } else {
+                    LOG_ERROR("Failed to send source block on path ", path_id);
+                    ok = false;
+                }
+            } else if (block.is_repair) {
+                fec_blocks_sent_++;
+            }
+            
+            send_queued_bytes_ -= block.bytes.size();
+            queue.pop_front();
+            freed = true;
+        }
+    }
+    
+    if (freed) {
+        send_space_cv_.notify_all();
+    }
+    return ok;
+}
+
+void MPQUICManager::trim_send_queues_locked() {
+    if (send_queued_bytes_ <= max_queued_bytes_) {
+        return;
+    }
+    
+    uint64_t dropped = 0;
+    if (backpressure_policy_ == BackpressurePolicy::DEGRADE_REDUNDANCY) {
+        // 先丢冗余块：源块仍能按序交付，只是失去这些组的保护
+        for (auto& [path_id, queue] : send_queues_) {
+            std::deque<QueuedBlock> kept;
+            for (auto& block : queue) {
+                if (block.is_repair && send_queued_bytes_ > max_queued_bytes_) {
+                    send_queued_bytes_ -= block.bytes.size();
+                    ++dropped;
+                    continue;
+                }
+                kept.push_back(std::move(block));
+            }
+            queue.swap(kept);
+        }
+    }
+    
+    while (send_queued_bytes_ > max_queued_bytes_) {
+        // 各路径队首中最早入队的块即全局最旧的块
+        std::deque<QueuedBlock>* oldest = nullptr;
+        for (auto& [path_id, queue] : send_queues_) {
+            if (!queue.empty() && (!oldest || queue.front().order < oldest->front().order)) {
+                oldest = &queue;
+            }
+        }
+        if (!oldest) {
+            break;
         }
+        send_queued_bytes_ -= oldest->front().bytes.size();
+        oldest->pop_front();
+        ++dropped;
+    }
+    
+    send_queue_dropped_.fetch_add(dropped, std::memory_order_relaxed);
+    if (dropped > 0) {
+        send_space_cv_.notify_all();
+    }
+    LOG_DEBUG("Send queue over ", max_queued_bytes_, " bytes, dropped ", dropped, " blocks");
+}
+
+size_t MPQUICManager::estimate_queued_bytes(size_t message_size, StreamID stream_id) const {
+    const size_t payload_per_block = fec_block_size_ - kBlockHeaderSize;
+    auto [k, m] = fec_controller_->get_coding_params(stream_id);
+    
+    size_t blocks = std::max<size_t>((message_size + payload_per_block - 1) / payload_per_block, 1);
+    size_t groups = (blocks + k - 1) / k;
+    return (blocks + groups * m) * (FECFrameHeader::HEADER_SIZE + fec_block_size_);
+}
+
+bool MPQUICManager::reserve_send_queue(size_t bytes, bool wait) {
+    std::unique_lock<ProfiledMutex> lock(send_mutex_);
+    bool waiting = wait && backpressure_policy_ == BackpressurePolicy::BLOCK;
+    auto fits = [this, bytes, waiting]() {
+        if (waiting && backpressure_policy_ != BackpressurePolicy::BLOCK) {
+            return true;   // 等待期间改为了不阻塞的策略
+        }
+        size_t committed = send_queued_bytes_ + send_reserved_bytes_;
+        return committed == 0 || committed + bytes <= max_queued_bytes_;
+    };
+    
+    bool granted;
+    if (waiting) {
+        granted = wait_send_space_locked(lock, fits);
+    } else {
+        drain_send_queues_locked();
+        granted = fits();
+    }
+    if (granted) {
+        send_reserved_bytes_ += bytes;
+    }
+    return granted;
+}
+
+void MPQUICManager::release_send_reservation(size_t& reserved) {
+    if (reserved == 0) {
+        return;
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(send_mutex_);
+        send_reserved_bytes_ -= reserved;
     }
+    reserved = 0;
+    send_space_cv_.notify_all();
+}
+
+bool MPQUICManager::wait_for_send_queue() {
+    std::unique_lock<ProfiledMutex> lock(send_mutex_);
+    return wait_send_space_locked(lock, [this]() {
+        return backpressure_policy_ != BackpressurePolicy::BLOCK ||
+               send_queued_bytes_ < max_queued_bytes_;
+    });
+}
+
+bool MPQUICManager::wait_send_space_locked(std::unique_lock<ProfiledMutex>& lock,
+                                           const std::function<bool()>& ready) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(block_timeout_ms_);
     
-    // 发送冗余块（选择不同的路径以提高可靠性）
-    for (size_t i = 0; i < parity_blocks.size(); ++i) {
-        PathID source_path = scheduler_->select_source_path(parity_blocks[i].size());
-        PathID repair_path = scheduler_->select_repair_path(source_path, 
-                                                            parity_blocks[i].size());
+    for (;;) {
+        drain_send_queues_locked();
+        if (ready()) {
+            return true;
+        }
         
-        if (!send_data_on_path(repair_path, parity_blocks[i])) {
-            LOG_WARN("Failed to send parity block ", i);
-            // 冗余块发送失败不算致命错误
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return false;
+        }
+        // 其他线程交出块或放宽上限时立即唤醒；没有线程驱动事件循环时，
+        // 等到传输层预计腾出空间，再由本线程交出队首的块
+        send_space_cv_.wait_until(lock, std::min(deadline, now + transport_drain_delay_locked()));
+    }
+}
+
+std::chrono::microseconds MPQUICManager::transport_drain_delay_locked() const {
+    std::chrono::microseconds delay(1000);   // 传输层不报告带宽时的兜底
+    bool estimated = false;
+    
+    for (const auto& path : quic_conn_->get_paths()) {
+        auto it = send_queues_.find(path.path_id);
+        if (it == send_queues_.end() || it->second.empty() || path.bandwidth_mbps <= 0) {
+            continue;
+        }
+        // 传输层缓冲回落到水位以下即可交出下一个块；Mbps即每微秒比特数
+        size_t buffered = quic_conn_->get_send_queue_bytes(path.path_id);
+        size_t excess = buffered >= kTransportQueueBytes ? buffered - kTransportQueueBytes + 1 : 0;
+        std::chrono::microseconds path_delay(
+            static_cast<int64_t>(excess * 8 / path.bandwidth_mbps) + 1);
+        if (!estimated || path_delay < delay) {
+            delay = path_delay;
+            estimated = true;
+        }
+    }
+    return delay;
+}
+
+void MPQUICManager::update_redundancy_degradation() {
+    bool degrade;
+    {
+        std::lock_guard<ProfiledMutex> lock(send_mutex_);
+        size_t queued = send_queued_bytes_;
+        if (backpressure_policy_ != BackpressurePolicy::DEGRADE_REDUNDANCY) {
+            degrade = false;
+        } else if (queued > max_queued_bytes_ / 2) {
+            degrade = true;
+        } else if (queued < max_queued_bytes_ / 4) {
+            degrade = false;
         } else {
-            fec_blocks_sent_++;
+            return;   // 回差区间内保持现状
         }
+        
+        if (degrade == redundancy_degraded_) {
+            return;
+        }
+        redundancy_degraded_ = degrade;
     }
     
-    LOG_INFO("Sent data with FEC: ", data_blocks.size(), " data blocks + ",
-            parity_blocks.size(), " parity blocks");
+    fec_controller_->set_redundancy_degraded(degrade);
+}
+
+void MPQUICManager::wait_transport_events(int timeout_ms) {
+    while (timeout_ms > 0 && send_queued_bytes_ > 0) {
+        quic_conn_->process_events(1);
+        --timeout_ms;
+        {
+            std::lock_guard<ProfiledMutex> lock(send_mutex_);
+            drain_send_queues_locked();
+        }
+        update_redundancy_degradation();
+    }
+    quic_conn_->process_events(timeout_ms);
+}
+
+bool MPQUICManager::send_fec_block_locked(PathID path_id, StreamID quic_stream,
+                                          const PooledBuffer& block, uint64_t packet_number) {
+    // 登记顺序与传输层分配的发送序号一致
+    size_t sent;
+    if (fec_transport_mode_ != FECTransportMode::DATAGRAM ||
+        block.size() > quic_conn_->max_datagram_size()) {
+        sent = quic_conn_->send_bytes_on_path(path_id, quic_stream, block.data(), block.size());
+    } else {
+        sent = quic_conn_->send_datagram_bytes_on_path(path_id, block.data(), block.size());
+    }
     
+    if (sent == 0) {
+        return false;
+    }
+    record_sent_packet_locked(path_id, packet_number);
+    total_bytes_sent_ += sent;
     return true;
 }
 
-bool MPQUICManager::send_without_fec(const std::vector<uint8_t>& data) {
-    LOG_DEBUG("Sending ", data.size(), " bytes without FEC");
+bool MPQUICManager::send_raw_on_path(PathID path_id, StreamID quic_stream,
+                                     const PooledBuffer& bytes, uint64_t packet_number) {
+    size_t sent;
+    {
+        std::lock_guard<ProfiledMutex> lock(send_mutex_);
+        sent = quic_conn_->send_bytes_on_path(path_id, quic_stream, bytes.data(), bytes.size());
+        if (sent > 0) {
+            record_sent_packet_locked(path_id, packet_number);
+        }
+    }
     
-    // 选择最优路径
-    PathID path_id = scheduler_->select_path(data.size());
+    if (sent > 0) {
+        total_bytes_sent_ += sent;
+        LOG_DEBUG("Sent ", sent, " bytes on path ", path_id);
+        return true;
+    }
+    
+    return false;
+}
+
+void MPQUICManager::record_sent_packet_locked(PathID path_id, uint64_t packet_number) {
+    uint64_t sequence = ++send_sequences_[path_id];
+    if (!packet_acks_ || packet_number == kUntrackedPacket) {
+        return;
+    }
+    
+    auto& sent = sent_packets_[path_id];
+    sent.emplace_hint(sent.end(), sequence, packet_number);
+    if (sent.size() > kMaxSentPacketsPerPath) {
+        sent.erase(sent.begin());
+    }
+}
+
+void MPQUICManager::handle_packet_ack(PathID path_id, uint64_t sequence, bool acked,
+                                      uint64_t rtt_us) {
+    uint64_t packet_number;
+    {
+        std::lock_guard<ProfiledMutex> lock(send_mutex_);
+        auto path = sent_packets_.find(path_id);
+        if (path == sent_packets_.end()) {
+            return;
+        }
+        auto it = path->second.find(sequence);
+        if (it == path->second.end()) {
+            return;
+        }
+        packet_number = it->second;
+        path->second.erase(it);
+    }
     
-    return send_data_on_path(path_id, data);
+    if (acked) {
+        fec_controller_->on_ack_received(path_id, packet_number, rtt_us);
+    } else {
+        fec_controller_->on_packet_lost(path_id, packet_number);
+    }
+}
+
+StreamID MPQUICManager::quic_stream_for(StreamID stream_id) const {
+    return stream_id < quic_streams_.size() ? quic_streams_[stream_id] : data_stream_;
 }
 
-void MPQUICManager::handle_received_data(StreamID stream_id,
+void MPQUICManager::handle_received_datagram(PathID path_id,
+                                             const std::vector<uint8_t>& data) {
+    LOG_DEBUG("Received ", data.size(), " byte datagram on path ", path_id);
+    total_bytes_received_ += data.size();
+    
+    // 每个数据报恰好承载一个帧
+    ReceivedMessages messages;
+    {
+        MPQUIC_FEC_STAGE_SCOPE(Stage::RECV_TRANSPORT_INGEST);
+        std::lock_guard<ProfiledMutex> lock(recv_mutex_);
+        try {
+            handle_received_frame(path_id, FECFrame::deserialize(data.data(), data.size()),
+                                  messages);
+        } catch (const std::exception& e) {
+            LOG_WARN("Dropping malformed datagram on path ", path_id, ": ", e.what());
+        }
+    }
+    
+    dispatch_messages(messages);
+}
+
+void MPQUICManager::handle_received_data(PathID path_id,
+                                        StreamID stream_id,
                                         const std::vector<uint8_t>& data,
                                         bool fin) {
     total_bytes_received_ += data.size();
     
     LOG_DEBUG("Received ", data.size(), " bytes on stream ", stream_id,
-             (fin ? " (FIN)" : ""));
+             " via path ", path_id, (fin ? " (FIN)" : ""));
+    
+    ReceivedMessages messages;
+    {
+        MPQUIC_FEC_STAGE_SCOPE(Stage::RECV_TRANSPORT_INGEST);
+        ClockBatch clock_batch;
+        std::lock_guard<ProfiledMutex> lock(recv_mutex_);
+        
+        // 流不保留写入边界，按帧头中的payload长度切分
+        auto& rx_buffer = stream_rx_buffers_[stream_id];
+        rx_buffer.insert(rx_buffer.end(), data.begin(), data.end());
+        
+        size_t offset = 0;
+        while (rx_buffer.size() - offset >= FECFrameHeader::HEADER_SIZE) {
+            const uint8_t* ptr = rx_buffer.data() + offset;
+            size_t available = rx_buffer.size() - offset;
+            
+            auto header = FECFrameHeader::deserialize(ptr, available);
+            if (header.frame_type != FrameType::STREAM_FRAME &&
+                header.frame_type != FrameType::FEC_SOURCE_FRAME &&
+                header.frame_type != FrameType::FEC_REPAIR_FRAME) {
+                LOG_ERROR("Unknown frame type on stream ", stream_id,
+                          ", discarding ", available, " buffered bytes");
+                offset = rx_buffer.size();
+                break;
+            }
+            
+            size_t frame_size = FECFrameHeader::HEADER_SIZE + header.payload_length;
+            if (frame_size > kMaxStreamFrameBytes) {
+                LOG_ERROR("Oversized frame (", frame_size, " bytes) on stream ", stream_id,
+                          ", discarding ", available, " buffered bytes");
+                offset = rx_buffer.size();
+                break;
+            }
+            if (available < frame_size) {
+                break;  // 等待帧的剩余部分
+            }
+            
+            // 跨多块数据的帧记在补齐它的那块数据的到达路径上
+            try {
+                handle_received_frame(path_id, FECFrame::deserialize(ptr, frame_size),
+                                      messages);
+            } catch (const std::exception& e) {
+                LOG_WARN("Dropping malformed frame on stream ", stream_id, ": ", e.what());
+            }
+            offset += frame_size;
+        }
+        
+        rx_buffer.erase(rx_buffer.begin(), rx_buffer.begin() + offset);
+    }
+    
+    dispatch_messages(messages);
+}
+
+void MPQUICManager::handle_received_frame(PathID path_id, const FECFrame& frame,
+                                          ReceivedMessages& messages) {
+    MPQUIC_FEC_STAGE_SCOPE(Stage::RECV_REASSEMBLY);
+    StreamID stream_id = group_stream_slot(frame.header.group_id);
+    
+    if (frame.header.frame_type == FrameType::STREAM_FRAME) {
+        messages.emplace_back(stream_id,
+                              std::vector<uint8_t>(frame.payload.begin(), frame.payload.end()));
+        return;
+    }
+    
+    auto decoded = fec_controller_->receive_fec_frame(frame, path_id);
+    if (decoded.empty()) {
+        return;
+    }
+    
+    fec_blocks_recovered_ = fec_controller_->get_statistics().packets_recovered;
+    
+    auto& stream = reassembly_[stream_id];
+    uint64_t seq = group_sequence(frame.header.group_id);
+    if (seq < stream.next_group_seq) {
+        LOG_DEBUG("Discarding late group ", seq, " of stream ", stream_id);
+        return;
+    }
+    
+    stream.decoded_groups[seq] = std::move(decoded);
+    deliver_decoded_groups(stream_id, stream, messages);
+}
+
+void MPQUICManager::skip_stalled_groups() {
+    ReceivedMessages messages;
+    {
+        std::lock_guard<ProfiledMutex> lock(recv_mutex_);
+        uint64_t now_us = Clock::now_us();
+        
+        for (auto& [stream_id, stream] : reassembly_) {
+            // 批次时刻可能早于其他线程刚记录的缺口时刻
+            if (stream.head_blocked_seq != 0 && now_us > stream.head_blocked_since_us &&
+                now_us - stream.head_blocked_since_us >= kHeadOfLineTimeoutUs) {
+                deliver_decoded_groups(stream_id, stream, messages, true);
+            }
+        }
+    }
+    
+    dispatch_messages(messages);
+}
+
+void MPQUICManager::deliver_decoded_groups(StreamID stream_id, StreamReassembly& stream,
+                                           ReceivedMessages& messages, bool skip_gap) {
+    while (!stream.decoded_groups.empty()) {
+        auto it = stream.decoded_groups.begin();
+        
+        if (it->first != stream.next_group_seq) {
+            if (!skip_gap && stream.decoded_groups.size() <= kMaxPendingGroups) {
+                // 等待队首组到达或被恢复，超时后由skip_stalled_groups()跳过
+                if (stream.head_blocked_seq != stream.next_group_seq) {
+                    stream.head_blocked_seq = stream.next_group_seq;
+                    stream.head_blocked_since_us = Clock::now_us();
+                }
+                return;
+            }
+            skip_gap = false;
+            
+            // 队首组已无法恢复：跳过，丢弃跨越缺口的消息
+            LOG_WARN("FEC groups ", stream.next_group_seq, "-", it->first - 1,
+                     " of stream ", stream_id, " unrecoverable, skipping");
+            stream.partial_message.clear();
+            stream.in_message = false;
+            stream.next_group_seq = it->first;
+        }
+        
+        for (const auto& block : it->second) {
+            if (block.size() < kBlockHeaderSize) {
+                continue;
+            }
+            
+            size_t length = (static_cast<size_t>(block[0]) << 8) | block[1];
+            uint8_t flags = block[2];
+            if (length == 0) {
+                continue;  // 组内填充块
+            }
+            length = std::min(length, block.size() - kBlockHeaderSize);
+            
+            if (flags & kBlockFlagRecords) {
+                // 合并块只出现在消息之间
+                if (stream.in_message) {
+                    LOG_WARN("Discarding incomplete message of ", stream.partial_message.size(),
+                             " bytes on stream ", stream_id);
+                    stream.partial_message.clear();
+                    stream.in_message = false;
+                }
+                
+                std::vector<std::vector<uint8_t>> records;
+                MessageCoalescer::split(block.data() + kBlockHeaderSize, length, records);
+                for (auto& record : records) {
+                    messages.emplace_back(stream_id, std::move(record));
+                }
+                continue;
+            }
+            
+            if (flags & kBlockFlagStart) {
+                if (stream.in_message) {
+                    LOG_WARN("Discarding incomplete message of ", stream.partial_message.size(),
+                             " bytes on stream ", stream_id);
+                }
+                stream.partial_message.clear();
+                stream.in_message = true;
+            } else if (!stream.in_message) {
+                continue;  // 跳过缺口后的续块，直到下一条消息开始
+            }
+            
+            stream.partial_message.insert(stream.partial_message.end(),
+                                          block.begin() + kBlockHeaderSize,
+                                          block.begin() + kBlockHeaderSize + length);
+            
+            if (flags & kBlockFlagEnd) {
+                messages.emplace_back(stream_id, std::move(stream.partial_message));
+                stream.partial_message.clear();
+                stream.in_message = false;
+            }
+        }
+        
+        stream.decoded_groups.erase(it);
+        ++stream.next_group_seq;
+    }
+    
+    stream.head_blocked_seq = 0;
+}
+
+void MPQUICManager::dispatch_messages(const ReceivedMessages& messages) {
+    if (messages.empty()) {
+        return;
+    }
+    
+    {
+        std::lock_guard<ProfiledMutex> lock(egress_mutex_);
+        for (const auto& [stream_id, message] : messages) {
+            if (!egress_ring_) {
+                break;
+            }
+            
+            // 只在整条消息放得下时写入，消费者不会看到半条消息
+            size_t slot_size = egress_ring_->slot_size();
+            size_t slots = std::max<size_t>(1, (message.size() + slot_size - 1) / slot_size);
+            if (egress_ring_->slot_count() - egress_ring_->size() < slots) {
+                egress_dropped_.fetch_add(1, std::memory_order_relaxed);
+                LOG_WARN("Egress ring full, dropping ", message.size(), " byte message of stream ",
+                         stream_id);
+                continue;
+            }
+            
+            size_t offset = 0;
+            for (size_t i = 0; i < slots; ++i) {
+                size_t chunk = std::min(slot_size, message.size() - offset);
+                uint32_t flags = 0;
+                if (i == 0) flags |= kRingMessageStart;
+                if (i + 1 == slots) flags |= kRingMessageEnd;
+                
+                uint8_t* slot = egress_ring_->try_reserve();
+                std::copy(message.begin() + offset, message.begin() + offset + chunk, slot);
+                egress_ring_->commit(static_cast<uint32_t>(chunk),
+                                     static_cast<uint32_t>(stream_id), flags);
+                offset += chunk;
+            }
+            egress_entries_.fetch_add(slots, std::memory_order_relaxed);
+        }
+    }
+    
+    for (const auto& [stream_id, message] : messages) {
+        if (stream_data_received_callback_) {
+            stream_data_received_callback_(stream_id, message);
+        }
+        if (data_received_callback_) {
+            data_received_callback_(message);
+        }
+    }
+}
+
+void MPQUICManager::attach_ingress_ring(std::shared_ptr<ShmRing> ring) {
+    const size_t payload_per_block = fec_block_size_ - kBlockHeaderSize;
+    if (ring->headroom() < kBlockHeaderSize) {
+        throw std::invalid_argument("Ingress ring needs at least " +
+                                    std::to_string(kBlockHeaderSize) + " bytes of headroom");
+    }
+    if (ring->slot_size() > payload_per_block) {
+        throw std::invalid_argument("Ingress ring slots of " + std::to_string(ring->slot_size()) +
+                                    " bytes exceed the FEC block payload of " +
+                                    std::to_string(payload_per_block) + " bytes");
+    }
+    
+    ingress_ring_ = std::move(ring);
+    ingress_partial_.clear();
+    LOG_INFO("Attached ingress ring: ", ingress_ring_->slot_count(), " slots x ",
+             ingress_ring_->slot_size(), " bytes");
+}
+
+void MPQUICManager::attach_egress_ring(std::shared_ptr<ShmRing> ring) {
+    std::lock_guard<ProfiledMutex> lock(egress_mutex_);
+    egress_ring_ = std::move(ring);
+    LOG_INFO("Attached egress ring: ", egress_ring_->slot_count(), " slots x ",
+             egress_ring_->slot_size(), " bytes");
+}
+
+void MPQUICManager::drain_ingress_ring() {
+    const size_t payload_per_block = fec_block_size_ - kBlockHeaderSize;
+    ShmRingEntry entry;
+    
+    for (size_t n = 0; n < ingress_ring_->slot_count() && ingress_ring_->peek(entry); ++n) {
+        StreamID stream_id = entry.stream_id;
+        
+        // BLOCK策略下队列放不下时停止取出，条目留在环中，生产者由环满感知背压；
+        // 其他策略照常入队，由send_packets按策略丢弃或降冗余
+        size_t reserved = 0;
+        if (fec_enabled_ && stream_id < stream_classes_.size() &&
+            backpressure_policy_ == BackpressurePolicy::BLOCK) {
+            reserved = estimate_queued_bytes(entry.length, stream_id);
+            if (!reserve_send_queue(reserved, false)) {
+                ++ingress_blocked_;
+                break;
+            }
+        }
+        ++ingress_entries_;
+        ingress_bytes_ += entry.length;
+        
+        try {
+            if (stream_id >= stream_classes_.size()) {
+                LOG_WARN("Dropping ingress entry for unknown stream ", stream_id);
+            } else if (entry.length > payload_per_block) {
+                // configure_fec() 缩小了块大小
+                LOG_WARN("Dropping ", entry.length, " byte ingress entry, FEC block payload is ",
+                         payload_per_block, " bytes");
+            } else if (fec_enabled_) {
+                // 块头写在槽位headroom中，块数据就是共享内存中的负载
+                uint8_t* block = entry.data - kBlockHeaderSize;
+                block[0] = static_cast<uint8_t>(entry.length >> 8);
+                block[1] = static_cast<uint8_t>(entry.length & 0xFF);
+                block[2] = 0;
+                block[3] = 0;
+                if (entry.flags & kRingMessageStart) block[2] |= kBlockFlagStart;
+                if (entry.flags & kRingMessageEnd) block[2] |= kBlockFlagEnd;
+                
+                // 环中的消息不经过合并器；新消息开始前先发出该流合并中的消息，保持流内顺序
+                if (entry.flags & kRingMessageStart) {
+                    std::vector<SendPacketMeta> coalesced;
+                    take_coalesced_block(stream_id, coalesced);
+                    send_packets(coalesced);
+                }
+                send_packets(fec_controller_->send_stream_data(
+                    block, kBlockHeaderSize + entry.length, 0, stream_id), &reserved);
+                if (entry.flags & kRingMessageEnd) {
+                    send_packets(fec_controller_->flush_pending_groups(stream_id), &reserved);
+                }
+            } else {
+                auto& partial = ingress_partial_[stream_id];
+                if (entry.flags & kRingMessageStart) {
+                    partial.clear();
+                }
+                partial.insert(partial.end(), entry.data, entry.data + entry.length);
+                if (entry.flags & kRingMessageEnd) {
+                    send_without_fec(partial, stream_id);
+                    partial.clear();
+                }
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR("Failed to send ingress entry of stream ", stream_id, ": ", e.what());
+        }
+        
+        release_send_reservation(reserved);
+        ingress_ring_->release();
+    }
+}
+
+void MPQUICManager::reset_fec_controller() {
+    // 合并中的消息按旧块大小打包，先用旧控制器发出
+    if (fec_controller_) {
+        flush_coalesced_messages(true);
+    }
+    {
+        std::lock_guard<ProfiledMutex> lock(coalesce_mutex_);
+        coalescers_.clear();
+    }
     
-    // 如果启用了FEC，这里应该进行FEC解码
-    // 为简化演示，直接传递数据
-    if (data_received_callback_) {
-        data_received_callback_(data);
+    // 重建前保留已学到的路径状态，新控制器在下面的路径同步中据此预热
+    if (!warm_state_file_.empty()) {
+        fec_controller_->export_warm_start(warm_store_);
     }
+    
+    fec_controller_ = std::make_unique<MPQUICFECController>(fec_k_, fec_m_, fec_block_size_);
+    fec_controller_->initialize();
+    
+    // 按原顺序重新打开，槽位与应用流ID保持一致
+    for (size_t i = 0; i < stream_classes_.size(); ++i) {
+        fec_controller_->open_stream(i, stream_classes_[i]);
+    }
+    
+    {
+        std::lock_guard<ProfiledMutex> lock(recv_mutex_);
+        reassembly_.clear();
+        stream_rx_buffers_.clear();
+    }
+    {
+        // 在途包的包号属于旧控制器；发送序号继续沿用传输层的计数
+        std::lock_guard<ProfiledMutex> lock(send_mutex_);
+        sent_packets_.clear();
+        for (auto& [path_id, queue] : send_queues_) {
+            for (auto& block : queue) {
+                block.packet_number = kUntrackedPacket;
+            }
+        }
+        redundancy_degraded_ = false;
+    }
+    
+    sync_path_states();
 }
 
 void MPQUICManager::sync_path_states() {
@@ -257,11 +1643,23 @@ void MPQUICManager::sync_path_states() {
         state.path_id = path_info.path_id;
         state.rtt_ms = path_info.rtt_ms;
         state.loss_rate = path_info.loss_rate;
-        state.bandwidth_mbps = 100.0;  // 默认值，实际应从QUIC获取
+        // 未知带宽时使用默认值
+        state.bandwidth_mbps = path_info.bandwidth_mbps > 0 ? path_info.bandwidth_mbps : 100.0;
         state.bytes_sent = path_info.bytes_sent;
         state.bytes_acked = path_info.bytes_received;
         
         scheduler_->update_path_state(state);
+        fec_controller_->update_path_state(state);
+        
+        if (!warm_state_file_.empty()) {
+            fec_controller_->set_path_fingerprint(
+                path_info.path_id,
+                path_fingerprint(path_info.local_addr, path_info.local_port, path_info.remote_addr));
+        }
+    }
+    
+    if (!warm_state_file_.empty() && !warm_store_.empty()) {
+        fec_controller_->apply_warm_start(warm_store_);
     }
 }
 
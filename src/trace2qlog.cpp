@@ -0,0 +1,175 @@
+#include "event_trace.hpp"
+#include "fec_frame.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace mpquic_fec;
+
+/**
+ * @brief 二进制事件追踪 → qlog JSON 转换工具
+ *
+ * 用法：
+ *   trace2qlog events.bin [events.qlog]
+ *
+ * 输出 qlog 0.3 JSON（单个trace），可直接载入qvis等可视化工具。
+ * 标准事件映射为 transport:packet_sent / recovery:packet_lost，
+ * FEC相关事件放在自定义的 fec: 类别下
+ */
+
+namespace {
+
+const char* event_name(uint16_t type) {
+    switch (static_cast<TraceEventType>(type)) {
+        case TraceEventType::PACKET_SENT:    return "transport:packet_sent";
+        case TraceEventType::PACKET_ACKED:   return "fec:packet_acked";
+        case TraceEventType::PACKET_LOST:    return "recovery:packet_lost";
+        case TraceEventType::GROUP_DECODED:  return "fec:group_decoded";
+        case TraceEventType::PARAMS_UPDATED: return "fec:parameters_updated";
+        case TraceEventType::PATH_SWITCH:    return "fec:path_switch";
+        default:                             return nullptr;
+    }
+}
+
+void write_group(std::ostream& out, uint64_t group_id) {
+    out << "\"group_id\":" << group_id
+        << ",\"stream_slot\":" << group_stream_slot(group_id)
+        << ",\"group_sequence\":" << group_sequence(group_id);
+}
+
+void write_event_data(std::ostream& out, const TraceRecord& rec) {
+    bool repair = (rec.flags & kTraceRepair) != 0;
+
+    out << "{";
+    switch (static_cast<TraceEventType>(rec.type)) {
+        case TraceEventType::PACKET_SENT:
+            out << "\"header\":{\"packet_type\":\"1RTT\",\"packet_number\":" << rec.value << "}"
+                << ",\"path_id\":" << rec.path_id << ",\"fec\":{";
+            write_group(out, rec.group_id);
+            out << ",\"block_index\":" << static_cast<int>(rec.block_index)
+                << ",\"k\":" << static_cast<int>(rec.k)
+                << ",\"m\":" << static_cast<int>(rec.m)
+                << ",\"repair\":" << (repair ? "true" : "false") << "}";
+            break;
+        case TraceEventType::PACKET_ACKED:
+            out << "\"path_id\":" << rec.path_id << ",\"rtt_us\":" << rec.value << ",";
+            write_group(out, rec.group_id);
+            out << ",\"block_index\":" << static_cast<int>(rec.block_index)
+                << ",\"repair\":" << (repair ? "true" : "false");
+            break;
+        case TraceEventType::PACKET_LOST:
+            out << "\"header\":{\"packet_type\":\"1RTT\",\"packet_number\":" << rec.value << "}"
+                << ",\"path_id\":" << rec.path_id << ",\"fec\":{";
+            write_group(out, rec.group_id);
+            out << ",\"block_index\":" << static_cast<int>(rec.block_index)
+                << ",\"repair\":" << (repair ? "true" : "false") << "}";
+            break;
+        case TraceEventType::GROUP_DECODED:
+            write_group(out, rec.group_id);
+            out << ",\"path_id\":" << rec.path_id
+                << ",\"k\":" << static_cast<int>(rec.k)
+                << ",\"m\":" << static_cast<int>(rec.m)
+                << ",\"recovered_blocks\":" << rec.value;
+            break;
+        case TraceEventType::PARAMS_UPDATED:
+            out << "\"stream_slot\":" << rec.group_id
+                << ",\"k\":" << static_cast<int>(rec.k)
+                << ",\"m\":" << static_cast<int>(rec.m)
+                << ",\"redundancy_rate\":" << rec.value / 1e6;
+            break;
+        case TraceEventType::PATH_SWITCH:
+            out << "\"old_path_id\":" << rec.value << ",\"new_path_id\":" << rec.path_id;
+            break;
+    }
+    out << "}";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " TRACE_FILE [OUTPUT.qlog]\n";
+        return 1;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << argv[1] << "\n";
+        return 1;
+    }
+
+    TraceFileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, EventTracer::kMagic, sizeof(header.magic)) != 0) {
+        std::cerr << argv[1] << " is not an event trace\n";
+        return 1;
+    }
+    if (header.version != EventTracer::kVersion || header.record_size != sizeof(TraceRecord)) {
+        std::cerr << "Unsupported trace version " << header.version
+                  << " (record size " << header.record_size << ")\n";
+        return 1;
+    }
+
+    std::ofstream file_out;
+    if (argc > 2) {
+        file_out.open(argv[2]);
+        if (!file_out) {
+            std::cerr << "Cannot create " << argv[2] << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = argc > 2 ? file_out : std::cout;
+
+    char reference_time[32];
+    std::snprintf(reference_time, sizeof(reference_time), "%.3f", header.start_unix_ns / 1e6);
+    out << "{\"qlog_version\":\"0.3\",\"qlog_format\":\"JSON\","
+        << "\"title\":\"mpquic-fec event trace\","
+        << "\"traces\":[{\"vantage_point\":{\"type\":\"client\"},"
+        << "\"common_fields\":{\"time_format\":\"relative\",\"reference_time\":"
+        << reference_time << "},"
+        << "\"events\":[\n";
+
+    // 多线程缓冲区按批写入，文件内仅大致有序；qlog要求按时间排序
+    std::vector<TraceRecord> records;
+    TraceRecord rec;
+    while (in.read(reinterpret_cast<char*>(&rec), sizeof(rec))) {
+        records.push_back(rec);
+    }
+    std::stable_sort(records.begin(), records.end(),
+                     [](const TraceRecord& a, const TraceRecord& b) {
+                         return a.time_ns < b.time_ns;
+                     });
+
+    size_t written = 0;
+    size_t unknown = 0;
+    for (const auto& r : records) {
+        const char* name = event_name(r.type);
+        if (!name) {
+            ++unknown;
+            continue;
+        }
+        char time_buf[32];
+        std::snprintf(time_buf, sizeof(time_buf), "%.6f", r.time_ns / 1e6);
+        out << (written > 0 ? ",\n" : "") << "{\"time\":" << time_buf
+            << ",\"name\":\"" << name << "\",\"data\":";
+        write_event_data(out, r);
+        out << "}";
+        ++written;
+    }
+
+    out << "\n]}]}\n";
+
+    std::cerr << "Converted " << written << " events";
+    if (unknown > 0) {
+        std::cerr << " (skipped " << unknown << " unknown)";
+    }
+    if (header.record_count != 0 && header.record_count != records.size()) {
+        std::cerr << " (header declares " << header.record_count << " records, file is truncated)";
+    }
+    std::cerr << "\n";
+    return 0;
+}